@@ -0,0 +1,103 @@
+// panlang/src/ast/ast.h
+// Token and Abstract Syntax Tree definitions shared by the C front end and backends
+
+#ifndef PANLANG_AST_H
+#define PANLANG_AST_H
+
+#include <stddef.h>
+#include "../runtime/value.h"
+
+// --- Token Definitions ---
+typedef enum {
+    TOKEN_NUMBER,
+    TOKEN_STRING,
+    TOKEN_IDENTIFIER,
+    TOKEN_ASSIGN,   // =
+    TOKEN_PLUS,     // +
+    TOKEN_MINUS,    // -
+    TOKEN_TIMES,    // *
+    TOKEN_DIVIDE,   // /
+    TOKEN_LPAREN,   // (
+    TOKEN_RPAREN,   // )
+    TOKEN_COMMA,    // ,
+    TOKEN_COLON,    // :
+    TOKEN_NEWLINE,  // \n
+    TOKEN_PRINT,    // darshaya
+    TOKEN_TRUE,     // satya
+    TOKEN_FALSE,    // asatya
+    TOKEN_IMPORT,   // pratibandha
+    TOKEN_ASK,      // prashna
+    TOKEN_WITH,     // saha
+    // Reserved for the standard library's module syntax, which is not parsed yet
+    TOKEN_MODULE,   // modula
+    TOKEN_CLASS,    // varg
+    TOKEN_EXPORT,   // vinirgam
+    TOKEN_DOC,      // lakshana
+    TOKEN_EOF,      // End of File
+    TOKEN_UNKNOWN,  // Unrecognized character (skipped by the lexer)
+    // Add other tokens here as grammar expands (e.g., MODEL_DEF, IF_STMT etc.)
+} TokenType;
+
+// Tokens are slices into the source buffer: no lexeme is ever copied.
+typedef struct {
+    TokenType type;
+    size_t offset; // Byte offset of the lexeme in the source
+    size_t length; // Length of the lexeme in bytes
+    int symbol;    // Interned slot for TOKEN_IDENTIFIER, -1 otherwise
+    int line;
+    int column;
+} Token;
+
+// --- AST Node Definitions (Simplified) ---
+typedef enum {
+    NODE_NUMBER,
+    NODE_STRING,
+    NODE_BOOL,
+    NODE_VAR,
+    NODE_BINOP,
+    NODE_ASSIGN,
+    NODE_PRINT,
+    NODE_CALL,
+    NODE_IMPORT,
+    // Add other node types here as grammar expands
+} NodeType;
+
+typedef struct ASTNode {
+    NodeType type;
+    int line; // Source line of a statement (for the profiler); unset in expressions
+    union {
+        Value number_val; // Int or double
+        Value string_val; // HeapString allocated in the AST arena; text includes the quotes
+        Value bool_val;
+        struct {
+            const char* name; // Interned; owned by the symbol table
+            int slot;
+        } var;
+        struct {
+            struct ASTNode* left;
+            TokenType op;
+            struct ASTNode* right;
+        } bin_op;
+        struct {
+            const char* var_name; // Interned; owned by the symbol table
+            int slot;
+            struct ASTNode* expr;
+        } assign_op;
+        struct {
+            struct ASTNode* expr;
+        } print_stmt;
+        struct {
+            int builtin;             // Index into the runtime's native function registry
+            const char* name;        // Interned; owned by the symbol table
+            struct ASTNode** args;   // Allocated in the AST arena
+            int num_args;
+            int typed;               // Argument types proven to match, so they are not checked at run time
+        } call;
+        struct {
+            const char* path;        // As written, without the quotes; allocated in the AST arena
+            int module;              // Module registry index once resolved, -1 before
+        } import_stmt;
+    } data;
+} ASTNode;
+
+#endif // PANLANG_AST_H
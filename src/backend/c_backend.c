@@ -0,0 +1,382 @@
+// panlang/src/backend/c_backend.c
+// Ahead-of-time backend: emits C for a parsed program and builds a standalone executable
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "c_backend.h"
+#include "../runtime/core_runtime.h"
+
+// Statements per generated function; keeps the C compiler's work per function bounded
+#define C_BACKEND_STATEMENTS_PER_FUNCTION 256
+#define C_BACKEND_OPERAND_SIZE 64
+
+// The grammar has no control flow, so the type of every variable at every
+// statement is known statically. Generated code keeps ints as Values, so int
+// arithmetic runs the value layer's inline int48 fast paths and moves to
+// bigints on overflow exactly as the interpreter does; doubles, bools and
+// strings are unboxed double, int and const char*. Type errors become
+// unconditional panics.
+typedef struct {
+    FILE* out;
+    unsigned char* types;   // Slot -> ValueType + 1 of its current contents, 0 while unassigned
+    int next_temp;          // Temporaries are numbered per statement
+    int terminated;         // Set once an unconditional runtime error has been emitted
+    const char* unsupported; // First built-in call met; compiled programs cannot make them yet
+    const char* unsupported_import; // First import met; modules only run in the interpreter and the VM
+} CEmitter;
+
+// A C expression together with the PanLang type it evaluates to
+typedef struct {
+    char text[C_BACKEND_OPERAND_SIZE];
+    ValueType type;
+} COperand;
+
+// Writes `text` as a C string literal. Non-ASCII and control bytes use octal escapes.
+static void c_backend_write_string_literal(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if (*p == '?') {
+            fputs("\\?", out); // Avoid accidental trigraphs
+        } else if (*p < 0x20 || *p >= 0x7f) {
+            fprintf(out, "\\%03o", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void c_backend_emit_panic(CEmitter* e, const char* message) {
+    fputs("        core_runtime_panic(", e->out);
+    c_backend_write_string_literal(e->out, message);
+    fputs(");\n", e->out);
+    e->terminated = 1;
+}
+
+// An int literal as a Value expression, written so that INT64_MIN stays valid
+// C. Bigints are rebuilt from their limbs into a temporary.
+static void c_backend_emit_int(CEmitter* e, Value value, COperand* operand) {
+    operand->type = VALUE_TYPE_INT;
+    if (value_is_bigint(value)) {
+        const HeapBigInt* big = value_as_bigint(value);
+        int temp = e->next_temp++;
+        fprintf(e->out, "        static const uint64_t t%d_limbs[] = {", temp);
+        for (size_t i = 0; i < big->length; i++) {
+            fprintf(e->out, "%sUINT64_C(0x%llx)", i ? (i % 4 ? ", " : ",\n            ") : "",
+                    (unsigned long long)big->limbs[i]);
+        }
+        fprintf(e->out, "};\n        const Value t%d = value_from_limbs(%d, t%d_limbs, %zu);\n",
+                temp, big->negative, temp, big->length);
+        snprintf(operand->text, C_BACKEND_OPERAND_SIZE, "t%d", temp);
+        return;
+    }
+    int64_t i = value_as_int64(value);
+    const char* box = value_is_small_int(value) ? "value_from_small_int" : "value_from_int64";
+    if (i == INT64_MIN) {
+        snprintf(operand->text, C_BACKEND_OPERAND_SIZE, "%s(-INT64_MAX - 1)", box);
+    } else if (i < 0) {
+        snprintf(operand->text, C_BACKEND_OPERAND_SIZE, "%s(-INT64_C(%lld))", box, -(long long)i);
+    } else {
+        snprintf(operand->text, C_BACKEND_OPERAND_SIZE, "%s(INT64_C(%lld))", box, (long long)i);
+    }
+}
+
+// Hexadecimal float literals round-trip exactly; folding can produce inf and nan
+static void c_backend_format_double(char* operand, double value) {
+    if (isnan(value)) {
+        snprintf(operand, C_BACKEND_OPERAND_SIZE, "NAN");
+    } else if (isinf(value)) {
+        snprintf(operand, C_BACKEND_OPERAND_SIZE, value < 0 ? "(-INFINITY)" : "INFINITY");
+    } else {
+        snprintf(operand, C_BACKEND_OPERAND_SIZE, "(%a)", value);
+    }
+}
+
+// The C array holding slots of each type
+static const char* c_backend_slot_array(ValueType type) {
+    switch (type) {
+        case VALUE_TYPE_DOUBLE: return "panlang_doubles";
+        case VALUE_TYPE_BOOL: return "panlang_bools";
+        case VALUE_TYPE_STRING: return "panlang_strings";
+        default: return "panlang_ints";
+    }
+}
+
+static const char* c_backend_c_type(ValueType type) {
+    switch (type) {
+        case VALUE_TYPE_DOUBLE: return "double";
+        case VALUE_TYPE_BOOL: return "int";
+        case VALUE_TYPE_STRING: return "const char*";
+        default: return "Value";
+    }
+}
+
+// Emits the statements needed to evaluate `node` and writes the C operand
+// holding its value to `operand`. Every binary operation gets its own
+// temporary so evaluation order (and therefore which error fires first)
+// matches the interpreter exactly.
+static void c_backend_emit_expression(CEmitter* e, ASTNode* node, COperand* operand) {
+    char message[512];
+    switch (node->type) {
+        case NODE_NUMBER:
+            if (value_is_int(node->data.number_val)) {
+                c_backend_emit_int(e, node->data.number_val, operand);
+            } else {
+                c_backend_format_double(operand->text, value_as_double(node->data.number_val));
+                operand->type = VALUE_TYPE_DOUBLE;
+            }
+            return;
+        case NODE_STRING: {
+            int temp = e->next_temp++;
+            fprintf(e->out, "        const char* t%d = ", temp);
+            c_backend_write_string_literal(e->out, value_string_chars(node->data.string_val));
+            fputs(";\n", e->out);
+            snprintf(operand->text, C_BACKEND_OPERAND_SIZE, "t%d", temp);
+            operand->type = VALUE_TYPE_STRING;
+            return;
+        }
+        case NODE_BOOL:
+            snprintf(operand->text, C_BACKEND_OPERAND_SIZE, "%d", value_as_bool(node->data.bool_val));
+            operand->type = VALUE_TYPE_BOOL;
+            return;
+        case NODE_VAR: {
+            int slot = node->data.var.slot;
+            if (!e->types[slot]) {
+                snprintf(message, sizeof(message), "Name Error: Variable '%s' not found.", node->data.var.name);
+                c_backend_emit_panic(e, message);
+                return;
+            }
+            operand->type = (ValueType)(e->types[slot] - 1);
+            snprintf(operand->text, C_BACKEND_OPERAND_SIZE, "%s[%d]", c_backend_slot_array(operand->type), slot);
+            return;
+        }
+        case NODE_BINOP: {
+            COperand left;
+            COperand right;
+            c_backend_emit_expression(e, node->data.bin_op.left, &left);
+            if (e->terminated) return;
+            c_backend_emit_expression(e, node->data.bin_op.right, &right);
+            if (e->terminated) return;
+            ValueOp op;
+            switch (node->data.bin_op.op) {
+                case TOKEN_PLUS: op = VALUE_OP_ADD; break;
+                case TOKEN_MINUS: op = VALUE_OP_SUB; break;
+                case TOKEN_TIMES: op = VALUE_OP_MUL; break;
+                case TOKEN_DIVIDE: op = VALUE_OP_DIV; break;
+                default:
+                    c_backend_emit_panic(e, "Runtime Error: Unknown binary operator.");
+                    return;
+            }
+            int type = value_arith_type(left.type, right.type);
+            if (type < 0) {
+                snprintf(message, sizeof(message), "Type Error: Unsupported operand types for '%s': '%s' and '%s'.",
+                         value_op_symbol(op), value_type_name(left.type), value_type_name(right.type));
+                c_backend_emit_panic(e, message);
+                return;
+            }
+            int temp = e->next_temp++;
+            fprintf(e->out, "        const %s t%d = ", c_backend_c_type((ValueType)type), temp);
+            if (type == VALUE_TYPE_INT) {
+                static const char* const functions[] = {"value_add", "value_sub", "value_mul", "value_div"};
+                fprintf(e->out, "%s(%s, %s);\n", functions[op], left.text, right.text);
+            } else {
+                const char* cast_left = left.type == VALUE_TYPE_INT ? "value_number_as_double" : "";
+                const char* cast_right = right.type == VALUE_TYPE_INT ? "value_number_as_double" : "";
+                if (op == VALUE_OP_DIV) {
+                    fprintf(e->out, "panlang_fdiv(%s(%s), %s(%s));\n", cast_left, left.text, cast_right, right.text);
+                } else {
+                    fprintf(e->out, "%s(%s) %s %s(%s);\n", cast_left, left.text, value_op_symbol(op), cast_right,
+                            right.text);
+                }
+            }
+            snprintf(operand->text, C_BACKEND_OPERAND_SIZE, "t%d", temp);
+            operand->type = (ValueType)type;
+            return;
+        }
+        case NODE_CALL:
+            // Built-ins work on boxed Values (tensors), which the generated code does not have
+            e->unsupported = node->data.call.name;
+            e->terminated = 1;
+            return;
+        default:
+            c_backend_emit_panic(e, "Runtime Error: Unexpected node type in expression evaluation.");
+            return;
+    }
+}
+
+static void c_backend_emit_statement(CEmitter* e, ASTNode* node) {
+    COperand operand;
+    if (!node) return;
+    e->next_temp = 0;
+    fputs("    {\n", e->out);
+    switch (node->type) {
+        case NODE_ASSIGN: {
+            int slot = node->data.assign_op.slot;
+            c_backend_emit_expression(e, node->data.assign_op.expr, &operand);
+            if (e->terminated) break;
+            fprintf(e->out, "        %s[%d] = %s;\n", c_backend_slot_array(operand.type), slot, operand.text);
+            e->types[slot] = (unsigned char)(operand.type + 1);
+            break;
+        }
+        case NODE_PRINT:
+            c_backend_emit_expression(e, node->data.print_stmt.expr, &operand);
+            if (e->terminated) break;
+            switch (operand.type) {
+                case VALUE_TYPE_INT: fprintf(e->out, "        value_print(%s);\n", operand.text); break;
+                case VALUE_TYPE_DOUBLE: fprintf(e->out, "        core_runtime_print_double(%s);\n", operand.text); break;
+                case VALUE_TYPE_BOOL: fprintf(e->out, "        core_runtime_print_bool(%s);\n", operand.text); break;
+                case VALUE_TYPE_STRING: fprintf(e->out, "        core_runtime_print_string(%s);\n", operand.text); break;
+                case VALUE_TYPE_TENSOR: // Only built-in calls produce tensors and futures
+                case VALUE_TYPE_FUTURE: break;
+            }
+            break;
+        case NODE_CALL:
+            c_backend_emit_expression(e, node, &operand); // Reports the unsupported built-in
+            break;
+        case NODE_IMPORT:
+            e->unsupported_import = node->data.import_stmt.path;
+            e->terminated = 1;
+            break;
+        default:
+            c_backend_emit_panic(e, "Runtime Error: Unexpected statement type.");
+            break;
+    }
+    fputs("    }\n", e->out);
+}
+
+int c_backend_emit_program(FILE* out, ASTNode** statements, int num_statements, int num_slots) {
+    CEmitter e;
+    e.out = out;
+    e.types = (unsigned char*)core_runtime_calloc(MEMORY_CODEGEN, num_slots ? num_slots : 1, 1);
+    if (!e.types) { fprintf(stderr, "Memory allocation failed for C backend.\n"); return 1; }
+    e.next_temp = 0;
+    e.terminated = 0;
+    e.unsupported = NULL;
+    e.unsupported_import = NULL;
+
+    fputs("/* Generated by `panlang build`. Do not edit. */\n"
+          "#include <math.h>\n"
+          "#include <stdint.h>\n"
+          "#include \"core_runtime.h\"\n\n", out);
+    int slots = num_slots ? num_slots : 1;
+    fprintf(out, "static Value panlang_ints[%d];\n", slots);
+    fprintf(out, "static double panlang_doubles[%d];\n", slots);
+    fprintf(out, "static int panlang_bools[%d];\n", slots);
+    fprintf(out, "static const char* panlang_strings[%d];\n\n", slots);
+    fputs("static double panlang_fdiv(double left, double right) {\n"
+          "    if (right == 0.0) core_runtime_panic(\"Runtime Error: Division by zero.\");\n"
+          "    return left / right;\n"
+          "}\n", out);
+
+    int num_functions = 0;
+    for (int i = 0; i < num_statements && !e.terminated; i++) {
+        if (i % C_BACKEND_STATEMENTS_PER_FUNCTION == 0) {
+            if (i > 0) fputs("}\n", out);
+            fprintf(out, "\nstatic void panlang_block_%d(void) {\n", num_functions++);
+        }
+        c_backend_emit_statement(&e, statements[i]);
+    }
+    if (num_functions > 0) fputs("}\n", out);
+
+    fputs("\nint main(void) {\n", out);
+    for (int i = 0; i < num_functions; i++) {
+        fprintf(out, "    panlang_block_%d();\n", i);
+    }
+    fputs("    return 0;\n}\n", out);
+
+    core_runtime_free(e.types);
+    if (e.unsupported) {
+        fprintf(stderr, "C Backend Error: built-in function '%s' is not supported in compiled programs yet.\n",
+                e.unsupported);
+        return 2;
+    }
+    if (e.unsupported_import) {
+        fprintf(stderr, "C Backend Error: imports (pratibandha \"%s\") are not supported in compiled programs yet.\n",
+                e.unsupported_import);
+        return 2;
+    }
+    return ferror(out) ? 1 : 0;
+}
+
+// Runs `argv` as a child process and waits for it. Returns its exit status.
+static int c_backend_run(char* const argv[]) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("Error starting C compiler");
+        return 1;
+    }
+    if (pid == 0) {
+        execvp(argv[0], argv);
+        fprintf(stderr, "Error: could not run C compiler '%s': %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            perror("Error waiting for C compiler");
+            return 1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+int c_backend_build_executable(ASTNode** statements, int num_statements, int num_slots,
+                               const char* output_path, const char* runtime_dir, int keep_c) {
+    size_t path_size = strlen(output_path) + 3;
+    char* c_path = (char*)core_runtime_alloc(MEMORY_CODEGEN, path_size);
+    size_t runtime_size = strlen(runtime_dir) + sizeof("/core_runtime.c");
+    char* runtime_source = (char*)core_runtime_alloc(MEMORY_CODEGEN, runtime_size);
+    char* include_flag = (char*)core_runtime_alloc(MEMORY_CODEGEN, strlen(runtime_dir) + 3);
+    if (!c_path || !runtime_source || !include_flag) {
+        fprintf(stderr, "Memory allocation failed for C backend paths.\n");
+        core_runtime_free(c_path); core_runtime_free(runtime_source); core_runtime_free(include_flag);
+        return 1;
+    }
+    snprintf(c_path, path_size, "%s.c", output_path);
+    snprintf(runtime_source, runtime_size, "%s/core_runtime.c", runtime_dir);
+    sprintf(include_flag, "-I%s", runtime_dir);
+
+    int status = 1;
+    FILE* out = fopen(c_path, "w");
+    if (!out) {
+        perror("Error creating generated C file");
+        goto cleanup;
+    }
+    int emit_status = c_backend_emit_program(out, statements, num_statements, num_slots);
+    if (emit_status == 2) { // Already reported
+        fclose(out);
+        remove(c_path);
+        goto cleanup;
+    }
+    if (fclose(out) != 0 || emit_status != 0) {
+        fprintf(stderr, "Error: could not write generated C file %s.\n", c_path);
+        goto cleanup;
+    }
+
+    const char* cc = getenv("CC");
+    if (!cc || !*cc) cc = "cc";
+    // -pthread is for the runtime's thread pool and -lm for its pow()
+    char* const argv[] = {(char*)cc, "-O2", "-pthread", include_flag, "-o", (char*)output_path,
+                          c_path, runtime_source, "-lm", NULL};
+    status = c_backend_run(argv);
+    if (status != 0) {
+        fprintf(stderr, "Error: C compiler exited with status %d (generated source kept at %s).\n", status, c_path);
+        keep_c = 1;
+    }
+    if (!keep_c) remove(c_path);
+
+cleanup:
+    core_runtime_free(c_path);
+    core_runtime_free(runtime_source);
+    core_runtime_free(include_flag);
+    return status;
+}
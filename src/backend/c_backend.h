@@ -0,0 +1,23 @@
+// panlang/src/backend/c_backend.h
+// Ahead-of-time backend: translates a program to C and links it against the core runtime
+
+#ifndef PANLANG_C_BACKEND_H
+#define PANLANG_C_BACKEND_H
+
+#include <stdio.h>
+#include "../ast/ast.h"
+
+// Writes a standalone C translation of the program to `out`. The generated
+// code only depends on src/runtime/core_runtime.h. Returns 0 on success, 1 if
+// writing failed and 2 if the program uses a construct the backend cannot
+// compile (built-in calls), which is reported on stderr.
+int c_backend_emit_program(FILE* out, ASTNode** statements, int num_statements, int num_slots);
+
+// Translates the program to C next to `output_path` (as `<output_path>.c`),
+// compiles it with $CC (default `cc`) together with core_runtime.c from
+// `runtime_dir`, and removes the C file unless `keep_c` is set.
+// Returns 0 on success.
+int c_backend_build_executable(ASTNode** statements, int num_statements, int num_slots,
+                               const char* output_path, const char* runtime_dir, int keep_c);
+
+#endif // PANLANG_C_BACKEND_H
@@ -1,30 +1,506 @@
 // panlang/src/backend/llvm_backend.c
-// Placeholder for LLVM code generation backend
+// LLVM code generation backend: lowers the AST to LLVM IR and runs it through ORC LLJIT
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-// Include LLVM headers here (e.g., #include <llvm-c/Core.h>)
-// Note: Actual LLVM C API usage is complex and would require LLVM development libraries.
-
-// Forward declaration of a simplified AST node for demonstration
-// In a real scenario, this would include the full AST definitions from main.c or its headers.
-typedef struct ASTNode ASTNode; // Declared in main.c
-
-// Function to generate LLVM IR from the Abstract Syntax Tree
-void llvm_backend_generate_code(ASTNode* ast) {
-    // This function would traverse the AST and emit LLVM Intermediate Representation (IR).
-    // For example:
-    // LLVMModuleRef module = LLVMModuleCreateWithName("panlang_module");
-    // LLVMBuilderRef builder = LLVMCreateBuilder();
-    // ... logic to create functions, variables, basic blocks, and instructions ...
-    // LLVMDumpModule(module); // To print the generated IR
-    // LLVMDisposeBuilder(builder);
-    // LLVMDisposeModule(module);
-
-    printf("LLVM Backend: Initializing LLVM code generation (mock).\n");
-    if (ast != NULL) {
-        printf("LLVM Backend: Processing AST root (mock)....\n");
-        // Recursive calls to generate code for child nodes
-    }
-    printf("LLVM Backend: LLVM IR generation complete (mock).\n");
+#include <string.h>
+
+#include <llvm-c/Analysis.h>
+#include <llvm-c/Core.h>
+#include <llvm-c/Error.h>
+#include <llvm-c/LLJIT.h>
+#include <llvm-c/Orc.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+
+#include "llvm_backend.h"
+#include "../runtime/core_runtime.h"
+
+// State shared while lowering one program. The grammar has no control flow,
+// so the type of every variable at every statement is known statically. Ints
+// stay Value words in an i64, so int arithmetic inlines value.h's int48 fast
+// path and calls value_arith for boxed ints and results that overflow it;
+// doubles, bools (0 or 1 in an i64) and strings are unboxed.
+typedef struct {
+    LLVMContextRef context;
+    LLVMModuleRef module;
+    LLVMBuilderRef builder;
+    LLVMValueRef function;       // panlang_main
+    LLVMTypeRef int_type;        // i64: int Values and bools
+    LLVMTypeRef double_type;
+    LLVMTypeRef string_type;     // i8*
+    LLVMTypeRef print_int_type;  // value_print
+    LLVMValueRef print_int_fn;
+    LLVMTypeRef arith_type;      // value_arith
+    LLVMValueRef arith_fn;
+    LLVMTypeRef to_double_type;  // value_int_to_double
+    LLVMValueRef to_double_fn;
+    LLVMTypeRef mul_overflow_type; // llvm.smul.with.overflow.i64
+    LLVMValueRef mul_overflow_fn;
+    LLVMTypeRef print_double_type;
+    LLVMValueRef print_double_fn;
+    LLVMTypeRef print_bool_type;
+    LLVMValueRef print_bool_fn;
+    LLVMTypeRef print_string_type;
+    LLVMValueRef print_string_fn;
+    LLVMTypeRef panic_type;
+    LLVMValueRef panic_fn;
+    LLVMValueRef* slots;         // Slot * 3 + {int, double, string} -> alloca
+    unsigned char* types;        // Slot -> ValueType + 1 of its current contents, 0 while unassigned
+    int terminated;              // Set once an unconditional runtime error has been emitted
+    const char* unsupported;     // First built-in call met; the JIT cannot make them yet
+    const char* unsupported_import; // First import met; modules only run in the interpreter and the VM
+} CodegenState;
+
+// Reports an LLVM error and releases it. Returns 1 if there was an error.
+static int llvm_backend_check(LLVMErrorRef error, const char* what) {
+    if (!error) return 0;
+    char* message = LLVMGetErrorMessage(error);
+    fprintf(stderr, "LLVM Backend Error: %s: %s\n", what, message);
+    LLVMDisposeErrorMessage(message);
+    return 1;
+}
+
+// Emits a call to core_runtime_panic; the current block ends in `unreachable`
+static void codegen_emit_panic(CodegenState* cg, const char* message) {
+    LLVMValueRef text = LLVMBuildGlobalStringPtr(cg->builder, message, "panic_msg");
+    LLVMBuildCall2(cg->builder, cg->panic_type, cg->panic_fn, &text, 1, "");
+    LLVMBuildUnreachable(cg->builder);
+}
+
+// Unconditional runtime error: nothing after it can execute
+static LLVMValueRef codegen_fail(CodegenState* cg, const char* message) {
+    codegen_emit_panic(cg, message);
+    cg->terminated = 1;
+    // Continue emitting into a dead block so callers need no special casing
+    LLVMBasicBlockRef dead = LLVMAppendBasicBlockInContext(cg->context, cg->function, "dead");
+    LLVMPositionBuilderAtEnd(cg->builder, dead);
+    return LLVMConstInt(cg->int_type, 0, 0);
+}
+
+// Branches to a panic when `failed` holds and continues in a fresh block otherwise
+static void codegen_check(CodegenState* cg, LLVMValueRef failed, const char* message) {
+    LLVMBasicBlockRef fail = LLVMAppendBasicBlockInContext(cg->context, cg->function, "check_failed");
+    LLVMBasicBlockRef ok = LLVMAppendBasicBlockInContext(cg->context, cg->function, "check_ok");
+    LLVMBuildCondBr(cg->builder, failed, fail, ok);
+    LLVMPositionBuilderAtEnd(cg->builder, fail);
+    codegen_emit_panic(cg, message);
+    LLVMPositionBuilderAtEnd(cg->builder, ok);
+}
+
+static LLVMValueRef codegen_slot(CodegenState* cg, int slot, ValueType type) {
+    int index = type == VALUE_TYPE_DOUBLE ? 1 : type == VALUE_TYPE_STRING ? 2 : 0;
+    return cg->slots[slot * 3 + index];
+}
+
+static LLVMTypeRef codegen_llvm_type(CodegenState* cg, ValueType type) {
+    return type == VALUE_TYPE_DOUBLE ? cg->double_type : type == VALUE_TYPE_STRING ? cg->string_type : cg->int_type;
+}
+
+// Whether an int Value is a small int, and its sign-extended payload
+static LLVMValueRef codegen_is_small_int(CodegenState* cg, LLVMValueRef value) {
+    LLVMValueRef tag = LLVMBuildLShr(cg->builder, value, LLVMConstInt(cg->int_type, 48, 0), "tag");
+    return LLVMBuildICmp(cg->builder, LLVMIntEQ, tag, LLVMConstInt(cg->int_type, VALUE_TAG_INT >> 48, 0), "is_small");
+}
+
+static LLVMValueRef codegen_small_int(CodegenState* cg, LLVMValueRef value) {
+    LLVMValueRef sixteen = LLVMConstInt(cg->int_type, 16, 0);
+    return LLVMBuildAShr(cg->builder, LLVMBuildShl(cg->builder, value, sixteen, ""), sixteen, "small");
+}
+
+// Joins a fast and a slow path that both end in branches to `done`
+static LLVMValueRef codegen_join(CodegenState* cg, LLVMTypeRef type, LLVMValueRef fast_value,
+                                 LLVMBasicBlockRef fast, LLVMValueRef slow_value, LLVMBasicBlockRef slow) {
+    LLVMValueRef phi = LLVMBuildPhi(cg->builder, type, "join");
+    LLVMValueRef values[2] = {fast_value, slow_value};
+    LLVMBasicBlockRef blocks[2] = {fast, slow};
+    LLVMAddIncoming(phi, values, blocks, 2);
+    return phi;
+}
+
+// An int Value as a double: small ints convert inline, boxed ones in the runtime
+static LLVMValueRef codegen_int_to_double(CodegenState* cg, LLVMValueRef value) {
+    LLVMBasicBlockRef fast = LLVMAppendBasicBlockInContext(cg->context, cg->function, "to_double_fast");
+    LLVMBasicBlockRef slow = LLVMAppendBasicBlockInContext(cg->context, cg->function, "to_double_slow");
+    LLVMBasicBlockRef done = LLVMAppendBasicBlockInContext(cg->context, cg->function, "to_double_done");
+    LLVMBuildCondBr(cg->builder, codegen_is_small_int(cg, value), fast, slow);
+    LLVMPositionBuilderAtEnd(cg->builder, fast);
+    LLVMValueRef fast_value = LLVMBuildSIToFP(cg->builder, codegen_small_int(cg, value), cg->double_type, "to_double");
+    LLVMBuildBr(cg->builder, done);
+    LLVMPositionBuilderAtEnd(cg->builder, slow);
+    LLVMValueRef slow_value = LLVMBuildCall2(cg->builder, cg->to_double_type, cg->to_double_fn, &value, 1, "to_double");
+    LLVMBuildBr(cg->builder, done);
+    LLVMPositionBuilderAtEnd(cg->builder, done);
+    return codegen_join(cg, cg->double_type, fast_value, fast, slow_value, slow);
+}
+
+// Int arithmetic on Values, as value_add and friends do it: two small ints
+// are computed inline (int48 operands cannot overflow an i64 sum, and
+// products use the overflow intrinsic), and results that still fit 48 bits
+// are re-tagged. Everything else, including division by zero, goes through
+// value_arith, which promotes to bigints or reports the error.
+static LLVMValueRef codegen_int_arith(CodegenState* cg, ValueOp op, LLVMValueRef left, LLVMValueRef right) {
+    LLVMBuilderRef builder = cg->builder;
+    LLVMBasicBlockRef fast = LLVMAppendBasicBlockInContext(cg->context, cg->function, "int_fast");
+    LLVMBasicBlockRef slow = LLVMAppendBasicBlockInContext(cg->context, cg->function, "int_slow");
+    LLVMBasicBlockRef done = LLVMAppendBasicBlockInContext(cg->context, cg->function, "int_done");
+    LLVMValueRef both_small = LLVMBuildAnd(builder, codegen_is_small_int(cg, left), codegen_is_small_int(cg, right),
+                                           "both_small");
+    LLVMBuildCondBr(builder, both_small, fast, slow);
+
+    LLVMPositionBuilderAtEnd(builder, fast);
+    LLVMValueRef x = codegen_small_int(cg, left);
+    LLVMValueRef y = codegen_small_int(cg, right);
+    LLVMValueRef result = NULL;
+    LLVMValueRef ok = NULL;
+    switch (op) {
+        case VALUE_OP_ADD: result = LLVMBuildAdd(builder, x, y, "add"); break;
+        case VALUE_OP_SUB: result = LLVMBuildSub(builder, x, y, "sub"); break;
+        case VALUE_OP_MUL: {
+            LLVMValueRef operands[2] = {x, y};
+            LLVMValueRef pair = LLVMBuildCall2(builder, cg->mul_overflow_type, cg->mul_overflow_fn, operands, 2, "mul");
+            result = LLVMBuildExtractValue(builder, pair, 0, "product");
+            ok = LLVMBuildNot(builder, LLVMBuildExtractValue(builder, pair, 1, "overflow"), "no_overflow");
+            break;
+        }
+        case VALUE_OP_DIV: {
+            // int48 / -1 cannot trap in i64; a zero divisor is left to value_arith
+            ok = LLVMBuildICmp(builder, LLVMIntNE, y, LLVMConstInt(cg->int_type, 0, 0), "nonzero");
+            LLVMValueRef divisor = LLVMBuildSelect(builder, ok, y, LLVMConstInt(cg->int_type, 1, 0), "divisor");
+            result = LLVMBuildSDiv(builder, x, divisor, "div");
+            break;
+        }
+    }
+    LLVMValueRef fits = LLVMBuildICmp(builder, LLVMIntEQ, codegen_small_int(cg, result), result, "fits");
+    ok = ok ? LLVMBuildAnd(builder, ok, fits, "ok") : fits;
+    LLVMValueRef payload = LLVMBuildAnd(builder, result, LLVMConstInt(cg->int_type, VALUE_PAYLOAD_MASK, 0), "payload");
+    LLVMValueRef fast_value = LLVMBuildOr(builder, payload, LLVMConstInt(cg->int_type, VALUE_TAG_INT, 0), "boxed");
+    LLVMBuildCondBr(builder, ok, done, slow);
+
+    LLVMPositionBuilderAtEnd(builder, slow);
+    LLVMValueRef args[3] = {LLVMConstInt(LLVMInt32TypeInContext(cg->context), (unsigned long long)op, 0), left, right};
+    LLVMValueRef slow_value = LLVMBuildCall2(builder, cg->arith_type, cg->arith_fn, args, 3, "value_arith");
+    LLVMBuildBr(builder, done);
+
+    LLVMPositionBuilderAtEnd(builder, done);
+    return codegen_join(cg, cg->int_type, fast_value, fast, slow_value, slow);
+}
+
+static LLVMValueRef codegen_arith(CodegenState* cg, ValueOp op, ValueType type, LLVMValueRef left, LLVMValueRef right) {
+    if (type == VALUE_TYPE_INT) return codegen_int_arith(cg, op, left, right);
+    switch (op) {
+        case VALUE_OP_ADD: return LLVMBuildFAdd(cg->builder, left, right, "fadd");
+        case VALUE_OP_SUB: return LLVMBuildFSub(cg->builder, left, right, "fsub");
+        case VALUE_OP_MUL: return LLVMBuildFMul(cg->builder, left, right, "fmul");
+        case VALUE_OP_DIV:
+            codegen_check(cg, LLVMBuildFCmp(cg->builder, LLVMRealOEQ, right, LLVMConstReal(cg->double_type, 0.0), "is_zero"),
+                          "Runtime Error: Division by zero.");
+            return LLVMBuildFDiv(cg->builder, left, right, "fdiv");
+    }
+    return left;
+}
+
+static LLVMValueRef codegen_expression(CodegenState* cg, ASTNode* node, ValueType* type) {
+    char message[512];
+    *type = VALUE_TYPE_INT;
+    switch (node->type) {
+        case NODE_NUMBER:
+            if (value_is_int(node->data.number_val)) {
+                // Boxed literals live on the session heap, which outlives the JIT-ed code
+                return LLVMConstInt(cg->int_type, node->data.number_val, 0);
+            }
+            *type = VALUE_TYPE_DOUBLE;
+            return LLVMConstReal(cg->double_type, value_as_double(node->data.number_val));
+        case NODE_STRING:
+            *type = VALUE_TYPE_STRING;
+            return LLVMBuildGlobalStringPtr(cg->builder, value_string_chars(node->data.string_val), "str");
+        case NODE_BOOL:
+            *type = VALUE_TYPE_BOOL;
+            return LLVMConstInt(cg->int_type, (unsigned long long)value_as_bool(node->data.bool_val), 0);
+        case NODE_VAR: {
+            int slot = node->data.var.slot;
+            if (!cg->types[slot]) {
+                snprintf(message, sizeof(message), "Name Error: Variable '%s' not found.", node->data.var.name);
+                return codegen_fail(cg, message);
+            }
+            *type = (ValueType)(cg->types[slot] - 1);
+            return LLVMBuildLoad2(cg->builder, codegen_llvm_type(cg, *type), codegen_slot(cg, slot, *type),
+                                  node->data.var.name);
+        }
+        case NODE_BINOP: {
+            ValueType left_type, right_type;
+            LLVMValueRef left = codegen_expression(cg, node->data.bin_op.left, &left_type);
+            if (cg->terminated) return left;
+            LLVMValueRef right = codegen_expression(cg, node->data.bin_op.right, &right_type);
+            if (cg->terminated) return right;
+            ValueOp op;
+            switch (node->data.bin_op.op) {
+                case TOKEN_PLUS: op = VALUE_OP_ADD; break;
+                case TOKEN_MINUS: op = VALUE_OP_SUB; break;
+                case TOKEN_TIMES: op = VALUE_OP_MUL; break;
+                case TOKEN_DIVIDE: op = VALUE_OP_DIV; break;
+                default:
+                    return codegen_fail(cg, "Runtime Error: Unknown binary operator.");
+            }
+            int result_type = value_arith_type(left_type, right_type);
+            if (result_type < 0) {
+                snprintf(message, sizeof(message), "Type Error: Unsupported operand types for '%s': '%s' and '%s'.",
+                         value_op_symbol(op), value_type_name(left_type), value_type_name(right_type));
+                return codegen_fail(cg, message);
+            }
+            *type = (ValueType)result_type;
+            if (result_type == VALUE_TYPE_DOUBLE) {
+                if (left_type == VALUE_TYPE_INT) left = codegen_int_to_double(cg, left);
+                if (right_type == VALUE_TYPE_INT) right = codegen_int_to_double(cg, right);
+            }
+            return codegen_arith(cg, op, *type, left, right);
+        }
+        case NODE_CALL:
+            // Built-ins work on boxed Values (tensors), which the generated code does not have
+            cg->unsupported = node->data.call.name;
+            return codegen_fail(cg, "Runtime Error: Unsupported built-in call.");
+        default:
+            return codegen_fail(cg, "Runtime Error: Unexpected node type in expression evaluation.");
+    }
+}
+
+static void codegen_statement(CodegenState* cg, ASTNode* node) {
+    ValueType type;
+    if (!node) return;
+    switch (node->type) {
+        case NODE_ASSIGN: {
+            int slot = node->data.assign_op.slot;
+            LLVMValueRef value = codegen_expression(cg, node->data.assign_op.expr, &type);
+            if (cg->terminated) return;
+            LLVMBuildStore(cg->builder, value, codegen_slot(cg, slot, type));
+            cg->types[slot] = (unsigned char)(type + 1);
+            break;
+        }
+        case NODE_PRINT: {
+            LLVMValueRef value = codegen_expression(cg, node->data.print_stmt.expr, &type);
+            if (cg->terminated) return;
+            switch (type) {
+                case VALUE_TYPE_INT:
+                    LLVMBuildCall2(cg->builder, cg->print_int_type, cg->print_int_fn, &value, 1, "");
+                    break;
+                case VALUE_TYPE_DOUBLE:
+                    LLVMBuildCall2(cg->builder, cg->print_double_type, cg->print_double_fn, &value, 1, "");
+                    break;
+                case VALUE_TYPE_BOOL:
+                    value = LLVMBuildTrunc(cg->builder, value, LLVMInt32TypeInContext(cg->context), "bool");
+                    LLVMBuildCall2(cg->builder, cg->print_bool_type, cg->print_bool_fn, &value, 1, "");
+                    break;
+                case VALUE_TYPE_STRING:
+                    LLVMBuildCall2(cg->builder, cg->print_string_type, cg->print_string_fn, &value, 1, "");
+                    break;
+                case VALUE_TYPE_TENSOR: // Only built-in calls produce tensors and futures
+                case VALUE_TYPE_FUTURE:
+                    break;
+            }
+            break;
+        }
+        case NODE_CALL:
+            codegen_expression(cg, node, &type); // Reports the unsupported built-in
+            break;
+        case NODE_IMPORT:
+            cg->unsupported_import = node->data.import_stmt.path;
+            codegen_fail(cg, "Runtime Error: Unsupported import.");
+            break;
+        default:
+            codegen_fail(cg, "Runtime Error: Unexpected statement type.");
+            break;
+    }
+}
+
+// Builds `void panlang_main(void)` for the whole program
+static void codegen_program(CodegenState* cg, ASTNode** statements, int num_statements, int num_slots) {
+    LLVMTypeRef void_type = LLVMVoidTypeInContext(cg->context);
+    LLVMTypeRef i32_type = LLVMInt32TypeInContext(cg->context);
+
+    cg->print_int_type = LLVMFunctionType(void_type, &cg->int_type, 1, 0);
+    cg->print_int_fn = LLVMAddFunction(cg->module, "value_print", cg->print_int_type);
+    LLVMTypeRef arith_params[3] = {i32_type, cg->int_type, cg->int_type};
+    cg->arith_type = LLVMFunctionType(cg->int_type, arith_params, 3, 0);
+    cg->arith_fn = LLVMAddFunction(cg->module, "value_arith", cg->arith_type);
+    cg->to_double_type = LLVMFunctionType(cg->double_type, &cg->int_type, 1, 0);
+    cg->to_double_fn = LLVMAddFunction(cg->module, "value_int_to_double", cg->to_double_type);
+    unsigned mul_overflow = LLVMLookupIntrinsicID("llvm.smul.with.overflow", strlen("llvm.smul.with.overflow"));
+    cg->mul_overflow_type = LLVMIntrinsicGetType(cg->context, mul_overflow, &cg->int_type, 1);
+    cg->mul_overflow_fn = LLVMGetIntrinsicDeclaration(cg->module, mul_overflow, &cg->int_type, 1);
+    cg->print_double_type = LLVMFunctionType(void_type, &cg->double_type, 1, 0);
+    cg->print_double_fn = LLVMAddFunction(cg->module, "core_runtime_print_double", cg->print_double_type);
+    cg->print_bool_type = LLVMFunctionType(void_type, &i32_type, 1, 0);
+    cg->print_bool_fn = LLVMAddFunction(cg->module, "core_runtime_print_bool", cg->print_bool_type);
+    cg->print_string_type = LLVMFunctionType(void_type, &cg->string_type, 1, 0);
+    cg->print_string_fn = LLVMAddFunction(cg->module, "core_runtime_print_string", cg->print_string_type);
+    cg->panic_type = LLVMFunctionType(void_type, &cg->string_type, 1, 0);
+    cg->panic_fn = LLVMAddFunction(cg->module, "core_runtime_panic", cg->panic_type);
+    LLVMAddAttributeAtIndex(cg->panic_fn, LLVMAttributeFunctionIndex,
+                            LLVMCreateEnumAttribute(cg->context, LLVMGetEnumAttributeKindForName("noreturn", 8), 0));
+    LLVMAddAttributeAtIndex(cg->panic_fn, LLVMAttributeFunctionIndex,
+                            LLVMCreateEnumAttribute(cg->context, LLVMGetEnumAttributeKindForName("cold", 4), 0));
+
+    cg->function = LLVMAddFunction(cg->module, "panlang_main", LLVMFunctionType(void_type, NULL, 0, 0));
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(cg->context, cg->function, "entry");
+    LLVMPositionBuilderAtEnd(cg->builder, entry);
+
+    // One stack slot per variable and type; mem2reg/SROA turns the used ones into SSA values
+    cg->slots = (LLVMValueRef*)core_runtime_calloc(MEMORY_CODEGEN, num_slots ? num_slots * 3 : 1,
+                                                   sizeof(LLVMValueRef));
+    cg->types = (unsigned char*)core_runtime_calloc(MEMORY_CODEGEN, num_slots ? num_slots : 1, 1);
+    if (!cg->slots || !cg->types) { fprintf(stderr, "Memory allocation failed for LLVM slots.\n"); exit(1); }
+    for (int i = 0; i < num_slots; i++) {
+        cg->slots[i * 3] = LLVMBuildAlloca(cg->builder, cg->int_type, "slot");
+        cg->slots[i * 3 + 1] = LLVMBuildAlloca(cg->builder, cg->double_type, "slot_f");
+        cg->slots[i * 3 + 2] = LLVMBuildAlloca(cg->builder, cg->string_type, "slot_s");
+    }
+
+    for (int i = 0; i < num_statements && !cg->terminated; i++) {
+        codegen_statement(cg, statements[i]);
+    }
+    if (cg->terminated) {
+        LLVMBuildUnreachable(cg->builder); // Terminates the trailing dead block
+    } else {
+        LLVMBuildRetVoid(cg->builder);
+    }
+}
+
+// Registers the runtime entry points the JIT-ed code may call
+static LLVMErrorRef llvm_backend_define_runtime_symbols(LLVMOrcLLJITRef jit) {
+    struct { const char* name; void* address; } runtime_symbols[] = {
+        {"value_print", (void*)&value_print},
+        {"value_arith", (void*)&value_arith},
+        {"value_int_to_double", (void*)&value_int_to_double},
+        {"core_runtime_print_double", (void*)&core_runtime_print_double},
+        {"core_runtime_print_bool", (void*)&core_runtime_print_bool},
+        {"core_runtime_print_string", (void*)&core_runtime_print_string},
+        {"core_runtime_panic", (void*)&core_runtime_panic},
+    };
+    enum { NUM_RUNTIME_SYMBOLS = sizeof(runtime_symbols) / sizeof(runtime_symbols[0]) };
+    LLVMJITCSymbolMapPair pairs[NUM_RUNTIME_SYMBOLS];
+    for (int i = 0; i < NUM_RUNTIME_SYMBOLS; i++) {
+        pairs[i].Name = LLVMOrcLLJITMangleAndIntern(jit, runtime_symbols[i].name);
+        pairs[i].Sym.Address = (LLVMOrcJITTargetAddress)(uintptr_t)runtime_symbols[i].address;
+        pairs[i].Sym.Flags.GenericFlags = LLVMJITSymbolGenericFlagsExported | LLVMJITSymbolGenericFlagsCallable;
+        pairs[i].Sym.Flags.TargetFlags = 0;
+    }
+    LLVMOrcMaterializationUnitRef unit = LLVMOrcAbsoluteSymbols(pairs, NUM_RUNTIME_SYMBOLS);
+    return LLVMOrcJITDylibDefine(LLVMOrcLLJITGetMainJITDylib(jit), unit);
+}
+
+int llvm_backend_generate_code(ASTNode** statements, int num_statements, int num_slots,
+                               int opt_level, int dump_ir) {
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+
+    // Target machine for the host, used for the data layout and the optimizer
+    char* triple = LLVMGetDefaultTargetTriple();
+    char* cpu = LLVMGetHostCPUName();
+    char* features = LLVMGetHostCPUFeatures();
+    LLVMTargetRef target;
+    char* error_message = NULL;
+    if (LLVMGetTargetFromTriple(triple, &target, &error_message)) {
+        fprintf(stderr, "LLVM Backend Error: %s\n", error_message);
+        LLVMDisposeMessage(error_message);
+        LLVMDisposeMessage(triple);
+        LLVMDisposeMessage(cpu);
+        LLVMDisposeMessage(features);
+        return 1;
+    }
+    LLVMCodeGenOptLevel codegen_level = opt_level <= 0 ? LLVMCodeGenLevelNone
+                                      : opt_level == 1 ? LLVMCodeGenLevelLess
+                                      : opt_level == 2 ? LLVMCodeGenLevelDefault
+                                      : LLVMCodeGenLevelAggressive;
+    LLVMTargetMachineRef machine = LLVMCreateTargetMachine(target, triple, cpu, features, codegen_level,
+                                                           LLVMRelocDefault, LLVMCodeModelJITDefault);
+
+    LLVMOrcThreadSafeContextRef ts_context = LLVMOrcCreateNewThreadSafeContext();
+    CodegenState cg;
+    memset(&cg, 0, sizeof(cg));
+    cg.context = LLVMOrcThreadSafeContextGetContext(ts_context);
+    cg.module = LLVMModuleCreateWithNameInContext("panlang_module", cg.context);
+    cg.builder = LLVMCreateBuilderInContext(cg.context);
+    cg.int_type = LLVMInt64TypeInContext(cg.context);
+    cg.double_type = LLVMDoubleTypeInContext(cg.context);
+    cg.string_type = LLVMPointerType(LLVMInt8TypeInContext(cg.context), 0);
+    LLVMSetTarget(cg.module, triple);
+    LLVMTargetDataRef data_layout = LLVMCreateTargetDataLayout(machine);
+    LLVMSetModuleDataLayout(cg.module, data_layout);
+    LLVMDisposeTargetData(data_layout);
+
+    codegen_program(&cg, statements, num_statements, num_slots);
+    LLVMDisposeBuilder(cg.builder);
+    core_runtime_free(cg.slots);
+    core_runtime_free(cg.types);
+
+    int status = 1;
+    if (cg.unsupported) {
+        fprintf(stderr, "LLVM Backend Error: built-in function '%s' is not supported by the JIT yet; "
+                "run without --llvm.\n", cg.unsupported);
+        LLVMDisposeModule(cg.module);
+        goto cleanup_context;
+    }
+    if (cg.unsupported_import) {
+        fprintf(stderr, "LLVM Backend Error: imports (pratibandha \"%s\") are not supported by the JIT yet; "
+                "run without --llvm.\n", cg.unsupported_import);
+        LLVMDisposeModule(cg.module);
+        goto cleanup_context;
+    }
+    if (LLVMVerifyModule(cg.module, LLVMPrintMessageAction, NULL)) {
+        fprintf(stderr, "LLVM Backend Error: generated module failed verification.\n");
+        LLVMDisposeModule(cg.module);
+        goto cleanup_context;
+    }
+
+    char pipeline[16];
+    snprintf(pipeline, sizeof(pipeline), "default<O%d>", opt_level < 0 ? 0 : opt_level > 3 ? 3 : opt_level);
+    LLVMPassBuilderOptionsRef pass_options = LLVMCreatePassBuilderOptions();
+    LLVMErrorRef error = LLVMRunPasses(cg.module, pipeline, machine, pass_options);
+    LLVMDisposePassBuilderOptions(pass_options);
+    if (llvm_backend_check(error, "optimization failed")) {
+        LLVMDisposeModule(cg.module);
+        goto cleanup_context;
+    }
+
+    if (dump_ir) {
+        char* ir = LLVMPrintModuleToString(cg.module);
+        printf("\n--- Optimized LLVM IR (%s) ---\n%s", pipeline, ir);
+        LLVMDisposeMessage(ir);
+    }
+
+    LLVMOrcLLJITRef jit;
+    if (llvm_backend_check(LLVMOrcCreateLLJIT(&jit, NULL), "could not create JIT")) {
+        LLVMDisposeModule(cg.module);
+        goto cleanup_context;
+    }
+    if (!llvm_backend_check(llvm_backend_define_runtime_symbols(jit), "could not register runtime symbols")) {
+        // The JIT takes ownership of the module
+        LLVMOrcThreadSafeModuleRef ts_module = LLVMOrcCreateNewThreadSafeModule(cg.module, ts_context);
+        if (llvm_backend_check(LLVMOrcLLJITAddLLVMIRModule(jit, LLVMOrcLLJITGetMainJITDylib(jit), ts_module),
+                               "could not add module")) {
+            LLVMOrcDisposeThreadSafeModule(ts_module);
+        } else {
+            LLVMOrcJITTargetAddress entry_address = 0;
+            if (!llvm_backend_check(LLVMOrcLLJITLookup(jit, &entry_address, "panlang_main"),
+                                    "could not find panlang_main")) {
+                printf("\n--- Execution Results ---\n");
+                void (*panlang_main)(void) = (void (*)(void))(uintptr_t)entry_address;
+                panlang_main();
+                status = 0;
+            }
+        }
+    } else {
+        LLVMDisposeModule(cg.module);
+    }
+    llvm_backend_check(LLVMOrcDisposeLLJIT(jit), "could not dispose JIT");
+
+cleanup_context:
+    LLVMOrcDisposeThreadSafeContext(ts_context);
+    LLVMDisposeTargetMachine(machine);
+    LLVMDisposeMessage(triple);
+    LLVMDisposeMessage(cpu);
+    LLVMDisposeMessage(features);
+    return status;
 }
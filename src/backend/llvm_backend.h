@@ -0,0 +1,16 @@
+// panlang/src/backend/llvm_backend.h
+// LLVM code generation backend (built only when PANLANG_WITH_LLVM is defined)
+
+#ifndef PANLANG_LLVM_BACKEND_H
+#define PANLANG_LLVM_BACKEND_H
+
+#include "../ast/ast.h"
+
+// Lowers a parsed program to LLVM IR, optimizes it at `opt_level` (0-3) and
+// runs it through the in-process JIT. `num_slots` is the number of symbol
+// slots referenced by the program. When `dump_ir` is set, the optimized IR is
+// printed to stdout before execution. Returns 0 on success.
+int llvm_backend_generate_code(ASTNode** statements, int num_statements, int num_slots,
+                               int opt_level, int dump_ir);
+
+#endif // PANLANG_LLVM_BACKEND_H
@@ -0,0 +1,465 @@
+// panlang/src/bench/panlang_bench.c
+// Benchmark driver: generates synthetic .pan workloads and measures the lexer,
+// parser, optimizer and evaluator phase by phase, reporting JSON on stdout.
+//
+// Build (from the repository root):
+//   gcc -O2 -pthread -o bin/panlang-bench src/bench/panlang_bench.c src/backend/c_backend.c src/runtime/core_runtime.c -lm
+//
+// The engine is compiled into this translation unit so the benchmark calls
+// exactly the functions the interpreter runs, with no extra indirection.
+
+#define PANLANG_NO_MAIN
+#include "../main.c"
+
+#include <stdint.h>
+#include <time.h>
+
+// --- Allocation counting ---
+// glibc exports its allocator under __libc_* names, so the benchmark can
+// interpose malloc and friends and count every call the engine makes, on
+// any thread (large files are parsed on the pool).
+static _Atomic unsigned long long bench_allocations = 0;
+
+#ifdef __GLIBC__
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+void* malloc(size_t size) { bench_allocations++; return __libc_malloc(size); }
+void* calloc(size_t count, size_t size) { bench_allocations++; return __libc_calloc(count, size); }
+void* realloc(void* ptr, size_t size) { bench_allocations++; return __libc_realloc(ptr, size); }
+void free(void* ptr) { __libc_free(ptr); }
+#define BENCH_COUNTS_ALLOCATIONS 1
+#else
+#define BENCH_COUNTS_ALLOCATIONS 0
+#endif
+
+// --- Measurement ---
+typedef struct {
+    const char* name;
+    double seconds;                  // Best time over all iterations
+    long long tokens;
+    long long nodes;
+    long long statements;
+    long long allocations;           // Allocator calls in one iteration (-1 if unavailable)
+    long peak_rss_kb;                // Highest RSS while the phase ran (-1 if unavailable)
+} PhaseResult;
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// The process's RSS high-water mark only grows, so it would report the
+// largest phase so far for every later one. Linux resets it to the current
+// RSS when "5" is written to /proc/self/clear_refs; bench_peak_rss_begin does
+// that before each iteration and returns 0 where it is not supported.
+static int bench_peak_rss_begin(void) {
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd < 0) return 0;
+    int ok = write(fd, "5", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+// VmHWM from /proc/self/status, in kilobytes, or -1
+static long bench_peak_rss_kb(void) {
+    FILE* status = fopen("/proc/self/status", "r");
+    if (!status) return -1;
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof(line), status)) {
+        if (sscanf(line, "VmHWM: %ld kB", &kb) == 1) break;
+    }
+    fclose(status);
+    return kb;
+}
+
+static void phase_begin(PhaseResult* phase, const char* name) {
+    memset(phase, 0, sizeof(*phase));
+    phase->name = name;
+    phase->seconds = -1.0;
+    phase->allocations = -1;
+    phase->peak_rss_kb = -1;
+}
+
+// Records one iteration, started after bench_peak_rss_begin returned
+// `rss_reset`; only the fastest time and the highest peak are kept
+static void phase_record(PhaseResult* phase, double seconds, unsigned long long allocations, int rss_reset) {
+    if (phase->seconds < 0 || seconds < phase->seconds) phase->seconds = seconds;
+    phase->allocations = BENCH_COUNTS_ALLOCATIONS ? (long long)allocations : -1;
+    long peak = rss_reset ? bench_peak_rss_kb() : -1;
+    if (peak > phase->peak_rss_kb) phase->peak_rss_kb = peak;
+}
+
+long long count_ast_nodes(ASTNode* node) {
+    if (!node) return 0;
+    switch (node->type) {
+        case NODE_BINOP:
+            return 1 + count_ast_nodes(node->data.bin_op.left) + count_ast_nodes(node->data.bin_op.right);
+        case NODE_ASSIGN:
+            return 1 + count_ast_nodes(node->data.assign_op.expr);
+        case NODE_PRINT:
+            return 1 + count_ast_nodes(node->data.print_stmt.expr);
+        case NODE_CALL: {
+            long long count = 1;
+            for (int i = 0; i < node->data.call.num_args; i++) count += count_ast_nodes(node->data.call.args[i]);
+            return count;
+        }
+        default:
+            return 1;
+    }
+}
+
+// Shortest time a rate is reported for. clock_getres gives 1 ns on Linux, but
+// reading the clock costs tens of nanoseconds, so shorter phases are noise.
+#define BENCH_MIN_RATE_SECONDS 1e-6
+
+static double bench_resolution(void) {
+    struct timespec ts;
+    double resolution = 0.0;
+    if (clock_getres(CLOCK_MONOTONIC, &ts) == 0) resolution = (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+    return resolution > BENCH_MIN_RATE_SECONDS ? resolution : BENCH_MIN_RATE_SECONDS;
+}
+
+// Writes count/seconds, or null when the phase was too fast to time
+static void print_rate_json(long long count, double seconds) {
+    static double resolution = 0.0;
+    if (resolution == 0.0) resolution = bench_resolution();
+    if (seconds < resolution) printf("null");
+    else printf("%.1f", (double)count / seconds);
+}
+
+// A phase with no completed iteration (evaluation that failed) has null times
+static void print_phase_json(const PhaseResult* phase, int last) {
+    printf("    \"%s\": {\"seconds\": ", phase->name);
+    if (phase->seconds < 0) printf("null");
+    else printf("%.6f", phase->seconds);
+    printf(", \"tokens\": %lld, \"tokens_per_sec\": ", phase->tokens);
+    print_rate_json(phase->tokens, phase->seconds);
+    printf(", \"nodes\": %lld, \"nodes_per_sec\": ", phase->nodes);
+    print_rate_json(phase->nodes, phase->seconds);
+    printf(", \"statements\": %lld, \"statements_per_sec\": ", phase->statements);
+    print_rate_json(phase->statements, phase->seconds);
+    printf(", \"allocations\": %lld, \"peak_rss_kb\": %ld}%s\n", phase->allocations, phase->peak_rss_kb,
+           last ? "" : ",");
+}
+
+// Writes a JSON string literal; file names are the only free-form text in the report
+static void print_json_string(const char* text) {
+    putchar('"');
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') printf("\\%c", *p);
+        else if (*p < 0x20) printf("\\u%04x", *p);
+        else putchar(*p);
+    }
+    putchar('"');
+}
+
+// --- Benchmark run ---
+typedef struct {
+    ASTNode** statements;
+    int num_statements;
+    int use_vm;
+} BenchProgram;
+
+// One evaluation of the program, as a SessionBody
+static void bench_evaluate(Session* session, void* context) {
+    const BenchProgram* program = (const BenchProgram*)context;
+    if (program->use_vm) {
+        vm_run(session, &session->bytecode, 0);
+    } else {
+        for (int i = 0; i < program->num_statements; i++) execute_statement(session, program->statements[i]);
+    }
+    core_runtime_output_flush();
+}
+
+int run_benchmark(const char* file_path, int iterations, int opt_level, int use_vm) {
+    size_t length = 0;
+    const char* code = map_source_file(file_path, &length);
+    if (code == NULL) return 1;
+
+    PhaseResult lex, parse, optimize, evaluate;
+    phase_begin(&lex, "lex");
+    phase_begin(&parse, "parse");
+    phase_begin(&optimize, "optimize");
+    phase_begin(&evaluate, "evaluate");
+
+    // Lexing alone. The symbol table is reset every iteration so interning is always measured cold.
+    Session session;
+    session_init(&session, NULL);
+    for (int it = 0; it < iterations; it++) {
+        symbol_table_free(&session.symbols);
+        int rss_reset = bench_peak_rss_begin();
+        unsigned long long allocs = bench_allocations;
+        double start = bench_now();
+        Lexer lexer;
+        lexer_init(&lexer, code, length, &session.symbols);
+        long long tokens = 0;
+        while (lexer_get_next_token(&lexer).type != TOKEN_EOF) tokens++;
+        phase_record(&lex, bench_now() - start, bench_allocations - allocs, rss_reset);
+        lex.tokens = tokens;
+    }
+
+    // Parsing (which drives the lexer itself, on every pool thread for large files), then
+    // optimization of each fresh tree.
+    // The tree from the last iteration is kept for the evaluator.
+    Arena* arena = &session.arena;
+    ASTNode** program_ast = NULL;
+    int num_statements = 0;
+    for (int it = 0; it < iterations; it++) {
+        arena_free(arena);
+        symbol_table_free(&session.symbols);
+        int rss_reset = bench_peak_rss_begin();
+        unsigned long long allocs = bench_allocations;
+        double start = bench_now();
+        program_ast = parse_source(code, length, &session.symbols, arena, &num_statements);
+        phase_record(&parse, bench_now() - start, bench_allocations - allocs, rss_reset);
+        parse.tokens = lex.tokens;
+        parse.statements = num_statements;
+        parse.nodes = 0;
+        for (int i = 0; i < num_statements; i++) parse.nodes += count_ast_nodes(program_ast[i]);
+
+        rss_reset = bench_peak_rss_begin();
+        allocs = bench_allocations;
+        start = bench_now();
+        program_ast = optimize_statements(program_ast, &num_statements, arena, &session.symbols, opt_level, 0);
+        double elapsed = bench_now() - start;
+        phase_record(&optimize, elapsed, bench_allocations - allocs, rss_reset);
+        optimize.statements = num_statements;
+        optimize.nodes = 0;
+        for (int i = 0; i < num_statements; i++) optimize.nodes += count_ast_nodes(program_ast[i]);
+    }
+
+    // Evaluation. Program output goes to /dev/null so terminal speed does not skew the numbers.
+    // Each iteration runs under the session's trap, so a runtime error ends the
+    // measurement and is reported in the JSON instead of exiting.
+    Bytecode* bytecode = &session.bytecode;
+    if (use_vm) bytecode_compile_program(bytecode, program_ast, num_statements);
+    BenchProgram program = {program_ast, num_statements, use_vm};
+    int failed = 0;
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    for (int it = 0; it < iterations && !failed; it++) {
+        int rss_reset = bench_peak_rss_begin();
+        unsigned long long allocs = bench_allocations;
+        double start = bench_now();
+        failed = session_protect(&session, bench_evaluate, &program) != 0;
+        if (!failed) phase_record(&evaluate, bench_now() - start, bench_allocations - allocs, rss_reset);
+    }
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    close(devnull);
+    evaluate.statements = num_statements;
+    evaluate.nodes = optimize.nodes;
+
+    printf("{\n  \"file\": ");
+    print_json_string(file_path);
+    printf(",\n  \"bytes\": %zu,\n  \"iterations\": %d,\n  \"opt_level\": %d,\n  \"engine\": \"%s\",\n",
+           length, iterations, opt_level, use_vm ? "vm" : "tree");
+    printf("  \"error\": ");
+    if (failed) print_json_string(session.error);
+    else printf("null");
+    printf(",\n");
+    printf("  \"arena_bytes\": %zu,\n  \"arena_chunks\": %d,\n  \"phases\": {\n",
+           arena->bytes_used, arena->num_chunks);
+    print_phase_json(&lex, 0);
+    print_phase_json(&parse, 0);
+    print_phase_json(&optimize, 0);
+    print_phase_json(&evaluate, 1);
+    printf("  }\n}\n");
+
+    session_free(&session);
+    value_heap_release();
+    unmap_source_file(code, length);
+    return failed;
+}
+
+// --- Workload generator ---
+typedef struct {
+    unsigned long long size;  // Target output size in bytes
+    int depth;                // Maximum expression nesting depth
+    int num_vars;             // Distinct variables assigned and read
+    double string_density;    // Fraction of statements that print string literals
+    uint64_t seed;
+} GeneratorOptions;
+
+// xorshift64*: deterministic for a given seed on every platform
+static uint64_t generator_state;
+
+static uint64_t generator_next(void) {
+    generator_state ^= generator_state >> 12;
+    generator_state ^= generator_state << 25;
+    generator_state ^= generator_state >> 27;
+    return generator_state * 0x2545F4914F6CDD1DULL;
+}
+
+static int generator_range(int n) {
+    return (int)(generator_next() % (uint64_t)n);
+}
+
+static double generator_unit(void) {
+    return (double)(generator_next() >> 11) / 9007199254740992.0;
+}
+
+// Writes an expression of at most `depth` nested operators. Divisors are always
+// non-zero literals and every variable is assigned in the prologue, so generated
+// programs run to completion on every engine.
+static void generate_expression(FILE* out, const GeneratorOptions* options, int depth) {
+    if (depth == 0 || generator_range(4) == 0) {
+        if (generator_range(2) == 0) fprintf(out, "v%d", generator_range(options->num_vars));
+        else fprintf(out, "%d", 1 + generator_range(99));
+        return;
+    }
+    static const char ops[] = {'+', '-', '*', '/'};
+    char op = ops[generator_range(4)];
+    fputc('(', out);
+    generate_expression(out, options, depth - 1);
+    fprintf(out, " %c ", op);
+    if (op == '/') fprintf(out, "%d", 1 + generator_range(9));
+    else generate_expression(out, options, depth - 1);
+    fputc(')', out);
+}
+
+static void generate_string(FILE* out) {
+    static const char* words[] = {"namaste", "ganita", "sankhya", "shabda", "vakya", "phalam", "jnana", "data"};
+    int count = 1 + generator_range(6);
+    fputs("darshaya(\"", out);
+    for (int i = 0; i < count; i++) {
+        if (i > 0) fputc(' ', out);
+        fputs(words[generator_range(8)], out);
+    }
+    fputs("\")\n", out);
+}
+
+int generate_workload(const char* output_path, const GeneratorOptions* options) {
+    FILE* out = fopen(output_path, "w");
+    if (!out) {
+        perror("Error creating workload file");
+        return 1;
+    }
+    generator_state = options->seed ? options->seed : 1;
+    fprintf(out, "# Synthetic PanLang workload: size=%llu depth=%d vars=%d string_density=%.3f seed=%llu\n",
+            options->size, options->depth, options->num_vars, options->string_density,
+            (unsigned long long)options->seed);
+    for (int i = 0; i < options->num_vars; i++) {
+        fprintf(out, "v%d = %d\n", i, 1 + generator_range(99));
+    }
+    while ((unsigned long long)ftell(out) < options->size) {
+        if (generator_unit() < options->string_density) {
+            generate_string(out);
+        } else if (generator_range(10) == 0) {
+            fputs("darshaya(", out);
+            generate_expression(out, options, options->depth);
+            fputs(")\n", out);
+        } else {
+            // Ints are exact, so each assignment is reduced modulo 1000 to keep
+            // the variables from growing into bigints statement after statement
+            int var = generator_range(options->num_vars);
+            fprintf(out, "v%d = ", var);
+            generate_expression(out, options, options->depth);
+            fprintf(out, "\nv%d = v%d - v%d / 1000 * 1000\n", var, var, var);
+        }
+    }
+    if (fclose(out) != 0) {
+        perror("Error writing workload file");
+        return 1;
+    }
+    return 0;
+}
+
+// Parses sizes such as 4096, 64K, 10M or 1G
+static int parse_size(const char* text, unsigned long long* size) {
+    char* end = NULL;
+    double value = strtod(text, &end);
+    if (end == text || value < 0) return 0;
+    switch (*end) {
+        case '\0': break;
+        case 'k': case 'K': value *= 1024.0; end++; break;
+        case 'm': case 'M': value *= 1024.0 * 1024.0; end++; break;
+        case 'g': case 'G': value *= 1024.0 * 1024.0 * 1024.0; end++; break;
+        default: return 0;
+    }
+    if (*end != '\0') return 0;
+    *size = (unsigned long long)value;
+    return 1;
+}
+
+// --- Command line ---
+static void print_bench_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-O0|-O1|-O2] [--vm] [--iterations N] file.pan\n", program);
+    fprintf(stderr, "       %s generate [--size N[K|M|G]] [--depth N] [--vars N]\n", program);
+    fprintf(stderr, "              [--string-density F] [--seed N] -o output.pan\n");
+    fprintf(stderr, "  Measures lex, parse, optimize and evaluate separately and prints JSON\n");
+    fprintf(stderr, "  (best time of N iterations; allocations and peak RSS per phase).\n");
+    fprintf(stderr, "  generate writes a synthetic program (defaults: 1M, depth 3, 64 vars,\n");
+    fprintf(stderr, "  string density 0.1, seed 1).\n");
+}
+
+static int generate_command(int argc, char* argv[]) {
+    GeneratorOptions options = {1024 * 1024, 3, 64, 0.1, 1};
+    const char* output_path = NULL;
+    for (int i = 2; i < argc; i++) {
+        int has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--size") == 0 && has_value) {
+            if (!parse_size(argv[++i], &options.size)) { print_bench_usage(argv[0]); return 1; }
+        } else if (strcmp(argv[i], "--depth") == 0 && has_value) {
+            options.depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--vars") == 0 && has_value) {
+            options.num_vars = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--string-density") == 0 && has_value) {
+            options.string_density = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0 && has_value) {
+            output_path = argv[++i];
+        } else {
+            print_bench_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!output_path || options.depth < 0 || options.num_vars < 1 ||
+        options.string_density < 0.0 || options.string_density > 1.0) {
+        print_bench_usage(argv[0]);
+        return 1;
+    }
+    return generate_workload(output_path, &options);
+}
+
+int main(int argc, char* argv[]) {
+    builtins_bind();
+    if (argc >= 2 && strcmp(argv[1], "generate") == 0) {
+        return generate_command(argc, argv);
+    }
+
+    int iterations = 1;
+    int opt_level = 1; // The interpreter's default
+    int use_vm = 0;
+    const char* file_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            print_bench_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "--vm") == 0) {
+            use_vm = 1;
+        } else if (strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '2' && argv[i][3] == '\0') {
+            opt_level = argv[i][2] - '0';
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (argv[i][0] == '-' || file_path != NULL) {
+            print_bench_usage(argv[0]);
+            return 1;
+        } else {
+            file_path = argv[i];
+        }
+    }
+    if (file_path == NULL || iterations < 1) {
+        print_bench_usage(argv[0]);
+        return 1;
+    }
+    return run_benchmark(file_path, iterations, opt_level, use_vm);
+}
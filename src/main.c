@@ -2,93 +2,188 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h> // For isspace, isdigit, isalpha
+#include <errno.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <fcntl.h>    // For open
+#include <sys/mman.h> // For mmap, munmap
+#include <sys/stat.h> // For fstat
+#include <time.h>     // For clock_gettime
+#include <unistd.h>   // For close, read
 
-// --- Token Definitions ---
-typedef enum {
-    TOKEN_NUMBER,
-    TOKEN_STRING,
-    TOKEN_IDENTIFIER,
-    TOKEN_ASSIGN,   // =
-    TOKEN_PLUS,     // +
-    TOKEN_MINUS,    // -
-    TOKEN_TIMES,    // *
-    TOKEN_DIVIDE,   // /
-    TOKEN_LPAREN,   // (
-    TOKEN_RPAREN,   // )
-    TOKEN_COMMA,    // ,
-    TOKEN_COLON,    // :
-    TOKEN_NEWLINE,  // \n
-    TOKEN_PRINT,    // darshaya
-    TOKEN_EOF,      // End of File
-    // Add other tokens here as grammar expands (e.g., MODEL_DEF, IF_STMT etc.)
-} TokenType;
+#include "ast/ast.h"
+#include "backend/c_backend.h"
+#include "backend/llvm_backend.h"
+#include "runtime/core_runtime.h"
+
+// --- Errors ---
+// Every error the engine finds (syntax, names, imports, memory) and every
+// runtime error goes through core_runtime_panic, which ends the process
+// unless a trap is set. session_run sets one, so a failed run returns its
+// message to the caller instead (see the Sessions section below).
+_Noreturn void raise_error(const char* format, ...) {
+    char message[RUNTIME_ERROR_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    core_runtime_panic(message);
+}
+
+// --- Arena Allocator ---
+// All AST nodes and their string payloads for one compilation are bump-allocated
+// from an arena, so nodes sit contiguously in parse order and the whole tree is
+// released in a single arena_free call.
+#define ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 16
+
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t capacity;
+    size_t used;
+    _Alignas(ARENA_ALIGNMENT) char data[];
+} ArenaChunk;
 
 typedef struct {
-    TokenType type;
-    char* value;
-    int line;
-    int column;
-} Token;
+    ArenaChunk* head;      // Chunk currently being filled
+    size_t chunk_size;     // Default capacity of new chunks
+    size_t bytes_used;     // Bytes handed out, including alignment padding
+    size_t bytes_reserved; // Bytes obtained from malloc for chunk payloads
+    int num_chunks;
+    MemoryTag tag;         // What the chunks are counted as
+} Arena;
 
-// --- AST Node Definitions (Simplified) ---
-typedef enum {
-    NODE_NUMBER,
-    NODE_STRING,
-    NODE_VAR,
-    NODE_BINOP,
-    NODE_ASSIGN,
-    NODE_PRINT,
-    // Add other node types here as grammar expands
-} NodeType;
-
-typedef struct ASTNode {
-    NodeType type;
-    union {
-        int number_val;
-        char* string_val;
-        char* var_name;
-        struct {
-            struct ASTNode* left;
-            TokenType op;
-            struct ASTNode* right;
-        } bin_op;
-        struct {
-            char* var_name;
-            struct ASTNode* expr;
-        } assign_op;
-        struct {
-            struct ASTNode* expr;
-        } print_stmt;
-    } data;
-} ASTNode;
+void arena_init(Arena* arena, size_t chunk_size, MemoryTag tag) {
+    arena->head = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : ARENA_DEFAULT_CHUNK_SIZE;
+    arena->bytes_used = 0;
+    arena->bytes_reserved = 0;
+    arena->num_chunks = 0;
+    arena->tag = tag;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    ArenaChunk* chunk = arena->head;
+    if (!chunk || chunk->capacity - chunk->used < size) {
+        size_t capacity = size > arena->chunk_size ? size : arena->chunk_size;
+        chunk = (ArenaChunk*)core_runtime_alloc(arena->tag, sizeof(ArenaChunk) + capacity);
+        if (!chunk) raise_error("Memory allocation failed for arena chunk.");
+        chunk->next = arena->head;
+        chunk->capacity = capacity;
+        chunk->used = 0;
+        arena->head = chunk;
+        arena->bytes_reserved += capacity;
+        arena->num_chunks++;
+    }
+    void* ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->bytes_used += size;
+    return ptr;
+}
+
+// Copies `length` bytes of `text` into the arena as a NUL-terminated string
+char* arena_copy_string(Arena* arena, const char* text, size_t length) {
+    char* copy = (char*)arena_alloc(arena, length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// Whether `ptr` points into memory handed out by the arena
+int arena_contains(const Arena* arena, const void* ptr) {
+    for (const ArenaChunk* chunk = arena->head; chunk; chunk = chunk->next) {
+        if ((const char*)ptr >= chunk->data && (const char*)ptr < chunk->data + chunk->used) return 1;
+    }
+    return 0;
+}
+
+// Moves every chunk of `other` into `arena` and leaves `other` empty. New
+// allocations keep going to the arena's own newest chunk.
+void arena_adopt(Arena* arena, Arena* other) {
+    if (!other->head) return;
+    ArenaChunk* last = other->head;
+    while (last->next) last = last->next;
+    if (arena->head) {
+        last->next = arena->head->next;
+        arena->head->next = other->head;
+    } else {
+        arena->head = other->head;
+    }
+    arena->bytes_used += other->bytes_used;
+    arena->bytes_reserved += other->bytes_reserved;
+    arena->num_chunks += other->num_chunks;
+    arena_init(other, other->chunk_size, other->tag);
+}
+
+// Releases everything allocated so far but keeps the newest chunk for reuse
+void arena_reset(Arena* arena) {
+    ArenaChunk* chunk = arena->head;
+    if (!chunk) return;
+    ArenaChunk* older = chunk->next;
+    while (older) {
+        ArenaChunk* next = older->next;
+        arena->bytes_reserved -= older->capacity;
+        arena->num_chunks--;
+        core_runtime_free(older);
+        older = next;
+    }
+    chunk->next = NULL;
+    chunk->used = 0;
+    arena->bytes_used = 0;
+}
+
+void arena_free(Arena* arena) {
+    ArenaChunk* chunk = arena->head;
+    while (chunk) {
+        ArenaChunk* next = chunk->next;
+        core_runtime_free(chunk);
+        chunk = next;
+    }
+    arena_init(arena, arena->chunk_size, arena->tag);
+}
 
 // Function to create AST nodes
-ASTNode* create_number_node(int value) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
+ASTNode* create_number_node(Arena* arena, Value value) {
+    ASTNode* node = (ASTNode*)arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_NUMBER;
     node->data.number_val = value;
     return node;
 }
 
-ASTNode* create_string_node(char* value) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
+// The string object lives in the arena next to the node, so literals cost no
+// runtime allocation and are released with the rest of the tree.
+ASTNode* create_string_node(Arena* arena, const char* value, size_t length) {
+    ASTNode* node = (ASTNode*)arena_alloc(arena, sizeof(ASTNode));
+    HeapString* string = (HeapString*)arena_alloc(arena, sizeof(HeapString) + length + 1);
+    string->header.next = NULL;
+    string->header.kind = HEAP_STRING;
+    string->length = length;
+    memcpy(string->chars, value, length);
+    string->chars[length] = '\0';
     node->type = NODE_STRING;
-    // +1 for null terminator
-    node->data.string_val = (char*)malloc(strlen(value) + 1);
-    strcpy(node->data.string_val, value);
+    node->data.string_val = value_from_heap(&string->header);
+    return node;
+}
+
+ASTNode* create_bool_node(Arena* arena, int value) {
+    ASTNode* node = (ASTNode*)arena_alloc(arena, sizeof(ASTNode));
+    node->type = NODE_BOOL;
+    node->data.bool_val = value_from_bool(value);
     return node;
 }
 
-ASTNode* create_var_node(char* name) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
+ASTNode* create_var_node(Arena* arena, const char* name, int slot) {
+    ASTNode* node = (ASTNode*)arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_VAR;
-    node->data.var_name = (char*)malloc(strlen(name) + 1);
-    strcpy(node->data.var_name, name);
+    node->data.var.name = name;
+    node->data.var.slot = slot;
     return node;
 }
 
-ASTNode* create_binop_node(ASTNode* left, TokenType op, ASTNode* right) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
+ASTNode* create_binop_node(Arena* arena, ASTNode* left, TokenType op, ASTNode* right) {
+    ASTNode* node = (ASTNode*)arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_BINOP;
     node->data.bin_op.left = left;
     node->data.bin_op.op = op;
@@ -96,510 +191,4121 @@ ASTNode* create_binop_node(ASTNode* left, TokenType op, ASTNode* right) {
     return node;
 }
 
-ASTNode* create_assign_node(char* name, ASTNode* expr) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
+ASTNode* create_assign_node(Arena* arena, const char* name, int slot, ASTNode* expr) {
+    ASTNode* node = (ASTNode*)arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_ASSIGN;
-    node->data.assign_op.var_name = (char*)malloc(strlen(name) + 1);
-    strcpy(node->data.assign_op.var_name, name);
+    node->data.assign_op.var_name = name;
+    node->data.assign_op.slot = slot;
     node->data.assign_op.expr = expr;
     return node;
 }
 
-ASTNode* create_print_node(ASTNode* expr) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
+ASTNode* create_call_node(Arena* arena, int builtin, const char* name, ASTNode** args, int num_args) {
+    ASTNode* node = (ASTNode*)arena_alloc(arena, sizeof(ASTNode));
+    node->type = NODE_CALL;
+    node->data.call.builtin = builtin;
+    node->data.call.name = name;
+    node->data.call.args = args;
+    node->data.call.num_args = num_args;
+    node->data.call.typed = 0;
+    return node;
+}
+
+ASTNode* create_print_node(Arena* arena, ASTNode* expr) {
+    ASTNode* node = (ASTNode*)arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_PRINT;
     node->data.print_stmt.expr = expr;
     return node;
 }
 
-// Function to free AST nodes (important for memory management)
-void free_ast_node(ASTNode* node) {
-    if (!node) return;
-    switch (node->type) {
-        case NODE_NUMBER:
-            break;
-        case NODE_STRING:
-            free(node->data.string_val);
-            break;
-        case NODE_VAR:
-            free(node->data.var_name);
-            break;
-        case NODE_BINOP:
-            free_ast_node(node->data.bin_op.left);
-            free_ast_node(node->data.bin_op.right);
-            break;
-        case NODE_ASSIGN:
-            free(node->data.assign_op.var_name);
-            free_ast_node(node->data.assign_op.expr);
-            break;
-        case NODE_PRINT:
-            free_ast_node(node->data.print_stmt.expr);
-            break;
-        default:
-            break;
+ASTNode* create_import_node(Arena* arena, const char* path, size_t length) {
+    ASTNode* node = (ASTNode*)arena_alloc(arena, sizeof(ASTNode));
+    node->type = NODE_IMPORT;
+    node->data.import_stmt.path = arena_copy_string(arena, path, length);
+    node->data.import_stmt.module = -1;
+    return node;
+}
+
+// --- Symbol Table ---
+// Identifiers are interned by the lexer into an open-addressing hash table.
+// Each distinct name gets a dense slot index at first sight, and the parser
+// stores that slot in NODE_VAR/NODE_ASSIGN, so at run time a variable access
+// is a plain array index with no hashing or string comparison.
+#define SYMBOL_TABLE_INITIAL_CAPACITY 64
+
+typedef struct {
+    const char* name; // Interned, NUL-terminated copy; NULL marks an empty bucket
+    size_t length;
+    unsigned int hash;
+    int slot;
+} SymbolEntry;
+
+typedef struct {
+    SymbolEntry* entries;   // Hash buckets; capacity is a power of two
+    size_t capacity;
+    int count;              // Number of interned names (== number of slots)
+    const char** names;     // Slot -> name, for diagnostics
+    Value* values;          // Slot -> current value
+    unsigned char* defined; // Slot -> whether the variable has been assigned
+    int slot_capacity;
+    Arena strings;          // Owns the interned names
+} SymbolTable;
+
+// FNV-1a over the identifier bytes
+unsigned int symbol_hash(const char* name, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void symbol_table_grow_buckets(SymbolTable* table) {
+    size_t new_capacity = table->capacity ? table->capacity * 2 : SYMBOL_TABLE_INITIAL_CAPACITY;
+    SymbolEntry* entries = (SymbolEntry*)core_runtime_calloc(MEMORY_SYMBOLS, new_capacity, sizeof(SymbolEntry));
+    if (!entries) raise_error("Memory allocation failed for symbol table.");
+    for (size_t i = 0; i < table->capacity; i++) {
+        SymbolEntry* entry = &table->entries[i];
+        if (!entry->name) continue;
+        size_t index = entry->hash & (new_capacity - 1);
+        while (entries[index].name) {
+            index = (index + 1) & (new_capacity - 1);
+        }
+        entries[index] = *entry;
+    }
+    core_runtime_free(table->entries);
+    table->entries = entries;
+    table->capacity = new_capacity;
+}
+
+void symbol_table_grow_slots(SymbolTable* table) {
+    int new_capacity = table->slot_capacity ? table->slot_capacity * 2 : SYMBOL_TABLE_INITIAL_CAPACITY;
+    table->names = (const char**)core_runtime_realloc(MEMORY_SYMBOLS, table->names, sizeof(const char*) * new_capacity);
+    table->values = (Value*)core_runtime_realloc(MEMORY_SYMBOLS, table->values, sizeof(Value) * new_capacity);
+    table->defined = (unsigned char*)core_runtime_realloc(MEMORY_SYMBOLS, table->defined, new_capacity);
+    if (!table->names || !table->values || !table->defined) {
+        raise_error("Memory allocation failed for symbol slots.");
+    }
+    table->slot_capacity = new_capacity;
+}
+
+// Returns the slot for `name`, interning it on first sight
+int symbol_intern(SymbolTable* table, const char* name, size_t length) {
+    // Keep the load factor at or below 1/2 so probe sequences stay short
+    if ((size_t)(table->count + 1) * 2 > table->capacity) {
+        symbol_table_grow_buckets(table);
+    }
+    unsigned int hash = symbol_hash(name, length);
+    size_t index = hash & (table->capacity - 1);
+    while (table->entries[index].name) {
+        SymbolEntry* entry = &table->entries[index];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->name, name, length) == 0) {
+            return entry->slot;
+        }
+        index = (index + 1) & (table->capacity - 1);
+    }
+    if (table->count >= table->slot_capacity) {
+        symbol_table_grow_slots(table);
+    }
+    if (table->count == 0 && table->strings.num_chunks == 0) {
+        arena_init(&table->strings, ARENA_DEFAULT_CHUNK_SIZE, MEMORY_SYMBOLS);
+    }
+    int slot = table->count++;
+    SymbolEntry* entry = &table->entries[index];
+    entry->name = arena_copy_string(&table->strings, name, length);
+    entry->length = length;
+    entry->hash = hash;
+    entry->slot = slot;
+    table->names[slot] = entry->name;
+    table->values[slot] = value_from_small_int(0);
+    table->defined[slot] = 0;
+    return slot;
+}
+
+// Returns the slot for `name`, or -1 if it was never interned. Does not
+// modify the table, so threads may look up names in it at the same time.
+int symbol_lookup(const SymbolTable* table, const char* name, size_t length) {
+    if (table->capacity == 0) return -1;
+    unsigned int hash = symbol_hash(name, length);
+    size_t index = hash & (table->capacity - 1);
+    while (table->entries[index].name) {
+        const SymbolEntry* entry = &table->entries[index];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->name, name, length) == 0) {
+            return entry->slot;
+        }
+        index = (index + 1) & (table->capacity - 1);
+    }
+    return -1;
+}
+
+// Set variable value
+void set_symbol(SymbolTable* table, int slot, Value value) {
+    table->values[slot] = value;
+    table->defined[slot] = 1;
+}
+
+// Get variable value
+Value get_symbol(const SymbolTable* table, int slot) {
+    if (!table->defined[slot]) {
+        raise_error("Name Error: Variable '%s' not found.", table->names[slot]);
     }
-    free(node);
+    return table->values[slot];
+}
+
+void symbol_table_free(SymbolTable* table) {
+    core_runtime_free(table->entries);
+    core_runtime_free(table->names);
+    core_runtime_free(table->values);
+    core_runtime_free(table->defined);
+    arena_free(&table->strings);
+    memset(table, 0, sizeof(*table));
 }
 
 // --- Lexer (Tokenizer) ---
+// The lexer scans [code, end) in a single pass. The source does not need to be
+// NUL-terminated (it is usually a read-only file mapping), so every read is
+// bounds-checked against `end` instead of calling strlen.
+//
+// Sources are UTF-8. lexer_init validates the whole buffer first and ends the
+// scan at the first malformed byte, which is reported as a syntax error once
+// the lexer gets there, so it comes in source order like any other error.
+// Identifiers may be written in any script (see lexer_char_class), and
+// columns count characters, not bytes.
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define LEXER_SIMD 1
+#endif
+
 typedef struct {
-    const char* code;
-    int pos;
+    const char* code; // Start of the source buffer
+    const char* end;  // Where the scan stops: source_end, or the first malformed UTF-8 byte
+    const char* source_end; // One past the last byte of the source
+    const char* cur;  // Current scan position
+    SymbolTable* symbols; // Identifiers are interned here as they are scanned
     int line;
     int column;
     Token current_token;
 } Lexer;
 
 // Keywords lookup
+// Keywords sit in a perfect hash table: no two of them share a slot, so a
+// lookup is one hash and at most one memcmp. The compiler places each keyword
+// with the same KEYWORD_HASH the lookup uses. A new keyword that collides
+// would silently replace another (only -Wextra warns), and a mistyped first
+// or last character would place it where no lookup finds it, so
+// lexer_check_keywords verifies the table at startup.
+#define KEYWORD_SLOTS 16
+#define KEYWORD_HASH(first, last, length) \
+    (((length) + 7 * (unsigned char)(first) + 3 * (unsigned char)(last)) & (KEYWORD_SLOTS - 1))
+#define KEYWORD(word, first, last, token) \
+    [KEYWORD_HASH(first, last, sizeof(word) - 1)] = {word, sizeof(word) - 1, token},
+#define KEYWORD_NAME(word, first, last, token) word,
+
+#define KEYWORD_LIST(X)                          \
+    X("darshaya", 'd', 'a', TOKEN_PRINT)         \
+    X("satya", 's', 'a', TOKEN_TRUE)             \
+    X("asatya", 'a', 'a', TOKEN_FALSE)           \
+    X("pratibandha", 'p', 'a', TOKEN_IMPORT)     \
+    X("prashna", 'p', 'a', TOKEN_ASK)            \
+    X("saha", 's', 'a', TOKEN_WITH)              \
+    X("modula", 'm', 'a', TOKEN_MODULE)          \
+    X("varg", 'v', 'g', TOKEN_CLASS)             \
+    X("vinirgam", 'v', 'm', TOKEN_EXPORT)        \
+    X("lakshana", 'l', 'a', TOKEN_DOC)
+
 typedef struct {
     const char* key;
+    size_t length; // 0 for an empty slot
     TokenType type;
 } Keyword;
 
-Keyword keywords[] = {
-    {"darshaya", TOKEN_PRINT},
-    // Add other keywords here
-    {NULL, 0} // Sentinel
+const Keyword keywords[KEYWORD_SLOTS] = {KEYWORD_LIST(KEYWORD)};
+const char* const keyword_names[] = {KEYWORD_LIST(KEYWORD_NAME)};
+_Static_assert(sizeof(keyword_names) / sizeof(keyword_names[0]) <= KEYWORD_SLOTS, "Too many keywords for the table");
+
+// Returns the keyword token for [start, start + length), or TOKEN_IDENTIFIER
+TokenType lexer_keyword(const char* start, size_t length) {
+    const Keyword* keyword = &keywords[KEYWORD_HASH(start[0], start[length - 1], length)];
+    if (keyword->length == length && memcmp(start, keyword->key, length) == 0) {
+        return keyword->type;
+    }
+    return TOKEN_IDENTIFIER;
+}
+
+// Every keyword must have a slot of its own and be found again by lexer_keyword
+void lexer_check_keywords(void) {
+    size_t count = sizeof(keyword_names) / sizeof(keyword_names[0]);
+    size_t filled = 0;
+    for (int slot = 0; slot < KEYWORD_SLOTS; slot++) filled += keywords[slot].length != 0;
+    if (filled != count) {
+        raise_error("Internal Error: %zu keywords share slots of the keyword table; change KEYWORD_HASH.", count - filled);
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t length = strlen(keyword_names[i]);
+        if (lexer_keyword(keyword_names[i], length) == TOKEN_IDENTIFIER) {
+            raise_error("Internal Error: Keyword '%s' is not in its slot of the keyword table; check its first and last characters.",
+                        keyword_names[i]);
+        }
+    }
+}
+
+// Length of the well-formed UTF-8 sequence at the non-ASCII byte p, or 0.
+// Overlong forms, surrogates and code points past U+10FFFF are malformed.
+int utf8_sequence_length(const unsigned char* p, const unsigned char* end) {
+    unsigned char low = 0x80, high = 0xBF; // Range of the second byte
+    int length;
+    if (p[0] >= 0xC2 && p[0] <= 0xDF) {
+        length = 2;
+    } else if (p[0] >= 0xE0 && p[0] <= 0xEF) {
+        length = 3;
+        if (p[0] == 0xE0) low = 0xA0;
+        if (p[0] == 0xED) high = 0x9F;
+    } else if (p[0] >= 0xF0 && p[0] <= 0xF4) {
+        length = 4;
+        if (p[0] == 0xF0) low = 0x90;
+        if (p[0] == 0xF4) high = 0x8F;
+    } else {
+        return 0;
+    }
+    if (end - p < length || p[1] < low || p[1] > high) return 0;
+    for (int i = 2; i < length; i++) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+    }
+    return length;
+}
+
+// Returns the first byte of [begin, end) that is not part of well-formed
+// UTF-8, or `end`. Even Devanagari sources are mostly ASCII (indentation,
+// operators, comments, numbers), and with SSE2 those runs are checked 16
+// bytes at a time; multi-byte sequences are checked one at a time.
+const char* utf8_find_invalid(const char* begin, const char* end) {
+    const unsigned char* p = (const unsigned char*)begin;
+    const unsigned char* stop = (const unsigned char*)end;
+    while (p < stop) {
+#ifdef LEXER_SIMD
+        while (stop - p >= 16 && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p)) == 0) {
+            p += 16;
+        }
+        if (p == stop) break;
+#endif
+        if (*p < 0x80) {
+            p++;
+            continue;
+        }
+        int length = utf8_sequence_length(p, stop);
+        if (length == 0) return (const char*)p;
+        p += length;
+    }
+    return end;
+}
+
+// ASCII letters and '_', and ASCII digits, without isalpha's locale lookup
+#define LEXER_ASCII_START(c) ((unsigned char)(((c) | 0x20) - 'a') < 26 || (c) == '_')
+#define LEXER_ASCII_DIGIT(c) ((unsigned char)((c) - '0') < 10)
+
+// What a character can be in an identifier
+typedef enum {
+    LEXER_CHAR_OTHER,    // Not part of an identifier
+    LEXER_CHAR_CONTINUE, // Digits and combining marks: anywhere but first
+    LEXER_CHAR_START,    // Letters and '_'
+} LexerCharClass;
+
+typedef struct {
+    unsigned int first;
+    unsigned int last;
+    LexerCharClass kind;
+} LexerUnicodeRange;
+
+// Non-ASCII code points that cannot start an identifier, sorted. Everything
+// else is taken for a letter, so identifiers in Devanagari, Latin, Greek,
+// Cyrillic, CJK and so on work without the full Unicode tables. Listed are
+// Devanagari's signs, digits and dandas, and the common punctuation and
+// symbol blocks. The joiners are kept: Devanagari spelling needs them.
+const LexerUnicodeRange lexer_unicode_ranges[] = {
+    {0x0080, 0x00BF, LEXER_CHAR_OTHER},    // C1 controls, no-break space, Latin-1 punctuation
+    {0x00D7, 0x00D7, LEXER_CHAR_OTHER},    // Multiplication sign
+    {0x00F7, 0x00F7, LEXER_CHAR_OTHER},    // Division sign
+    {0x0300, 0x036F, LEXER_CHAR_CONTINUE}, // Combining diacritical marks
+    {0x0900, 0x0903, LEXER_CHAR_CONTINUE}, // Candrabindu, anusvara, visarga
+    {0x093A, 0x093C, LEXER_CHAR_CONTINUE}, // Vowel signs, nukta
+    {0x093E, 0x094F, LEXER_CHAR_CONTINUE}, // Vowel signs, virama
+    {0x0951, 0x0957, LEXER_CHAR_CONTINUE}, // Stress signs, vowel signs
+    {0x0962, 0x0963, LEXER_CHAR_CONTINUE}, // Vocalic vowel signs
+    {0x0964, 0x0965, LEXER_CHAR_OTHER},    // Danda, double danda
+    {0x0966, 0x096F, LEXER_CHAR_CONTINUE}, // Devanagari digits
+    {0x0970, 0x0970, LEXER_CHAR_OTHER},    // Abbreviation sign
+    {0x1AB0, 0x1AFF, LEXER_CHAR_CONTINUE}, // Combining diacritical marks extended
+    {0x1CD0, 0x1CFF, LEXER_CHAR_CONTINUE}, // Vedic extensions
+    {0x1DC0, 0x1DFF, LEXER_CHAR_CONTINUE}, // Combining diacritical marks supplement
+    {0x2000, 0x200B, LEXER_CHAR_OTHER},    // Spaces
+    {0x200C, 0x200D, LEXER_CHAR_CONTINUE}, // Zero-width non-joiner and joiner
+    {0x200E, 0x2BFF, LEXER_CHAR_OTHER},    // Punctuation, arrows, math operators, symbols
+    {0x3000, 0x303F, LEXER_CHAR_OTHER},    // CJK punctuation
+    {0xA8E0, 0xA8F1, LEXER_CHAR_CONTINUE}, // Devanagari extended combining marks
+    {0xFE00, 0xFE0F, LEXER_CHAR_CONTINUE}, // Variation selectors
+    {0xFEFF, 0xFEFF, LEXER_CHAR_OTHER},    // Byte order mark
+    {0xFFF0, 0xFFFF, LEXER_CHAR_OTHER},    // Specials
+    {0x1F000, 0x1FAFF, LEXER_CHAR_OTHER},  // Emoji and pictographs
 };
 
-void lexer_init(Lexer* lexer, const char* code) {
+// Classifies the character at p and stores its length in bytes. p is below
+// the lexer's `end`, so its sequence is well-formed.
+LexerCharClass lexer_char_class(const char* p, int* length) {
+    const unsigned char* s = (const unsigned char*)p;
+    if (s[0] < 0x80) {
+        *length = 1;
+        if (LEXER_ASCII_START(s[0])) return LEXER_CHAR_START;
+        return LEXER_ASCII_DIGIT(s[0]) ? LEXER_CHAR_CONTINUE : LEXER_CHAR_OTHER;
+    }
+    unsigned int code;
+    if (s[0] < 0xE0) {
+        *length = 2;
+        code = (s[0] & 0x1Fu) << 6 | (s[1] & 0x3Fu);
+    } else if (s[0] < 0xF0) {
+        *length = 3;
+        code = (s[0] & 0x0Fu) << 12 | (s[1] & 0x3Fu) << 6 | (s[2] & 0x3Fu);
+    } else {
+        *length = 4;
+        code = (s[0] & 0x07u) << 18 | (s[1] & 0x3Fu) << 12 | (s[2] & 0x3Fu) << 6 | (s[3] & 0x3Fu);
+    }
+    size_t low = 0, high = sizeof(lexer_unicode_ranges) / sizeof(lexer_unicode_ranges[0]);
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (code > lexer_unicode_ranges[mid].last) {
+            low = mid + 1;
+        } else if (code < lexer_unicode_ranges[mid].first) {
+            high = mid;
+        } else {
+            return lexer_unicode_ranges[mid].kind;
+        }
+    }
+    return LEXER_CHAR_START;
+}
+
+void lexer_init(Lexer* lexer, const char* code, size_t length, SymbolTable* symbols) {
     lexer->code = code;
-    lexer->pos = 0;
+    lexer->symbols = symbols;
+    lexer->source_end = code + length;
+    lexer->end = utf8_find_invalid(code, lexer->source_end);
+    lexer->cur = code;
     lexer->line = 1;
     lexer->column = 1;
     lexer->current_token.type = TOKEN_EOF; // Initialize to EOF
 }
 
+// Raised when the scan reaches a malformed byte
+_Noreturn void lexer_invalid_utf8(const Lexer* lexer) {
+    raise_error("Syntax Error: Invalid UTF-8 byte 0x%02X at line %d, column %d.",
+            (unsigned char)*lexer->end, lexer->line, lexer->column);
+}
+
+// Returns a pointer to the first byte of a token's lexeme
+const char* lexer_token_text(const Lexer* lexer, Token token) {
+    return lexer->code + token.offset;
+}
+
 // Helper to advance position and column
 void lexer_advance_char(Lexer* lexer) {
-    if (lexer->pos < strlen(lexer->code)) {
-        if (lexer->code[lexer->pos] == '\n') {
+    if (lexer->cur < lexer->end) {
+        if (*lexer->cur == '\n') {
             lexer->line++;
             lexer->column = 1;
-        } else {
+        } else if (((unsigned char)*lexer->cur & 0xC0) != 0x80) { // Continuation bytes belong to the previous character
             lexer->column++;
         }
-        lexer->pos++;
+        lexer->cur++;
     }
 }
 
+// Builds a token covering [start, lexer->cur)
+Token lexer_make_token(Lexer* lexer, TokenType type, const char* start, int line, int column) {
+    return (Token){type, (size_t)(start - lexer->code), (size_t)(lexer->cur - start), -1, line, column};
+}
+
 // Read a number token
+// Digits with an optional fraction and exponent ("12", "0.5", "6.02e23").
+// A '.' or 'e' only belongs to the number when digits follow it.
 Token lexer_read_number(Lexer* lexer) {
-    int start_pos = lexer->pos;
-    while (isdigit(lexer->code[lexer->pos])) {
-        lexer_advance_char(lexer);
+    const char* start = lexer->cur;
+    int column = lexer->column;
+    while (lexer->cur < lexer->end && isdigit((unsigned char)*lexer->cur)) {
+        lexer->cur++;
+    }
+    if (lexer->end - lexer->cur >= 2 && lexer->cur[0] == '.' && isdigit((unsigned char)lexer->cur[1])) {
+        lexer->cur++;
+        while (lexer->cur < lexer->end && isdigit((unsigned char)*lexer->cur)) {
+            lexer->cur++;
+        }
     }
-    int len = lexer->pos - start_pos;
-    char* value = (char*)malloc(len + 1);
-    strncpy(value, lexer->code + start_pos, len);
-    value[len] = '\0';
-    return (Token){TOKEN_NUMBER, value, lexer->line, lexer->column - len};
+    if (lexer->cur < lexer->end && (*lexer->cur == 'e' || *lexer->cur == 'E')) {
+        const char* exponent = lexer->cur + 1;
+        if (exponent < lexer->end && (*exponent == '+' || *exponent == '-')) exponent++;
+        if (exponent < lexer->end && isdigit((unsigned char)*exponent)) {
+            lexer->cur = exponent;
+            while (lexer->cur < lexer->end && isdigit((unsigned char)*lexer->cur)) {
+                lexer->cur++;
+            }
+        }
+    }
+    lexer->column += (int)(lexer->cur - start);
+    return lexer_make_token(lexer, TOKEN_NUMBER, start, lexer->line, column);
 }
 
-// Read a string token
+// Read a string token. The slice includes the surrounding quotes.
 Token lexer_read_string(Lexer* lexer) {
+    const char* start = lexer->cur;
+    int line = lexer->line;
+    int column = lexer->column;
     lexer_advance_char(lexer); // Consume opening quote
-    int start_pos = lexer->pos;
-    while (lexer->code[lexer->pos] != '"' && lexer->code[lexer->pos] != '\0') {
+    while (lexer->cur < lexer->end && *lexer->cur != '"') {
         lexer_advance_char(lexer);
     }
-    int len = lexer->pos - start_pos;
-    char* value = (char*)malloc(len + 3); // +2 for quotes, +1 for null terminator
-    value[0] = '"';
-    strncpy(value + 1, lexer->code + start_pos, len);
-    value[len + 1] = '"';
-    value[len + 2] = '\0';
+    if (lexer->cur == lexer->end && lexer->end < lexer->source_end) {
+        lexer_invalid_utf8(lexer);
+    }
     lexer_advance_char(lexer); // Consume closing quote
-    return (Token){TOKEN_STRING, value, lexer->line, lexer->column - len - 2};
+    return lexer_make_token(lexer, TOKEN_STRING, start, line, column);
 }
 
-// Read an identifier or keyword
+// Read an identifier or keyword. Dotted names such as Matrix.zeros are one
+// identifier: a '.' belongs to the name when a letter or '_' follows it.
 Token lexer_read_identifier(Lexer* lexer) {
-    int start_pos = lexer->pos;
-    while (isalnum(lexer->code[lexer->pos]) || lexer->code[lexer->pos] == '_') {
-        lexer_advance_char(lexer);
+    const char* start = lexer->cur;
+    int column = lexer->column;
+    int characters = 0;
+    int length;
+    while (lexer->cur < lexer->end) {
+        char c = *lexer->cur;
+        if (LEXER_ASCII_START(c) || LEXER_ASCII_DIGIT(c)) { // The common case, without decoding
+            lexer->cur++;
+            characters++;
+        } else if (c == '.' && lexer->end - lexer->cur >= 2 &&
+            lexer_char_class(lexer->cur + 1, &length) == LEXER_CHAR_START) {
+            lexer->cur += 1 + length;
+            characters += 2;
+        } else if (lexer_char_class(lexer->cur, &length) != LEXER_CHAR_OTHER) {
+            lexer->cur += length;
+            characters++;
+        } else {
+            break;
+        }
     }
-    int len = lexer->pos - start_pos;
-    char* value = (char*)malloc(len + 1);
-    strncpy(value, lexer->code + start_pos, len);
-    value[len] = '\0';
+    size_t len = (size_t)(lexer->cur - start);
+    lexer->column += characters;
 
-    // Check if it's a keyword
-    for (int i = 0; keywords[i].key != NULL; i++) {
-        if (strcmp(value, keywords[i].key) == 0) {
-            TokenType type = keywords[i].type;
-            free(value); // Free the allocated string for keyword
-            return (Token){type, (char*)keywords[i].key, lexer->line, lexer->column - len};
-        }
+    TokenType type = lexer_keyword(start, len);
+    Token token = lexer_make_token(lexer, type, start, lexer->line, column);
+    if (type == TOKEN_IDENTIFIER) {
+        token.symbol = symbol_intern(lexer->symbols, start, len);
     }
-    return (Token){TOKEN_IDENTIFIER, value, lexer->line, lexer->column - len};
+    return token;
 }
 
 Token lexer_get_next_token(Lexer* lexer) {
-    // Skip whitespace and comments
-    while (lexer->pos < strlen(lexer->code)) {
-        char c = lexer->code[lexer->pos];
-        if (isspace(c) && c != '\n') { // Skip horizontal whitespace
-            lexer_advance_char(lexer);
-        } else if (c == '#') { // Skip comments
-            while (lexer->pos < strlen(lexer->code) && lexer->code[lexer->pos] != '\n') {
+    while (1) {
+        // Skip whitespace, comments and byte order marks
+        while (lexer->cur < lexer->end) {
+            char c = *lexer->cur;
+            if (isspace((unsigned char)c) && c != '\n') { // Skip horizontal whitespace
                 lexer_advance_char(lexer);
+            } else if (c == '#') { // Skip comments
+                while (lexer->cur < lexer->end && *lexer->cur != '\n') {
+                    lexer_advance_char(lexer);
+                }
+            } else if (lexer->end - lexer->cur >= 3 && memcmp(lexer->cur, "\xEF\xBB\xBF", 3) == 0) {
+                lexer->cur += 3;
+            } else {
+                break;
             }
-        } else {
-            break;
         }
-    }
 
-    if (lexer->pos >= strlen(lexer->code)) {
-        return (Token){TOKEN_EOF, NULL, lexer->line, lexer->column};
-    }
+        if (lexer->cur >= lexer->end) {
+            if (lexer->end < lexer->source_end) {
+                lexer_invalid_utf8(lexer);
+            }
+            return lexer_make_token(lexer, TOKEN_EOF, lexer->cur, lexer->line, lexer->column);
+        }
 
-    char c = lexer->code[lexer->pos];
-    Token token;
+        const char* start = lexer->cur;
+        int line = lexer->line;
+        int column = lexer->column;
+        char c = *start;
+        TokenType type;
+        int length = 1;
+
+        if (isdigit((unsigned char)c)) {
+            return lexer_read_number(lexer);
+        } else if (LEXER_ASCII_START(c) ||
+                   ((unsigned char)c >= 0x80 && lexer_char_class(start, &length) == LEXER_CHAR_START)) {
+            return lexer_read_identifier(lexer);
+        } else if (c == '"') {
+            return lexer_read_string(lexer);
+        }
 
-    if (isdigit(c)) {
-        token = lexer_read_number(lexer);
-    } else if (isalpha(c) || c == '_') {
-        token = lexer_read_identifier(lexer);
-    } else if (c == '"') {
-        token = lexer_read_string(lexer);
-    } else if (c == '\n') {
-        lexer_advance_char(lexer);
-        token = (Token){TOKEN_NEWLINE, "\n", lexer->line -1, 1}; // Newline was consumed
-    } else {
         switch (c) {
-            case '=': token = (Token){TOKEN_ASSIGN, "=", lexer->line, lexer->column}; break;
-            case '+': token = (Token){TOKEN_PLUS, "+", lexer->line, lexer->column}; break;
-            case '-': token = (Token){TOKEN_MINUS, "-", lexer->line, lexer->column}; break;
-            case '*': token = (Token){TOKEN_TIMES, "*", lexer->line, lexer->column}; break;
-            case '/': token = (Token){TOKEN_DIVIDE, "/", lexer->line, lexer->column}; break;
-            case '(': token = (Token){TOKEN_LPAREN, "(", lexer->line, lexer->column}; break;
-            case ')': token = (Token){TOKEN_RPAREN, ")", lexer->line, lexer->column}; break;
-            case ',': token = (Token){TOKEN_COMMA, ",", lexer->line, lexer->column}; break;
-            case ':': token = (Token){TOKEN_COLON, ":", lexer->line, lexer->column}; break;
-            default:
-                // Handle unknown characters gracefully by skipping them
-                fprintf(stderr, "Lexer Warning: Unknown character '%c' at line %d, column %d. Skipping.\n", c, lexer->line, lexer->column);
-                token = (Token){TOKEN_UNKNOWN, (char*)&c, lexer->line, lexer->column}; // Create token for warning, then skip
-                break;
+            case '\n': type = TOKEN_NEWLINE; break;
+            case '=': type = TOKEN_ASSIGN; break;
+            case '+': type = TOKEN_PLUS; break;
+            case '-': type = TOKEN_MINUS; break;
+            case '*': type = TOKEN_TIMES; break;
+            case '/': type = TOKEN_DIVIDE; break;
+            case '(': type = TOKEN_LPAREN; break;
+            case ')': type = TOKEN_RPAREN; break;
+            case ',': type = TOKEN_COMMA; break;
+            case ':': type = TOKEN_COLON; break;
+            default: type = TOKEN_UNKNOWN; break;
         }
-        if (token.type != TOKEN_UNKNOWN) { // Only advance for recognized tokens
-            lexer_advance_char(lexer);
-        } else {
-            // If it's unknown, advance one char to avoid infinite loop
-            lexer_advance_char(lexer);
-            return lexer_get_next_token(lexer); // Try to get next valid token
+        lexer_advance_char(lexer);
+        if (type != TOKEN_UNKNOWN) {
+            return lexer_make_token(lexer, type, start, line, column);
         }
+        // Handle unknown characters gracefully by skipping them, whole
+        lexer->cur = start + length;
+        fprintf(stderr, "Lexer Warning: Unknown character '%.*s' at line %d, column %d. Skipping.\n",
+                length, start, line, column);
     }
-    return token;
 }
 
 
-// --- Parser ---
-typedef struct {
-    Lexer* lexer;
-    Token current_token;
-    Token peek_token; // For 1-token lookahead
-} Parser;
+// --- Built-in Functions ---
+// Native functions called as `Name(args)`, bound at startup in the runtime's
+// native registry (see core_runtime.h) next to the standard library's
+// Sankhya.* natives. A call is resolved to its registry index and
+// arity-checked when it is parsed. Literal arguments are type-checked there
+// too, and calls whose argument types the parser or optimizer can prove are
+// marked `typed` and skip the check at run time. Matrix.* wraps the tensor
+// kernels in core_runtime.c (tensor arithmetic itself goes through + - * /),
+// Buddhimatta.* the batched activation kernels and the autodiff tape that
+// trains parameters with Adam, Parallel.* configures the
+// thread pool those kernels share and Prashna.* queries language models
+// through the runtime's batching dispatcher. A call may also stand alone as a
+// statement, in which case its result is discarded.
+// Argument accessors. Types were checked against the binding before the call.
+HeapTensor* builtin_tensor_arg(const Value* args, int index) {
+    return value_as_tensor(args[index]);
+}
 
-void parser_init(Parser* parser, Lexer* lexer) {
-    parser->lexer = lexer;
-    // Prime the parser with two tokens for lookahead
-    parser->current_token = lexer_get_next_token(parser->lexer);
-    parser->peek_token = lexer_get_next_token(parser->lexer);
+double builtin_number_arg(const Value* args, int index) {
+    return value_number_as_double(args[index]);
 }
 
-// Consumes current_token and fetches next_token
-void parser_advance(Parser* parser) {
-    // If the current token's value was dynamically allocated (e.g., IDENTIFIER, NUMBER, STRING), free it.
-    // Keywords values point to static strings, no need to free.
-    if (parser->current_token.value && 
-        (parser->current_token.type == TOKEN_IDENTIFIER ||
-         parser->current_token.type == TOKEN_NUMBER ||
-         parser->current_token.type == TOKEN_STRING)
-       ) {
-        free(parser->current_token.value);
-    }
+// Bigints saturate, so they fail every range check
+int64_t builtin_int_arg(const Value* args, int index) {
+    return value_as_int64_saturated(args[index]);
+}
 
-    parser->current_token = parser->peek_token;
-    parser->peek_token = lexer_get_next_token(parser->lexer);
+int builtin_bool_arg(const Value* args, int index) {
+    return value_as_bool(args[index]);
 }
 
-// Checks if current token matches expected type(s) and advances
-void parser_expect(Parser* parser, TokenType type) {
-    if (parser->current_token.type == type) {
-        parser_advance(parser);
-    } else {
-        fprintf(stderr, "Syntax Error: Expected token type %d, but got %d ('%s') at line %d, column %d.\n",
-                type, parser->current_token.type, parser->current_token.value,
-                parser->current_token.line, parser->current_token.column);
-        exit(1);
+// An int in [0, limit)
+size_t builtin_index_arg(const Value* args, int index, const char* name, size_t limit) {
+    int64_t i = builtin_int_arg(args, index);
+    if (i < 0 || (uint64_t)i >= limit) {
+        char text[48];
+        char message[200];
+        value_format(args[index], text, sizeof(text));
+        snprintf(message, sizeof(message), "Runtime Error: %s argument %d is out of range (%s, expected 0 to %zu).",
+                 name, index + 1, text, limit - 1);
+        core_runtime_panic(message);
     }
+    return (size_t)i;
 }
 
-// Function to consume newlines
-void parser_consume_newlines(Parser* parser) {
-    while (parser->current_token.type == TOKEN_NEWLINE) {
-        parser_advance(parser);
+// Tensor dimensions are positive ints
+size_t builtin_dimension_arg(const Value* args, int index, const char* name) {
+    if (value_is_int(args[index]) && builtin_int_arg(args, index) <= 0) {
+        char text[48];
+        char message[200];
+        value_format(args[index], text, sizeof(text));
+        snprintf(message, sizeof(message), "Runtime Error: %s expects a positive size for argument %d, got %s.",
+                 name, index + 1, text);
+        core_runtime_panic(message);
     }
+    return builtin_index_arg(args, index, name, SIZE_MAX);
 }
 
-// Forward declarations for recursive descent parsing
-ASTNode* parse_expression(Parser* parser);
-ASTNode* parse_term(Parser* parser);
-ASTNode* parse_factor(Parser* parser);
-ASTNode* parse_statement(Parser* parser);
+Value builtin_tensor_value(HeapTensor* tensor) {
+    return value_from_heap(&tensor->header);
+}
 
-// Main parsing function
-ASTNode** parse_program(Parser* parser, int* num_statements) {
-    ASTNode** statements = NULL;
-    *num_statements = 0;
-    int capacity = 2; // Initial capacity
+Value builtin_matrix_zeros(const Value* args) {
+    return builtin_tensor_value(core_runtime_tensor_new(builtin_dimension_arg(args, 0, "Matrix.zeros"),
+                                                        builtin_dimension_arg(args, 1, "Matrix.zeros")));
+}
 
-    statements = (ASTNode**)malloc(sizeof(ASTNode*) * capacity);
-    if (!statements) { fprintf(stderr, "Memory allocation failed for statements.\n"); exit(1); }
+Value builtin_matrix_ones(const Value* args) {
+    return builtin_tensor_value(core_runtime_tensor_fill(builtin_dimension_arg(args, 0, "Matrix.ones"),
+                                                         builtin_dimension_arg(args, 1, "Matrix.ones"), 1.0));
+}
 
-    parser_consume_newlines(parser); // Consume leading newlines
+Value builtin_matrix_fill(const Value* args) {
+    size_t rows = builtin_dimension_arg(args, 0, "Matrix.fill");
+    size_t cols = builtin_dimension_arg(args, 1, "Matrix.fill");
+    return builtin_tensor_value(core_runtime_tensor_fill(rows, cols, builtin_number_arg(args, 2)));
+}
 
-    while (parser->current_token.type != TOKEN_EOF) {
-        if (*num_statements >= capacity) {
-            capacity *= 2;
-            statements = (ASTNode**)realloc(statements, sizeof(ASTNode*) * capacity);
-            if (!statements) { fprintf(stderr, "Memory reallocation failed for statements.\n"); exit(1); }
-        }
-        
-        ASTNode* stmt = parse_statement(parser);
-        if (stmt) { // Only add if a statement was successfully parsed
-            statements[(*num_statements)++] = stmt;
-        }
-        parser_consume_newlines(parser); // Consume newlines after each statement
+// Matrix.range(start, stop): the 1 x (stop - start) vector start, ..., stop - 1
+Value builtin_matrix_range(const Value* args) {
+    int64_t start = builtin_int_arg(args, 0);
+    int64_t stop = builtin_int_arg(args, 1);
+    if (stop <= start) {
+        char message[160];
+        snprintf(message, sizeof(message), "Runtime Error: Matrix.range needs stop > start, got %lld and %lld.",
+                 (long long)start, (long long)stop);
+        core_runtime_panic(message);
     }
-    return statements;
+    return builtin_tensor_value(core_runtime_tensor_range((double)start, (size_t)((uint64_t)stop - (uint64_t)start)));
 }
 
-ASTNode* parse_statement(Parser* parser) {
-    ASTNode* node = NULL;
-    if (parser->current_token.type == TOKEN_PRINT) {
-        parser_advance(parser); // Consume darshaya
-        parser_expect(parser, TOKEN_LPAREN);
-        ASTNode* expr = parse_expression(parser);
-        parser_expect(parser, TOKEN_RPAREN);
-        node = create_print_node(expr);
-    } else if (parser->current_token.type == TOKEN_IDENTIFIER && parser->peek_token.type == TOKEN_ASSIGN) {
-        char* var_name = parser->current_token.value; // Store value before advance
-        parser_advance(parser); // Consume identifier
-        parser_advance(parser); // Consume '='
-        ASTNode* expr = parse_expression(parser);
-        node = create_assign_node(var_name, expr);
-    } else if (parser->current_token.type == TOKEN_NEWLINE) {
-        parser_advance(parser); // Consume newline, try parsing next statement
-        return NULL; // Indicate no actual statement was parsed, just a newline
-    } else {
-        fprintf(stderr, "Syntax Error: Unexpected token for statement '%s' at line %d, column %d.\n",
-                parser->current_token.value, parser->current_token.line, parser->current_token.column);
-        exit(1);
+Value builtin_matrix_random(const Value* args) {
+    return builtin_tensor_value(core_runtime_tensor_random(builtin_dimension_arg(args, 0, "Matrix.random"),
+                                                           builtin_dimension_arg(args, 1, "Matrix.random")));
+}
+
+Value builtin_matrix_multiply(const Value* args) {
+    HeapTensor* a = builtin_tensor_arg(args, 0);
+    HeapTensor* b = builtin_tensor_arg(args, 1);
+    if (a->cols != b->rows) {
+        char message[160];
+        snprintf(message, sizeof(message), "Runtime Error: Matrix.multiply shapes (%zu, %zu) and (%zu, %zu) are not aligned.",
+                 a->rows, a->cols, b->rows, b->cols);
+        core_runtime_panic(message);
     }
-    return node;
+    return builtin_tensor_value(core_runtime_tensor_matmul(a, b));
 }
 
+// Same as `a + b`: numbers and tensors broadcast
+Value builtin_matrix_add(const Value* args) {
+    return value_arith(VALUE_OP_ADD, args[0], args[1]);
+}
 
-// Expression parsing (precedence climbing)
-ASTNode* parse_expression(Parser* parser) {
-    ASTNode* left = parse_term(parser);
+Value builtin_matrix_transpose(const Value* args) {
+    return builtin_tensor_value(core_runtime_tensor_transpose(builtin_tensor_arg(args, 0)));
+}
 
-    while (parser->current_token.type == TOKEN_PLUS || parser->current_token.type == TOKEN_MINUS) {
-        TokenType op = parser->current_token.type;
-        parser_advance(parser);
-        ASTNode* right = parse_term(parser);
-        left = create_binop_node(left, op, right);
-    }
-    return left;
+Value builtin_matrix_sum(const Value* args) {
+    return value_from_double(core_runtime_tensor_sum(builtin_tensor_arg(args, 0)));
 }
 
-ASTNode* parse_term(Parser* parser) {
-    ASTNode* left = parse_factor(parser);
+Value builtin_matrix_mean(const Value* args) {
+    HeapTensor* tensor = builtin_tensor_arg(args, 0);
+    return value_from_double(core_runtime_tensor_sum(tensor) / (double)tensor->size);
+}
 
-    while (parser->current_token.type == TOKEN_TIMES || parser->current_token.type == TOKEN_DIVIDE) {
-        TokenType op = parser->current_token.type;
-        parser_advance(parser);
-        ASTNode* right = parse_factor(parser);
-        left = create_binop_node(left, op, right);
+Value builtin_matrix_max(const Value* args) {
+    return value_from_double(core_runtime_tensor_max(builtin_tensor_arg(args, 0)));
+}
+
+Value builtin_matrix_min(const Value* args) {
+    return value_from_double(core_runtime_tensor_min(builtin_tensor_arg(args, 0)));
+}
+
+Value builtin_matrix_rows(const Value* args) {
+    return value_from_int64((int64_t)builtin_tensor_arg(args, 0)->rows);
+}
+
+Value builtin_matrix_cols(const Value* args) {
+    return value_from_int64((int64_t)builtin_tensor_arg(args, 0)->cols);
+}
+
+Value builtin_matrix_get(const Value* args) {
+    HeapTensor* tensor = builtin_tensor_arg(args, 0);
+    size_t row = builtin_index_arg(args, 1, "Matrix.get", tensor->rows);
+    size_t col = builtin_index_arg(args, 2, "Matrix.get", tensor->cols);
+    return value_from_double(tensor->data[row * tensor->cols + col]);
+}
+
+// Activations map over every element of a tensor, or apply to a single number
+Value builtin_activation(const Value* args, Activation activation) {
+    if (value_is_tensor(args[0])) {
+        return builtin_tensor_value(core_runtime_tensor_activation(activation, value_as_tensor(args[0])));
     }
-    return left;
+    double x = builtin_number_arg(args, 0);
+    core_runtime_activation(activation, &x, &x, 1);
+    return value_from_double(x);
+}
+
+Value builtin_relu(const Value* args) {
+    return builtin_activation(args, ACTIVATION_RELU);
+}
+
+Value builtin_sigmoid(const Value* args) {
+    return builtin_activation(args, ACTIVATION_SIGMOID);
+}
+
+Value builtin_tanh(const Value* args) {
+    return builtin_activation(args, ACTIVATION_TANH);
+}
+
+// Row-wise: each row of the result sums to 1
+Value builtin_softmax(const Value* args) {
+    return builtin_tensor_value(core_runtime_tensor_softmax(builtin_tensor_arg(args, 0)));
+}
+
+// Buddhimatta.Param(t) makes t trainable and returns it
+Value builtin_param(const Value* args) {
+    core_runtime_autodiff_param(builtin_tensor_arg(args, 0));
+    return args[0];
+}
+
+// Buddhimatta.GhanaSthara(x, w, b) is a dense layer, x w + b, computed and
+// differentiated as one operation
+Value builtin_dense(const Value* args) {
+    HeapTensor* x = builtin_tensor_arg(args, 0);
+    HeapTensor* w = builtin_tensor_arg(args, 1);
+    HeapTensor* b = builtin_tensor_arg(args, 2);
+    char message[200];
+    if (x->cols != w->rows) {
+        snprintf(message, sizeof(message), "Runtime Error: Buddhimatta.GhanaSthara shapes (%zu, %zu) and (%zu, %zu) are not aligned.",
+                 x->rows, x->cols, w->rows, w->cols);
+        core_runtime_panic(message);
+    }
+    if (b->rows != 1 || b->cols != w->cols) {
+        snprintf(message, sizeof(message), "Runtime Error: Buddhimatta.GhanaSthara expects a (1, %zu) bias, got (%zu, %zu).",
+                 w->cols, b->rows, b->cols);
+        core_runtime_panic(message);
+    }
+    return builtin_tensor_value(core_runtime_tensor_affine(x, w, b));
+}
+
+// Losses compare two tensors of the same shape
+void builtin_check_same_shape(const Value* args, const char* name) {
+    HeapTensor* a = builtin_tensor_arg(args, 0);
+    HeapTensor* b = builtin_tensor_arg(args, 1);
+    if (a->rows != b->rows || a->cols != b->cols) {
+        char message[200];
+        snprintf(message, sizeof(message), "Runtime Error: %s shapes (%zu, %zu) and (%zu, %zu) differ.",
+                 name, a->rows, a->cols, b->rows, b->cols);
+        core_runtime_panic(message);
+    }
+}
+
+Value builtin_mse(const Value* args) {
+    builtin_check_same_shape(args, "Buddhimatta.MSE");
+    return value_from_double(core_runtime_tensor_mse(builtin_tensor_arg(args, 0), builtin_tensor_arg(args, 1)));
+}
+
+// Buddhimatta.CrossEntropy(logits, labels): softmax and cross-entropy in one
+Value builtin_cross_entropy(const Value* args) {
+    builtin_check_same_shape(args, "Buddhimatta.CrossEntropy");
+    return value_from_double(core_runtime_tensor_cross_entropy(builtin_tensor_arg(args, 0), builtin_tensor_arg(args, 1)));
+}
+
+// Buddhimatta.AdamOptimizer(learning_rate) sets the learning rate of later steps
+Value builtin_adam(const Value* args) {
+    double rate = builtin_number_arg(args, 0);
+    if (!(rate > 0.0)) {
+        char text[48];
+        char message[160];
+        value_format(args[0], text, sizeof(text));
+        snprintf(message, sizeof(message), "Runtime Error: Buddhimatta.AdamOptimizer expects a positive learning rate, got %s.", text);
+        core_runtime_panic(message);
+    }
+    AdamSettings settings;
+    core_runtime_adam_settings(&settings);
+    settings.learning_rate = rate;
+    core_runtime_adam_configure(&settings);
+    return args[0];
+}
+
+// Buddhimatta.Step() backpropagates this step's losses, updates every
+// parameter they depend on with Adam and returns the loss
+Value builtin_step(const Value* args) {
+    (void)args;
+    return value_from_double(core_runtime_autodiff_step());
+}
+
+// Buddhimatta.Reset() forgets the forward pass recorded so far, losses
+// included, and returns how many operations it recorded
+Value builtin_autodiff_reset(const Value* args) {
+    (void)args;
+    AutodiffStats stats;
+    core_runtime_autodiff_reset();
+    core_runtime_autodiff_stats(&stats);
+    return value_from_int64((int64_t)stats.nodes);
+}
+
+// Parallel.threads(n) sets the number of threads tensor kernels may use (0
+// restores the default) and returns the count now in effect
+Value builtin_parallel_threads(const Value* args) {
+    int64_t threads = builtin_index_arg(args, 0, "Parallel.threads", INT_MAX);
+    core_runtime_set_threads((int)threads);
+    return value_from_int64(core_runtime_threads());
+}
+
+// Parallel.deterministic(satya) makes reductions independent of the thread count
+Value builtin_parallel_deterministic(const Value* args) {
+    core_runtime_set_deterministic(builtin_bool_arg(args, 0));
+    return value_from_bool(core_runtime_deterministic());
+}
+
+// Prashna.puccha(prompt, context) asks a language model and returns a future
+// without waiting; the context may be any value
+Value builtin_prashna_ask(const Value* args) {
+    const HeapString* prompt = (const HeapString*)value_as_heap(args[0]);
+    if (value_is_string(args[1])) {
+        const HeapString* context = (const HeapString*)value_as_heap(args[1]);
+        return core_runtime_prashna_ask(prompt->chars, prompt->length, context->chars, context->length);
+    }
+    char context[RUNTIME_ERROR_SIZE];
+    value_format(args[1], context, sizeof(context));
+    return core_runtime_prashna_ask(prompt->chars, prompt->length, context, strlen(context));
+}
+
+// Prashna.pratiksha(future) waits for the answer
+Value builtin_prashna_await(const Value* args) {
+    return core_runtime_prashna_await(args[0]);
+}
+
+// Prashna.batch(size, window_ms) sets how queries are batched and returns the
+// batch size now in effect
+Value builtin_prashna_batch(const Value* args) {
+    size_t size = builtin_dimension_arg(args, 0, "Prashna.batch");
+    size_t window = builtin_index_arg(args, 1, "Prashna.batch", INT_MAX);
+    core_runtime_prashna_set_batching(size, (int)window);
+    return value_from_int64((int64_t)core_runtime_prashna_batch_size());
+}
+
+// Prashna.batches() is the number of batches sent to the backend so far
+Value builtin_prashna_batches(const Value* args) {
+    (void)args;
+    PrashnaStats stats;
+    core_runtime_prashna_stats(&stats);
+    return value_from_int64((int64_t)stats.batches);
+}
+
+const NativeBinding builtins[] = {
+    {"Matrix.zeros", 2, {NATIVE_INT, NATIVE_INT}, builtin_matrix_zeros},
+    {"Matrix.ones", 2, {NATIVE_INT, NATIVE_INT}, builtin_matrix_ones},
+    {"Matrix.fill", 3, {NATIVE_INT, NATIVE_INT, NATIVE_NUMBER}, builtin_matrix_fill},
+    {"Matrix.random", 2, {NATIVE_INT, NATIVE_INT}, builtin_matrix_random},
+    {"Matrix.range", 2, {NATIVE_INT, NATIVE_INT}, builtin_matrix_range},
+    {"Matrix.multiply", 2, {NATIVE_TENSOR, NATIVE_TENSOR}, builtin_matrix_multiply},
+    {"Matrix.add", 2, {NATIVE_NUMERIC, NATIVE_NUMERIC}, builtin_matrix_add},
+    {"Matrix.transpose", 1, {NATIVE_TENSOR}, builtin_matrix_transpose},
+    {"Matrix.sum", 1, {NATIVE_TENSOR}, builtin_matrix_sum},
+    {"Matrix.mean", 1, {NATIVE_TENSOR}, builtin_matrix_mean},
+    {"Matrix.max", 1, {NATIVE_TENSOR}, builtin_matrix_max},
+    {"Matrix.min", 1, {NATIVE_TENSOR}, builtin_matrix_min},
+    {"Matrix.rows", 1, {NATIVE_TENSOR}, builtin_matrix_rows},
+    {"Matrix.cols", 1, {NATIVE_TENSOR}, builtin_matrix_cols},
+    {"Matrix.get", 3, {NATIVE_TENSOR, NATIVE_INT, NATIVE_INT}, builtin_matrix_get},
+    {"Buddhimatta.Relu", 1, {NATIVE_NUMERIC}, builtin_relu},
+    {"Buddhimatta.Sigmoid", 1, {NATIVE_NUMERIC}, builtin_sigmoid},
+    {"Buddhimatta.Tanh", 1, {NATIVE_NUMERIC}, builtin_tanh},
+    {"Buddhimatta.Softmax", 1, {NATIVE_TENSOR}, builtin_softmax},
+    {"Buddhimatta.Param", 1, {NATIVE_TENSOR}, builtin_param},
+    {"Buddhimatta.GhanaSthara", 3, {NATIVE_TENSOR, NATIVE_TENSOR, NATIVE_TENSOR}, builtin_dense},
+    {"Buddhimatta.MSE", 2, {NATIVE_TENSOR, NATIVE_TENSOR}, builtin_mse},
+    {"Buddhimatta.CrossEntropy", 2, {NATIVE_TENSOR, NATIVE_TENSOR}, builtin_cross_entropy},
+    {"Buddhimatta.AdamOptimizer", 1, {NATIVE_NUMBER}, builtin_adam},
+    {"Buddhimatta.Step", 0, {0}, builtin_step},
+    {"Buddhimatta.Reset", 0, {0}, builtin_autodiff_reset},
+    {"Parallel.threads", 1, {NATIVE_INT}, builtin_parallel_threads},
+    {"Parallel.deterministic", 1, {NATIVE_BOOL}, builtin_parallel_deterministic},
+    {"Prashna.puccha", 2, {NATIVE_STRING, NATIVE_ANY}, builtin_prashna_ask},
+    {"Prashna.pratiksha", 1, {NATIVE_FUTURE}, builtin_prashna_await},
+    {"Prashna.batch", 2, {NATIVE_INT, NATIVE_INT}, builtin_prashna_batch},
+    {"Prashna.batches", 0, {0}, builtin_prashna_batches},
+    // Add other built-in functions here
+    {NULL, 0, {0}, NULL} // Sentinel
+};
+
+// Binds the table above, then the standard library's natives. Called once at
+// startup, before anything is parsed, so it also checks the keyword table.
+void builtins_bind(void) {
+    lexer_check_keywords();
+    core_runtime_native_bind_table(builtins);
+    core_runtime_native_bind_stdlib();
+}
+
+// Whether `node` is a literal; if so, stores its value in *value
+int builtin_literal_value(const ASTNode* node, Value* value) {
+    switch (node->type) {
+        case NODE_NUMBER: *value = node->data.number_val; return 1;
+        case NODE_STRING: *value = node->data.string_val; return 1;
+        case NODE_BOOL: *value = node->data.bool_val; return 1;
+        default: return 0;
+    }
+}
+
+
+// --- Parser ---
+typedef struct {
+    Lexer* lexer;
+    Arena* arena; // Owns every node built by this parser
+    Token current_token;
+    Token peek_token; // For 1-token lookahead
+} Parser;
+
+void parser_init(Parser* parser, Lexer* lexer, Arena* arena) {
+    parser->lexer = lexer;
+    parser->arena = arena;
+    // Prime the parser with two tokens for lookahead
+    parser->current_token = lexer_get_next_token(parser->lexer);
+    parser->peek_token = lexer_get_next_token(parser->lexer);
+}
+
+// Consumes current_token and fetches next_token
+void parser_advance(Parser* parser) {
+    parser->current_token = parser->peek_token;
+    parser->peek_token = lexer_get_next_token(parser->lexer);
+}
+
+// Checks if current token matches expected type(s) and advances
+void parser_expect(Parser* parser, TokenType type) {
+    if (parser->current_token.type == type) {
+        parser_advance(parser);
+    } else {
+        raise_error("Syntax Error: Expected token type %d, but got %d ('%.*s') at line %d, column %d.",
+                type, parser->current_token.type, (int)parser->current_token.length,
+                lexer_token_text(parser->lexer, parser->current_token), parser->current_token.line, parser->current_token.column);
+    }
+}
+
+// Function to consume newlines
+void parser_consume_newlines(Parser* parser) {
+    while (parser->current_token.type == TOKEN_NEWLINE) {
+        parser_advance(parser);
+    }
+}
+
+// Forward declarations for recursive descent parsing
+ASTNode* parse_expression(Parser* parser);
+ASTNode* parse_term(Parser* parser);
+ASTNode* parse_factor(Parser* parser);
+ASTNode* parse_call(Parser* parser);
+ASTNode* parser_finish_call(Parser* parser, int builtin, int symbol, ASTNode** args, Token name);
+ASTNode* parse_prashna(Parser* parser);
+const char* parse_string_literal(Parser* parser, Token token, size_t* length);
+ASTNode* parse_statement(Parser* parser);
+
+// Main parsing function. The statement array lives in the parser's arena with
+// the nodes, so a parse that stops on a syntax error leaks nothing.
+ASTNode** parse_program(Parser* parser, int* num_statements) {
+    ASTNode** statements = NULL;
+    *num_statements = 0;
+    int capacity = 16; // Initial capacity
+
+    statements = (ASTNode**)arena_alloc(parser->arena, sizeof(ASTNode*) * capacity);
+
+    parser_consume_newlines(parser); // Consume leading newlines
+
+    while (parser->current_token.type != TOKEN_EOF) {
+        if (*num_statements >= capacity) {
+            // Outgrown arrays stay in the arena; together they are smaller than the final one
+            ASTNode** grown = (ASTNode**)arena_alloc(parser->arena, sizeof(ASTNode*) * capacity * 2);
+            memcpy(grown, statements, sizeof(ASTNode*) * capacity);
+            statements = grown;
+            capacity *= 2;
+        }
+
+        ASTNode* stmt = parse_statement(parser);
+        if (stmt) { // Only add if a statement was successfully parsed
+            statements[(*num_statements)++] = stmt;
+        }
+        parser_consume_newlines(parser); // Consume newlines after each statement
+    }
+    return statements;
+}
+
+ASTNode* parse_statement(Parser* parser) {
+    ASTNode* node = NULL;
+    int line = parser->current_token.line;
+    if (parser->current_token.type == TOKEN_PRINT) {
+        parser_advance(parser); // Consume darshaya
+        parser_expect(parser, TOKEN_LPAREN);
+        ASTNode* expr = parse_expression(parser);
+        parser_expect(parser, TOKEN_RPAREN);
+        node = create_print_node(parser->arena, expr);
+    } else if (parser->current_token.type == TOKEN_IDENTIFIER && parser->peek_token.type == TOKEN_ASSIGN) {
+        Token var_name = parser->current_token; // Store token before advance
+        parser_advance(parser); // Consume identifier
+        parser_advance(parser); // Consume '='
+        ASTNode* expr = parse_expression(parser);
+        node = create_assign_node(parser->arena, parser->lexer->symbols->names[var_name.symbol], var_name.symbol, expr);
+    } else if (parser->current_token.type == TOKEN_IDENTIFIER && parser->peek_token.type == TOKEN_LPAREN) {
+        node = parse_call(parser); // Call statement, e.g. Parallel.threads(8)
+    } else if (parser->current_token.type == TOKEN_IMPORT) {
+        parser_advance(parser); // Consume pratibandha
+        Token path = parser->current_token;
+        if (path.type != TOKEN_STRING) {
+            raise_error("Syntax Error: Expected a module path string after 'pratibandha' at line %d, column %d.",
+                    path.line, path.column);
+        }
+        size_t length;
+        const char* text = parse_string_literal(parser, path, &length);
+        node = create_import_node(parser->arena, text, length);
+        parser_advance(parser);
+    } else if (parser->current_token.type == TOKEN_ASK) {
+        node = parse_prashna(parser);
+    } else if (parser->current_token.type >= TOKEN_MODULE && parser->current_token.type <= TOKEN_DOC) {
+        raise_error("Syntax Error: '%.*s' at line %d, column %d is reserved for module definitions, which are not supported yet.",
+                (int)parser->current_token.length, lexer_token_text(parser->lexer, parser->current_token),
+                parser->current_token.line, parser->current_token.column);
+    } else if (parser->current_token.type == TOKEN_NEWLINE) {
+        parser_advance(parser); // Consume newline, try parsing next statement
+        return NULL; // Indicate no actual statement was parsed, just a newline
+    } else {
+        raise_error("Syntax Error: Unexpected token for statement '%.*s' at line %d, column %d.",
+                (int)parser->current_token.length, lexer_token_text(parser->lexer, parser->current_token),
+                parser->current_token.line, parser->current_token.column);
+    }
+    node->line = line;
+    return node;
+}
+
+
+// Expression parsing (precedence climbing)
+ASTNode* parse_expression(Parser* parser) {
+    ASTNode* left = parse_term(parser);
+
+    while (parser->current_token.type == TOKEN_PLUS || parser->current_token.type == TOKEN_MINUS) {
+        TokenType op = parser->current_token.type;
+        parser_advance(parser);
+        ASTNode* right = parse_term(parser);
+        left = create_binop_node(parser->arena, left, op, right);
+    }
+    return left;
+}
+
+ASTNode* parse_term(Parser* parser) {
+    ASTNode* left = parse_factor(parser);
+
+    while (parser->current_token.type == TOKEN_TIMES || parser->current_token.type == TOKEN_DIVIDE) {
+        TokenType op = parser->current_token.type;
+        parser_advance(parser);
+        ASTNode* right = parse_factor(parser);
+        left = create_binop_node(parser->arena, left, op, right);
+    }
+    return left;
+}
+
+// Number literals with a fraction or exponent are copied out for strtod,
+// since the source is not NUL-terminated
+Value parse_double_literal(const char* text, size_t length) {
+    char buffer[128];
+    char* copy = length < sizeof(buffer) ? buffer : (char*)core_runtime_alloc(MEMORY_PARSER, length + 1);
+    if (!copy) raise_error("Memory allocation failed for number literal.");
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    double value = strtod(copy, NULL);
+    if (copy != buffer) core_runtime_free(copy);
+    return value_from_double(value);
+}
+
+// Integer literals are converted straight from the slice; those past int64
+// become bigints
+Value parse_number_literal(Parser* parser, Token token) {
+    const char* text = lexer_token_text(parser->lexer, token);
+    uint64_t value = 0;
+    for (size_t i = 0; i < token.length; i++) {
+        unsigned digit = (unsigned)(text[i] - '0');
+        if (digit > 9) return parse_double_literal(text, token.length); // '.', 'e' or 'E'
+        if (value > ((uint64_t)INT64_MAX - digit) / 10) {
+            for (size_t j = i; j < token.length; j++) {
+                if (!isdigit((unsigned char)text[j])) return parse_double_literal(text, token.length);
+            }
+            Value big;
+            if (value_parse_int(text, token.length, &big) != VALUE_OK) {
+                raise_error("Syntax Error: Integer literal at line %d, column %d is too large (%zu digits).",
+                        token.line, token.column, token.length);
+            }
+            return big;
+        }
+        value = value * 10 + digit;
+    }
+    return value_from_int64((int64_t)value);
+}
+
+// The text between a string literal's quotes. Literals are stored without
+// their quotes, so a string's value is the same wherever it came from.
+const char* parse_string_literal(Parser* parser, Token token, size_t* length) {
+    const char* text = lexer_token_text(parser->lexer, token);
+    if (token.length < 2 || text[token.length - 1] != '"') {
+        raise_error("Syntax Error: Unterminated string at line %d, column %d.", token.line, token.column);
+    }
+    *length = token.length - 2;
+    return text + 1;
 }
 
 ASTNode* parse_factor(Parser* parser) {
     ASTNode* node = NULL;
-    if (parser->current_token.type == TOKEN_NUMBER) {
-        node = create_number_node(atoi(parser->current_token.value));
+    Token token = parser->current_token;
+    if (token.type == TOKEN_NUMBER) {
+        node = create_number_node(parser->arena, parse_number_literal(parser, token));
+        parser_advance(parser);
+    } else if (token.type == TOKEN_TRUE || token.type == TOKEN_FALSE) {
+        node = create_bool_node(parser->arena, token.type == TOKEN_TRUE);
         parser_advance(parser);
-    } else if (parser->current_token.type == TOKEN_STRING) {
-        node = create_string_node(parser->current_token.value);
+    } else if (token.type == TOKEN_STRING) {
+        size_t length;
+        const char* chars = parse_string_literal(parser, token, &length);
+        node = create_string_node(parser->arena, chars, length);
         parser_advance(parser);
-    } else if (parser->current_token.type == TOKEN_IDENTIFIER) {
-        node = create_var_node(parser->current_token.value);
+    } else if (token.type == TOKEN_IDENTIFIER && parser->peek_token.type == TOKEN_LPAREN) {
+        node = parse_call(parser);
+    } else if (token.type == TOKEN_IDENTIFIER) {
+        node = create_var_node(parser->arena, parser->lexer->symbols->names[token.symbol], token.symbol);
         parser_advance(parser);
     } else if (parser->current_token.type == TOKEN_LPAREN) {
         parser_advance(parser); // Consume '('
         node = parse_expression(parser);
         parser_expect(parser, TOKEN_RPAREN); // Consume ')'
     } else {
-        fprintf(stderr, "Syntax Error: Unexpected token '%s' for factor at line %d, column %d.\n",
-                parser->current_token.value, parser->current_token.line, parser->current_token.column);
-        exit(1);
+        raise_error("Syntax Error: Unexpected token '%.*s' for factor at line %d, column %d.",
+                (int)parser->current_token.length, lexer_token_text(parser->lexer, parser->current_token),
+                parser->current_token.line, parser->current_token.column);
+    }
+    return node;
+}
+
+// Built-in call: name '(' [expression {',' expression}] ')'
+ASTNode* parse_call(Parser* parser) {
+    Token name = parser->current_token;
+    const char* text = lexer_token_text(parser->lexer, name);
+    int builtin = core_runtime_native_lookup(text, name.length);
+    if (builtin < 0) {
+        raise_error("Name Error: Function '%.*s' not found at line %d, column %d.",
+                (int)name.length, text, name.line, name.column);
+    }
+    parser_advance(parser); // Consume the name
+    parser_expect(parser, TOKEN_LPAREN);
+
+    const NativeBinding* native = &core_runtime_natives()[builtin];
+    int arity = native->arity;
+    ASTNode** args = (ASTNode**)arena_alloc(parser->arena, sizeof(ASTNode*) * (arity ? arity : 1));
+    int num_args = 0;
+    if (parser->current_token.type != TOKEN_RPAREN) {
+        while (1) {
+            ASTNode* arg = parse_expression(parser);
+            if (num_args < arity) args[num_args] = arg;
+            num_args++;
+            if (parser->current_token.type != TOKEN_COMMA) break;
+            parser_advance(parser); // Consume ','
+        }
+    }
+    parser_expect(parser, TOKEN_RPAREN);
+    if (num_args != arity) {
+        raise_error("Syntax Error: %s takes %d argument%s, got %d at line %d, column %d.",
+                native->name, arity, arity == 1 ? "" : "s", num_args, name.line, name.column);
+    }
+    return parser_finish_call(parser, builtin, name.symbol, args, name);
+}
+
+// Builds the call node once its arguments are parsed, checking the types of
+// literal arguments. `name` is where errors are reported.
+ASTNode* parser_finish_call(Parser* parser, int builtin, int symbol, ASTNode** args, Token name) {
+    const NativeBinding* native = &core_runtime_natives()[builtin];
+    int typed = 1;
+    for (int i = 0; i < native->arity; i++) {
+        Value literal;
+        if (!builtin_literal_value(args[i], &literal)) {
+            typed = 0;
+        } else if (!core_runtime_native_accepts(native->params[i], literal)) {
+            raise_error("Type Error: %s expects %s for argument %d, got '%s' at line %d, column %d.",
+                    native->name, core_runtime_native_type_name(native->params[i]), i + 1,
+                    value_type_name(value_type(literal)), name.line, name.column);
+        }
+    }
+    ASTNode* node = create_call_node(parser->arena, builtin, parser->lexer->symbols->names[symbol], args, native->arity);
+    node->data.call.typed = typed;
+    return node;
+}
+
+// `prashna name: prompt saha context` asks without waiting, as
+// name = Prashna.puccha(prompt, context). Without `saha` the context is empty.
+ASTNode* parse_prashna(Parser* parser) {
+    Token keyword = parser->current_token;
+    parser_advance(parser); // Consume prashna
+    Token name = parser->current_token;
+    if (name.type != TOKEN_IDENTIFIER) {
+        raise_error("Syntax Error: Expected a variable name after 'prashna' at line %d, column %d.",
+                name.line, name.column);
+    }
+    parser_advance(parser);
+    parser_expect(parser, TOKEN_COLON);
+    ASTNode** args = (ASTNode**)arena_alloc(parser->arena, sizeof(ASTNode*) * 2);
+    args[0] = parse_expression(parser);
+    if (parser->current_token.type == TOKEN_WITH) {
+        parser_advance(parser); // Consume saha
+        args[1] = parse_expression(parser);
+    } else {
+        args[1] = create_string_node(parser->arena, "", 0);
+    }
+    static const char ask[] = "Prashna.puccha";
+    int symbol = symbol_intern(parser->lexer->symbols, ask, sizeof(ask) - 1);
+    ASTNode* call = parser_finish_call(parser, core_runtime_native_lookup(ask, sizeof(ask) - 1), symbol, args, keyword);
+    return create_assign_node(parser->arena, parser->lexer->symbols->names[name.symbol], name.symbol, call);
+}
+
+// --- Parallel parsing ---
+// Statements end at newlines, so a large source is cut into chunks at
+// newlines outside string literals and comments, and each chunk is lexed and
+// parsed on the thread pool by its own Lexer and Parser, into its own arena
+// and symbol table. Finding the cuts is parallel too: each region of the
+// source is scanned once for every state it might start in (code, string,
+// comment), and chaining the regions' end states gives the true ones.
+// Afterwards the chunks' names are interned into the shared table in chunk
+// order, which gives every name the slot a single-threaded parse would have,
+// and the chunks' trees are renumbered to those slots. The result, errors
+// included, is the same as parse_program's for any thread count.
+#define PARSE_PARALLEL_MIN_BYTES (1024 * 1024) // Smaller sources are parsed on the calling thread
+#define PARSE_CHUNK_BYTES (256 * 1024)         // Smallest region worth a chunk of its own
+#define PARSE_CHUNKS_PER_THREAD 4
+
+// Where a byte of the source is, as far as the lexer is concerned
+typedef enum {
+    SCAN_CODE,
+    SCAN_STRING,
+    SCAN_COMMENT,
+    SCAN_STATES
+} ScanState;
+
+typedef struct {
+    size_t begin;
+    size_t end;
+    ScanState end_state[SCAN_STATES]; // State after the region, for each state it may start in
+    int newlines;
+} ParseRegion;
+
+typedef struct {
+    size_t begin;
+    size_t end;
+    int line;              // Source line of the chunk's first byte
+    SymbolTable symbols;
+    Arena arena;
+    ASTNode** statements;
+    int num_statements;
+    int* slots;            // Chunk slot -> slot in the shared table
+    char error[RUNTIME_ERROR_SIZE];
+} ParseChunk;
+
+typedef struct {
+    const char* code;
+    ParseRegion* regions;
+    ParseChunk* chunks;
+    const SymbolTable* symbols;
+} ParseJob;
+
+ScanState parse_scan_step(ScanState state, char c) {
+    switch (state) {
+        case SCAN_STRING: return c == '"' ? SCAN_CODE : SCAN_STRING;
+        case SCAN_COMMENT: return c == '\n' ? SCAN_CODE : SCAN_COMMENT;
+        default: return c == '"' ? SCAN_STRING : c == '#' ? SCAN_COMMENT : SCAN_CODE;
+    }
+}
+
+// The three guesses usually agree within a line or two; from there on one
+// scan serves them all
+void parse_scan_range(void* context, size_t begin, size_t end) {
+    ParseJob* job = (ParseJob*)context;
+    for (size_t r = begin; r < end; r++) {
+        ParseRegion* region = &job->regions[r];
+        const char* code = job->code;
+        ScanState states[SCAN_STATES] = {SCAN_CODE, SCAN_STRING, SCAN_COMMENT};
+        size_t i = region->begin;
+        for (; i < region->end && (states[0] != states[1] || states[1] != states[2]); i++) {
+            for (int s = 0; s < SCAN_STATES; s++) states[s] = parse_scan_step(states[s], code[i]);
+        }
+        if (states[0] == states[1] && states[1] == states[2]) {
+            for (; i < region->end; i++) states[0] = parse_scan_step(states[0], code[i]);
+            states[1] = states[2] = states[0];
+        }
+        memcpy(region->end_state, states, sizeof(states));
+        region->newlines = 0;
+        const char* p = code + region->begin;
+        while ((p = memchr(p, '\n', code + region->end - p)) != NULL) {
+            region->newlines++;
+            p++;
+        }
+    }
+}
+
+// Runs on pool threads, so errors are trapped and kept in chunk->error for
+// parse_source to raise on the caller's thread
+void parse_chunk(const char* code, ParseChunk* chunk) {
+    RuntimeTrap trap;
+    core_runtime_trap_push(&trap);
+    if (setjmp(trap.jump) == 0) {
+        Lexer lexer;
+        lexer_init(&lexer, code + chunk->begin, chunk->end - chunk->begin, &chunk->symbols);
+        lexer.line = chunk->line;
+        Parser parser;
+        parser_init(&parser, &lexer, &chunk->arena);
+        chunk->statements = parse_program(&parser, &chunk->num_statements);
+        core_runtime_trap_pop(&trap);
+    } else {
+        memcpy(chunk->error, trap.message, sizeof(chunk->error));
+    }
+}
+
+void parse_chunk_range(void* context, size_t begin, size_t end) {
+    ParseJob* job = (ParseJob*)context;
+    for (size_t c = begin; c < end; c++) parse_chunk(job->code, &job->chunks[c]);
+}
+
+void parse_remap_node(ASTNode* node, const int* slots, const SymbolTable* symbols) {
+    switch (node->type) {
+        case NODE_VAR:
+            node->data.var.slot = slots[node->data.var.slot];
+            node->data.var.name = symbols->names[node->data.var.slot];
+            break;
+        case NODE_ASSIGN:
+            node->data.assign_op.slot = slots[node->data.assign_op.slot];
+            node->data.assign_op.var_name = symbols->names[node->data.assign_op.slot];
+            parse_remap_node(node->data.assign_op.expr, slots, symbols);
+            break;
+        case NODE_BINOP:
+            parse_remap_node(node->data.bin_op.left, slots, symbols);
+            parse_remap_node(node->data.bin_op.right, slots, symbols);
+            break;
+        case NODE_PRINT:
+            parse_remap_node(node->data.print_stmt.expr, slots, symbols);
+            break;
+        case NODE_CALL: {
+            const char* name = node->data.call.name;
+            node->data.call.name = symbols->names[symbol_lookup(symbols, name, strlen(name))];
+            for (int i = 0; i < node->data.call.num_args; i++) {
+                parse_remap_node(node->data.call.args[i], slots, symbols);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void parse_remap_range(void* context, size_t begin, size_t end) {
+    ParseJob* job = (ParseJob*)context;
+    for (size_t c = begin; c < end; c++) {
+        ParseChunk* chunk = &job->chunks[c];
+        for (int i = 0; i < chunk->num_statements; i++) {
+            parse_remap_node(chunk->statements[i], chunk->slots, job->symbols);
+        }
+    }
+}
+
+// Cuts [0, length) into chunks after the first newline outside a string in
+// each region. Returns the number of chunks.
+int parse_split(ParseJob* job, size_t length, int num_regions) {
+    ScanState state = SCAN_CODE;
+    int line = 1;
+    int num_chunks = 1;
+    job->chunks[0].begin = 0;
+    job->chunks[0].line = 1;
+    for (int r = 0; r < num_regions; r++) {
+        const ParseRegion* region = &job->regions[r];
+        if (r > 0) {
+            ScanState s = state;
+            int lines = line;
+            size_t i = region->begin;
+            while (i < length) {
+                char c = job->code[i++];
+                if (c == '\n') {
+                    lines++;
+                    if (s != SCAN_STRING) break;
+                }
+                s = parse_scan_step(s, c);
+            }
+            if (i < length && i > job->chunks[num_chunks - 1].begin) {
+                job->chunks[num_chunks].begin = i;
+                job->chunks[num_chunks].line = lines;
+                num_chunks++;
+            }
+        }
+        state = region->end_state[state];
+        line += region->newlines;
+    }
+    for (int c = 0; c < num_chunks; c++) {
+        job->chunks[c].end = c + 1 < num_chunks ? job->chunks[c + 1].begin : length;
+    }
+    return num_chunks;
+}
+
+void parse_chunks_free(ParseChunk* chunks, int num_chunks) {
+    for (int c = 0; c < num_chunks; c++) {
+        arena_free(&chunks[c].arena);
+        symbol_table_free(&chunks[c].symbols);
+        core_runtime_free(chunks[c].slots);
+    }
+}
+
+// Parses [code, code + length) like parse_program, interning names into
+// `symbols` and building the tree in `arena`; large sources are parsed on
+// several threads
+ASTNode** parse_source(const char* code, size_t length, SymbolTable* symbols, Arena* arena, int* num_statements) {
+    int threads = core_runtime_threads();
+    size_t max_regions = length / PARSE_CHUNK_BYTES;
+    if (threads > 1 && length >= PARSE_PARALLEL_MIN_BYTES && max_regions > 1) {
+        int num_regions = (int)(max_regions < (size_t)threads * PARSE_CHUNKS_PER_THREAD
+                                ? max_regions : (size_t)threads * PARSE_CHUNKS_PER_THREAD);
+        ParseJob job = {code, NULL, NULL, symbols};
+        job.regions = (ParseRegion*)core_runtime_calloc(MEMORY_PARSER, num_regions, sizeof(ParseRegion));
+        job.chunks = (ParseChunk*)core_runtime_calloc(MEMORY_PARSER, num_regions, sizeof(ParseChunk));
+        if (!job.regions || !job.chunks) {
+            core_runtime_free(job.regions);
+            core_runtime_free(job.chunks);
+            raise_error("Memory allocation failed for the parser.");
+        }
+        for (int r = 0; r < num_regions; r++) {
+            job.regions[r].begin = length / num_regions * r;
+            job.regions[r].end = r + 1 < num_regions ? length / num_regions * (r + 1) : length;
+        }
+        core_runtime_parallel_for((size_t)num_regions, 1, parse_scan_range, &job);
+        int num_chunks = parse_split(&job, length, num_regions);
+        core_runtime_free(job.regions);
+        for (int c = 0; c < num_chunks; c++) {
+            arena_init(&job.chunks[c].arena, ARENA_DEFAULT_CHUNK_SIZE, MEMORY_AST);
+        }
+        core_runtime_parallel_for((size_t)num_chunks, 1, parse_chunk_range, &job);
+
+        // The first error in the source is the one a single-threaded parse stops at
+        for (int c = 0; c < num_chunks; c++) {
+            if (!job.chunks[c].error[0]) continue;
+            char message[RUNTIME_ERROR_SIZE];
+            memcpy(message, job.chunks[c].error, sizeof(message));
+            parse_chunks_free(job.chunks, num_chunks);
+            core_runtime_free(job.chunks);
+            raise_error("%s", message);
+        }
+
+        int total = 0;
+        for (int c = 0; c < num_chunks; c++) {
+            ParseChunk* chunk = &job.chunks[c];
+            chunk->slots = (int*)core_runtime_alloc(MEMORY_PARSER, sizeof(int) * (chunk->symbols.count + 1));
+            if (!chunk->slots) {
+                parse_chunks_free(job.chunks, num_chunks);
+                core_runtime_free(job.chunks);
+                raise_error("Memory allocation failed for the parser.");
+            }
+            for (int s = 0; s < chunk->symbols.count; s++) {
+                const char* name = chunk->symbols.names[s];
+                chunk->slots[s] = symbol_intern(symbols, name, strlen(name));
+            }
+            total += chunk->num_statements;
+        }
+        core_runtime_parallel_for((size_t)num_chunks, 1, parse_remap_range, &job);
+
+        ASTNode** statements = (ASTNode**)arena_alloc(arena, sizeof(ASTNode*) * (total ? total : 1));
+        *num_statements = 0;
+        for (int c = 0; c < num_chunks; c++) {
+            ParseChunk* chunk = &job.chunks[c];
+            memcpy(statements + *num_statements, chunk->statements, sizeof(ASTNode*) * chunk->num_statements);
+            *num_statements += chunk->num_statements;
+            arena_adopt(arena, &chunk->arena);
+        }
+        parse_chunks_free(job.chunks, num_chunks);
+        core_runtime_free(job.chunks);
+        return statements;
+    }
+
+    Lexer lexer;
+    lexer_init(&lexer, code, length, symbols);
+    Parser parser;
+    parser_init(&parser, &lexer, arena);
+    return parse_program(&parser, num_statements);
+}
+
+// --- Optimization Passes ---
+// Passes run between parse_program and execution. The C grammar has no control
+// flow, so the whole program is one basic block and every analysis below is a
+// single forward or backward sweep over the statement list. Passes never change
+// observable behaviour: expressions that could raise a runtime error (reads of
+// unassigned variables, arithmetic on strings or bools, division by anything
+// but a non-zero literal) are left where they are. An import runs code the
+// passes cannot see, so it is a barrier: any variable may be read or
+// reassigned there.
+typedef struct {
+    ASTNode** statements;   // In `arena`; passes may replace the array
+    int num_statements;
+    Arena* arena;           // Owns nodes created by passes
+    SymbolTable* symbols;   // Temporaries introduced by passes are interned here
+    char summary[160];      // What the last pass did, for the stats report
+} OptimizerState;
+
+// What the optimizer knows statically about a slot or an expression's result
+typedef enum {
+    STATIC_UNKNOWN, // Unassigned, or may hold a string or bool
+    STATIC_NUMBER,  // Holds an int or a double
+    STATIC_INT,     // Holds an int
+} StaticKind;
+
+typedef struct {
+    const char* name;
+    int min_level; // Lowest -O level that enables the pass
+    void (*run)(OptimizerState* state);
+} OptimizationPass;
+
+// Initial slot kinds (StaticKind) come from the runtime so REPL lines see earlier assignments
+unsigned char* optimizer_slot_kinds(OptimizerState* state) {
+    int capacity = state->symbols->slot_capacity ? state->symbols->slot_capacity : 1;
+    unsigned char* kinds = (unsigned char*)core_runtime_calloc(MEMORY_OPTIMIZER, capacity, 1);
+    if (!kinds) raise_error("Memory allocation failed for optimizer.");
+    for (int i = 0; i < state->symbols->count; i++) {
+        if (!state->symbols->defined[i]) continue;
+        Value value = state->symbols->values[i];
+        kinds[i] = value_is_int(value) ? STATIC_INT : value_is_double(value) ? STATIC_NUMBER : STATIC_UNKNOWN;
+    }
+    return kinds;
+}
+
+// Kind of the value `node` produces if its evaluation succeeds. Arithmetic
+// on two numbers either fails or yields a number; with an operand of unknown
+// kind it may yield a tensor.
+StaticKind optimizer_expression_kind(ASTNode* node, const unsigned char* kinds) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            return value_is_int(node->data.number_val) ? STATIC_INT : STATIC_NUMBER;
+        case NODE_VAR:
+            return (StaticKind)kinds[node->data.var.slot];
+        case NODE_BINOP: {
+            StaticKind left = optimizer_expression_kind(node->data.bin_op.left, kinds);
+            StaticKind right = optimizer_expression_kind(node->data.bin_op.right, kinds);
+            if (left == STATIC_UNKNOWN || right == STATIC_UNKNOWN) return STATIC_UNKNOWN;
+            return left == STATIC_INT && right == STATIC_INT ? STATIC_INT : STATIC_NUMBER;
+        }
+        default:
+            return STATIC_UNKNOWN;
+    }
+}
+
+// Whether every argument of a call is known to have its parameter's type, so
+// the call can skip the check at run time
+int optimizer_call_is_typed(ASTNode* call, const unsigned char* kinds) {
+    const NativeBinding* native = &core_runtime_natives()[call->data.call.builtin];
+    for (int i = 0; i < call->data.call.num_args; i++) {
+        Value literal;
+        if (builtin_literal_value(call->data.call.args[i], &literal)) {
+            if (!core_runtime_native_accepts(native->params[i], literal)) return 0;
+            continue;
+        }
+        StaticKind kind = optimizer_expression_kind(call->data.call.args[i], kinds);
+        NativeType type = kind == STATIC_INT ? NATIVE_INT : kind == STATIC_NUMBER ? NATIVE_NUMBER : NATIVE_ANY;
+        if ((type & ~native->params[i]) != 0) return 0;
+    }
+    return 1;
+}
+
+// A division is only safe to move, fold or drop if its divisor is a non-zero
+// literal. Ints are canonical, so the only zero int is the small int 0.
+int optimizer_division_is_safe(ASTNode* divisor) {
+    if (divisor->type != NODE_NUMBER) return 0;
+    Value value = divisor->data.number_val;
+    return value_is_int(value) ? value != value_from_small_int(0) : value_as_double(value) != 0.0;
+}
+
+// Whether evaluating `node` can fail, given what each slot is known to hold
+int optimizer_expression_is_safe(ASTNode* node, const unsigned char* kinds) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            return 1;
+        case NODE_VAR:
+            return kinds[node->data.var.slot] >= STATIC_NUMBER;
+        case NODE_BINOP:
+            if (node->data.bin_op.op == TOKEN_DIVIDE && !optimizer_division_is_safe(node->data.bin_op.right)) {
+                return 0;
+            }
+            return optimizer_expression_is_safe(node->data.bin_op.left, kinds) &&
+                   optimizer_expression_is_safe(node->data.bin_op.right, kinds);
+        default:
+            return 0;
+    }
+}
+
+// Maps a binary operator token to the runtime's arithmetic operation
+ValueOp optimizer_value_op(TokenType op) {
+    switch (op) {
+        case TOKEN_PLUS: return VALUE_OP_ADD;
+        case TOKEN_MINUS: return VALUE_OP_SUB;
+        case TOKEN_TIMES: return VALUE_OP_MUL;
+        default: return VALUE_OP_DIV;
+    }
+}
+
+// Constant folding with constant propagation
+typedef struct {
+    unsigned char* known; // Slot -> holds a compile-time constant
+    Value* values;
+    unsigned char* kinds; // Slot -> StaticKind
+    int folded;
+    int propagated;
+    int simplified;
+    int typed;            // Calls whose argument checks were removed
+} FoldState;
+
+void fold_expression(FoldState* fs, ASTNode* node) {
+    if (node->type == NODE_VAR) {
+        int slot = node->data.var.slot;
+        if (fs->known[slot]) {
+            node->type = NODE_NUMBER;
+            node->data.number_val = fs->values[slot];
+            fs->propagated++;
+        }
+        return;
+    }
+    if (node->type == NODE_CALL) {
+        for (int i = 0; i < node->data.call.num_args; i++) fold_expression(fs, node->data.call.args[i]);
+        if (!node->data.call.typed && optimizer_call_is_typed(node, fs->kinds)) {
+            node->data.call.typed = 1;
+            fs->typed++;
+        }
+        return;
+    }
+    if (node->type != NODE_BINOP) return;
+
+    ASTNode* left = node->data.bin_op.left;
+    ASTNode* right = node->data.bin_op.right;
+    TokenType op = node->data.bin_op.op;
+    fold_expression(fs, left);
+    fold_expression(fs, right);
+
+    if (left->type == NODE_NUMBER && right->type == NODE_NUMBER) {
+        // The runtime's own arithmetic, so bigint promotion and int/double promotion match exactly
+        Value result;
+        if (value_try_arith(optimizer_value_op(op), left->data.number_val, right->data.number_val, &result) != VALUE_OK) {
+            return; // Leave the runtime error in place
+        }
+        node->type = NODE_NUMBER;
+        node->data.number_val = result;
+        fs->folded++;
+        return;
+    }
+
+    // Algebraic identities that drop only an int literal. The kept operand must
+    // be known to be a number, since darshaya(s * 1) must still fail for a
+    // string s; x + 0 additionally needs an int, because -0.0 + 0 is 0.0.
+    Value zero = value_from_small_int(0);
+    Value one = value_from_small_int(1);
+    int right_zero = right->type == NODE_NUMBER && right->data.number_val == zero;
+    int right_one = right->type == NODE_NUMBER && right->data.number_val == one;
+    int left_zero = left->type == NODE_NUMBER && left->data.number_val == zero;
+    int left_one = left->type == NODE_NUMBER && left->data.number_val == one;
+    StaticKind left_kind = optimizer_expression_kind(left, fs->kinds);
+    StaticKind right_kind = optimizer_expression_kind(right, fs->kinds);
+    if ((op == TOKEN_PLUS && right_zero && left_kind == STATIC_INT) ||
+        (op == TOKEN_MINUS && right_zero && left_kind >= STATIC_NUMBER) ||
+        ((op == TOKEN_TIMES || op == TOKEN_DIVIDE) && right_one && left_kind >= STATIC_NUMBER)) {
+        *node = *left;
+        fs->simplified++;
+    } else if ((op == TOKEN_PLUS && left_zero && right_kind == STATIC_INT) ||
+               (op == TOKEN_TIMES && left_one && right_kind >= STATIC_NUMBER)) {
+        *node = *right;
+        fs->simplified++;
+    }
+}
+
+void pass_constant_folding(OptimizerState* state) {
+    FoldState fs = {0};
+    int capacity = state->symbols->slot_capacity ? state->symbols->slot_capacity : 1;
+    fs.known = (unsigned char*)core_runtime_calloc(MEMORY_OPTIMIZER, capacity, 1);
+    fs.values = (Value*)core_runtime_calloc(MEMORY_OPTIMIZER, capacity, sizeof(Value));
+    fs.kinds = optimizer_slot_kinds(state);
+    if (!fs.known || !fs.values) raise_error("Memory allocation failed for optimizer.");
+
+    for (int i = 0; i < state->num_statements; i++) {
+        ASTNode* stmt = state->statements[i];
+        if (stmt->type == NODE_ASSIGN) {
+            ASTNode* expr = stmt->data.assign_op.expr;
+            fold_expression(&fs, expr);
+            int slot = stmt->data.assign_op.slot;
+            fs.known[slot] = expr->type == NODE_NUMBER;
+            fs.values[slot] = expr->data.number_val;
+            fs.kinds[slot] = (unsigned char)optimizer_expression_kind(expr, fs.kinds);
+        } else if (stmt->type == NODE_PRINT) {
+            fold_expression(&fs, stmt->data.print_stmt.expr);
+        } else if (stmt->type == NODE_CALL) {
+            fold_expression(&fs, stmt);
+        } else if (stmt->type == NODE_IMPORT) {
+            memset(fs.known, 0, capacity);
+            memset(fs.kinds, STATIC_UNKNOWN, capacity);
+        }
+    }
+    snprintf(state->summary, sizeof(state->summary),
+             "%d expressions folded, %d constants propagated, %d identities simplified, %d calls typed",
+             fs.folded, fs.propagated, fs.simplified, fs.typed);
+    core_runtime_free(fs.known);
+    core_runtime_free(fs.values);
+    core_runtime_free(fs.kinds);
+}
+
+// Common subexpression elimination by value numbering. Every safe binary
+// operation gets a value number from (op, vn(left), vn(right)); a variable read
+// has the value number of whatever was last assigned to it. When a value is
+// computed a second time, its first occurrence is hoisted into a fresh
+// temporary just before the statement that contained it, and both
+// occurrences become reads of that temporary. Hoisting is only done for
+// expressions that cannot fail, so it never reorders observable effects.
+typedef struct {
+    int kind;    // TokenType for operators, -1 for literals
+    int a, b;    // Operand value numbers, or the literal's Value split in two halves
+    int vn;
+} ValueKey;
+
+typedef struct {
+    ASTNode* first;   // First occurrence of the value
+    int statement;    // Statement that contained it
+    int temp_slot;    // Temporary holding it once hoisted, -1 before
+} ValueInfo;
+
+typedef struct {
+    ValueKey* keys;       // Open-addressing table; vn < 0 marks an empty bucket
+    size_t capacity;
+    int num_keys;
+    ValueInfo* values;    // Value number -> info
+    int num_values;
+    int values_capacity;
+    int* slot_vn;         // Slot -> value number of its current contents, -1 if unknown
+    unsigned char* kinds; // Slot -> StaticKind
+    int slot_capacity;    // Size of slot_vn/kinds
+    ASTNode*** hoisted;   // Statement -> temporaries to assign before it
+    int* num_hoisted;
+    int replaced;
+    int temporaries;
+} CSEState;
+
+// Temporaries grow the symbol table; keeps the per-slot arrays in step
+void cse_sync_slots(CSEState* cs, SymbolTable* symbols) {
+    int capacity = symbols->slot_capacity ? symbols->slot_capacity : 1;
+    if (capacity <= cs->slot_capacity) return;
+    cs->slot_vn = (int*)core_runtime_realloc(MEMORY_OPTIMIZER, cs->slot_vn, sizeof(int) * capacity);
+    cs->kinds = (unsigned char*)core_runtime_realloc(MEMORY_OPTIMIZER, cs->kinds, capacity);
+    if (!cs->slot_vn || !cs->kinds) raise_error("Memory allocation failed for optimizer.");
+    for (int i = cs->slot_capacity; i < capacity; i++) {
+        cs->slot_vn[i] = -1;
+        cs->kinds[i] = STATIC_UNKNOWN;
+    }
+    cs->slot_capacity = capacity;
+}
+
+int cse_new_value(CSEState* cs, ASTNode* first, int statement) {
+    if (cs->num_values >= cs->values_capacity) {
+        cs->values_capacity = cs->values_capacity ? cs->values_capacity * 2 : 256;
+        cs->values = (ValueInfo*)core_runtime_realloc(MEMORY_OPTIMIZER, cs->values,
+                                                      sizeof(ValueInfo) * cs->values_capacity);
+        if (!cs->values) raise_error("Memory allocation failed for optimizer.");
+    }
+    cs->values[cs->num_values] = (ValueInfo){first, statement, -1};
+    return cs->num_values++;
+}
+
+unsigned int cse_hash(int kind, int a, int b) {
+    unsigned int hash = 2166136261u;
+    hash = (hash ^ (unsigned int)kind) * 16777619u;
+    hash = (hash ^ (unsigned int)a) * 16777619u;
+    hash = (hash ^ (unsigned int)b) * 16777619u;
+    return hash;
+}
+
+void cse_grow_keys(CSEState* cs) {
+    size_t new_capacity = cs->capacity ? cs->capacity * 2 : 256;
+    ValueKey* keys = (ValueKey*)core_runtime_alloc(MEMORY_OPTIMIZER, sizeof(ValueKey) * new_capacity);
+    if (!keys) raise_error("Memory allocation failed for optimizer.");
+    for (size_t i = 0; i < new_capacity; i++) keys[i].vn = -1;
+    for (size_t i = 0; i < cs->capacity; i++) {
+        if (cs->keys[i].vn < 0) continue;
+        size_t index = cse_hash(cs->keys[i].kind, cs->keys[i].a, cs->keys[i].b) & (new_capacity - 1);
+        while (keys[index].vn >= 0) index = (index + 1) & (new_capacity - 1);
+        keys[index] = cs->keys[i];
+    }
+    core_runtime_free(cs->keys);
+    cs->keys = keys;
+    cs->capacity = new_capacity;
+}
+
+// Finds the value number for (kind, a, b); *found tells whether it already existed
+int cse_lookup(CSEState* cs, int kind, int a, int b, ASTNode* node, int statement, int* found) {
+    if ((size_t)(cs->num_keys + 1) * 2 > cs->capacity) cse_grow_keys(cs);
+    size_t index = cse_hash(kind, a, b) & (cs->capacity - 1);
+    while (cs->keys[index].vn >= 0) {
+        ValueKey* key = &cs->keys[index];
+        if (key->kind == kind && key->a == a && key->b == b) {
+            *found = 1;
+            return key->vn;
+        }
+        index = (index + 1) & (cs->capacity - 1);
+    }
+    *found = 0;
+    cs->keys[index] = (ValueKey){kind, a, b, cse_new_value(cs, node, statement)};
+    cs->num_keys++;
+    return cs->keys[index].vn;
+}
+
+// Value number of `node`, or -1 if it is unsafe to reuse
+int cse_expression(CSEState* cs, OptimizerState* state, ASTNode* node, int statement) {
+    int found;
+    switch (node->type) {
+        case NODE_NUMBER: {
+            Value value = node->data.number_val;
+            return cse_lookup(cs, -1, (int)(uint32_t)value, (int)(uint32_t)(value >> 32), NULL, statement, &found);
+        }
+        case NODE_VAR: {
+            int slot = node->data.var.slot;
+            if (cs->kinds[slot] < STATIC_NUMBER) return -1;
+            if (cs->slot_vn[slot] < 0) cs->slot_vn[slot] = cse_new_value(cs, NULL, statement);
+            return cs->slot_vn[slot];
+        }
+        case NODE_BINOP: {
+            int left = cse_expression(cs, state, node->data.bin_op.left, statement);
+            int right = cse_expression(cs, state, node->data.bin_op.right, statement);
+            if (left < 0 || right < 0) return -1;
+            if (node->data.bin_op.op == TOKEN_DIVIDE && !optimizer_division_is_safe(node->data.bin_op.right)) {
+                return -1;
+            }
+            int vn = cse_lookup(cs, node->data.bin_op.op, left, right, node, statement, &found);
+            if (!found) return vn;
+
+            ValueInfo* info = &cs->values[vn];
+            if (info->temp_slot < 0) {
+                // Hoist the first occurrence: a copy feeds the temporary and the original becomes a read of it
+                char name[32];
+                // Numbered per run, so repeated runs (REPL lines, stream batches) reuse the same slots
+                snprintf(name, sizeof(name), "$t%d", cs->temporaries);
+                int temp = symbol_intern(state->symbols, name, strlen(name));
+                cse_sync_slots(cs, state->symbols);
+                cs->slot_vn[temp] = vn;
+                cs->kinds[temp] = STATIC_NUMBER; // Assigned before any statement that can read it
+                ASTNode* value = (ASTNode*)arena_alloc(state->arena, sizeof(ASTNode));
+                *value = *info->first;
+                const char* temp_name = state->symbols->names[temp];
+                ASTNode* assign = create_assign_node(state->arena, temp_name, temp, value);
+                int s = info->statement;
+                assign->line = state->statements[s]->line;
+                cs->hoisted[s] = (ASTNode**)core_runtime_realloc(MEMORY_OPTIMIZER, cs->hoisted[s],
+                                                                 sizeof(ASTNode*) * (cs->num_hoisted[s] + 1));
+                if (!cs->hoisted[s]) raise_error("Memory allocation failed for optimizer.");
+                cs->hoisted[s][cs->num_hoisted[s]++] = assign;
+                info->first->type = NODE_VAR;
+                info->first->data.var.name = temp_name;
+                info->first->data.var.slot = temp;
+                info->temp_slot = temp;
+                cs->temporaries++;
+            }
+            node->type = NODE_VAR;
+            node->data.var.name = state->symbols->names[info->temp_slot];
+            node->data.var.slot = info->temp_slot;
+            cs->replaced++;
+            return vn;
+        }
+        default:
+            return -1;
+    }
+}
+
+void pass_common_subexpressions(OptimizerState* state) {
+    CSEState cs = {0};
+    int n = state->num_statements;
+    cs.hoisted = (ASTNode***)core_runtime_calloc(MEMORY_OPTIMIZER, n ? n : 1, sizeof(ASTNode**));
+    cs.num_hoisted = (int*)core_runtime_calloc(MEMORY_OPTIMIZER, n ? n : 1, sizeof(int));
+    if (!cs.hoisted || !cs.num_hoisted) raise_error("Memory allocation failed for optimizer.");
+    cse_sync_slots(&cs, state->symbols);
+    unsigned char* initial_kinds = optimizer_slot_kinds(state);
+    memcpy(cs.kinds, initial_kinds, cs.slot_capacity);
+    core_runtime_free(initial_kinds);
+
+    for (int i = 0; i < n; i++) {
+        ASTNode* stmt = state->statements[i];
+        if (stmt->type == NODE_ASSIGN) {
+            StaticKind kind = optimizer_expression_kind(stmt->data.assign_op.expr, cs.kinds);
+            int vn = cse_expression(&cs, state, stmt->data.assign_op.expr, i);
+            int slot = stmt->data.assign_op.slot;
+            cs.slot_vn[slot] = vn; // -1 (unknown) if the value is not reusable
+            cs.kinds[slot] = (unsigned char)kind;
+        } else if (stmt->type == NODE_PRINT) {
+            cse_expression(&cs, state, stmt->data.print_stmt.expr, i);
+        } else if (stmt->type == NODE_IMPORT) {
+            for (int slot = 0; slot < cs.slot_capacity; slot++) cs.slot_vn[slot] = -1;
+            memset(cs.kinds, STATIC_UNKNOWN, cs.slot_capacity);
+        }
+    }
+
+    if (cs.temporaries > 0) {
+        ASTNode** statements = (ASTNode**)arena_alloc(state->arena, sizeof(ASTNode*) * (n + cs.temporaries));
+        int count = 0;
+        for (int i = 0; i < n; i++) {
+            for (int h = 0; h < cs.num_hoisted[i]; h++) statements[count++] = cs.hoisted[i][h];
+            statements[count++] = state->statements[i];
+        }
+        state->statements = statements;
+        state->num_statements = count;
+    }
+
+    snprintf(state->summary, sizeof(state->summary),
+             "%d redundant subexpressions replaced by %d temporaries", cs.replaced, cs.temporaries);
+    for (int i = 0; i < n; i++) core_runtime_free(cs.hoisted[i]);
+    core_runtime_free(cs.hoisted);
+    core_runtime_free(cs.num_hoisted);
+    core_runtime_free(cs.kinds);
+    core_runtime_free(cs.slot_vn);
+    core_runtime_free(cs.keys);
+    core_runtime_free(cs.values);
+}
+
+// Dead-store elimination: an assignment whose value is overwritten before it is
+// ever read is removed, provided evaluating it could not have failed. Values
+// still held at the end of the program are kept (the REPL can read them later).
+void mark_reads_live(ASTNode* node, unsigned char* live) {
+    if (node->type == NODE_VAR) {
+        live[node->data.var.slot] = 1;
+    } else if (node->type == NODE_BINOP) {
+        mark_reads_live(node->data.bin_op.left, live);
+        mark_reads_live(node->data.bin_op.right, live);
+    } else if (node->type == NODE_CALL) {
+        for (int i = 0; i < node->data.call.num_args; i++) mark_reads_live(node->data.call.args[i], live);
+    }
+}
+
+void pass_dead_stores(OptimizerState* state) {
+    int n = state->num_statements;
+    int capacity = state->symbols->slot_capacity ? state->symbols->slot_capacity : 1;
+    unsigned char* kinds = optimizer_slot_kinds(state);
+    unsigned char* safe = (unsigned char*)core_runtime_calloc(MEMORY_OPTIMIZER, n ? n : 1, 1);
+    unsigned char* live = (unsigned char*)core_runtime_alloc(MEMORY_OPTIMIZER, capacity);
+    if (!safe || !live) raise_error("Memory allocation failed for optimizer.");
+
+    // Forward sweep: can each assignment's right-hand side fail?
+    for (int i = 0; i < n; i++) {
+        ASTNode* stmt = state->statements[i];
+        if (stmt->type == NODE_ASSIGN) {
+            safe[i] = (unsigned char)optimizer_expression_is_safe(stmt->data.assign_op.expr, kinds);
+            kinds[stmt->data.assign_op.slot] = (unsigned char)optimizer_expression_kind(stmt->data.assign_op.expr, kinds);
+        } else if (stmt->type == NODE_IMPORT) {
+            memset(kinds, STATIC_UNKNOWN, capacity);
+        }
+    }
+
+    // Backward sweep over liveness
+    memset(live, 1, capacity);
+    int removed = 0;
+    for (int i = n - 1; i >= 0; i--) {
+        ASTNode* stmt = state->statements[i];
+        if (stmt->type == NODE_ASSIGN) {
+            int slot = stmt->data.assign_op.slot;
+            if (!live[slot] && safe[i]) {
+                state->statements[i] = NULL;
+                removed++;
+                continue;
+            }
+            live[slot] = 0;
+            mark_reads_live(stmt->data.assign_op.expr, live);
+        } else if (stmt->type == NODE_PRINT) {
+            mark_reads_live(stmt->data.print_stmt.expr, live);
+        } else if (stmt->type == NODE_CALL) {
+            mark_reads_live(stmt, live);
+        } else if (stmt->type == NODE_IMPORT) {
+            memset(live, 1, capacity);
+        }
+    }
+
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (state->statements[i]) state->statements[count++] = state->statements[i];
+    }
+    state->num_statements = count;
+    snprintf(state->summary, sizeof(state->summary), "%d dead stores removed", removed);
+    core_runtime_free(kinds);
+    core_runtime_free(safe);
+    core_runtime_free(live);
+}
+
+OptimizationPass optimization_passes[] = {
+    {"constant-folding", 1, pass_constant_folding},
+    {"common-subexpression-elimination", 2, pass_common_subexpressions},
+    {"dead-store-elimination", 2, pass_dead_stores},
+    {NULL, 0, NULL} // Sentinel
+};
+
+// Runs every pass enabled at `level` over statements whose slots belong to
+// `symbols`, printing what each one did if `report` is set. Returns the
+// (possibly replaced) statement array.
+ASTNode** optimize_statements(ASTNode** statements, int* num_statements, Arena* arena, SymbolTable* symbols,
+                              int level, int report) {
+    if (level <= 0) return statements;
+    OptimizerState state = {statements, *num_statements, arena, symbols, ""};
+    if (report) printf("\n--- Optimization (-O%d) ---\n", level);
+    for (int i = 0; optimization_passes[i].name != NULL; i++) {
+        if (level < optimization_passes[i].min_level) continue;
+        optimization_passes[i].run(&state);
+        if (report) printf("%s: %s.\n", optimization_passes[i].name, state.summary);
+    }
+    if (report) printf("Statements after optimization: %d.\n", state.num_statements);
+    *num_statements = state.num_statements;
+    return state.statements;
+}
+
+// --- Profiler ---
+// --profile records where a run spends its time as a calling-context tree.
+// The root is the script; below it are the script's source lines, and below a
+// line the natives it called and the modules it imported, whose own lines sit
+// below them in turn. Each transition (a statement starting, a native or a
+// module being entered or left) reads the clock once and charges the time
+// since the previous transition to the node that was running, so every node
+// gets its exact self time for one clock read and one hash lookup per
+// statement. A Profiler belongs to one session (its `profiler`, NULL when not
+// profiling); when profiling is off the interpreter and VM only test that
+// pointer per statement and call, and bytecode has no OP_LINE markers.
+#define PROFILE_DEFAULT_TOP 10
+
+typedef enum {
+    PROFILE_ROOT,
+    PROFILE_LINE,   // key: source line in the enclosing script or module
+    PROFILE_NATIVE, // key: native registry index
+    PROFILE_MODULE, // key: module registry index
+} ProfileKind;
+
+typedef struct {
+    int parent;       // -1 for the root
+    ProfileKind kind;
+    int key;
+    char* label;      // Script, module or native name; NULL for lines
+    long hits;
+    uint64_t self_ns;
+    uint64_t total_ns; // Filled in by the report
+    int* lines;        // Script and module: line -> child node + 1, 0 if none yet
+    int num_lines;
+} ProfileNode;
+
+// A native or module being run, or the script itself
+typedef struct {
+    int node;
+    int caller; // Node to charge again once it returns
+} ProfileFrame;
+
+typedef struct {
+    ProfileNode* nodes;
+    int count;
+    int capacity;
+    int* table;          // Natives and modules by (parent, kind, key): node index + 1, 0 if empty
+    int table_capacity;
+    int calls;           // Nodes in the table
+    ProfileFrame* frames;
+    int depth;
+    int frames_capacity;
+    int current;         // Node being charged; -1 while no program code runs
+    uint64_t last;       // Clock reading at the last transition
+    const char* folded_path;
+    int top;             // Rows in each table of the report
+} Profiler;
+
+uint64_t profile_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+// Charges the time since the last transition to the running node
+void profile_charge(Profiler* profiler) {
+    uint64_t now = profile_clock();
+    if (profiler->current >= 0) profiler->nodes[profiler->current].self_ns += now - profiler->last;
+    profiler->last = now;
+}
+
+size_t profile_slot(Profiler* profiler, int parent, ProfileKind kind, int key) {
+    uint64_t hash = ((uint64_t)(uint32_t)parent * 4 + kind) * 0x9E3779B97F4A7C15ULL ^ (uint32_t)key;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    return (size_t)(hash >> 17) & (size_t)(profiler->table_capacity - 1);
+}
+
+void profile_rehash(Profiler* profiler) {
+    core_runtime_free(profiler->table);
+    profiler->table_capacity = profiler->table_capacity ? profiler->table_capacity * 2 : 1024;
+    profiler->table = (int*)core_runtime_calloc(MEMORY_PROFILER, profiler->table_capacity, sizeof(int));
+    if (!profiler->table) raise_error("Memory allocation failed for the profiler.");
+    for (int i = 0; i < profiler->count; i++) {
+        const ProfileNode* node = &profiler->nodes[i];
+        if (node->kind != PROFILE_NATIVE && node->kind != PROFILE_MODULE) continue; // Not looked up here
+        size_t slot = profile_slot(profiler, node->parent, node->kind, node->key);
+        while (profiler->table[slot]) slot = (slot + 1) & (size_t)(profiler->table_capacity - 1);
+        profiler->table[slot] = i + 1;
+    }
+}
+
+int profile_add_node(Profiler* profiler, int parent, ProfileKind kind, int key, const char* label) {
+    if (profiler->count == profiler->capacity) {
+        profiler->capacity = profiler->capacity ? profiler->capacity * 2 : 256;
+        profiler->nodes = (ProfileNode*)core_runtime_realloc(MEMORY_PROFILER, profiler->nodes,
+                                                             sizeof(ProfileNode) * profiler->capacity);
+        if (!profiler->nodes) raise_error("Memory allocation failed for the profiler.");
+    }
+    ProfileNode* node = &profiler->nodes[profiler->count];
+    memset(node, 0, sizeof(ProfileNode));
+    node->parent = parent;
+    node->kind = kind;
+    node->key = key;
+    if (label) {
+        node->label = core_runtime_strndup(MEMORY_PROFILER, label, strlen(label));
+        if (!node->label) raise_error("Memory allocation failed for the profiler.");
+    }
+    return profiler->count++;
+}
+
+// The native or module child of `parent` for `key`, created on first use
+int profile_child(Profiler* profiler, int parent, ProfileKind kind, int key, const char* label) {
+    if (2 * profiler->calls >= profiler->table_capacity) profile_rehash(profiler);
+    size_t slot = profile_slot(profiler, parent, kind, key);
+    while (profiler->table[slot]) {
+        const ProfileNode* node = &profiler->nodes[profiler->table[slot] - 1];
+        if (node->parent == parent && node->kind == kind && node->key == key) return profiler->table[slot] - 1;
+        slot = (slot + 1) & (size_t)(profiler->table_capacity - 1);
+    }
+    int index = profile_add_node(profiler, parent, kind, key, label);
+    profiler->table[slot] = index + 1;
+    profiler->calls++;
+    return index;
+}
+
+void profile_push_frame(Profiler* profiler, int node, int caller) {
+    if (profiler->depth == profiler->frames_capacity) {
+        profiler->frames_capacity = profiler->frames_capacity ? profiler->frames_capacity * 2 : 16;
+        profiler->frames = (ProfileFrame*)core_runtime_realloc(MEMORY_PROFILER, profiler->frames,
+                                                               sizeof(ProfileFrame) * profiler->frames_capacity);
+        if (!profiler->frames) raise_error("Memory allocation failed for the profiler.");
+    }
+    profiler->frames[profiler->depth].node = node;
+    profiler->frames[profiler->depth].caller = caller;
+    profiler->depth++;
+}
+
+// The statement at `line` of the running script or module starts. Lines are
+// found by index rather than through the hash table: most programs run each
+// statement once, so this lookup is the profiler's hottest path.
+void profile_line(Profiler* profiler, int line) {
+    profile_charge(profiler);
+    int frame = profiler->frames[profiler->depth - 1].node;
+    if (line >= profiler->nodes[frame].num_lines) {
+        int count = profiler->nodes[frame].num_lines * 2 > line ? profiler->nodes[frame].num_lines * 2 : line + 64;
+        int* lines = (int*)core_runtime_realloc(MEMORY_PROFILER, profiler->nodes[frame].lines, sizeof(int) * count);
+        if (!lines) raise_error("Memory allocation failed for the profiler.");
+        memset(lines + profiler->nodes[frame].num_lines, 0, sizeof(int) * (count - profiler->nodes[frame].num_lines));
+        profiler->nodes[frame].lines = lines;
+        profiler->nodes[frame].num_lines = count;
+    }
+    if (profiler->nodes[frame].lines[line] == 0) {
+        int node = profile_add_node(profiler, frame, PROFILE_LINE, line, NULL);
+        profiler->nodes[frame].lines[line] = node + 1;
+    }
+    profiler->current = profiler->nodes[frame].lines[line] - 1;
+    profiler->nodes[profiler->current].hits++;
+}
+
+// A native or module starts running under the current statement
+void profile_enter(Profiler* profiler, ProfileKind kind, int key, const char* label) {
+    profile_charge(profiler);
+    int node = profile_child(profiler, profiler->current, kind, key, label);
+    profiler->nodes[node].hits++;
+    profile_push_frame(profiler, node, profiler->current);
+    profiler->current = node;
+}
+
+void profile_leave(Profiler* profiler) {
+    profile_charge(profiler);
+    profiler->current = profiler->frames[--profiler->depth].caller;
+}
+
+// Program code starts or stops running; time in between (parsing, the REPL
+// prompt) is not charged to any node
+void profile_resume(Profiler* profiler) {
+    if (!profiler) return;
+    profiler->last = profile_clock();
+    profiler->current = profiler->frames[profiler->depth - 1].node;
+}
+
+void profile_suspend(Profiler* profiler) {
+    if (!profiler) return;
+    profile_charge(profiler);
+    profiler->current = -1;
+}
+
+// The program stopped on an error inside natives or modules: their frames are
+// dropped and the time so far stays charged where it was spent
+void profile_unwind(Profiler* profiler) {
+    if (!profiler) return;
+    profile_suspend(profiler);
+    profiler->depth = 1;
+}
+
+// Name of the script or module whose source `index` belongs to
+const char* profile_unit(Profiler* profiler, int index) {
+    while (profiler->nodes[index].kind == PROFILE_LINE || profiler->nodes[index].kind == PROFILE_NATIVE) {
+        index = profiler->nodes[index].parent;
+    }
+    const char* slash = strrchr(profiler->nodes[index].label, '/');
+    return slash ? slash + 1 : profiler->nodes[index].label;
+}
+
+void profile_format_label(Profiler* profiler, int index, char* buffer, size_t size) {
+    const ProfileNode* node = &profiler->nodes[index];
+    if (node->kind == PROFILE_LINE) {
+        snprintf(buffer, size, "%s:%d", profile_unit(profiler, index), node->key);
+    } else if (node->kind == PROFILE_NATIVE) {
+        snprintf(buffer, size, "%s", node->label);
+    } else {
+        snprintf(buffer, size, "%s", profile_unit(profiler, index));
+    }
+}
+
+// Writes the path from the root to `index`, frames separated by ';'
+void profile_write_stack(Profiler* profiler, FILE* out, int index) {
+    if (profiler->nodes[index].parent >= 0) {
+        profile_write_stack(profiler, out, profiler->nodes[index].parent);
+        fputc(';', out);
+    }
+    char label[PATH_MAX + 32];
+    profile_format_label(profiler, index, label, sizeof(label));
+    fputs(label, out);
+}
+
+// Fills `rows` with the (at most profiler->top) nodes of `kind` with the most
+// total time, highest first, and returns how many nodes of that kind exist.
+// A line or native reached from several places (REPL inputs all start at
+// line 1) is counted once per place.
+int profile_top_nodes(Profiler* profiler, ProfileKind kind, int* rows, int* num_rows) {
+    int found = 0;
+    *num_rows = 0;
+    for (int i = 0; i < profiler->count; i++) {
+        if (profiler->nodes[i].kind != kind) continue;
+        found++;
+        uint64_t total = profiler->nodes[i].total_ns;
+        int at = *num_rows;
+        while (at > 0 && profiler->nodes[rows[at - 1]].total_ns < total) at--;
+        if (at >= profiler->top) continue;
+        int last = *num_rows < profiler->top ? (*num_rows)++ : profiler->top - 1;
+        memmove(rows + at + 1, rows + at, sizeof(int) * (last - at));
+        rows[at] = i;
+    }
+    return found;
+}
+
+void profile_print_table(Profiler* profiler, const char* title, const int* rows, int num_rows, uint64_t run_ns) {
+    fprintf(stderr, "%s:\n", title);
+    fprintf(stderr, "  %10s %10s %6s %10s  %s\n", "total ms", "self ms", "%", "hits", "location");
+    for (int i = 0; i < num_rows; i++) {
+        const ProfileNode* node = &profiler->nodes[rows[i]];
+        char label[PATH_MAX + 32];
+        profile_format_label(profiler, rows[i], label, sizeof(label));
+        fprintf(stderr, "  %10.3f %10.3f %5.1f%% %10ld  %s\n", node->total_ns / 1e6, node->self_ns / 1e6,
+                run_ns ? 100.0 * node->total_ns / run_ns : 0.0, node->hits, label);
+    }
+}
+
+// Writes the folded stacks (one "frame;frame;... nanoseconds" line per node
+// with self time, the input format of flamegraph.pl and speedscope) and
+// prints the hottest lines and natives. A run that stopped on an error is
+// reported too, up to the error.
+void profile_report(Profiler* profiler) {
+    if (profiler->current >= 0) profile_charge(profiler);
+    for (int i = 0; i < profiler->count; i++) profiler->nodes[i].total_ns = profiler->nodes[i].self_ns;
+    for (int i = profiler->count - 1; i > 0; i--) { // Children come after their parent
+        profiler->nodes[profiler->nodes[i].parent].total_ns += profiler->nodes[i].total_ns;
+    }
+
+    FILE* out = fopen(profiler->folded_path, "w");
+    if (!out) {
+        fprintf(stderr, "Error: could not write profile to %s: %s\n", profiler->folded_path, strerror(errno));
+    } else {
+        for (int i = 0; i < profiler->count; i++) {
+            if (profiler->nodes[i].self_ns == 0) continue;
+            profile_write_stack(profiler, out, i);
+            fprintf(out, " %llu\n", (unsigned long long)profiler->nodes[i].self_ns);
+        }
+        fclose(out);
+    }
+
+    int* lines = (int*)core_runtime_alloc(MEMORY_PROFILER, sizeof(int) * profiler->top);
+    int* natives = (int*)core_runtime_alloc(MEMORY_PROFILER, sizeof(int) * profiler->top);
+    if (!lines || !natives) raise_error("Memory allocation failed for the profiler.");
+    int num_lines, num_natives;
+    int total_lines = profile_top_nodes(profiler, PROFILE_LINE, lines, &num_lines);
+    int total_natives = profile_top_nodes(profiler, PROFILE_NATIVE, natives, &num_natives);
+    uint64_t run_ns = profiler->nodes[0].total_ns;
+    fprintf(stderr, "\n--- Profile: %.3f ms in %d lines and %d natives (folded stacks in %s) ---\n",
+            run_ns / 1e6, total_lines, total_natives, profiler->folded_path);
+    profile_print_table(profiler, "Hottest lines", lines, num_lines, run_ns);
+    if (num_natives > 0) profile_print_table(profiler, "Hottest natives", natives, num_natives, run_ns);
+    core_runtime_free(lines);
+    core_runtime_free(natives);
+}
+
+// Prepares `profiler` for the script called `name`. Give it to the session
+// before anything is compiled, since bytecode only carries line markers when
+// profiling.
+void profile_init(Profiler* profiler, const char* name, const char* folded_path, int top) {
+    memset(profiler, 0, sizeof(*profiler));
+    profiler->folded_path = folded_path ? folded_path : "panlang.folded";
+    profiler->top = top > 0 ? top : PROFILE_DEFAULT_TOP;
+    profiler->current = -1;
+    profile_push_frame(profiler, profile_add_node(profiler, -1, PROFILE_ROOT, 0, name), -1);
+}
+
+void profile_free(Profiler* profiler) {
+    for (int i = 0; i < profiler->count; i++) {
+        core_runtime_free(profiler->nodes[i].label);
+        core_runtime_free(profiler->nodes[i].lines);
+    }
+    core_runtime_free(profiler->nodes);
+    core_runtime_free(profiler->table);
+    core_runtime_free(profiler->frames);
+    memset(profiler, 0, sizeof(*profiler));
+}
+
+// --- Memory statistics ---
+// `--mem-stats` turns on the runtime's allocation tracking (see "Memory" in
+// core_runtime.h) and records, for each phase of a run, how many blocks and
+// bytes it allocated and the most memory the process held while it ran.
+// Repeated phases (REPL lines, stream batches) add up, and their peak is the
+// highest of any run. Phases reset the runtime's peaks, so the report keeps
+// the overall ones itself. The counters are process-wide: with sessions on
+// several threads, each phase also sees the others' allocations.
+typedef enum {
+    MEMORY_PHASE_PARSE,    // Lexing and parsing, and reading the batch with --stream
+    MEMORY_PHASE_MODULES,  // Loading and compiling imports
+    MEMORY_PHASE_OPTIMIZE,
+    MEMORY_PHASE_EXECUTE,  // Compiling to bytecode and running
+    MEMORY_PHASE_COUNT
+} MemoryPhase;
+
+const char* memory_phase_names[MEMORY_PHASE_COUNT] = {"parse", "modules", "optimize", "execute"};
+
+typedef struct {
+    long runs;
+    size_t allocations;
+    size_t bytes;
+    size_t peak;
+} MemoryPhaseStats;
+
+typedef struct {
+    MemoryPhaseStats phases[MEMORY_PHASE_COUNT];
+    MemoryStats start;                  // Totals when the current phase started
+    size_t peak;                        // Highest live bytes over the whole run
+    size_t tag_peaks[MEMORY_TAG_COUNT];
+} MemoryReport;
+
+void memory_report_init(MemoryReport* report) {
+    memset(report, 0, sizeof(*report));
+    core_runtime_memory_track(1);
+}
+
+// Folds the runtime's current peaks into the report's
+void memory_report_peaks(MemoryReport* report) {
+    MemoryStats tags[MEMORY_TAG_COUNT], total;
+    core_runtime_memory_stats(tags, &total);
+    if (total.peak > report->peak) report->peak = total.peak;
+    for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+        if (tags[i].peak > report->tag_peaks[i]) report->tag_peaks[i] = tags[i].peak;
+    }
+}
+
+void memory_phase_start(MemoryReport* report) {
+    if (!report) return;
+    memory_report_peaks(report);
+    core_runtime_memory_reset_peaks();
+    core_runtime_memory_stats(NULL, &report->start);
+}
+
+// Records `phase` as ending now and starts the next one
+void memory_phase_end(MemoryReport* report, MemoryPhase phase) {
+    if (!report) return;
+    MemoryStats now;
+    core_runtime_memory_stats(NULL, &now);
+    MemoryPhaseStats* stats = &report->phases[phase];
+    stats->runs++;
+    stats->allocations += now.allocations - report->start.allocations;
+    stats->bytes += now.bytes - report->start.bytes;
+    if (now.peak > stats->peak) stats->peak = now.peak;
+    memory_phase_start(report);
+}
+
+// Prints each phase's and each tag's figures, then what is still allocated.
+// Blocks tagged "runtime" (output buffers, the thread pool, the native
+// registry) last as long as the process, so only the other tags can leak.
+void memory_report_print(MemoryReport* report) {
+    memory_report_peaks(report);
+    MemoryStats tags[MEMORY_TAG_COUNT], total;
+    core_runtime_memory_stats(tags, &total);
+    fprintf(stderr, "\n--- Memory: %zu allocations, %zu bytes, peak %zu bytes live ---\n",
+            total.allocations, total.bytes, report->peak);
+    fprintf(stderr, "Phases:\n");
+    fprintf(stderr, "  %-10s %8s %12s %14s %14s\n", "phase", "runs", "allocations", "bytes", "peak live");
+    for (int i = 0; i < MEMORY_PHASE_COUNT; i++) {
+        const MemoryPhaseStats* phase = &report->phases[i];
+        if (phase->runs == 0) continue;
+        fprintf(stderr, "  %-10s %8ld %12zu %14zu %14zu\n", memory_phase_names[i], phase->runs,
+                phase->allocations, phase->bytes, phase->peak);
+    }
+    fprintf(stderr, "Subsystems:\n");
+    fprintf(stderr, "  %-10s %12s %14s %14s %14s\n", "tag", "allocations", "bytes", "peak live", "live at exit");
+    size_t leaked_blocks = 0, leaked_bytes = 0;
+    for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+        if (tags[i].allocations == 0) continue;
+        fprintf(stderr, "  %-10s %12zu %14zu %14zu %14zu\n", core_runtime_memory_tag_name((MemoryTag)i),
+                tags[i].allocations, tags[i].bytes, report->tag_peaks[i], tags[i].live);
+        if (i == MEMORY_RUNTIME) continue;
+        leaked_blocks += tags[i].allocations - tags[i].frees;
+        leaked_bytes += tags[i].live;
+    }
+    if (leaked_blocks > 0) {
+        fprintf(stderr, "Leaked: %zu bytes in %zu blocks\n", leaked_bytes, leaked_blocks);
+    } else {
+        fprintf(stderr, "No leaks.\n");
+    }
+}
+
+// --- Bytecode Compiler ---
+// Alternative to the tree-walking evaluator: the AST is flattened into a
+// linear stream of int opcodes/operands and run by a stack VM over Values.
+// Literals live in a constant pool. Binary operators whose right operand is a
+// number literal are compiled to "K" forms that name the constant directly,
+// which removes a push/pop from the hottest path.
+typedef enum {
+    OP_CONST,      // operand: constant index push constant
+    OP_LOAD,       // operand: slot           push symbol value
+    OP_STORE,      // operand: slot           pop into symbol
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_ADDK,       // operand: constant index top = top + constant
+    OP_SUBK,       // operand: constant index top = top - constant
+    OP_MULK,       // operand: constant index top = top * constant
+    OP_DIVK,       // operand: constant index top = top / constant
+    OP_CALL,       // operand: builtin index  pop its arguments, check their types, push the result
+    OP_CALL_TYPED, // operand: builtin index  OP_CALL with argument types proven at compile time
+    OP_PRINT,      //                         pop and print
+    OP_POP,        //                         pop and discard
+    OP_IMPORT,     // operand: module index   run the module if it has not run yet
+    OP_LINE,       // operand: source line    a statement starts (only compiled in when profiling)
+    OP_HALT,
+    OP_COUNT
+} OpCode;
+
+// What each opcode's operand refers to; modules use this to relocate and check code
+typedef enum {
+    OPERAND_NONE,
+    OPERAND_CONSTANT,
+    OPERAND_SLOT,
+    OPERAND_BUILTIN,
+    OPERAND_MODULE,
+    OPERAND_LINE,
+} OperandKind;
+
+const unsigned char opcode_operands[OP_COUNT] = {
+    [OP_CONST] = OPERAND_CONSTANT, [OP_LOAD] = OPERAND_SLOT, [OP_STORE] = OPERAND_SLOT,
+    [OP_ADDK] = OPERAND_CONSTANT, [OP_SUBK] = OPERAND_CONSTANT, [OP_MULK] = OPERAND_CONSTANT,
+    [OP_DIVK] = OPERAND_CONSTANT, [OP_CALL] = OPERAND_BUILTIN, [OP_CALL_TYPED] = OPERAND_BUILTIN,
+    [OP_IMPORT] = OPERAND_MODULE, [OP_LINE] = OPERAND_LINE,
+};
+
+typedef struct {
+    int* code;
+    int count;
+    int capacity;
+    Value* constants;     // Heap values point into the AST arena or the runtime heap
+    int num_constants;
+    int constants_capacity;
+    int stack_depth;      // Current depth while compiling
+    int max_stack_depth;  // Stack size the VM must provide
+    int line_markers;     // Compile an OP_LINE before each statement (when profiling)
+} Bytecode;
+
+void bytecode_init(Bytecode* bc) {
+    memset(bc, 0, sizeof(Bytecode));
+}
+
+void bytecode_free(Bytecode* bc) {
+    core_runtime_free(bc->code);
+    core_runtime_free(bc->constants);
+    bytecode_init(bc);
+}
+
+// Empties `bc` but keeps its buffers for reuse
+void bytecode_clear(Bytecode* bc) {
+    bc->count = 0;
+    bc->num_constants = 0;
+    bc->stack_depth = 0;
+    bc->max_stack_depth = 0;
+}
+
+void bytecode_emit(Bytecode* bc, int word) {
+    if (bc->count >= bc->capacity) {
+        bc->capacity = bc->capacity ? bc->capacity * 2 : 256;
+        bc->code = (int*)core_runtime_realloc(MEMORY_BYTECODE, bc->code, sizeof(int) * bc->capacity);
+        if (!bc->code) raise_error("Memory allocation failed for bytecode.");
+    }
+    bc->code[bc->count++] = word;
+}
+
+int bytecode_add_constant(Bytecode* bc, Value value) {
+    if (bc->num_constants >= bc->constants_capacity) {
+        bc->constants_capacity = bc->constants_capacity ? bc->constants_capacity * 2 : 16;
+        bc->constants = (Value*)core_runtime_realloc(MEMORY_BYTECODE, bc->constants,
+                                                     sizeof(Value) * bc->constants_capacity);
+        if (!bc->constants) raise_error("Memory allocation failed for bytecode constants.");
+    }
+    bc->constants[bc->num_constants] = value;
+    return bc->num_constants++;
+}
+
+// Tracks the compile-time stack depth so the VM stack can be sized exactly
+void bytecode_adjust_stack(Bytecode* bc, int delta) {
+    bc->stack_depth += delta;
+    if (bc->stack_depth > bc->max_stack_depth) {
+        bc->max_stack_depth = bc->stack_depth;
+    }
+}
+
+void bytecode_compile_expression(Bytecode* bc, ASTNode* node) {
+    switch (node->type) {
+        case NODE_NUMBER:
+        case NODE_STRING:
+        case NODE_BOOL:
+            bytecode_emit(bc, OP_CONST);
+            bytecode_emit(bc, bytecode_add_constant(bc, node->type == NODE_NUMBER ? node->data.number_val
+                                                      : node->type == NODE_STRING ? node->data.string_val
+                                                      : node->data.bool_val));
+            bytecode_adjust_stack(bc, 1);
+            break;
+        case NODE_VAR:
+            bytecode_emit(bc, OP_LOAD);
+            bytecode_emit(bc, node->data.var.slot);
+            bytecode_adjust_stack(bc, 1);
+            break;
+        case NODE_BINOP: {
+            ASTNode* right = node->data.bin_op.right;
+            bytecode_compile_expression(bc, node->data.bin_op.left);
+            // A zero divisor is fine here: the K form raises the same error at the same point
+            int constant_right = right->type == NODE_NUMBER;
+            if (!constant_right) {
+                bytecode_compile_expression(bc, right);
+            }
+            switch (node->data.bin_op.op) {
+                case TOKEN_PLUS: bytecode_emit(bc, constant_right ? OP_ADDK : OP_ADD); break;
+                case TOKEN_MINUS: bytecode_emit(bc, constant_right ? OP_SUBK : OP_SUB); break;
+                case TOKEN_TIMES: bytecode_emit(bc, constant_right ? OP_MULK : OP_MUL); break;
+                case TOKEN_DIVIDE: bytecode_emit(bc, constant_right ? OP_DIVK : OP_DIV); break;
+                default:
+                    raise_error("Runtime Error: Unknown binary operator.");
+            }
+            if (constant_right) {
+                bytecode_emit(bc, bytecode_add_constant(bc, right->data.number_val));
+            } else {
+                bytecode_adjust_stack(bc, -1);
+            }
+            break;
+        }
+        case NODE_CALL:
+            for (int i = 0; i < node->data.call.num_args; i++) {
+                bytecode_compile_expression(bc, node->data.call.args[i]);
+            }
+            bytecode_emit(bc, node->data.call.typed ? OP_CALL_TYPED : OP_CALL);
+            bytecode_emit(bc, node->data.call.builtin);
+            bytecode_adjust_stack(bc, 1 - node->data.call.num_args);
+            break;
+        default:
+            raise_error("Runtime Error: Unexpected node type in expression evaluation.");
+    }
+}
+
+void bytecode_compile_statement(Bytecode* bc, ASTNode* node) {
+    if (!node) return;
+    if (bc->line_markers) {
+        bytecode_emit(bc, OP_LINE);
+        bytecode_emit(bc, node->line);
+    }
+    switch (node->type) {
+        case NODE_ASSIGN:
+            bytecode_compile_expression(bc, node->data.assign_op.expr);
+            bytecode_emit(bc, OP_STORE);
+            bytecode_emit(bc, node->data.assign_op.slot);
+            bytecode_adjust_stack(bc, -1);
+            break;
+        case NODE_PRINT:
+            bytecode_compile_expression(bc, node->data.print_stmt.expr);
+            bytecode_emit(bc, OP_PRINT);
+            bytecode_adjust_stack(bc, -1);
+            break;
+        case NODE_CALL:
+            bytecode_compile_expression(bc, node);
+            bytecode_emit(bc, OP_POP);
+            bytecode_adjust_stack(bc, -1);
+            break;
+        case NODE_IMPORT:
+            bytecode_emit(bc, OP_IMPORT);
+            bytecode_emit(bc, node->data.import_stmt.module);
+            break;
+        default:
+            raise_error("Runtime Error: Unexpected statement type.");
+    }
+}
+
+// Appends code for `statements` to `bc` and returns the offset execution should
+// start from. Code compiled earlier is kept, so a session can extend it line by line.
+int bytecode_compile_program(Bytecode* bc, ASTNode** statements, int num_statements) {
+    if (bc->count > 0) {
+        bc->count--; // Drop the previous OP_HALT; new code continues from there
+    }
+    int start = bc->count;
+    for (int i = 0; i < num_statements; i++) {
+        bytecode_compile_statement(bc, statements[i]);
+    }
+    bytecode_emit(bc, OP_HALT);
+    return start;
+}
+
+// --- Source loading ---
+// Maps a source file read-only into memory so the lexer can scan it in place.
+// The mapping is not NUL-terminated; callers must use the returned length.
+const char* map_source_file(const char* path, size_t* length) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening file");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Error reading file size");
+        close(fd);
+        return NULL;
+    }
+    *length = (size_t)st.st_size;
+    if (*length == 0) { // mmap rejects empty mappings
+        close(fd);
+        return "";
+    }
+    void* mapping = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping stays valid after the descriptor is closed
+    if (mapping == MAP_FAILED) {
+        perror("Error mapping file");
+        return NULL;
+    }
+    madvise(mapping, *length, MADV_SEQUENTIAL); // The lexer reads front to back exactly once
+    return (const char*)mapping;
+}
+
+void unmap_source_file(const char* code, size_t length) {
+    if (length > 0) {
+        munmap((void*)code, length);
+    }
+}
+
+// --- Modules ---
+// `pratibandha "path"` runs another PanLang file once, the first time execution
+// reaches the import. Its variables stay readable afterwards as <module>.<name>,
+// where <module> is the file's base name; names that already contain a '.'
+// are kept as written, so a module can also read another module's variables.
+// The path is resolved against the importing file's directory, then the
+// working directory, and ".pan" is appended when it is missing.
+//
+// Each module is compiled once, to bytecode against its own symbol table and
+// arena, and then linked: its slots are mapped onto the session's symbol table
+// and its imports onto the session's module registry. Modules always run on the bytecode
+// VM, whichever engine runs the program importing them. Because compilation
+// shares no state, every module found in one import wave is compiled on the
+// runtime's thread pool at the same time; linking is serial and finds the next
+// wave. The compiled form is also cached on disk (see below), so later runs
+// map it instead of lexing, parsing and optimizing the source again.
+typedef enum {
+    MODULE_PENDING, // Registered but not compiled or loaded yet
+    MODULE_FAILED,  // Could not be loaded; `error` says why, and importing it again retries
+    MODULE_LINKED,  // Ready to run
+    MODULE_RUNNING,
+    MODULE_DONE,
+} ModuleState;
+
+// A module's bytecode before linking: slot and module operands index `names` and `imports`
+typedef struct {
+    Bytecode bytecode;    // From the cache, `code` points into the mapping
+    const char** names;   // Slot -> variable name as written in the module
+    int num_names;
+    const char** imports; // Import index -> path as written
+    int num_imports;
+    SymbolTable symbols;  // Compiled from source: owns `names`
+    Arena arena;          // Compiled from source: owns the AST, `imports` and string constants
+    void* mapping;        // Loaded from the cache: the file every pointer above refers to
+    size_t mapping_length;
+} CompiledModule;
+
+typedef struct {
+    char* path;               // Canonical path of the source file
+    char* name;               // File name without ".pan": the prefix of the module's variables
+    ModuleState state;
+    CompiledModule compiled;
+    Bytecode bytecode;        // Linked code; `constants` is borrowed from `compiled`
+    char error[RUNTIME_ERROR_SIZE]; // Why the last load failed, empty if it did not
+} Module;
+
+typedef struct {
+    Module* modules;
+    int count;
+    int capacity;
+    int opt_level;            // Modules are optimized like the program that imports them
+    int line_markers;         // Modules are compiled with OP_LINE markers (when profiling)
+    uint64_t engine_hash;     // See module_engine_hash; 0 until the first load
+    char cache_dir[PATH_MAX]; // Empty if the cache is off
+    int* pending;             // Modules of the import wave being loaded
+} ModuleRegistry;
+
+#define MODULE_HASH_SEED 14695981039346656037ULL
+
+// FNV-1a, 64-bit; chain calls by passing the previous result as `hash`
+uint64_t module_hash(const void* data, size_t length, uint64_t hash) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Identifies what compiled bytecode depends on besides its source: the value
+// and opcode encodings, whether it carries OP_LINE markers, and the native
+// registry, whose indices and parameter types (for OP_CALL_TYPED) it embeds
+uint64_t module_engine_hash(int line_markers) {
+    int layout[4] = {(int)sizeof(Value), (int)sizeof(int), OP_COUNT, line_markers};
+    uint64_t hash = module_hash(layout, sizeof(layout), MODULE_HASH_SEED);
+    const NativeBinding* natives = core_runtime_natives();
+    for (int i = 0; i < core_runtime_native_count(); i++) {
+        hash = module_hash(natives[i].name, strlen(natives[i].name) + 1, hash);
+        hash = module_hash(&natives[i].arity, sizeof(int), hash);
+        hash = module_hash(natives[i].params, sizeof(natives[i].params[0]) * natives[i].arity, hash);
+    }
+    return hash;
+}
+
+// Checks compiled code against its tables and returns the stack depth it
+// needs, or -1 if it is malformed (so a damaged cache file is never run)
+int module_check_code(const CompiledModule* compiled) {
+    const Bytecode* bc = &compiled->bytecode;
+    int depth = 0;
+    int max_depth = 0;
+    int i = 0;
+    while (i < bc->count) {
+        int op = bc->code[i++];
+        if (op < 0 || op >= OP_COUNT) return -1;
+        if (op == OP_HALT) return i == bc->count ? max_depth : -1;
+        int operand = 0;
+        if (opcode_operands[op] != OPERAND_NONE) {
+            if (i >= bc->count) return -1;
+            operand = bc->code[i++];
+            int limit = opcode_operands[op] == OPERAND_CONSTANT ? bc->num_constants
+                      : opcode_operands[op] == OPERAND_SLOT ? compiled->num_names
+                      : opcode_operands[op] == OPERAND_MODULE ? compiled->num_imports
+                      : opcode_operands[op] == OPERAND_LINE ? INT_MAX
+                      : core_runtime_native_count();
+            if (operand < 0 || operand >= limit) return -1;
+        }
+        int pops = 0, pushes = 0;
+        switch (op) {
+            case OP_CONST: case OP_LOAD: pushes = 1; break;
+            case OP_STORE: case OP_PRINT: case OP_POP: pops = 1; break;
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: pops = 2; pushes = 1; break;
+            case OP_ADDK: case OP_SUBK: case OP_MULK: case OP_DIVK: pops = 1; pushes = 1; break;
+            case OP_CALL: case OP_CALL_TYPED: pops = core_runtime_natives()[operand].arity; pushes = 1; break;
+            default: break;
+        }
+        if (depth < pops) return -1;
+        depth += pushes - pops;
+        if (depth > max_depth) max_depth = depth;
+    }
+    return -1; // No OP_HALT
+}
+
+// Lexes, parses, optimizes and compiles a module. Runs on pool threads.
+void module_compile_source(CompiledModule* compiled, const char* code, size_t length, int opt_level,
+                           int line_markers) {
+    arena_init(&compiled->arena, ARENA_DEFAULT_CHUNK_SIZE, MEMORY_AST);
+    int num_statements = 0;
+    ASTNode** statements = parse_source(code, length, &compiled->symbols, &compiled->arena, &num_statements);
+
+    // Imports are numbered in order of first appearance
+    compiled->imports = (const char**)arena_alloc(&compiled->arena, sizeof(const char*) * (num_statements + 1));
+    for (int i = 0; i < num_statements; i++) {
+        if (statements[i]->type != NODE_IMPORT) continue;
+        const char* path = statements[i]->data.import_stmt.path;
+        int index = 0;
+        while (index < compiled->num_imports && strcmp(compiled->imports[index], path) != 0) index++;
+        if (index == compiled->num_imports) compiled->imports[compiled->num_imports++] = path;
+        statements[i]->data.import_stmt.module = index;
+    }
+
+    statements = optimize_statements(statements, &num_statements, &compiled->arena, &compiled->symbols, opt_level, 0);
+    compiled->bytecode.line_markers = line_markers;
+    bytecode_compile_program(&compiled->bytecode, statements, num_statements);
+    compiled->names = compiled->symbols.names;
+    compiled->num_names = compiled->symbols.count;
+}
+
+void module_compiled_free(CompiledModule* compiled) {
+    if (compiled->mapping) {
+        core_runtime_free(compiled->bytecode.constants);
+        core_runtime_free((void*)compiled->names); // `imports` shares this allocation
+        munmap(compiled->mapping, compiled->mapping_length);
+    } else {
+        bytecode_free(&compiled->bytecode);
+        symbol_table_free(&compiled->symbols);
+        arena_free(&compiled->arena);
     }
-    return node;
+    memset(compiled, 0, sizeof(*compiled));
 }
 
-// --- Interpreter ---
-// Simple symbol table using a linked list (for dynamic memory)
-typedef struct Symbol {
-    char* name;
-    int value; // Only supports integer values for now
-    struct Symbol* next;
-} Symbol;
+// --- Module cache ---
+// One file per compiled module in the cache directory, named after the hash
+// of the module's source and the -O level:
+//
+//   ModuleCacheHeader
+//   int code[code_count]
+//   ModuleCacheConstant constants[num_constants]
+//   uint64_t names[num_names], imports[num_imports]  file offsets of NUL-terminated strings
+//   string and object data; string and bigint constants are HeapString and HeapBigInt
+//   images, 8-byte aligned
+//
+// Loading maps the file and uses it in place: string and bigint constants
+// become Values pointing into the mapping. A file whose header does not match
+// the source, the -O level or the engine, that fails its checksum, or whose
+// code fails module_check_code is ignored and rewritten. Files are written to a
+// temporary name and renamed into place, so concurrent runs never see a
+// partial file.
+#define MODULE_CACHE_MAGIC "PANMODC"
+#define MODULE_CACHE_VERSION 3
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t opt_level;
+    uint64_t source_hash;
+    uint64_t source_length;
+    uint64_t engine_hash;
+    uint64_t file_length;
+    uint64_t checksum;       // module_hash of everything after the header
+    uint32_t code_count;
+    uint32_t num_constants;
+    uint32_t num_names;
+    uint32_t num_imports;
+} ModuleCacheHeader;
 
-Symbol* symbol_table = NULL; // Global symbol table
+typedef enum {
+    MODULE_CONSTANT_VALUE,  // payload: the Value itself (not a heap value)
+    MODULE_CONSTANT_INT,    // payload: an int64 outside int48
+    MODULE_CONSTANT_STRING, // payload: file offset of a HeapString
+    MODULE_CONSTANT_BIGINT, // payload: file offset of a HeapBigInt
+} ModuleConstantKind;
 
-// Set variable value
-void set_symbol(const char* name, int value) {
-    Symbol* current = symbol_table;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            current->value = value;
-            return;
+typedef struct {
+    uint64_t kind;
+    uint64_t payload;
+} ModuleCacheConstant;
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} ModuleCacheBuffer;
+
+size_t module_cache_align(size_t offset) {
+    return (offset + 7) & ~(size_t)7;
+}
+
+// Section offsets follow from the header's counts
+size_t module_cache_constants_offset(const ModuleCacheHeader* header) {
+    return module_cache_align(sizeof(ModuleCacheHeader) + (size_t)header->code_count * sizeof(int));
+}
+
+size_t module_cache_names_offset(const ModuleCacheHeader* header) {
+    return module_cache_constants_offset(header) + (size_t)header->num_constants * sizeof(ModuleCacheConstant);
+}
+
+size_t module_cache_data_offset(const ModuleCacheHeader* header) {
+    return module_cache_names_offset(header) + ((size_t)header->num_names + header->num_imports) * sizeof(uint64_t);
+}
+
+// Appends `length` bytes (zeros if `data` is NULL) at the next 8-byte boundary
+// and returns their offset
+size_t module_cache_append(ModuleCacheBuffer* buffer, const void* data, size_t length) {
+    size_t offset = module_cache_align(buffer->length);
+    if (offset + length > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (offset + length > capacity) capacity *= 2;
+        buffer->data = (char*)core_runtime_realloc(MEMORY_MODULES, buffer->data, capacity);
+        if (!buffer->data) raise_error("Memory allocation failed for module cache.");
+        buffer->capacity = capacity;
+    }
+    memset(buffer->data + buffer->length, 0, offset - buffer->length);
+    if (data) {
+        memcpy(buffer->data + offset, data, length);
+    } else {
+        memset(buffer->data + offset, 0, length);
+    }
+    buffer->length = offset + length;
+    return offset;
+}
+
+size_t module_cache_append_string(ModuleCacheBuffer* buffer, const char* text) {
+    return module_cache_append(buffer, text, strlen(text) + 1);
+}
+
+// Path of the cache file for a source hash, or 0 if the cache is off. The
+// engine hash is part of the name so that builds with and without line
+// markers (or from other engine versions) keep separate files.
+int module_cache_path(const ModuleRegistry* registry, uint64_t source_hash, char* path, size_t size) {
+    if (!registry->cache_dir[0]) return 0;
+    int length = snprintf(path, size, "%s/%016llx-%016llx-O%d.pbc", registry->cache_dir,
+                          (unsigned long long)source_hash, (unsigned long long)registry->engine_hash,
+                          registry->opt_level);
+    return length > 0 && (size_t)length < size;
+}
+
+// Creates the cache directory and its parents; failures surface when writing
+void module_cache_make_directory(const char* dir) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s", dir);
+    for (char* p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(path, 0755);
+        *p = '/';
+    }
+    mkdir(path, 0755);
+}
+
+void module_cache_write(const CompiledModule* compiled, const char* cache_dir, const char* cache_path,
+                        ModuleCacheHeader header) {
+    const Bytecode* bc = &compiled->bytecode;
+    header.code_count = (uint32_t)bc->count;
+    header.num_constants = (uint32_t)bc->num_constants;
+    header.num_names = (uint32_t)compiled->num_names;
+    header.num_imports = (uint32_t)compiled->num_imports;
+
+    ModuleCacheBuffer buffer = {0};
+    module_cache_append(&buffer, &header, sizeof(header));
+    module_cache_append(&buffer, bc->code, (size_t)bc->count * sizeof(int));
+    // The constant and name tables are zero-filled here and patched as the data they point to is appended
+    size_t constants = module_cache_append(&buffer, NULL, module_cache_data_offset(&header) -
+                                                          module_cache_constants_offset(&header));
+
+    for (int i = 0; i < bc->num_constants; i++) {
+        Value value = bc->constants[i];
+        ModuleCacheConstant constant = {MODULE_CONSTANT_VALUE, value};
+        if (value_is_heap(value) && value_as_heap(value)->kind == HEAP_INT) {
+            constant.kind = MODULE_CONSTANT_INT;
+            constant.payload = (uint64_t)value_as_int64(value);
+        } else if (value_is_string(value)) {
+            const HeapString* string = (const HeapString*)value_as_heap(value);
+            size_t size = sizeof(HeapString) + string->length + 1;
+            HeapString* image = (HeapString*)core_runtime_calloc(MEMORY_MODULES, 1, size);
+            if (!image) raise_error("Memory allocation failed for module cache.");
+            image->header.kind = HEAP_STRING; // `next` stays NULL: the runtime heap never owns it
+            image->length = string->length;
+            memcpy(image->chars, string->chars, string->length + 1);
+            constant.kind = MODULE_CONSTANT_STRING;
+            constant.payload = module_cache_append(&buffer, image, size);
+            core_runtime_free(image);
+        } else if (value_is_bigint(value)) {
+            const HeapBigInt* big = value_as_bigint(value);
+            size_t size = sizeof(HeapBigInt) + big->length * sizeof(uint64_t);
+            HeapBigInt* image = (HeapBigInt*)core_runtime_calloc(MEMORY_MODULES, 1, size);
+            if (!image) raise_error("Memory allocation failed for module cache.");
+            image->header.kind = HEAP_BIGINT;
+            image->negative = big->negative;
+            image->length = big->length;
+            memcpy(image->limbs, big->limbs, big->length * sizeof(uint64_t));
+            constant.kind = MODULE_CONSTANT_BIGINT;
+            constant.payload = module_cache_append(&buffer, image, size);
+            core_runtime_free(image);
+        } else if (value_is_heap(value)) {
+            core_runtime_free(buffer.data);
+            return; // Tensor constants cannot be written out; never produced by the compiler
+        }
+        memcpy(buffer.data + constants + i * sizeof(ModuleCacheConstant), &constant, sizeof(constant));
+    }
+    size_t names = module_cache_names_offset(&header);
+    for (int i = 0; i < compiled->num_names + compiled->num_imports; i++) {
+        const char* text = i < compiled->num_names ? compiled->names[i] : compiled->imports[i - compiled->num_names];
+        uint64_t offset = module_cache_append_string(&buffer, text);
+        memcpy(buffer.data + names + i * sizeof(uint64_t), &offset, sizeof(offset));
+    }
+    header.file_length = buffer.length;
+    header.checksum = module_hash(buffer.data + sizeof(header), buffer.length - sizeof(header), MODULE_HASH_SEED);
+    memcpy(buffer.data, &header, sizeof(header));
+
+    char temp_path[PATH_MAX + 16];
+    snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", cache_path);
+    int fd = mkstemp(temp_path);
+    if (fd < 0) {
+        module_cache_make_directory(cache_dir);
+        snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", cache_path); // mkstemp may have changed it
+        fd = mkstemp(temp_path);
+    }
+    if (fd >= 0) {
+        size_t written = 0;
+        while (written < buffer.length) {
+            ssize_t n = write(fd, buffer.data + written, buffer.length - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            written += (size_t)n;
         }
-        current = current->next;
+        close(fd);
+        if (written != buffer.length || rename(temp_path, cache_path) != 0) unlink(temp_path);
     }
-    // If not found, create new symbol
-    Symbol* new_symbol = (Symbol*)malloc(sizeof(Symbol));
-    if (!new_symbol) { fprintf(stderr, "Memory allocation failed for symbol.\n"); exit(1); }
-    new_symbol->name = (char*)malloc(strlen(name) + 1);
-    strcpy(new_symbol->name, name);
-    new_symbol->value = value;
-    new_symbol->next = symbol_table;
-    symbol_table = new_symbol;
+    core_runtime_free(buffer.data);
 }
 
-// Get variable value
-int get_symbol(const char* name) {
-    Symbol* current = symbol_table;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            return current->value;
+// Maps the cache file for a module if it holds the module's current compiled
+// form. Returns 0, leaving `compiled` untouched, if it is missing or stale.
+int module_cache_read(CompiledModule* compiled, const char* cache_path, const ModuleCacheHeader* key) {
+    int fd = open(cache_path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ModuleCacheHeader)) {
+        close(fd);
+        return 0;
+    }
+    size_t length = (size_t)st.st_size;
+    char* mapping = (char*)mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return 0;
+
+    ModuleCacheHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    CompiledModule loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    if (memcmp(header.magic, key->magic, sizeof(header.magic)) != 0 || header.version != key->version ||
+        header.opt_level != key->opt_level || header.source_hash != key->source_hash ||
+        header.source_length != key->source_length || header.engine_hash != key->engine_hash ||
+        header.file_length != length || header.code_count > INT_MAX / 16 || header.num_constants > INT_MAX / 16 ||
+        header.num_names > INT_MAX / 16 || header.num_imports > INT_MAX / 16 ||
+        module_cache_data_offset(&header) > length ||
+        header.checksum != module_hash(mapping + sizeof(header), length - sizeof(header), MODULE_HASH_SEED)) {
+        goto stale;
+    }
+
+    loaded.mapping = mapping;
+    loaded.mapping_length = length;
+    loaded.bytecode.code = (int*)(mapping + sizeof(ModuleCacheHeader));
+    loaded.bytecode.count = (int)header.code_count;
+    loaded.num_names = (int)header.num_names;
+    loaded.num_imports = (int)header.num_imports;
+    loaded.names = (const char**)core_runtime_alloc(MEMORY_MODULES,
+                                                    sizeof(const char*) * (header.num_names + header.num_imports + 1));
+    loaded.bytecode.constants = (Value*)core_runtime_alloc(MEMORY_BYTECODE, sizeof(Value) * (header.num_constants + 1));
+    if (!loaded.names || !loaded.bytecode.constants) {
+        raise_error("Memory allocation failed for module cache.");
+    }
+    loaded.imports = NULL; // Shares the `names` allocation, see below
+
+    const uint64_t* offsets = (const uint64_t*)(mapping + module_cache_names_offset(&header));
+    for (uint32_t i = 0; i < header.num_names + header.num_imports; i++) {
+        if (offsets[i] >= length || !memchr(mapping + offsets[i], '\0', length - offsets[i])) goto stale;
+        loaded.names[i] = mapping + offsets[i];
+    }
+
+    const ModuleCacheConstant* constants = (const ModuleCacheConstant*)(mapping + module_cache_constants_offset(&header));
+    for (uint32_t i = 0; i < header.num_constants; i++) {
+        ModuleCacheConstant constant = constants[i];
+        Value value = constant.payload;
+        if (constant.kind == MODULE_CONSTANT_INT) {
+            value = value_from_int64((int64_t)constant.payload);
+        } else if (constant.kind == MODULE_CONSTANT_STRING) {
+            if (constant.payload % 8 != 0 || constant.payload > length - sizeof(HeapString)) goto stale;
+            HeapString* string = (HeapString*)(mapping + constant.payload);
+            if (string->header.kind != HEAP_STRING || string->length >= length - constant.payload - sizeof(HeapString) ||
+                string->chars[string->length] != '\0') {
+                goto stale;
+            }
+            value = value_from_heap(&string->header);
+        } else if (constant.kind == MODULE_CONSTANT_BIGINT) {
+            if (constant.payload % 8 != 0 || constant.payload > length - sizeof(HeapBigInt)) goto stale;
+            HeapBigInt* big = (HeapBigInt*)(mapping + constant.payload);
+            size_t room = (length - constant.payload - sizeof(HeapBigInt)) / sizeof(uint64_t);
+            if (big->header.kind != HEAP_BIGINT || big->length == 0 || big->length > room ||
+                big->limbs[big->length - 1] == 0 ||
+                (big->length == 1 && (big->limbs[0] <= (uint64_t)INT64_MAX ||
+                                      (big->negative && big->limbs[0] == (uint64_t)1 << 63)))) {
+                goto stale;
+            }
+            value = value_from_heap(&big->header);
+        } else if (constant.kind != MODULE_CONSTANT_VALUE || value_is_heap(value)) {
+            goto stale;
+        }
+        loaded.bytecode.constants[i] = value;
+        loaded.bytecode.num_constants = (int)i + 1;
+    }
+    int max_stack_depth = module_check_code(&loaded);
+    if (max_stack_depth < 0) goto stale;
+    loaded.bytecode.max_stack_depth = max_stack_depth;
+
+    // `imports` is the tail of the names array; module_compiled_free releases them together
+    *compiled = loaded;
+    compiled->imports = compiled->names + compiled->num_names;
+    return 1;
+
+stale:
+    core_runtime_free((void*)loaded.names);
+    core_runtime_free(loaded.bytecode.constants);
+    munmap(mapping, length);
+    return 0;
+}
+
+// Compiles `module` or loads it from the cache. Runs on pool threads, where
+// an error must not reach core_runtime_panic's exit: it is trapped here and
+// kept in module->error for modules_resolve to raise on the session's thread.
+void module_load(const ModuleRegistry* registry, Module* module) {
+    module->error[0] = '\0';
+    size_t length = 0;
+    const char* code = map_source_file(module->path, &length);
+    if (code == NULL) {
+        snprintf(module->error, sizeof(module->error), "Import Error: Could not read module '%s'.", module->path);
+        return;
+    }
+    ModuleCacheHeader key;
+    memset(&key, 0, sizeof(key));
+    memcpy(key.magic, MODULE_CACHE_MAGIC, sizeof(key.magic));
+    key.version = MODULE_CACHE_VERSION;
+    key.opt_level = (uint32_t)registry->opt_level;
+    key.source_hash = module_hash(code, length, MODULE_HASH_SEED);
+    key.source_length = length;
+    key.engine_hash = registry->engine_hash;
+
+    char cache_path[PATH_MAX];
+    int cacheable = module_cache_path(registry, key.source_hash, cache_path, sizeof(cache_path));
+    RuntimeTrap trap;
+    core_runtime_trap_push(&trap);
+    if (setjmp(trap.jump) == 0) {
+        if (!cacheable || !module_cache_read(&module->compiled, cache_path, &key)) {
+            module_compile_source(&module->compiled, code, length, registry->opt_level, registry->line_markers);
+            if (cacheable) module_cache_write(&module->compiled, registry->cache_dir, cache_path, key);
+        }
+        core_runtime_trap_pop(&trap);
+    } else {
+        module_compiled_free(&module->compiled); // Whatever the compile got to
+        memcpy(module->error, trap.message, sizeof(module->error));
+    }
+    unmap_source_file(code, length);
+}
+
+void module_load_range(void* context, size_t begin, size_t end) {
+    ModuleRegistry* registry = (ModuleRegistry*)context;
+    for (size_t i = begin; i < end; i++) {
+        module_load(registry, &registry->modules[registry->pending[i]]);
+    }
+}
+
+// $PANLANG_CACHE_DIR, else $XDG_CACHE_HOME/panlang, else ~/.cache/panlang.
+// Setting $PANLANG_CACHE_DIR to the empty string turns the cache off.
+void module_cache_init(ModuleRegistry* registry) {
+    const char* dir = getenv("PANLANG_CACHE_DIR");
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    char* out = registry->cache_dir;
+    size_t size = sizeof(registry->cache_dir);
+    if (dir) {
+        snprintf(out, size, "%s", dir);
+    } else if (xdg && *xdg) {
+        snprintf(out, size, "%s/panlang", xdg);
+    } else if (home && *home) {
+        snprintf(out, size, "%s/.cache/panlang", home);
+    } else {
+        out[0] = '\0';
+    }
+}
+
+// Finds the file `spec` names: relative to `base_dir`, then to the working
+// directory (absolute paths as they are), with ".pan" appended if missing.
+// Writes its canonical path to `resolved` (PATH_MAX bytes) and returns 1 if found.
+int module_resolve_path(const char* spec, const char* base_dir, char* resolved) {
+    size_t length = strlen(spec);
+    const char* extension = length >= 4 && strcmp(spec + length - 4, ".pan") == 0 ? "" : ".pan";
+    const char* bases[2] = {spec[0] == '/' ? NULL : base_dir, NULL};
+    for (int i = 0; i < 2; i++) {
+        char candidate[PATH_MAX];
+        int written = bases[i] ? snprintf(candidate, sizeof(candidate), "%s/%s%s", bases[i], spec, extension)
+                               : snprintf(candidate, sizeof(candidate), "%s%s", spec, extension);
+        struct stat st;
+        if (written > 0 && (size_t)written < sizeof(candidate) && realpath(candidate, resolved) &&
+            stat(resolved, &st) == 0 && S_ISREG(st.st_mode)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Registry index of the module `spec` names, registering it if it is new
+int module_import(ModuleRegistry* registry, const char* spec, const char* base_dir) {
+    char path[PATH_MAX];
+    if (!module_resolve_path(spec, base_dir, path)) {
+        raise_error("Import Error: Module '%s' not found in %s or the working directory.", spec, base_dir);
+    }
+    for (int i = 0; i < registry->count; i++) {
+        if (strcmp(registry->modules[i].path, path) != 0) continue;
+        if (registry->modules[i].state == MODULE_FAILED) registry->modules[i].state = MODULE_PENDING;
+        return i;
+    }
+    if (registry->count >= registry->capacity) {
+        registry->capacity = registry->capacity ? registry->capacity * 2 : 8;
+        registry->modules = (Module*)core_runtime_realloc(MEMORY_MODULES, registry->modules,
+                                                          sizeof(Module) * registry->capacity);
+        if (!registry->modules) raise_error("Memory allocation failed for modules.");
+    }
+    Module* module = &registry->modules[registry->count];
+    memset(module, 0, sizeof(*module));
+    module->path = core_runtime_strndup(MEMORY_MODULES, path, strlen(path));
+    const char* base = strrchr(path, '/') + 1; // realpath output is absolute
+    size_t base_length = strlen(base);
+    if (base_length > 4 && strcmp(base + base_length - 4, ".pan") == 0) base_length -= 4;
+    module->name = core_runtime_strndup(MEMORY_MODULES, base, base_length);
+    if (!module->path || !module->name) raise_error("Memory allocation failed for modules.");
+    module->state = MODULE_PENDING;
+    return registry->count++;
+}
+
+// Maps a loaded module onto the session: its slots onto `symbols` and its
+// imports onto registry indices (registering new modules)
+void module_link(ModuleRegistry* registry, SymbolTable* symbols, int index) {
+    CompiledModule* compiled = &registry->modules[index].compiled;
+    int* slots = (int*)core_runtime_alloc(MEMORY_MODULES, sizeof(int) * (compiled->num_names + compiled->num_imports + 1));
+    if (!slots) raise_error("Memory allocation failed for modules.");
+    int* imports = slots + compiled->num_names;
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", registry->modules[index].path);
+    *strrchr(dir, '/') = '\0';
+    if (!dir[0]) snprintf(dir, sizeof(dir), "/");
+    for (int i = 0; i < compiled->num_imports; i++) {
+        imports[i] = module_import(registry, compiled->imports[i], dir);
+        compiled = &registry->modules[index].compiled; // The registry may have grown
+    }
+
+    Module* module = &registry->modules[index];
+    for (int i = 0; i < compiled->num_names; i++) {
+        const char* name = compiled->names[i];
+        if (strchr(name, '.')) {
+            slots[i] = symbol_intern(symbols, name, strlen(name));
+            continue;
+        }
+        size_t length = strlen(module->name) + 1 + strlen(name);
+        char* qualified = (char*)core_runtime_alloc(MEMORY_MODULES, length + 1);
+        if (!qualified) raise_error("Memory allocation failed for modules.");
+        snprintf(qualified, length + 1, "%s.%s", module->name, name);
+        slots[i] = symbol_intern(symbols, qualified, length);
+        core_runtime_free(qualified);
+    }
+
+    Bytecode* bc = &module->bytecode;
+    *bc = compiled->bytecode;
+    bc->code = (int*)core_runtime_alloc(MEMORY_BYTECODE, sizeof(int) * (compiled->bytecode.count + 1));
+    if (!bc->code) raise_error("Memory allocation failed for modules.");
+    bc->capacity = compiled->bytecode.count;
+    for (int i = 0; i < bc->count; i++) {
+        int op = compiled->bytecode.code[i];
+        bc->code[i] = op;
+        if (opcode_operands[op] == OPERAND_NONE) continue;
+        int operand = compiled->bytecode.code[++i];
+        bc->code[i] = opcode_operands[op] == OPERAND_SLOT ? slots[operand]
+                    : opcode_operands[op] == OPERAND_MODULE ? imports[operand] : operand;
+    }
+    core_runtime_free(slots);
+    module->state = MODULE_LINKED;
+}
+
+// Resolves the imports among `statements` against `base_dir`, then loads and
+// links every module they need, directly or through other modules. Returns
+// how many modules were loaded and sets *cache_hits to how many of those came
+// from the cache. Modules that fail to load are marked MODULE_FAILED once the
+// rest of their wave is linked, and the first failure is raised.
+int modules_resolve(ModuleRegistry* registry, SymbolTable* symbols, ASTNode** statements, int num_statements,
+                    const char* base_dir, int opt_level, int* cache_hits) {
+    *cache_hits = 0;
+    for (int i = 0; i < num_statements; i++) {
+        if (statements[i]->type == NODE_IMPORT && statements[i]->data.import_stmt.module < 0) {
+            statements[i]->data.import_stmt.module = module_import(registry, statements[i]->data.import_stmt.path,
+                                                                   base_dir);
+        }
+    }
+    if (registry->engine_hash == 0) {
+        registry->engine_hash = module_engine_hash(registry->line_markers);
+        module_cache_init(registry);
+    }
+    registry->opt_level = opt_level;
+
+    int loaded = 0;
+    while (1) {
+        int num_pending = 0;
+        int* pending = (int*)core_runtime_realloc(MEMORY_MODULES, registry->pending, sizeof(int) * (registry->count + 1));
+        if (!pending) raise_error("Memory allocation failed for modules.");
+        registry->pending = pending;
+        for (int i = 0; i < registry->count; i++) {
+            if (registry->modules[i].state == MODULE_PENDING) pending[num_pending++] = i;
         }
-        current = current->next;
+        if (num_pending == 0) break;
+        // Compiling shares no state, so each module of this wave can go to a different thread
+        core_runtime_parallel_for((size_t)num_pending, 1, module_load_range, registry);
+        int failed = -1;
+        for (int i = 0; i < num_pending; i++) {
+            Module* module = &registry->modules[pending[i]];
+            if (module->error[0]) {
+                module->state = MODULE_FAILED;
+                if (failed < 0) failed = pending[i];
+                continue;
+            }
+            if (module->compiled.mapping) (*cache_hits)++;
+            module_link(registry, symbols, pending[i]);
+        }
+        if (failed >= 0) raise_error("%s", registry->modules[failed].error);
+        loaded += num_pending;
+    }
+    return loaded;
+}
+
+void modules_free(ModuleRegistry* registry) {
+    for (int i = 0; i < registry->count; i++) {
+        Module* module = &registry->modules[i];
+        core_runtime_free(module->bytecode.code);
+        module_compiled_free(&module->compiled);
+        core_runtime_free(module->path);
+        core_runtime_free(module->name);
     }
-    fprintf(stderr, "Name Error: Variable '%s' not found.\n", name);
-    exit(1);
+    core_runtime_free(registry->modules);
+    core_runtime_free(registry->pending);
+    memset(registry, 0, sizeof(*registry));
+}
+
+// --- Sessions ---
+// A session is one interpreter context: the symbol table, the AST arena, the
+// bytecode, the loaded modules, the runtime context the program's values live
+// on and its output sink all belong to it. The engine's only process-wide
+// state is the native registry, bound before any session starts, and the
+// settings core_runtime.h lists as process-wide, so separate sessions can run
+// on separate threads at the same time with nothing shared to lock. State
+// persists across session_run calls, so each new chunk of input is lexed,
+// parsed and compiled incrementally against what came before instead of
+// rebuilding everything. An error ends the call, not the process: the message
+// is kept in `error` and the session stays usable.
+typedef struct {
+    Value* values;
+    int capacity;
+} VMStack;
+
+typedef struct {
+    SymbolTable symbols;    // Variables of the program and, qualified, of its modules
+    Arena arena;            // Owns the AST (and string constants) of every input run so far
+    Bytecode bytecode;      // --vm: code for every input run so far; new input is appended
+    ModuleRegistry modules;
+    RuntimeContext runtime; // Heap of the program's values, output sink and Matrix.random state
+    Profiler* profiler;     // NULL unless profiling
+    VMStack* stacks;        // vm_run stacks: the program's, then one per module being imported
+    int num_stacks;
+    int stack_depth;        // vm_run calls in progress
+    char error[RUNTIME_ERROR_SIZE]; // Message of the last failed run
+} Session;
+
+// `profiler` may be NULL; several sessions must not share one
+void session_init(Session* session, Profiler* profiler) {
+    memset(session, 0, sizeof(*session));
+    arena_init(&session->arena, ARENA_DEFAULT_CHUNK_SIZE, MEMORY_AST);
+    bytecode_init(&session->bytecode);
+    core_runtime_context_init(&session->runtime);
+    session->profiler = profiler;
+    session->bytecode.line_markers = profiler != NULL;
+    session->modules.line_markers = profiler != NULL;
+}
+
+void session_free(Session* session) {
+    // The arena owns every node and string, so the trees go in one shot
+    arena_free(&session->arena);
+    bytecode_free(&session->bytecode);
+    modules_free(&session->modules);
+    symbol_table_free(&session->symbols);
+    for (int i = 0; i < session->num_stacks; i++) core_runtime_free(session->stacks[i].values);
+    core_runtime_free(session->stacks);
+    core_runtime_context_free(&session->runtime);
 }
 
-// Free symbol table
-void free_symbol_table() {
-    Symbol* current = symbol_table;
-    while (current) {
-        Symbol* next = current->next;
-        free(current->name);
-        free(current);
-        current = next;
+typedef void (*SessionBody)(Session* session, void* context);
+
+// Calls body(session, context) with the session's runtime context entered
+// and errors trapped. Returns 0, or -1 with the message in session->error
+// once whatever the error interrupted (VM calls, running modules, profiler
+// frames) has been wound back.
+int session_protect(Session* session, SessionBody body, void* context) {
+    RuntimeContext* previous = core_runtime_context_enter(&session->runtime);
+    RuntimeTrap trap;
+    int status = 0;
+    core_runtime_trap_push(&trap);
+    if (setjmp(trap.jump) == 0) {
+        body(session, context);
+        core_runtime_trap_pop(&trap);
+    } else {
+        memcpy(session->error, trap.message, sizeof(session->error));
+        session->stack_depth = 0;
+        for (int i = 0; i < session->modules.count; i++) {
+            // A module stopped halfway runs again from the start when it is next imported
+            if (session->modules.modules[i].state == MODULE_RUNNING) session->modules.modules[i].state = MODULE_LINKED;
+        }
+        profile_unwind(session->profiler);
+        status = -1;
     }
-    symbol_table = NULL;
+    core_runtime_context_enter(previous);
+    return status;
 }
 
+// Runs a resolved import (see the Bytecode VM section below)
+void module_run(Session* session, int module);
 
+// --- Interpreter ---
 // Evaluate expressions
-int evaluate_expression(ASTNode* node) {
-    if (!node) { fprintf(stderr, "Runtime Error: Null expression node.\n"); exit(1); }
+Value evaluate_expression(Session* session, ASTNode* node) {
+    if (!node) raise_error("Runtime Error: Null expression node.");
     switch (node->type) {
         case NODE_NUMBER:
             return node->data.number_val;
         case NODE_STRING:
-            fprintf(stderr, "Runtime Error: String '%s' cannot be evaluated as an integer expression.\n", node->data.string_val);
-            exit(1);
+            return node->data.string_val;
+        case NODE_BOOL:
+            return node->data.bool_val;
         case NODE_VAR:
-            return get_symbol(node->data.var_name);
+            return get_symbol(&session->symbols, node->data.var.slot);
         case NODE_BINOP: {
-            int left_val = evaluate_expression(node->data.bin_op.left);
-            int right_val = evaluate_expression(node->data.bin_op.right);
+            Value left_val = evaluate_expression(session, node->data.bin_op.left);
+            Value right_val = evaluate_expression(session, node->data.bin_op.right);
+            // Type errors and division by zero are reported by the value layer
             switch (node->data.bin_op.op) {
-                case TOKEN_PLUS: return left_val + right_val;
-                case TOKEN_MINUS: return left_val - right_val;
-                case TOKEN_TIMES: return left_val * right_val;
-                case TOKEN_DIVIDE:
-                    if (right_val == 0) {
-                        fprintf(stderr, "Runtime Error: Division by zero.\n");
-                        exit(1);
-                    }
-                    return left_val / right_val;
+                case TOKEN_PLUS: return value_add(left_val, right_val);
+                case TOKEN_MINUS: return value_sub(left_val, right_val);
+                case TOKEN_TIMES: return value_mul(left_val, right_val);
+                case TOKEN_DIVIDE: return value_div(left_val, right_val);
                 default:
-                    fprintf(stderr, "Runtime Error: Unknown binary operator.\n");
-                    exit(1);
+                    raise_error("Runtime Error: Unknown binary operator.");
+            }
+        }
+        case NODE_CALL: {
+            Value args[NATIVE_MAX_ARITY];
+            for (int i = 0; i < node->data.call.num_args; i++) {
+                args[i] = evaluate_expression(session, node->data.call.args[i]);
+            }
+            const NativeBinding* native = &core_runtime_natives()[node->data.call.builtin];
+            if (session->profiler) {
+                profile_enter(session->profiler, PROFILE_NATIVE, node->data.call.builtin, native->name);
+                Value result = node->data.call.typed ? native->function(args) : core_runtime_native_call(native, args);
+                profile_leave(session->profiler);
+                return result;
             }
+            return node->data.call.typed ? native->function(args) : core_runtime_native_call(native, args);
         }
         default:
-            fprintf(stderr, "Runtime Error: Unexpected node type in expression evaluation.\n");
-            exit(1);
+            raise_error("Runtime Error: Unexpected node type in expression evaluation.");
     }
 }
 
 // Execute statements
-void execute_statement(ASTNode* node) {
+void execute_statement(Session* session, ASTNode* node) {
     if (!node) return;
+    if (session->profiler) profile_line(session->profiler, node->line);
     switch (node->type) {
         case NODE_ASSIGN:
-            set_symbol(node->data.assign_op.var_name, evaluate_expression(node->data.assign_op.expr));
+            set_symbol(&session->symbols, node->data.assign_op.slot,
+                       evaluate_expression(session, node->data.assign_op.expr));
             break;
-        case NODE_PRINT: {
-            ASTNode* expr = node->data.print_stmt.expr;
-            if (expr->type == NODE_STRING) {
-                printf("%s\n", expr->data.string_val);
-            } else {
-                printf("%d\n", evaluate_expression(expr));
-            }
+        case NODE_PRINT:
+            value_print(evaluate_expression(session, node->data.print_stmt.expr));
+            break;
+        case NODE_CALL:
+            evaluate_expression(session, node);
+            break;
+        case NODE_IMPORT:
+            module_run(session, node->data.import_stmt.module);
             break;
-        }
         default:
-            fprintf(stderr, "Runtime Error: Unexpected statement type.\n");
-            exit(1);
+            raise_error("Runtime Error: Unexpected statement type.");
+    }
+}
+
+// --- Bytecode VM ---
+// Uses computed-goto threaded dispatch on GCC/Clang and a switch loop elsewhere.
+#if defined(__GNUC__) && !defined(PANLANG_NO_THREADED_DISPATCH)
+#define VM_THREADED_DISPATCH 1
+#endif
+
+// Each nested vm_run (a module imported by running code) gets its own stack,
+// kept by the session for the next run at that depth
+Value* vm_acquire_stack(Session* session, int size) {
+    if (session->stack_depth == session->num_stacks) {
+        VMStack* stacks = (VMStack*)core_runtime_realloc(MEMORY_BYTECODE, session->stacks,
+                                                         sizeof(VMStack) * (session->num_stacks + 1));
+        if (!stacks) raise_error("Memory allocation failed for VM stack.");
+        session->stacks = stacks;
+        session->stacks[session->num_stacks++] = (VMStack){NULL, 0};
+    }
+    VMStack* stack = &session->stacks[session->stack_depth];
+    if (stack->capacity < size) {
+        Value* values = (Value*)core_runtime_realloc(MEMORY_BYTECODE, stack->values, sizeof(Value) * size);
+        if (!values) raise_error("Memory allocation failed for VM stack.");
+        stack->values = values;
+        stack->capacity = size;
+    }
+    session->stack_depth++;
+    return stack->values;
+}
+
+void vm_run(Session* session, const Bytecode* bc, int start) {
+    Value* stack = vm_acquire_stack(session, bc->max_stack_depth + 1);
+    Value* sp = stack; // Points one past the top of the stack
+    const int* ip = bc->code + start;
+    const Value* constants = bc->constants;
+    const NativeBinding* natives = core_runtime_natives();
+    SymbolTable* symbols = &session->symbols;
+    Value* values = symbols->values;
+    unsigned char* defined = symbols->defined;
+    Profiler* profiler = session->profiler;
+
+#ifdef VM_THREADED_DISPATCH
+    static void* dispatch_table[OP_COUNT] = {
+        [OP_CONST] = &&do_CONST, [OP_LOAD] = &&do_LOAD, [OP_STORE] = &&do_STORE,
+        [OP_ADD] = &&do_ADD, [OP_SUB] = &&do_SUB, [OP_MUL] = &&do_MUL, [OP_DIV] = &&do_DIV,
+        [OP_ADDK] = &&do_ADDK, [OP_SUBK] = &&do_SUBK, [OP_MULK] = &&do_MULK, [OP_DIVK] = &&do_DIVK,
+        [OP_CALL] = &&do_CALL, [OP_CALL_TYPED] = &&do_CALL_TYPED, [OP_PRINT] = &&do_PRINT, [OP_POP] = &&do_POP, [OP_IMPORT] = &&do_IMPORT,
+        [OP_LINE] = &&do_LINE, [OP_HALT] = &&do_HALT,
+    };
+#define VM_CASE(op) do_##op
+#define VM_DISPATCH() goto *dispatch_table[*ip++]
+    VM_DISPATCH();
+#else
+#define VM_CASE(op) case OP_##op
+#define VM_DISPATCH() goto dispatch
+dispatch:
+    switch ((OpCode)*ip++) {
+#endif
+
+    VM_CASE(CONST):
+        *sp++ = constants[*ip++];
+        VM_DISPATCH();
+    VM_CASE(LOAD): {
+        int slot = *ip++;
+        if (!defined[slot]) get_symbol(symbols, slot); // Raises the Name Error
+        *sp++ = values[slot];
+        VM_DISPATCH();
+    }
+    VM_CASE(STORE):
+        set_symbol(symbols, *ip++, *--sp);
+        VM_DISPATCH();
+    // The value_* helpers inline the small-int and double cases
+    VM_CASE(ADD):
+        sp--; sp[-1] = value_add(sp[-1], sp[0]);
+        VM_DISPATCH();
+    VM_CASE(SUB):
+        sp--; sp[-1] = value_sub(sp[-1], sp[0]);
+        VM_DISPATCH();
+    VM_CASE(MUL):
+        sp--; sp[-1] = value_mul(sp[-1], sp[0]);
+        VM_DISPATCH();
+    VM_CASE(DIV):
+        sp--; sp[-1] = value_div(sp[-1], sp[0]);
+        VM_DISPATCH();
+    VM_CASE(ADDK):
+        sp[-1] = value_add(sp[-1], constants[*ip++]);
+        VM_DISPATCH();
+    VM_CASE(SUBK):
+        sp[-1] = value_sub(sp[-1], constants[*ip++]);
+        VM_DISPATCH();
+    VM_CASE(MULK):
+        sp[-1] = value_mul(sp[-1], constants[*ip++]);
+        VM_DISPATCH();
+    VM_CASE(DIVK):
+        sp[-1] = value_div(sp[-1], constants[*ip++]);
+        VM_DISPATCH();
+    VM_CASE(CALL): {
+        int index = *ip++;
+        const NativeBinding* native = &natives[index];
+        sp -= native->arity; // Arguments are in order on the stack
+        if (profiler) profile_enter(profiler, PROFILE_NATIVE, index, native->name);
+        *sp = core_runtime_native_call(native, sp);
+        if (profiler) profile_leave(profiler);
+        sp++;
+        VM_DISPATCH();
+    }
+    VM_CASE(CALL_TYPED): {
+        int index = *ip++;
+        const NativeBinding* native = &natives[index];
+        sp -= native->arity;
+        if (profiler) profile_enter(profiler, PROFILE_NATIVE, index, native->name);
+        *sp = native->function(sp);
+        if (profiler) profile_leave(profiler);
+        sp++;
+        VM_DISPATCH();
+    }
+    VM_CASE(PRINT):
+        value_print(*--sp);
+        VM_DISPATCH();
+    VM_CASE(POP):
+        sp--;
+        VM_DISPATCH();
+    VM_CASE(IMPORT):
+        module_run(session, *ip++); // Imports are linked before anything runs, so `values` stays valid
+        VM_DISPATCH();
+    VM_CASE(LINE):
+        profile_line(profiler, *ip++);
+        VM_DISPATCH();
+    VM_CASE(HALT):
+        session->stack_depth--;
+        return;
+
+#ifndef VM_THREADED_DISPATCH
+    default:
+        raise_error("Runtime Error: Invalid opcode %d.", ip[-1]);
     }
+#endif
+#undef VM_CASE
+#undef VM_DISPATCH
+}
+
+void module_run(Session* session, int index) {
+    Module* module = &session->modules.modules[index];
+    if (module->state == MODULE_DONE) return;
+    if (module->state == MODULE_FAILED) raise_error("%s", module->error); // Imported by a module that loaded
+    if (module->state == MODULE_RUNNING) {
+        raise_error("Import Error: Circular import of module '%s'.", module->path);
+    }
+    module->state = MODULE_RUNNING;
+    if (session->profiler) profile_enter(session->profiler, PROFILE_MODULE, index, module->path);
+    vm_run(session, &module->bytecode, 0);
+    if (session->profiler) profile_leave(session->profiler);
+    module->state = MODULE_DONE;
 }
 
 // --- Main execution flow ---
-void run_panlang_code(const char* code) {
+typedef struct {
+    int use_vm;    // Run through the bytecode VM instead of the tree-walking evaluator
+    int use_llvm;  // Lower to LLVM IR and run it through the JIT
+    int dump_ir;   // Print the optimized LLVM IR before running it
+    int opt_level; // -O level: AST passes (see optimization_passes) and LLVM pipeline
+    int quiet;     // Print only the program's output, not the parse, module and optimizer reports
+    MemoryReport* memory;   // --mem-stats: where each phase's allocations are recorded; NULL: off
+    const char* module_dir; // Imports are resolved here first; NULL means the working directory
+} RunOptions;
+
+typedef struct {
+    const char* code;
+    size_t length;
+    const RunOptions* options;
+} SessionInput;
+
+void session_execute(Session* session, void* context) {
+    const SessionInput* input = (const SessionInput*)context;
+    const RunOptions* options = input->options;
+    memory_phase_start(options->memory);
+    int num_statements = 0;
+    ASTNode** program_ast = parse_source(input->code, input->length, &session->symbols, &session->arena,
+                                         &num_statements);
+    memory_phase_end(options->memory, MEMORY_PHASE_PARSE);
+
+    if (!options->quiet) {
+        printf("\n--- Abstract Syntax Tree (Parsed) ---\n");
+        // In a real project, you'd print a structured AST for debugging.
+        // For this simple mock, just confirm nodes exist.
+        printf("Successfully parsed %d statements.\n", num_statements);
+        printf("AST arena: %zu bytes used (%zu reserved in %d chunks).\n",
+               session->arena.bytes_used, session->arena.bytes_reserved, session->arena.num_chunks);
+    }
+
+    int cache_hits = 0;
+    int loaded = modules_resolve(&session->modules, &session->symbols, program_ast, num_statements,
+                                 options->module_dir ? options->module_dir : ".", options->opt_level, &cache_hits);
+    if (loaded > 0 && !options->quiet) {
+        printf("Loaded %d module%s (%d from the module cache).\n", loaded, loaded == 1 ? "" : "s", cache_hits);
+    }
+    memory_phase_end(options->memory, MEMORY_PHASE_MODULES);
+
+    program_ast = optimize_statements(program_ast, &num_statements, &session->arena, &session->symbols,
+                                      options->opt_level, !options->quiet);
+    memory_phase_end(options->memory, MEMORY_PHASE_OPTIMIZE);
+
+    profile_resume(session->profiler);
+    if (options->use_llvm) {
+#ifdef PANLANG_WITH_LLVM
+        // The backend prints its own results header after the optional IR dump, and
+        // the details of a failure on stderr
+        if (llvm_backend_generate_code(program_ast, num_statements, session->symbols.count,
+                                       options->opt_level, options->dump_ir) != 0) {
+            raise_error("LLVM Backend Error: The program could not be compiled with --llvm.");
+        }
+#else
+        raise_error("Error: this build of PanLang was compiled without LLVM support.");
+#endif
+    } else if (options->use_vm) {
+        if (!options->quiet) printf("\n--- Execution Results ---\n");
+        int start = bytecode_compile_program(&session->bytecode, program_ast, num_statements);
+        vm_run(session, &session->bytecode, start);
+    } else {
+        if (!options->quiet) printf("\n--- Execution Results ---\n");
+        for (int i = 0; i < num_statements; i++) {
+            execute_statement(session, program_ast[i]);
+        }
+    }
+    profile_suspend(session->profiler);
+    core_runtime_output_flush(); // Program output is buffered by the runtime
+    memory_phase_end(options->memory, MEMORY_PHASE_EXECUTE);
+}
+
+// Lexes, parses, optimizes and runs `code` in the session. Returns 0, or -1
+// if it stopped on an error, whose message is then in session->error.
+// Sessions on different threads may run at the same time.
+int session_run(Session* session, const char* code, size_t length, const RunOptions* options) {
+    SessionInput input = {code, length, options};
+    return session_protect(session, session_execute, &input);
+}
+
+// Runs a whole program in a fresh session. Returns 0, or 1 after reporting
+// an error on stderr.
+int run_panlang_code(const char* code, size_t length, const RunOptions* options, Profiler* profiler) {
+    Session session;
+    session_init(&session, profiler);
+    int status = 0;
+    if (session_run(&session, code, length, options) != 0) {
+        fflush(stdout);
+        fprintf(stderr, "%s\n", session.error);
+        status = 1;
+    }
+    session_free(&session);
+    return status;
+}
+
+// --- Streaming execution ---
+// `--stream` runs a script while it is being read, from a file or a pipe.
+// Complete statements are parsed, optimized and executed in batches, and each
+// batch's AST and bytecode are released before the next one is read. Memory is
+// bounded by the batch size and the number of distinct variables rather than
+// by the length of the script, and output starts after the first batch rather
+// than after the whole parse. A statement ends at a newline outside a string
+// literal or comment, so a batch boundary never splits one.
+//
+// Values outlive their batch. String literals still held by a variable are
+// copied to the runtime heap, and the heap is collected between batches with
+// the variables and the loaded modules' constants as roots.
+#define STREAM_READ_SIZE (64 * 1024)
+#define STREAM_BATCH_LINES 256        // Most lines parsed and run at once
+#define STREAM_MIN_COLLECT 4096       // Heap objects below which collecting is not worth it
+
+typedef struct {
+    int fd;
+    int interactive; // Not a regular file: a read may block, so output is flushed first
+    char* buffer;
+    size_t length;   // Bytes held
+    size_t capacity;
+    size_t scanned;  // Bytes already scanned for statement boundaries
+    size_t complete; // End of the last complete line found, 0 if none
+    int lines;       // Complete lines in [0, complete)
+    int in_string;   // Scanner state at `scanned`
+    int in_comment;
+    int eof;
+    int line;        // Source line number of buffer[0]
+} StreamReader;
+
+// Finds line ends after `scanned`, up to a full batch, tracking strings and
+// comments the way the lexer does
+void stream_scan(StreamReader* reader) {
+    size_t i = reader->scanned;
+    while (i < reader->length && reader->lines < STREAM_BATCH_LINES) {
+        char c = reader->buffer[i++];
+        if (reader->in_string) {
+            if (c == '"') reader->in_string = 0;
+        } else if (c == '\n') {
+            reader->in_comment = 0;
+            reader->complete = i;
+            reader->lines++;
+        } else if (!reader->in_comment) {
+            if (c == '#') reader->in_comment = 1;
+            else if (c == '"') reader->in_string = 1;
+        }
+    }
+    reader->scanned = i;
+}
+
+// Reads until a batch of complete statements is buffered in [0, complete).
+// Returns 0 once the input is exhausted.
+int stream_next_batch(StreamReader* reader) {
+    while (1) {
+        stream_scan(reader);
+        if (reader->lines >= STREAM_BATCH_LINES) return 1;
+        if (reader->eof) {
+            reader->complete = reader->length; // The last line may lack a newline
+            return reader->complete > 0;
+        }
+        // A pipe may not deliver more for a while; run what has arrived
+        if (reader->complete > 0 && reader->interactive) return 1;
+
+        if (reader->capacity - reader->length < STREAM_READ_SIZE) {
+            reader->capacity = reader->capacity ? reader->capacity * 2 : 2 * STREAM_READ_SIZE;
+            reader->buffer = (char*)core_runtime_realloc(MEMORY_SOURCE, reader->buffer, reader->capacity);
+            if (!reader->buffer) raise_error("Memory allocation failed for input buffer.");
+        }
+        if (reader->interactive) core_runtime_output_flush(); // Show everything so far before waiting
+        ssize_t n = read(reader->fd, reader->buffer + reader->length, STREAM_READ_SIZE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) raise_error("Error reading input: %s", strerror(errno));
+        if (n == 0) reader->eof = 1;
+        reader->length += (size_t)n;
+    }
+}
+
+// Drops the batch that has run from the front of the buffer
+void stream_consume(StreamReader* reader) {
+    for (const char* p = reader->buffer; (p = memchr(p, '\n', reader->buffer + reader->complete - p)) != NULL; p++) {
+        reader->line++;
+    }
+    memmove(reader->buffer, reader->buffer + reader->complete, reader->length - reader->complete);
+    reader->length -= reader->complete;
+    reader->scanned -= reader->complete;
+    reader->complete = 0;
+    reader->lines = 0;
+}
+
+// Variables holding a string literal from the batch get their own copy before the AST goes
+void stream_promote_strings(SymbolTable* symbols, const Arena* arena) {
+    for (int slot = 0; slot < symbols->count; slot++) {
+        Value value = symbols->values[slot];
+        if (symbols->defined[slot] && value_is_string(value) && arena_contains(arena, value_as_heap(value))) {
+            const HeapString* string = (const HeapString*)value_as_heap(value);
+            symbols->values[slot] = value_box_string(string->chars, string->length);
+        }
+    }
+}
+
+// Frees heap objects no variable or module constant refers to, once the heap
+// has doubled since the last collection
+void stream_collect(Session* session, size_t* threshold) {
+    if (value_heap_count() < *threshold) return;
+    const SymbolTable* symbols = &session->symbols;
+    const ModuleRegistry* registry = &session->modules;
+    size_t num_roots = (size_t)symbols->count;
+    for (int i = 0; i < registry->count; i++) {
+        num_roots += (size_t)registry->modules[i].compiled.bytecode.num_constants;
+    }
+    Value* roots = (Value*)core_runtime_alloc(MEMORY_VALUES, sizeof(Value) * (num_roots + 1));
+    if (!roots) raise_error("Memory allocation failed for heap collection.");
+    memcpy(roots, symbols->values, sizeof(Value) * symbols->count);
+    size_t count = (size_t)symbols->count;
+    for (int i = 0; i < registry->count; i++) {
+        const Bytecode* bc = &registry->modules[i].compiled.bytecode;
+        memcpy(roots + count, bc->constants, sizeof(Value) * bc->num_constants);
+        count += (size_t)bc->num_constants;
+    }
+    value_heap_collect(roots, count);
+    core_runtime_free(roots);
+    *threshold = value_heap_count() * 2 > STREAM_MIN_COLLECT ? value_heap_count() * 2 : STREAM_MIN_COLLECT;
+}
+
+typedef struct {
+    StreamReader reader;
+    const RunOptions* options;
+    size_t collect_threshold;
+    long total_statements;
+    int done;
+} StreamState;
+
+// Reads, runs and releases one batch; sets `done` at the end of the input
+void stream_batch(Session* session, void* context) {
+    StreamState* stream = (StreamState*)context;
+    const RunOptions* options = stream->options;
+    memory_phase_start(options->memory);
+    if (!stream_next_batch(&stream->reader)) {
+        stream->done = 1;
+        return;
+    }
     Lexer lexer;
-    parser_init(&lexer, code); // Initialize lexer, then parser (lexer is embedded)
-    
+    lexer_init(&lexer, stream->reader.buffer, stream->reader.complete, &session->symbols);
+    lexer.line = stream->reader.line; // Errors report lines of the whole script
     Parser parser;
-    parser_init(&parser, &lexer);
-
+    parser_init(&parser, &lexer, &session->arena);
     int num_statements = 0;
-    ASTNode** program_ast = parse_program(&parser, &num_statements);
+    ASTNode** batch = parse_program(&parser, &num_statements);
+    stream->total_statements += num_statements;
+    memory_phase_end(options->memory, MEMORY_PHASE_PARSE);
+
+    int cache_hits = 0;
+    modules_resolve(&session->modules, &session->symbols, batch, num_statements,
+                    options->module_dir ? options->module_dir : ".", options->opt_level, &cache_hits);
+    memory_phase_end(options->memory, MEMORY_PHASE_MODULES);
+    batch = optimize_statements(batch, &num_statements, &session->arena, &session->symbols, options->opt_level, 0);
+    memory_phase_end(options->memory, MEMORY_PHASE_OPTIMIZE);
+    profile_resume(session->profiler);
+    if (options->use_vm) {
+        bytecode_clear(&session->bytecode);
+        vm_run(session, &session->bytecode, bytecode_compile_program(&session->bytecode, batch, num_statements));
+    } else {
+        for (int i = 0; i < num_statements; i++) {
+            execute_statement(session, batch[i]);
+        }
+    }
+    profile_suspend(session->profiler);
+
+    stream_promote_strings(&session->symbols, &session->arena);
+    arena_reset(&session->arena);
+    stream_collect(session, &stream->collect_threshold);
+    stream_consume(&stream->reader);
+    memory_phase_end(options->memory, MEMORY_PHASE_EXECUTE);
+}
 
-    printf("\n--- Abstract Syntax Tree (Parsed) ---\n");
-    // In a real project, you'd print a structured AST for debugging.
-    // For this simple mock, just confirm nodes exist.
-    printf("Successfully parsed %d statements.\n", num_statements);
+// Runs the script read from `fd` batch by batch. `name` is for the header
+// only. Returns 0, or 1 after reporting an error on stderr.
+int stream_run(int fd, const char* name, const RunOptions* options, Profiler* profiler) {
+    StreamState stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.reader.fd = fd;
+    stream.reader.line = 1;
+    struct stat st;
+    stream.reader.interactive = fstat(fd, &st) != 0 || !S_ISREG(st.st_mode);
+    stream.options = options;
+    stream.collect_threshold = STREAM_MIN_COLLECT;
 
+    Session session;
+    session_init(&session, profiler);
+    printf("--- PanLang Streaming Execution from %s ---\n", name);
     printf("\n--- Execution Results ---\n");
-    for (int i = 0; i < num_statements; i++) {
-        execute_statement(program_ast[i]);
+
+    int status = 0;
+    while (!stream.done) {
+        if (session_protect(&session, stream_batch, &stream) != 0) {
+            fflush(stdout);
+            fprintf(stderr, "%s\n", session.error);
+            status = 1;
+            break;
+        }
     }
+    core_runtime_output_flush();
+    if (status == 0) printf("\nStreamed %ld statements.\n", stream.total_statements);
 
-    // Clean up
-    for (int i = 0; i < num_statements; i++) {
-        free_ast_node(program_ast[i]);
+    session_free(&session);
+    core_runtime_free(stream.reader.buffer);
+    return status;
+}
+
+// --- Command line ---
+void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-O0|-O1|-O2] [--vm | --llvm] [--dump-ir] [--threads N] [--deterministic]\n"
+                    "       [--output FILE] [--unbuffered] [--stream] [--profile] [--profile-out FILE]\n"
+                    "       [--profile-top N] [--mem-stats] [file.pan | -]\n", program);
+    fprintf(stderr, "       %s build [-O0|-O1|-O2] file.pan [-o output] [--emit-c]\n", program);
+    fprintf(stderr, "  -O<n>            Optimization level (default -O1): -O1 constant folding,\n");
+    fprintf(stderr, "                   -O2 adds common-subexpression and dead-store elimination\n");
+    fprintf(stderr, "  --vm             Execute through the bytecode VM instead of the tree-walking evaluator\n");
+    fprintf(stderr, "  --llvm           JIT-compile the program through LLVM (requires a PANLANG_WITH_LLVM build)\n");
+    fprintf(stderr, "  --dump-ir        With --llvm, print the optimized LLVM IR before running it\n");
+    fprintf(stderr, "  --threads N      Threads for tensor kernels (default $PANLANG_THREADS or one per CPU)\n");
+    fprintf(stderr, "  --deterministic  Make tensor reductions independent of the thread count\n");
+    fprintf(stderr, "  --output FILE    Write program output to FILE instead of stdout\n");
+    fprintf(stderr, "  --unbuffered     Pass output on line by line (the default when stdout is a terminal)\n");
+    fprintf(stderr, "  --stream         Run statements as they are read, in bounded memory; reads stdin\n");
+    fprintf(stderr, "                   when the file is - or missing\n");
+    fprintf(stderr, "  --profile        Time each source line, native call and module; print the hottest\n");
+    fprintf(stderr, "                   lines and write folded stacks for flame graphs (not with --llvm)\n");
+    fprintf(stderr, "  --profile-out F  Folded stacks file (default panlang.folded); implies --profile\n");
+    fprintf(stderr, "  --profile-top N  Rows in each table of the profile report (default 10)\n");
+    fprintf(stderr, "  --mem-stats      Count allocations per phase and subsystem; print them, the peaks\n");
+    fprintf(stderr, "                   and any leaks at exit\n");
+    fprintf(stderr, "  build            Compile to a standalone executable linked against the core runtime\n");
+    fprintf(stderr, "                   (--emit-c keeps the generated <output>.c)\n");
+}
+
+int has_pan_extension(const char* file_path) {
+    size_t length = strlen(file_path);
+    return length >= 4 && strcmp(file_path + length - 4, ".pan") == 0;
+}
+
+// Directory holding `file_path`; a script's imports are resolved against it
+void script_directory(const char* file_path, char* dir, size_t size) {
+    const char* slash = strrchr(file_path, '/');
+    if (!slash) {
+        snprintf(dir, size, ".");
+    } else {
+        snprintf(dir, size, "%.*s", slash == file_path ? 1 : (int)(slash - file_path), file_path);
+    }
+}
+
+// --- Ahead-of-time build ---
+// Directory holding core_runtime.{c,h}; generated programs are linked against it
+#ifndef PANLANG_RUNTIME_DIR
+#define PANLANG_RUNTIME_DIR "src/runtime"
+#endif
+
+// Parses `file_path` and compiles it to a standalone executable at `output_path`
+int build_panlang_program(const char* file_path, const char* output_path, int keep_c, int opt_level) {
+    size_t code_length = 0;
+    const char* code = map_source_file(file_path, &code_length);
+    if (code == NULL) {
+        return 1;
+    }
+
+    SymbolTable symbols = {0};
+    Arena arena;
+    arena_init(&arena, ARENA_DEFAULT_CHUNK_SIZE, MEMORY_AST);
+    int num_statements = 0;
+    ASTNode** program_ast = parse_source(code, code_length, &symbols, &arena, &num_statements);
+    program_ast = optimize_statements(program_ast, &num_statements, &arena, &symbols, opt_level, 1);
+
+    const char* runtime_dir = getenv("PANLANG_RUNTIME_DIR");
+    if (!runtime_dir || !*runtime_dir) runtime_dir = PANLANG_RUNTIME_DIR;
+    int status = c_backend_build_executable(program_ast, num_statements, symbols.count,
+                                            output_path, runtime_dir, keep_c);
+    if (status == 0) {
+        printf("Built %s from %s (%d statements).\n", output_path, file_path, num_statements);
+    }
+
+    arena_free(&arena);
+    symbol_table_free(&symbols);
+    unmap_source_file(code, code_length);
+    return status;
+}
+
+// Handles `build file.pan [-o output] [--emit-c]`
+int build_command(int argc, char* argv[]) {
+    const char* file_path = NULL;
+    const char* output_path = NULL;
+    int keep_c = 0;
+    int opt_level = 1;
+    for (int i = 2; i < argc; i++) {
+        if (strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '2' && argv[i][3] == '\0') {
+            opt_level = argv[i][2] - '0';
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--emit-c") == 0) {
+            keep_c = 1;
+        } else if (argv[i][0] == '-' || file_path != NULL) {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            file_path = argv[i];
+        }
     }
-    free(program_ast);
-    free_symbol_table();
-    
-    // Free the remaining tokens from lexer
-    // This is simplified; a more robust lexer/parser would manage token lifetimes explicitly
-    // For now, only string/identifier/number tokens are dynamically allocated and freed in advance()
+    if (file_path == NULL || !has_pan_extension(file_path)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    char default_output[4096];
+    if (output_path == NULL) {
+        // foo/bar.pan -> bar
+        const char* base = strrchr(file_path, '/');
+        base = base ? base + 1 : file_path;
+        snprintf(default_output, sizeof(default_output), "%.*s", (int)(strlen(base) - 4), base);
+        output_path = default_output;
+    }
+    return build_panlang_program(file_path, output_path, keep_c, opt_level);
 }
 
 // --- REPL ---
-void repl() {
+void repl(const RunOptions* options, Profiler* profiler) {
     printf("PanLang REPL. Type 'nirgam' to exit.\n");
+    if (options->use_llvm) {
+        // Each JIT module keeps variables in its own stack frame, so nothing would carry over
+        fprintf(stderr, "Note: --llvm is not supported in the REPL; using the tree-walking evaluator.\n");
+    }
+    RunOptions line_options = *options;
+    line_options.use_llvm = 0;
+    line_options.dump_ir = 0;
+
+    // One session for the whole REPL: variables, AST and bytecode persist between lines,
+    // and an error only ends the line that raised it
+    Session session;
+    session_init(&session, profiler);
     char line[1024]; // Max line length
     while (1) {
         printf(">>> ");
@@ -611,46 +4317,146 @@ void repl() {
             printf("Exiting PanLang REPL.\n");
             break;
         }
-        run_panlang_code(line);
-        // Clear symbol table for each REPL line for simplicity.
-        // A real REPL would maintain state.
-        free_symbol_table(); 
+        if (session_run(&session, line, strlen(line), &line_options) != 0) {
+            fflush(stdout);
+            fprintf(stderr, "%s\n", session.error);
+        }
     }
+    session_free(&session);
 }
 
 
+// Tools that embed the engine (such as the benchmark in src/bench) define
+// PANLANG_NO_MAIN and provide their own entry point.
+#ifndef PANLANG_NO_MAIN
 int main(int argc, char *argv[]) {
-    if (argc == 2) {
-        const char *file_path = argv[1];
-        if (strlen(file_path) < 4 || strcmp(file_path + strlen(file_path) - 4, ".pan") != 0) {
+    builtins_bind();
+    if (argc >= 2 && strcmp(argv[1], "build") == 0) {
+        return build_command(argc, argv);
+    }
+
+    RunOptions options = {0};
+    options.opt_level = 1;
+    const char *file_path = NULL;
+    int stream = 0;
+    int status = 0;
+    int profile = 0;
+    const char* profile_out = NULL;
+    int profile_top = PROFILE_DEFAULT_TOP;
+    Profiler profiler;
+    MemoryReport memory;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "--vm") == 0) {
+            options.use_vm = 1;
+        } else if (strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '2' && argv[i][3] == '\0') {
+            options.opt_level = argv[i][2] - '0';
+        } else if (strcmp(argv[i], "--llvm") == 0) {
+            options.use_llvm = 1;
+        } else if (strcmp(argv[i], "--dump-ir") == 0) {
+            options.use_llvm = 1;
+            options.dump_ir = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            core_runtime_set_threads(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--deterministic") == 0) {
+            core_runtime_set_deterministic(1);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            if (core_runtime_output_file(argv[++i]) != 0) {
+                fprintf(stderr, "Error: could not open output file %s: %s\n", argv[i], strerror(errno));
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--unbuffered") == 0) {
+            core_runtime_set_output_buffered(0);
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream = 1;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = 1;
+        } else if (strcmp(argv[i], "--profile-out") == 0 && i + 1 < argc) {
+            profile = 1;
+            profile_out = argv[++i];
+        } else if (strcmp(argv[i], "--profile-top") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            profile_top = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mem-stats") == 0) {
+            memory_report_init(&memory);
+            options.memory = &memory;
+        } else if ((argv[i][0] == '-' && strcmp(argv[i], "-") != 0) || file_path != NULL) {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            file_path = argv[i];
+        }
+    }
+
+    if (profile) {
+        if (options.use_llvm) {
+            // JIT-compiled code has no statement boundaries to time
+            fprintf(stderr, "Note: --profile is not supported with --llvm; using the tree-walking evaluator.\n");
+            options.use_llvm = 0;
+            options.dump_ir = 0;
+        }
+        const char* name = file_path != NULL && strcmp(file_path, "-") != 0 ? file_path
+                         : file_path != NULL || stream ? "<stdin>" : "<repl>";
+        profile_init(&profiler, name, profile_out, profile_top);
+    }
+
+    if (stream || (file_path != NULL && strcmp(file_path, "-") == 0)) {
+        if (options.use_llvm) {
+            // The JIT compiles whole programs; batches could not share variables
+            fprintf(stderr, "Note: --llvm is not supported with --stream; using the tree-walking evaluator.\n");
+            options.use_llvm = 0;
+        }
+        int fd = 0;
+        const char* name = "<stdin>";
+        char module_dir[PATH_MAX] = ".";
+        if (file_path != NULL && strcmp(file_path, "-") != 0) {
+            if (!has_pan_extension(file_path)) {
+                fprintf(stderr, "Error: PanLang files must have a .pan extension.\n");
+                return 1;
+            }
+            fd = open(file_path, O_RDONLY);
+            if (fd < 0) {
+                perror("Error opening file");
+                return 1;
+            }
+            name = file_path;
+            script_directory(file_path, module_dir, sizeof(module_dir));
+        }
+        options.module_dir = module_dir;
+        status = stream_run(fd, name, &options, profile ? &profiler : NULL);
+        if (fd != 0) close(fd);
+    } else if (file_path != NULL) {
+        if (!has_pan_extension(file_path)) {
             fprintf(stderr, "Error: PanLang files must have a .pan extension.\n");
             return 1;
         }
 
-        FILE *f = fopen(file_path, "r");
-        if (f == NULL) {
-            perror("Error opening file");
+        size_t code_length = 0;
+        const char *code = map_source_file(file_path, &code_length);
+        if (code == NULL) {
             return 1;
         }
 
-        // Read file content into a buffer
-        fseek(f, 0, SEEK_END);
-        long fsize = ftell(f);
-        fseek(f, 0, SEEK_SET);
-        char *code = (char*)malloc(fsize + 1);
-        if (!code) { fprintf(stderr, "Memory allocation failed for file content.\n"); fclose(f); return 1; }
-        fread(code, 1, fsize, f);
-        code[fsize] = '\0';
-        fclose(f);
+        char module_dir[PATH_MAX];
+        script_directory(file_path, module_dir, sizeof(module_dir));
+        options.module_dir = module_dir;
 
         printf("--- PanLang Execution from %s ---\n", file_path);
-        printf("Input Code:\n%s\n", code);
+        printf("Input Code:\n");
+        fwrite(code, 1, code_length, stdout);
+        printf("\n");
 
-        run_panlang_code(code);
-        free(code); // Free the file content buffer
+        status = run_panlang_code(code, code_length, &options, profile ? &profiler : NULL);
+        unmap_source_file(code, code_length);
     } else {
-        repl();
+        repl(&options, profile ? &profiler : NULL);
     }
-    return 0;
+    if (profile) {
+        profile_report(&profiler);
+        profile_free(&profiler);
+    }
+    if (options.memory) memory_report_print(&memory);
+    return status;
 }
-
+#endif // PANLANG_NO_MAIN
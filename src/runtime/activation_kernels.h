@@ -0,0 +1,121 @@
+// panlang/src/runtime/activation_kernels.h
+// Activation kernel template. core_runtime.c includes this file once per
+// instruction set after defining:
+//
+//   ACT_SUFFIX                   name suffix for the generated functions
+//   ACT_TARGET                   function attribute enabling the instruction set (may be empty)
+//   ACT_LANES                    doubles per vector
+//   ActVec                       vector type
+//   act_load, act_store, act_splat, act_add, act_sub, act_mul, act_div,
+//   act_max(a, b)                a > b ? a : b, per lane (MAXPD semantics)
+//   act_min(a, b)                a < b ? a : b, per lane
+//   act_madd(a, b, c)            a * b + c, fused if the instruction set has FMA
+//   act_abs(x), act_copysign(magnitude, sign)
+//   act_pow2(shifted)            2^n, where `shifted` = n + ACT_ROUND_MAGIC
+//   act_keep_nan(x, result)      x where x is NaN, result elsewhere
+//
+// No include guard: every inclusion instantiates another kernel set.
+
+#define ACT_CONCAT_(name, suffix) name##_##suffix
+#define ACT_CONCAT(name, suffix) ACT_CONCAT_(name, suffix)
+#define ACT_NAME(name) ACT_CONCAT(name, ACT_SUFFIX)
+
+// Shared argument reduction for exp and expm1: x = n ln2 + r with |r| <= ln2 / 2.
+// Returns exp(r) - 1 from its degree-12 Taylor polynomial (evaluated with
+// Estrin's scheme, which keeps the dependency chain short) and sets *scale to
+// 2^n. x is clamped to [ACT_EXP_MIN, ACT_EXP_MAX] first.
+static ACT_TARGET ActVec ACT_NAME(act_exp_reduce)(ActVec x, ActVec* scale) {
+    ActVec clamped = act_min(act_max(x, act_splat(ACT_EXP_MIN)), act_splat(ACT_EXP_MAX));
+    ActVec shifted = act_madd(clamped, act_splat(ACT_LOG2E), act_splat(ACT_ROUND_MAGIC));
+    ActVec n = act_sub(shifted, act_splat(ACT_ROUND_MAGIC));
+    ActVec r = act_madd(n, act_splat(-ACT_LN2_HI), clamped); // Exact: ACT_LN2_HI has 32 significant bits
+    r = act_madd(n, act_splat(-ACT_LN2_LO), r);
+    *scale = act_pow2(shifted);
+
+    ActVec r2 = act_mul(r, r);
+    ActVec r4 = act_mul(r2, r2);
+    ActVec r8 = act_mul(r4, r4);
+    // (exp(r) - 1) / r = sum over k of r^k / (k + 1)!, k = 0..11
+    ActVec p01 = act_madd(act_splat(0.5), r, act_splat(1.0));
+    ActVec p23 = act_madd(act_splat(ACT_EXP_C4), r, act_splat(ACT_EXP_C3));
+    ActVec p45 = act_madd(act_splat(ACT_EXP_C6), r, act_splat(ACT_EXP_C5));
+    ActVec p67 = act_madd(act_splat(ACT_EXP_C8), r, act_splat(ACT_EXP_C7));
+    ActVec p89 = act_madd(act_splat(ACT_EXP_C10), r, act_splat(ACT_EXP_C9));
+    ActVec p1011 = act_madd(act_splat(ACT_EXP_C12), r, act_splat(ACT_EXP_C11));
+    ActVec p03 = act_madd(p23, r2, p01);
+    ActVec p47 = act_madd(p67, r2, p45);
+    ActVec p811 = act_madd(p1011, r2, p89);
+    ActVec p07 = act_madd(p47, r4, p03);
+    ActVec p = act_madd(p811, r8, p07);
+    return act_mul(p, r);
+}
+
+// exp(x) = 2^n + 2^n (exp(r) - 1)
+static ACT_TARGET ActVec ACT_NAME(act_exp)(ActVec x) {
+    ActVec scale;
+    ActVec q = ACT_NAME(act_exp_reduce)(x, &scale);
+    return act_keep_nan(x, act_madd(scale, q, scale));
+}
+
+// exp(x) - 1 = (2^n - 1) + 2^n (exp(r) - 1), accurate near 0
+static ACT_TARGET ActVec ACT_NAME(act_expm1)(ActVec x) {
+    ActVec scale;
+    ActVec q = ACT_NAME(act_exp_reduce)(x, &scale);
+    return act_keep_nan(x, act_madd(scale, q, act_sub(scale, act_splat(1.0))));
+}
+
+// max(0, x) with no branches; NaN stays NaN
+static ACT_TARGET ActVec ACT_NAME(act_relu)(ActVec x) {
+    return act_max(act_splat(0.0), x);
+}
+
+// 1 / (1 + exp(-x))
+static ACT_TARGET ActVec ACT_NAME(act_sigmoid)(ActVec x) {
+    ActVec e = ACT_NAME(act_exp)(act_sub(act_splat(0.0), x));
+    return act_keep_nan(x, act_div(act_splat(1.0), act_add(act_splat(1.0), e)));
+}
+
+// With m = expm1(-2|x|): tanh(|x|) = -m / (m + 2), given the sign of x.
+// Saturates to +-1 instead of overflowing and stays accurate near 0.
+static ACT_TARGET ActVec ACT_NAME(act_tanh)(ActVec x) {
+    ActVec m = ACT_NAME(act_expm1)(act_mul(act_splat(-2.0), act_abs(x)));
+    ActVec magnitude = act_div(act_sub(act_splat(0.0), m), act_add(m, act_splat(2.0)));
+    return act_keep_nan(x, act_copysign(magnitude, x));
+}
+
+// Maps `vec_fn` over x[0..n) into out (which may alias x). A partial last
+// vector goes through a padded buffer, so every element sees the same code.
+#define ACT_MAP(vec_fn)                                                            \
+    do {                                                                           \
+        size_t i = 0;                                                              \
+        for (; i + ACT_LANES <= n; i += ACT_LANES) {                               \
+            act_store(out + i, vec_fn(act_load(x + i)));                           \
+        }                                                                          \
+        if (i < n) {                                                               \
+            double buffer[ACT_LANES] = {0};                                        \
+            memcpy(buffer, x + i, (n - i) * sizeof(double));                       \
+            act_store(buffer, vec_fn(act_load(buffer)));                           \
+            memcpy(out + i, buffer, (n - i) * sizeof(double));                     \
+        }                                                                          \
+    } while (0)
+
+static ACT_TARGET void ACT_NAME(activation_exp)(const double* x, double* out, size_t n) {
+    ACT_MAP(ACT_NAME(act_exp));
+}
+
+static ACT_TARGET void ACT_NAME(activation_relu)(const double* x, double* out, size_t n) {
+    ACT_MAP(ACT_NAME(act_relu));
+}
+
+static ACT_TARGET void ACT_NAME(activation_sigmoid)(const double* x, double* out, size_t n) {
+    ACT_MAP(ACT_NAME(act_sigmoid));
+}
+
+static ACT_TARGET void ACT_NAME(activation_tanh)(const double* x, double* out, size_t n) {
+    ACT_MAP(ACT_NAME(act_tanh));
+}
+
+#undef ACT_MAP
+#undef ACT_NAME
+#undef ACT_CONCAT
+#undef ACT_CONCAT_
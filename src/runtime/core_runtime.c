@@ -4,23 +4,3934 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "core_runtime.h"
 // Include other standard library headers as needed (e.g., math.h, etc.)
 
+// --- Memory ---
+// The header sits right before the caller's pointer. `offset` is how far it
+// is from the start of the block malloc returned, which is only non-zero for
+// aligned blocks. Counter updates are relaxed atomics: any thread may
+// allocate, and only a report reads them.
+typedef struct {
+    _Alignas(16) size_t size;
+    uint16_t tag;
+    uint16_t tracked;
+    uint32_t offset;
+} MemoryHeader;
+
+typedef struct {
+    atomic_size_t allocations;
+    atomic_size_t frees;
+    atomic_size_t bytes;
+    atomic_size_t live;
+    atomic_size_t peak;
+} MemoryCounters;
+
+static const char* const memory_tag_names[MEMORY_TAG_COUNT] = {
+    "source", "parser", "ast", "symbols", "optimizer", "bytecode",
+    "modules", "profiler", "codegen", "values", "autodiff", "runtime"
+};
+
+static atomic_int memory_tracking = 0;
+static MemoryCounters memory_counters[MEMORY_TAG_COUNT + 1]; // The last one totals all tags
+
+void core_runtime_memory_track(int enabled) {
+    atomic_store(&memory_tracking, enabled != 0);
+}
+
+int core_runtime_memory_tracking(void) {
+    return atomic_load_explicit(&memory_tracking, memory_order_relaxed);
+}
+
+const char* core_runtime_memory_tag_name(MemoryTag tag) {
+    return tag < MEMORY_TAG_COUNT ? memory_tag_names[tag] : "unknown";
+}
+
+static void memory_counters_add(MemoryCounters* counters, size_t size) {
+    atomic_fetch_add_explicit(&counters->allocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->bytes, size, memory_order_relaxed);
+    size_t live = atomic_fetch_add_explicit(&counters->live, size, memory_order_relaxed) + size;
+    size_t peak = atomic_load_explicit(&counters->peak, memory_order_relaxed);
+    while (live > peak &&
+           !atomic_compare_exchange_weak_explicit(&counters->peak, &peak, live, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+static void memory_counters_remove(MemoryCounters* counters, size_t size) {
+    atomic_fetch_add_explicit(&counters->frees, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&counters->live, size, memory_order_relaxed);
+}
+
+static void* memory_attach(void* block, void* ptr, MemoryTag tag, size_t size) {
+    MemoryHeader* header = (MemoryHeader*)ptr - 1;
+    header->size = size;
+    header->tag = (uint16_t)tag;
+    header->tracked = (uint16_t)core_runtime_memory_tracking();
+    header->offset = (uint32_t)((char*)header - (char*)block);
+    if (header->tracked) {
+        memory_counters_add(&memory_counters[tag], size);
+        memory_counters_add(&memory_counters[MEMORY_TAG_COUNT], size);
+    }
+    return ptr;
+}
+
+static void memory_detach(const MemoryHeader* header) {
+    if (!header->tracked) return;
+    memory_counters_remove(&memory_counters[header->tag], header->size);
+    memory_counters_remove(&memory_counters[MEMORY_TAG_COUNT], header->size);
+}
+
+void* core_runtime_alloc(MemoryTag tag, size_t size) {
+    if (size > SIZE_MAX - sizeof(MemoryHeader)) return NULL;
+    MemoryHeader* block = (MemoryHeader*)malloc(sizeof(MemoryHeader) + size);
+    return block ? memory_attach(block, block + 1, tag, size) : NULL;
+}
+
+void* core_runtime_calloc(MemoryTag tag, size_t count, size_t size) {
+    if (size && count > (SIZE_MAX - sizeof(MemoryHeader)) / size) return NULL;
+    void* ptr = core_runtime_alloc(tag, count * size);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void* core_runtime_realloc(MemoryTag tag, void* ptr, size_t size) {
+    if (!ptr) return core_runtime_alloc(tag, size);
+    if (size > SIZE_MAX - sizeof(MemoryHeader)) return NULL;
+    MemoryHeader* header = (MemoryHeader*)ptr - 1;
+    MemoryHeader old = *header;
+    MemoryHeader* block = (MemoryHeader*)realloc(header, sizeof(MemoryHeader) + size);
+    if (!block) return NULL;
+    memory_detach(&old);
+    return memory_attach(block, block + 1, (MemoryTag)old.tag, size);
+}
+
+void* core_runtime_aligned_alloc(MemoryTag tag, size_t alignment, size_t size) {
+    if (alignment < sizeof(MemoryHeader)) alignment = sizeof(MemoryHeader);
+    if (size > SIZE_MAX - sizeof(MemoryHeader) - alignment) return NULL;
+    char* block = (char*)malloc(sizeof(MemoryHeader) + alignment + size);
+    if (!block) return NULL;
+    uintptr_t start = (uintptr_t)(block + sizeof(MemoryHeader));
+    uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    return memory_attach(block, block + (aligned - (uintptr_t)block), tag, size);
+}
+
+char* core_runtime_strndup(MemoryTag tag, const char* text, size_t length) {
+    char* copy = (char*)core_runtime_alloc(tag, length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+void core_runtime_free(void* ptr) {
+    if (!ptr) return;
+    const MemoryHeader* header = (const MemoryHeader*)ptr - 1;
+    memory_detach(header);
+    free((char*)header - header->offset);
+}
+
+void core_runtime_memory_stats(MemoryStats* stats, MemoryStats* total) {
+    for (int i = 0; i <= MEMORY_TAG_COUNT; i++) {
+        MemoryStats* out = i == MEMORY_TAG_COUNT ? total : stats ? &stats[i] : NULL;
+        if (!out) continue;
+        MemoryCounters* counters = &memory_counters[i];
+        out->allocations = atomic_load_explicit(&counters->allocations, memory_order_relaxed);
+        out->frees = atomic_load_explicit(&counters->frees, memory_order_relaxed);
+        out->bytes = atomic_load_explicit(&counters->bytes, memory_order_relaxed);
+        out->live = atomic_load_explicit(&counters->live, memory_order_relaxed);
+        out->peak = atomic_load_explicit(&counters->peak, memory_order_relaxed);
+    }
+}
+
+void core_runtime_memory_reset_peaks(void) {
+    for (int i = 0; i <= MEMORY_TAG_COUNT; i++) {
+        atomic_store_explicit(&memory_counters[i].peak,
+                              atomic_load_explicit(&memory_counters[i].live, memory_order_relaxed),
+                              memory_order_relaxed);
+    }
+}
+
+// --- Contexts ---
+// A thread's context is found through a thread-local pointer; NULL means the
+// process-wide default. Pool threads take on the context of the loop they
+// are running.
+#define RUNTIME_RANDOM_SEED 0x2545F4914F6CDD1DULL
+
+static RuntimeContext runtime_default_context = {.random_state = RUNTIME_RANDOM_SEED};
+static _Thread_local RuntimeContext* runtime_context = NULL;
+static _Thread_local RuntimeTrap* runtime_trap = NULL;
+
+static RuntimeContext* runtime_current(void) {
+    return runtime_context ? runtime_context : &runtime_default_context;
+}
+
+void core_runtime_context_init(RuntimeContext* context) {
+    atomic_init(&context->heap, NULL);
+    atomic_init(&context->heap_objects, 0);
+    context->output = NULL;
+    context->output_context = NULL;
+    context->random_state = RUNTIME_RANDOM_SEED;
+    context->tape = NULL;
+}
+
+RuntimeContext* core_runtime_context_enter(RuntimeContext* context) {
+    RuntimeContext* previous = runtime_context;
+    core_runtime_output_flush(); // Printed on the previous context
+    runtime_context = context;
+    return previous;
+}
+
+// --- Output ---
+// Everything the runtime prints goes through a per-thread buffer that is
+// handed to the current sink when it fills, on core_runtime_output_flush, and
+// at exit (main thread) or thread exit (other threads). In unbuffered mode,
+// the default when the sink is stdout and stdout is a terminal, each printed
+// line is passed on as soon as it ends. Sink writes are serialized, so one
+// thread's flush is never interleaved with another's.
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+#define OUTPUT_NUMBER_SIZE 32 // Longest formatted int64 or double, with a newline
+#define OUTPUT_FIXED_EXPONENT 16 // Doubles from 1e16 up print in exponent form
+
+typedef struct {
+    char* data;
+    size_t length;
+} OutputBuffer;
+
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t output_once = PTHREAD_ONCE_INIT;
+static pthread_key_t output_key;
+static _Thread_local OutputBuffer output_buffer;
+
+static void output_write_stdout(void* context, const char* data, size_t length);
+static OutputWrite output_sink = output_write_stdout;
+static void* output_sink_context = NULL;
+static int output_buffered = -1;   // -1: unbuffered only for a terminal on stdout
+static int output_stdout_tty = 0;  // isatty(STDOUT_FILENO), checked once
+static int output_file = -1;       // Descriptor owned by the file sink
+
+static struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} output_memory;
+
+// write(2) until everything is out; EINTR is retried, other errors drop the output
+static void output_write_fd(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+static void output_write_stdout(void* context, const char* data, size_t length) {
+    (void)context;
+    fflush(stdout); // Keep order with anything the host printed through stdio
+    output_write_fd(STDOUT_FILENO, data, length);
+}
+
+static void output_write_file(void* context, const char* data, size_t length) {
+    output_write_fd(*(int*)context, data, length);
+}
+
+static void output_write_memory(void* context, const char* data, size_t length) {
+    (void)context;
+    if (output_memory.length + length + 1 > output_memory.capacity) {
+        size_t capacity = output_memory.capacity ? output_memory.capacity : OUTPUT_BUFFER_SIZE;
+        while (output_memory.length + length + 1 > capacity) capacity *= 2;
+        char* grown = (char*)core_runtime_realloc(MEMORY_RUNTIME, output_memory.data, capacity);
+        if (!grown) {
+            fprintf(stderr, "Memory allocation failed for output buffer.\n");
+            exit(1);
+        }
+        output_memory.data = grown;
+        output_memory.capacity = capacity;
+    }
+    memcpy(output_memory.data + output_memory.length, data, length);
+    output_memory.length += length;
+    output_memory.data[output_memory.length] = '\0';
+}
+
+// Hands `data` to the current context's sink, or to the process-wide one
+static void output_send(const char* data, size_t length) {
+    RuntimeContext* context = runtime_current();
+    if (context->output) { // Only the thread on the context writes to it
+        context->output(context->output_context, data, length);
+        return;
+    }
+    pthread_mutex_lock(&output_lock);
+    output_sink(output_sink_context, data, length);
+    pthread_mutex_unlock(&output_lock);
+}
+
+static void output_flush_buffer(OutputBuffer* buffer) {
+    if (buffer->length == 0) return;
+    output_send(buffer->data, buffer->length);
+    buffer->length = 0;
+}
+
+static void output_thread_exit(void* buffer) {
+    output_flush_buffer((OutputBuffer*)buffer);
+    core_runtime_free(((OutputBuffer*)buffer)->data);
+}
+
+static void output_exit(void) {
+    core_runtime_output_flush();
+}
+
+static void output_init(void) {
+    output_stdout_tty = isatty(STDOUT_FILENO);
+    pthread_key_create(&output_key, output_thread_exit);
+    atexit(output_exit); // Key destructors do not run for the thread that calls exit
+}
+
+static OutputBuffer* output_thread_buffer(void) {
+    if (!output_buffer.data) {
+        pthread_once(&output_once, output_init);
+        output_buffer.data = (char*)core_runtime_alloc(MEMORY_RUNTIME, OUTPUT_BUFFER_SIZE);
+        if (!output_buffer.data) {
+            fprintf(stderr, "Memory allocation failed for output buffer.\n");
+            exit(1);
+        }
+        pthread_setspecific(output_key, &output_buffer);
+    }
+    return &output_buffer;
+}
+
+// Room for `length` more bytes in the calling thread's buffer (length <= OUTPUT_BUFFER_SIZE)
+static char* output_reserve(size_t length) {
+    OutputBuffer* buffer = output_thread_buffer();
+    if (OUTPUT_BUFFER_SIZE - buffer->length < length) output_flush_buffer(buffer);
+    return buffer->data + buffer->length;
+}
+
+static int output_is_buffered(void) {
+    if (output_buffered >= 0) return output_buffered;
+    if (runtime_current()->output || output_sink != output_write_stdout) return 1;
+    return !output_stdout_tty; // Set by output_init, which has run for this thread's buffer
+}
+
+// Ends a printed line: appends the newline and, when unbuffered, passes it on
+static void output_end_line(void) {
+    char* end = output_reserve(1);
+    *end = '\n';
+    output_buffer.length++;
+    if (!output_is_buffered()) output_flush_buffer(&output_buffer);
+}
+
+void core_runtime_output_write(const char* data, size_t length) {
+    OutputBuffer* buffer = output_thread_buffer();
+    if (OUTPUT_BUFFER_SIZE - buffer->length < length) {
+        output_flush_buffer(buffer);
+        if (length > OUTPUT_BUFFER_SIZE) {
+            output_send(data, length);
+            return;
+        }
+    }
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+}
+
+void core_runtime_output_flush(void) {
+    if (output_buffer.data) output_flush_buffer(&output_buffer);
+}
+
+void core_runtime_set_output_buffered(int buffered) {
+    output_buffered = buffered != 0;
+    if (!buffered) core_runtime_output_flush();
+}
+
+void core_runtime_output_sink(OutputWrite write, void* context) {
+    core_runtime_output_flush(); // What was printed so far belongs to the old sink
+    pthread_mutex_lock(&output_lock);
+    if (output_file >= 0 && context != &output_file) {
+        close(output_file);
+        output_file = -1;
+    }
+    output_sink = write ? write : output_write_stdout;
+    output_sink_context = context;
+    pthread_mutex_unlock(&output_lock);
+}
+
+void core_runtime_output_stdout(void) {
+    core_runtime_output_sink(output_write_stdout, NULL);
+}
+
+int core_runtime_output_file(const char* path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    core_runtime_output_sink(output_write_stdout, NULL); // Closes a previous file
+    output_file = fd;
+    core_runtime_output_sink(output_write_file, &output_file);
+    return 0;
+}
+
+void core_runtime_output_memory(void) {
+    core_runtime_output_sink(output_write_memory, NULL);
+    output_memory.length = 0;
+    if (output_memory.data) output_memory.data[0] = '\0';
+}
+
+const char* core_runtime_output_memory_contents(size_t* length) {
+    core_runtime_output_flush();
+    if (length) *length = output_memory.length;
+    return output_memory.data ? output_memory.data : "";
+}
+
+// --- Number formatting ---
+static const char output_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Writes `val` in decimal to `out` (at least 20 bytes) and returns its length
+static size_t output_format_uint64(uint64_t val, char* out) {
+    char digits[20];
+    char* p = digits + sizeof(digits);
+    while (val >= 100) {
+        p -= 2;
+        memcpy(p, output_digit_pairs + (val % 100) * 2, 2);
+        val /= 100;
+    }
+    if (val >= 10) {
+        p -= 2;
+        memcpy(p, output_digit_pairs + val * 2, 2);
+    } else {
+        *--p = (char)('0' + val);
+    }
+    size_t length = (size_t)(digits + sizeof(digits) - p);
+    memcpy(out, p, length);
+    return length;
+}
+
+// `out` needs at least 21 bytes
+static size_t output_format_int64(int64_t val, char* out) {
+    if (val >= 0) return output_format_uint64((uint64_t)val, out);
+    *out = '-';
+    return 1 + output_format_uint64(0 - (uint64_t)val, out + 1);
+}
+
+// Doubles print in the shortest form that reads back exactly: with P the
+// fewest significant digits whose correctly rounded value round-trips, the
+// text is what printf("%.Pg") gives. P is found on the exact decimal
+// expansions of the value and of the two halfway points to its neighbours,
+// computed with a small base-10^9 bignum, so no step can be off by an ulp.
+#define OUTPUT_BIG_LIMBS 90  // 2^55 * 5^1077 < 10^(9 * 90)
+#define OUTPUT_MAX_DIGITS 800
+
+typedef struct {
+    char digits[OUTPUT_MAX_DIGITS]; // Significant digits, no leading or trailing zeros
+    int count;
+    int exponent;                   // Decimal exponent of digits[0]
+} OutputDecimal;
+
+static void output_big_multiply(uint32_t* limbs, int* count, uint32_t factor) {
+    uint64_t carry = 0;
+    for (int i = 0; i < *count; i++) {
+        carry += (uint64_t)limbs[i] * factor;
+        limbs[i] = (uint32_t)(carry % 1000000000u);
+        carry /= 1000000000u;
+    }
+    while (carry) {
+        limbs[(*count)++] = (uint32_t)(carry % 1000000000u);
+        carry /= 1000000000u;
+    }
+}
+
+// mantissa * 2^exponent exactly, for 0 < mantissa < 2^55
+static void output_exact_decimal(uint64_t mantissa, int exponent, OutputDecimal* out) {
+    uint32_t limbs[OUTPUT_BIG_LIMBS];
+    int count = 0;
+    for (; mantissa; mantissa /= 1000000000u) limbs[count++] = (uint32_t)(mantissa % 1000000000u);
+    // 2^e or 5^-e, a factor below 2^31 at a time; mantissa * 2^e or (mantissa * 5^-e) * 10^e
+    for (int e = exponent; e > 0; e -= 30) output_big_multiply(limbs, &count, 1u << (e < 30 ? e : 30));
+    for (int e = -exponent; e > 0; e -= 13) {
+        uint32_t factor = 1;
+        for (int k = 0; k < (e < 13 ? e : 13); k++) factor *= 5;
+        output_big_multiply(limbs, &count, factor);
+    }
+
+    char* p = out->digits + output_format_uint64(limbs[count - 1], out->digits);
+    for (int i = count - 2; i >= 0; i--) {
+        uint32_t limb = limbs[i];
+        for (int k = 8; k >= 0; k--, limb /= 10) p[k] = (char)('0' + limb % 10);
+        p += 9;
+    }
+    out->count = (int)(p - out->digits);
+    out->exponent = out->count - 1 + (exponent < 0 ? exponent : 0);
+    while (out->digits[out->count - 1] == '0') out->count--;
+}
+
+static int output_decimal_compare(const OutputDecimal* a, const OutputDecimal* b) {
+    if (a->exponent != b->exponent) return a->exponent < b->exponent ? -1 : 1;
+    int count = a->count > b->count ? a->count : b->count;
+    for (int i = 0; i < count; i++) {
+        char x = i < a->count ? a->digits[i] : '0';
+        char y = i < b->count ? b->digits[i] : '0';
+        if (x != y) return x < y ? -1 : 1;
+    }
+    return 0;
+}
+
+// `exact` correctly rounded (half to even) to `precision` significant digits
+static void output_decimal_round(const OutputDecimal* exact, int precision, OutputDecimal* out) {
+    out->exponent = exact->exponent;
+    out->count = exact->count < precision ? exact->count : precision;
+    memcpy(out->digits, exact->digits, (size_t)out->count);
+    if (exact->count <= precision) return;
+    int up = exact->digits[precision] > '5' ||
+             (exact->digits[precision] == '5' &&
+              (exact->count > precision + 1 || (exact->digits[precision - 1] - '0') % 2 == 1));
+    if (up) {
+        int i = precision - 1;
+        while (i >= 0 && out->digits[i] == '9') i--;
+        if (i < 0) { // 99..9 rounds up to 10..0
+            out->digits[0] = '1';
+            out->count = 1;
+            out->exponent++;
+            return;
+        }
+        out->digits[i]++;
+        out->count = i + 1;
+    }
+    while (out->count > 1 && out->digits[out->count - 1] == '0') out->count--;
+}
+
+// Shortest round-trip form of a finite, nonzero, positive double that is not a
+// small integer. Returns P and leaves the digits in *out.
+static int output_shortest_decimal(double val, OutputDecimal* out) {
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    int biased = (int)(bits >> 52);
+    uint64_t mantissa = bits & ((1ULL << 52) - 1);
+    int exponent = biased ? biased - 1075 : -1074;
+    if (biased) mantissa |= 1ULL << 52;
+
+    // Every decimal strictly between the halfway points reads back as val; the
+    // points themselves do when the mantissa is even (ties go to even)
+    OutputDecimal exact, low, high;
+    output_exact_decimal(mantissa, exponent, &exact);
+    output_exact_decimal(2 * mantissa + 1, exponent - 1, &high);
+    if (mantissa == 1ULL << 52 && biased > 1) {
+        output_exact_decimal(4 * mantissa - 1, exponent - 2, &low); // The gap below a power of two is half as wide
+    } else {
+        output_exact_decimal(2 * mantissa - 1, exponent - 1, &low);
+    }
+    int inclusive = mantissa % 2 == 0;
+    for (int precision = 1;; precision++) {
+        output_decimal_round(&exact, precision, out);
+        int above_low = output_decimal_compare(out, &low);
+        int below_high = output_decimal_compare(out, &high);
+        if ((above_low > 0 || (inclusive && above_low == 0)) && (below_high < 0 || (inclusive && below_high == 0))) {
+            return precision;
+        }
+    }
+}
+
+// Writes `digits` x 10^exponent in fixed notation, or in exponent form when the
+// decimal exponent is below -4 or at least OUTPUT_FIXED_EXPONENT
+static size_t output_format_decimal(const char* digits, int count, int exponent, char* out) {
+    char* p = out;
+    if (exponent < -4 || exponent >= OUTPUT_FIXED_EXPONENT) {
+        *p++ = digits[0];
+        if (count > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, (size_t)count - 1);
+            p += count - 1;
+        }
+        *p++ = 'e';
+        *p++ = exponent < 0 ? '-' : '+';
+        int magnitude = exponent < 0 ? -exponent : exponent;
+        if (magnitude >= 100) *p++ = (char)('0' + magnitude / 100);
+        memcpy(p, output_digit_pairs + (magnitude % 100) * 2, 2);
+        p += 2;
+    } else if (exponent >= 0) {
+        for (int i = 0; i <= exponent; i++) *p++ = i < count ? digits[i] : '0';
+        if (count > exponent + 1) {
+            *p++ = '.';
+            memcpy(p, digits + exponent + 1, (size_t)(count - exponent - 1));
+            p += count - exponent - 1;
+        }
+    } else {
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = -1; i > exponent; i--) *p++ = '0';
+        memcpy(p, digits, (size_t)count);
+        p += count;
+    }
+    return (size_t)(p - out);
+}
+
+// `out` needs OUTPUT_NUMBER_SIZE bytes
+static size_t output_format_double(double val, char* out) {
+    if (isnan(val)) { // NaN's sign bit depends on how it was produced; print one spelling
+        memcpy(out, "nan", 3);
+        return 3;
+    }
+    char* p = out;
+    if (signbit(val)) {
+        *p++ = '-';
+        val = -val;
+    }
+    if (isinf(val)) {
+        memcpy(p, "inf", 3);
+        return (size_t)(p - out) + 3;
+    }
+    if (val < 9007199254740992.0 && val == (double)(uint64_t)val) {
+        // Integers below 2^53 are exact, so their digits are already the shortest form
+        char digits[20];
+        int count = (int)output_format_uint64((uint64_t)val, digits);
+        int exponent = count - 1;
+        while (count > 1 && digits[count - 1] == '0') count--;
+        p += output_format_decimal(digits, count, exponent, p);
+    } else {
+        OutputDecimal decimal;
+        output_shortest_decimal(val, &decimal);
+        p += output_format_decimal(decimal.digits, decimal.count, decimal.exponent, p);
+    }
+    if (!memchr(out, '.', (size_t)(p - out)) && !memchr(out, 'e', (size_t)(p - out))) {
+        memcpy(p, ".0", 2); // Integral values keep a ".0" so they never print like ints
+        p += 2;
+    }
+    return (size_t)(p - out);
+}
+
+void core_runtime_format_double(double val, char* buffer, size_t size) {
+    char text[OUTPUT_NUMBER_SIZE];
+    size_t length = output_format_double(val, text);
+    if (size == 0) return;
+    if (length >= size) length = size - 1;
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+}
+
+// --- Printing ---
 // Function to print a string to the console
 void core_runtime_print_string(const char* str) {
     if (str != NULL) {
-        printf("%s\n", str);
+        core_runtime_output_write(str, strlen(str));
+        output_end_line();
     }
 }
 
 // Function to print an integer to the console
 void core_runtime_print_int(int val) {
-    printf("%d\n", val);
+    core_runtime_print_int64(val);
+}
+
+// Function to print a 64-bit integer to the console
+void core_runtime_print_int64(int64_t val) {
+    char* p = output_reserve(OUTPUT_NUMBER_SIZE);
+    output_buffer.length += output_format_int64(val, p);
+    output_end_line();
 }
 
 // Function to print a double/float to the console
 void core_runtime_print_double(double val) {
-    printf("%f\n", val);
+    char* p = output_reserve(OUTPUT_NUMBER_SIZE);
+    output_buffer.length += output_format_double(val, p);
+    output_end_line();
+}
+
+// Booleans print as the keywords that spell them
+void core_runtime_print_bool(int val) {
+    if (val) {
+        core_runtime_output_write("satya", 5);
+    } else {
+        core_runtime_output_write("asatya", 6);
+    }
+    output_end_line();
+}
+
+void core_runtime_trap_push(RuntimeTrap* trap) {
+    trap->message[0] = '\0';
+    trap->previous = runtime_trap;
+    runtime_trap = trap;
+}
+
+void core_runtime_trap_pop(RuntimeTrap* trap) {
+    runtime_trap = trap->previous;
+}
+
+// Function to abort execution with a runtime error. Compiled code calls this for
+// the same failures the interpreter reports (e.g. division by zero).
+_Noreturn void core_runtime_panic(const char* message) {
+    core_runtime_output_flush();
+    RuntimeTrap* trap = runtime_trap;
+    if (trap) {
+        snprintf(trap->message, sizeof(trap->message), "%s", message);
+        runtime_trap = trap->previous;
+        longjmp(trap->jump, 1);
+    }
+    fflush(stdout);
+    fprintf(stderr, "%s\n", message);
+    exit(1);
+}
+
+// --- Big integers ---
+// Magnitudes are arrays of 64-bit limbs, least significant first (see
+// HeapBigInt). These routines work on bare limb arrays and allocate only
+// scratch space; value_try_arith gives their results a sign and boxes them.
+// Products switch from schoolbook to Karatsuba at BIGINT_KARATSUBA_THRESHOLD
+// limbs, and division is Knuth's algorithm D with a one-limb fast path.
+#define BIGINT_KARATSUBA_THRESHOLD 32
+#define BIGINT_DECIMAL_CHUNK 10000000000000000000ULL // 10^19, the largest power of ten in a limb
+#define BIGINT_DECIMAL_CHUNK_DIGITS 19
+
+// The low limb of a * b; the high limb goes to *high
+static inline uint64_t bigint_mul_wide(uint64_t a, uint64_t b, uint64_t* high) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)a * b;
+    *high = (uint64_t)(product >> 64);
+    return (uint64_t)product;
+#else
+    uint64_t a0 = (uint32_t)a, a1 = a >> 32, b0 = (uint32_t)b, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t middle = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    *high = p11 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+    return (middle << 32) | (uint32_t)p00;
+#endif
+}
+
+// (high * 2^64 + low) / divisor for high < divisor; the remainder goes to *remainder
+static inline uint64_t bigint_div_wide(uint64_t high, uint64_t low, uint64_t divisor, uint64_t* remainder) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 dividend = ((unsigned __int128)high << 64) | low;
+    uint64_t quotient = (uint64_t)(dividend / divisor);
+    *remainder = (uint64_t)(dividend - (unsigned __int128)quotient * divisor);
+    return quotient;
+#else
+    for (int i = 0; i < 64; i++) { // Shift and subtract, one quotient bit at a time
+        uint64_t carry = high >> 63;
+        high = (high << 1) | (low >> 63);
+        low <<= 1;
+        if (carry || high >= divisor) {
+            high -= divisor;
+            low |= 1;
+        }
+    }
+    *remainder = high;
+    return low;
+#endif
+}
+
+static uint64_t* bigint_scratch(size_t limbs) {
+    uint64_t* scratch = (uint64_t*)core_runtime_alloc(MEMORY_VALUES, limbs * sizeof(uint64_t));
+    if (!scratch) core_runtime_panic("Memory allocation failed for big integer.");
+    return scratch;
+}
+
+// Length of `limbs` without its leading zero limbs
+static size_t bigint_trim(const uint64_t* limbs, size_t length) {
+    while (length > 0 && limbs[length - 1] == 0) length--;
+    return length;
+}
+
+// Compares two trimmed magnitudes
+static int bigint_compare(const uint64_t* a, size_t na, const uint64_t* b, size_t nb) {
+    if (na != nb) return na < nb ? -1 : 1;
+    for (size_t i = na; i-- > 0;) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+// r = a + b for na >= nb, where r has na limbs and may be a. Returns the carry.
+static uint64_t bigint_add(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb) {
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < nb; i++) {
+        uint64_t sum = a[i] + b[i];
+        uint64_t overflow = sum < b[i];
+        r[i] = sum + carry;
+        carry = overflow | (r[i] < carry);
+    }
+    for (; i < na; i++) {
+        r[i] = a[i] + carry;
+        carry = r[i] < carry;
+    }
+    return carry;
+}
+
+// r = a - b for na >= nb, where r has na limbs and may be a. Returns the borrow.
+static uint64_t bigint_sub(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb) {
+    uint64_t borrow = 0;
+    size_t i = 0;
+    for (; i < nb; i++) {
+        uint64_t x = a[i];
+        uint64_t difference = x - b[i];
+        uint64_t underflow = x < b[i];
+        r[i] = difference - borrow;
+        borrow = underflow | (difference < borrow);
+    }
+    for (; i < na; i++) {
+        uint64_t x = a[i];
+        r[i] = x - borrow;
+        borrow = x < borrow;
+    }
+    return borrow;
+}
+
+// r[0, n) += a[0, n) * m. Returns the carry limb.
+static uint64_t bigint_addmul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t m) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t high;
+        uint64_t low = bigint_mul_wide(a[i], m, &high) + carry;
+        high += low < carry;
+        r[i] += low;
+        carry = high + (r[i] < low);
+    }
+    return carry;
+}
+
+// r[0, n) -= a[0, n) * m. Returns the borrow limb.
+static uint64_t bigint_submul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t m) {
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t high;
+        uint64_t low = bigint_mul_wide(a[i], m, &high) + borrow;
+        high += low < borrow;
+        uint64_t x = r[i];
+        r[i] = x - low;
+        borrow = high + (x < low);
+    }
+    return borrow;
+}
+
+static void bigint_mul_schoolbook(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb) {
+    memset(r, 0, (na + nb) * sizeof(uint64_t));
+    for (size_t j = 0; j < nb; j++) {
+        r[na + j] = bigint_addmul_1(r + j, a, na, b[j]);
+    }
+}
+
+// r = a * b for na >= nb >= 1, where r has na + nb limbs and overlaps neither
+static void bigint_mul(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb) {
+    if (nb < BIGINT_KARATSUBA_THRESHOLD) {
+        bigint_mul_schoolbook(r, a, na, b, nb);
+        return;
+    }
+    size_t half = (na + 1) / 2;
+    if (nb <= half) {
+        // Too lopsided to split both: multiply b by pieces of a as long as b.
+        // Each partial sum fits one limb past its product, so carries stop there.
+        uint64_t* product = bigint_scratch(2 * nb);
+        memset(r, 0, (na + nb) * sizeof(uint64_t));
+        for (size_t offset = 0; offset < na; offset += nb) {
+            size_t piece = na - offset < nb ? na - offset : nb;
+            bigint_mul(product, b, nb, a + offset, piece);
+            size_t span = na + nb - offset < nb + piece + 1 ? na + nb - offset : nb + piece + 1;
+            bigint_add(r + offset, r + offset, span, product, nb + piece);
+        }
+        core_runtime_free(product);
+        return;
+    }
+    // With a = a1 B^half + a0 and b = b1 B^half + b0 (B = 2^64), a * b is
+    // a1 b1 B^2half + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B^half + a0 b0:
+    // three half-size products instead of four.
+    size_t na1 = na - half, nb1 = nb - half;
+    uint64_t* scratch = bigint_scratch(4 * half + 4);
+    uint64_t* sum_a = scratch;
+    uint64_t* sum_b = scratch + half + 1;
+    uint64_t* middle = scratch + 2 * half + 2;
+    sum_a[half] = bigint_add(sum_a, a, half, a + half, na1);
+    sum_b[half] = bigint_add(sum_b, b, half, b + half, nb1);
+    bigint_mul(r, a, half, b, half);
+    bigint_mul(r + 2 * half, a + half, na1, b + half, nb1);
+    bigint_mul(middle, sum_a, half + 1, sum_b, half + 1);
+    bigint_sub(middle, middle, 2 * half + 2, r, 2 * half);
+    bigint_sub(middle, middle, 2 * half + 2, r + 2 * half, na1 + nb1);
+    bigint_add(r + half, r + half, na + nb - half, middle, bigint_trim(middle, 2 * half + 2));
+    core_runtime_free(scratch);
+}
+
+// q = u / d for d != 0, where q has n limbs and may be u. Returns the remainder.
+static uint64_t bigint_div_1(uint64_t* q, const uint64_t* u, size_t n, uint64_t d) {
+    uint64_t remainder = 0;
+    for (size_t i = n; i-- > 0;) {
+        q[i] = bigint_div_wide(remainder, u[i], d, &remainder);
+    }
+    return remainder;
+}
+
+// q = u / v for nu >= nv >= 2 and v trimmed, where q has nu - nv + 1 limbs
+static void bigint_div(uint64_t* q, const uint64_t* u, size_t nu, const uint64_t* v, size_t nv) {
+    // Shift both so the divisor's top bit is set; each quotient limb estimated
+    // from the top limbs is then at most two too large
+    int shift = 0;
+    for (uint64_t top = v[nv - 1]; !(top >> 63); top <<= 1) shift++;
+    uint64_t* un = bigint_scratch(nu + 1 + nv);
+    uint64_t* vn = un + nu + 1;
+    for (size_t i = nv - 1; i > 0; i--) vn[i] = (v[i] << shift) | (shift ? v[i - 1] >> (64 - shift) : 0);
+    vn[0] = v[0] << shift;
+    un[nu] = shift ? u[nu - 1] >> (64 - shift) : 0;
+    for (size_t i = nu - 1; i > 0; i--) un[i] = (u[i] << shift) | (shift ? u[i - 1] >> (64 - shift) : 0);
+    un[0] = u[0] << shift;
+
+    uint64_t top = vn[nv - 1], next = vn[nv - 2];
+    for (size_t j = nu - nv + 1; j-- > 0;) {
+        uint64_t estimate, rest;
+        int rest_overflow = 0;
+        if (un[j + nv] >= top) { // The estimate would not fit a limb
+            estimate = UINT64_MAX;
+            rest = un[j + nv - 1] + top;
+            rest_overflow = rest < top;
+        } else {
+            estimate = bigint_div_wide(un[j + nv], un[j + nv - 1], top, &rest);
+        }
+        // Knuth's test on the next limb removes almost every overestimate
+        while (!rest_overflow) {
+            uint64_t high;
+            uint64_t low = bigint_mul_wide(estimate, next, &high);
+            if (high < rest || (high == rest && low <= un[j + nv - 2])) break;
+            estimate--;
+            rest += top;
+            rest_overflow = rest < top;
+        }
+        uint64_t borrow = bigint_submul_1(un + j, vn, nv, estimate);
+        uint64_t x = un[j + nv];
+        un[j + nv] = x - borrow;
+        if (x < borrow) { // Still one too large: add the divisor back
+            estimate--;
+            un[j + nv] += bigint_add(un + j, un + j, nv, vn, nv);
+        }
+        q[j] = estimate;
+    }
+    core_runtime_free(un);
+}
+
+// --- Values ---
+// Objects created at run time (integers outside int48, tensors, boxed strings)
+// are chained on the current context's heap. String literals are owned by
+// whoever created them (the AST arena, a module cache file) and are not on
+// it. Objects are pushed with a compare-and-swap, so the pool threads working
+// for a context may allocate too.
+static void value_heap_push(HeapObject* object) {
+    RuntimeContext* context = runtime_current();
+    object->next = atomic_load_explicit(&context->heap, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&context->heap, &object->next, object,
+                                                  memory_order_release, memory_order_relaxed)) {
+    }
+    atomic_fetch_add_explicit(&context->heap_objects, 1, memory_order_relaxed);
+}
+
+static void prashna_request_release(PrashnaRequest* request);
+static void autodiff_tape_free(AutodiffTape* tape);
+static void autodiff_mark(AutodiffTape* tape, const uintptr_t* live, size_t num_live);
+static int autodiff_keeps(const AutodiffTape* tape, const HeapTensor* t);
+static void autodiff_compact(AutodiffTape* tape, HeapObject* kept);
+
+static void value_heap_free_object(HeapObject* object) {
+    if (object->kind == HEAP_TENSOR) {
+        core_runtime_free(((HeapTensor*)object)->data);
+        core_runtime_free(((HeapTensor*)object)->param);
+    }
+    if (object->kind == HEAP_FUTURE) prashna_request_release(((HeapFuture*)object)->request);
+    core_runtime_free(object);
+}
+
+Value value_box_int64(int64_t i) {
+    HeapInt* object = (HeapInt*)core_runtime_alloc(MEMORY_VALUES, sizeof(HeapInt));
+    if (!object) core_runtime_panic("Memory allocation failed for boxed integer.");
+    object->header.kind = HEAP_INT;
+    object->value = i;
+    value_heap_push(&object->header);
+    return value_from_heap(&object->header);
+}
+
+// A bigint with room for `length` limbs, not on the heap yet
+static HeapBigInt* value_bigint_new(size_t length) {
+    HeapBigInt* object = (HeapBigInt*)core_runtime_alloc(MEMORY_VALUES, sizeof(HeapBigInt) + length * sizeof(uint64_t));
+    if (!object) core_runtime_panic("Memory allocation failed for big integer.");
+    object->header.kind = HEAP_BIGINT;
+    return object;
+}
+
+// Gives `object` its sign and trimmed length and boxes the result. Values that
+// fit in int64 are returned as such, and `object` is freed.
+static Value value_bigint_finish(HeapBigInt* object, int negative, size_t length) {
+    length = bigint_trim(object->limbs, length);
+    if (length <= 1) {
+        uint64_t magnitude = length ? object->limbs[0] : 0;
+        if (magnitude <= (uint64_t)INT64_MAX || (negative && magnitude == (uint64_t)1 << 63)) {
+            core_runtime_free(object);
+            return value_from_int64(negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude);
+        }
+    }
+    object->negative = negative;
+    object->length = length;
+    value_heap_push(&object->header);
+    return value_from_heap(&object->header);
+}
+
+Value value_from_limbs(int negative, const uint64_t* limbs, size_t length) {
+    HeapBigInt* object = value_bigint_new(length);
+    memcpy(object->limbs, limbs, length * sizeof(uint64_t));
+    return value_bigint_finish(object, negative, length);
+}
+
+ValueStatus value_parse_int(const char* digits, size_t length, Value* result) {
+    // Each chunk of 19 digits adds at most one limb: value = value * 10^k + chunk
+    size_t capacity = length / BIGINT_DECIMAL_CHUNK_DIGITS + 1;
+    if (capacity > VALUE_BIGINT_MAX_LIMBS) return VALUE_ERROR_RANGE;
+    HeapBigInt* object = value_bigint_new(capacity);
+    size_t used = 0;
+    size_t count = length % BIGINT_DECIMAL_CHUNK_DIGITS ? length % BIGINT_DECIMAL_CHUNK_DIGITS
+                                                        : BIGINT_DECIMAL_CHUNK_DIGITS;
+    for (size_t i = 0; i < length; i += count, count = BIGINT_DECIMAL_CHUNK_DIGITS) {
+        uint64_t chunk = 0, scale = 1;
+        for (size_t k = 0; k < count; k++) {
+            chunk = chunk * 10 + (uint64_t)(digits[i + k] - '0');
+            scale *= 10;
+        }
+        uint64_t carry = chunk;
+        for (size_t k = 0; k < used; k++) {
+            uint64_t high;
+            uint64_t low = bigint_mul_wide(object->limbs[k], scale, &high) + carry;
+            object->limbs[k] = low;
+            carry = high + (low < carry);
+        }
+        if (carry) object->limbs[used++] = carry;
+    }
+    *result = value_bigint_finish(object, 0, used);
+    return VALUE_OK;
+}
+
+// Decimal digits of a bigint, after a '-' if it is negative, in a
+// NUL-terminated allocation. Peels off 19 digits per division by 10^19.
+static char* value_bigint_format(const HeapBigInt* big, size_t* length) {
+    size_t n = big->length;
+    uint64_t* work = bigint_scratch(n + n / 32 + 2 + n);
+    uint64_t* chunks = work + n;
+    memcpy(work, big->limbs, n * sizeof(uint64_t));
+    size_t count = 0;
+    while (n > 0) {
+        chunks[count++] = bigint_div_1(work, work, n, BIGINT_DECIMAL_CHUNK);
+        n = bigint_trim(work, n);
+    }
+    char* text = (char*)core_runtime_alloc(MEMORY_VALUES, count * BIGINT_DECIMAL_CHUNK_DIGITS + 2);
+    if (!text) core_runtime_panic("Memory allocation failed for big integer.");
+    char* p = text;
+    if (big->negative) *p++ = '-';
+    p += output_format_uint64(chunks[count - 1], p);
+    for (size_t i = count - 1; i-- > 0;) {
+        char digits[20];
+        size_t digit_count = output_format_uint64(chunks[i], digits);
+        memset(p, '0', BIGINT_DECIMAL_CHUNK_DIGITS - digit_count);
+        memcpy(p + BIGINT_DECIMAL_CHUNK_DIGITS - digit_count, digits, digit_count);
+        p += BIGINT_DECIMAL_CHUNK_DIGITS;
+    }
+    *p = '\0';
+    *length = (size_t)(p - text);
+    core_runtime_free(work);
+    return text;
+}
+
+double value_int_to_double(Value v) {
+    if (!value_is_bigint(v)) return (double)value_as_int64(v);
+    // The top 64 bits, rounded once to 53 with everything below them as a sticky bit
+    const HeapBigInt* big = value_as_bigint(v);
+    size_t n = big->length;
+    uint64_t top = big->limbs[n - 1];
+    uint64_t below = n >= 2 ? big->limbs[n - 2] : 0;
+    int shift = 0;
+    while (!(top >> 63)) {
+        top <<= 1;
+        shift++;
+    }
+    if (shift) top |= below >> (64 - shift);
+    uint64_t sticky = shift ? below << shift : below;
+    for (size_t i = 0; i + 2 < n && !sticky; i++) sticky = big->limbs[i];
+    uint64_t mantissa = top >> 11;
+    uint64_t dropped = top & 0x7FF;
+    if (dropped > 0x400 || (dropped == 0x400 && (sticky || (mantissa & 1)))) mantissa++;
+    double magnitude = ldexp((double)mantissa, (int)(64 * (n - 1)) - shift + 11);
+    return big->negative ? -magnitude : magnitude;
+}
+
+Value value_box_string(const char* chars, size_t length) {
+    HeapString* object = (HeapString*)core_runtime_alloc(MEMORY_VALUES, sizeof(HeapString) + length + 1);
+    if (!object) core_runtime_panic("Memory allocation failed for string.");
+    object->header.kind = HEAP_STRING;
+    object->length = length;
+    memcpy(object->chars, chars, length);
+    object->chars[length] = '\0';
+    value_heap_push(&object->header);
+    return value_from_heap(&object->header);
+}
+
+void core_runtime_context_free(RuntimeContext* context) {
+    HeapObject* object = atomic_exchange(&context->heap, NULL);
+    atomic_store(&context->heap_objects, 0);
+    while (object) {
+        HeapObject* next = object->next;
+        value_heap_free_object(object);
+        object = next;
+    }
+    autodiff_tape_free(context->tape);
+    context->tape = NULL;
+}
+
+void value_heap_release(void) {
+    core_runtime_context_free(runtime_current());
+}
+
+size_t value_heap_count(void) {
+    return atomic_load_explicit(&runtime_current()->heap_objects, memory_order_relaxed);
+}
+
+static int value_compare_roots(const void* a, const void* b) {
+    uintptr_t x = *(const uintptr_t*)a, y = *(const uintptr_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// The heap holds no references between objects, so the live set is exactly the
+// objects the roots point to, plus the tensors the autodiff tape still needs:
+// sort the roots' addresses, then sweep the list once. The tape is then
+// compacted to the records those tensors need.
+void value_heap_collect(const Value* roots, size_t num_roots) {
+    uintptr_t* live = (uintptr_t*)core_runtime_alloc(MEMORY_VALUES, sizeof(uintptr_t) * (num_roots + 1));
+    if (!live) core_runtime_panic("Memory allocation failed for heap collection.");
+    size_t num_live = 0;
+    for (size_t i = 0; i < num_roots; i++) {
+        if (value_is_heap(roots[i])) live[num_live++] = (uintptr_t)value_as_heap(roots[i]);
+    }
+    qsort(live, num_live, sizeof(uintptr_t), value_compare_roots);
+
+    RuntimeContext* context = runtime_current();
+    autodiff_mark(context->tape, live, num_live);
+    HeapObject* object = atomic_exchange(&context->heap, NULL);
+    HeapObject* kept = NULL;
+    size_t num_kept = 0;
+    while (object) {
+        HeapObject* next = object->next;
+        uintptr_t key = (uintptr_t)object;
+        if (bsearch(&key, live, num_live, sizeof(uintptr_t), value_compare_roots) ||
+            (object->kind == HEAP_TENSOR && autodiff_keeps(context->tape, (HeapTensor*)object))) {
+            object->next = kept;
+            kept = object;
+            num_kept++;
+        } else {
+            value_heap_free_object(object);
+        }
+        object = next;
+    }
+    atomic_store(&context->heap, kept);
+    atomic_store(&context->heap_objects, num_kept);
+    core_runtime_free(live);
+    autodiff_compact(context->tape, kept);
+}
+
+const char* value_type_name(ValueType type) {
+    switch (type) {
+        case VALUE_TYPE_INT: return "int";
+        case VALUE_TYPE_DOUBLE: return "float";
+        case VALUE_TYPE_BOOL: return "bool";
+        case VALUE_TYPE_STRING: return "string";
+        case VALUE_TYPE_TENSOR: return "tensor";
+        case VALUE_TYPE_FUTURE: return "future";
+    }
+    return "unknown";
+}
+
+const char* value_op_symbol(ValueOp op) {
+    static const char* symbols[] = {"+", "-", "*", "/"};
+    return symbols[op];
+}
+
+// `x op y` in int64, or 0 if it overflows. The compiler builtins compile to
+// the CPU's overflow flag; elsewhere products of larger operands give up.
+static int value_int64_arith(ValueOp op, int64_t x, int64_t y, int64_t* result) {
+    switch (op) {
+#if defined(__GNUC__)
+        case VALUE_OP_ADD: return !__builtin_add_overflow(x, y, result);
+        case VALUE_OP_SUB: return !__builtin_sub_overflow(x, y, result);
+        case VALUE_OP_MUL: return !__builtin_mul_overflow(x, y, result);
+#else
+        case VALUE_OP_ADD:
+            if (y > 0 ? x > INT64_MAX - y : x < INT64_MIN - y) return 0;
+            *result = x + y;
+            return 1;
+        case VALUE_OP_SUB:
+            if (y < 0 ? x > INT64_MAX + y : x < INT64_MIN + y) return 0;
+            *result = x - y;
+            return 1;
+        case VALUE_OP_MUL:
+            if (x < INT32_MIN || x > INT32_MAX || y < INT32_MIN || y > INT32_MAX) return 0;
+            *result = x * y;
+            return 1;
+#endif
+        case VALUE_OP_DIV:
+            if (x == INT64_MIN && y == -1) return 0;
+            *result = x / y;
+            return 1;
+    }
+    return 0;
+}
+
+// An int operand as a sign and magnitude; int64s use `small` as their one limb
+typedef struct {
+    const uint64_t* limbs;
+    size_t length;
+    int negative;
+    uint64_t small;
+} ValueIntView;
+
+static void value_int_view(Value v, ValueIntView* view) {
+    if (value_is_bigint(v)) {
+        const HeapBigInt* big = value_as_bigint(v);
+        view->limbs = big->limbs;
+        view->length = big->length;
+        view->negative = big->negative;
+        return;
+    }
+    int64_t i = value_as_int64(v);
+    view->negative = i < 0;
+    view->small = view->negative ? 0 - (uint64_t)i : (uint64_t)i;
+    view->limbs = &view->small;
+    view->length = view->small != 0;
+}
+
+// `a op b` for ints once int64 is not enough: either operand is a bigint or the result overflows
+static ValueStatus value_bigint_arith(ValueOp op, Value a, Value b, Value* result) {
+    ValueIntView x, y;
+    value_int_view(a, &x);
+    value_int_view(b, &y);
+    if (op == VALUE_OP_ADD || op == VALUE_OP_SUB) {
+        // Add or subtract magnitudes, the smaller from the larger, which gives the sign
+        const ValueIntView* large = &x;
+        const ValueIntView* small = &y;
+        int large_negative = x.negative, small_negative = y.negative ^ (op == VALUE_OP_SUB);
+        if (bigint_compare(x.limbs, x.length, y.limbs, y.length) < 0) {
+            large = &y;
+            small = &x;
+            large_negative = small_negative;
+            small_negative = x.negative;
+        }
+        size_t length = large->length + 1;
+        if (length > VALUE_BIGINT_MAX_LIMBS) return VALUE_ERROR_RANGE;
+        HeapBigInt* out = value_bigint_new(length);
+        if (large_negative == small_negative) {
+            out->limbs[large->length] = bigint_add(out->limbs, large->limbs, large->length, small->limbs, small->length);
+        } else {
+            bigint_sub(out->limbs, large->limbs, large->length, small->limbs, small->length);
+            out->limbs[large->length] = 0;
+        }
+        *result = value_bigint_finish(out, large_negative, length);
+        return VALUE_OK;
+    }
+    int negative = x.negative != y.negative;
+    if (op == VALUE_OP_MUL) {
+        if (x.length == 0 || y.length == 0) {
+            *result = value_from_small_int(0);
+            return VALUE_OK;
+        }
+        size_t length = x.length + y.length;
+        if (length > VALUE_BIGINT_MAX_LIMBS) return VALUE_ERROR_RANGE;
+        HeapBigInt* out = value_bigint_new(length);
+        if (x.length >= y.length) {
+            bigint_mul(out->limbs, x.limbs, x.length, y.limbs, y.length);
+        } else {
+            bigint_mul(out->limbs, y.limbs, y.length, x.limbs, x.length);
+        }
+        *result = value_bigint_finish(out, negative, length);
+        return VALUE_OK;
+    }
+    // Division truncates toward zero, as for int64
+    if (y.length == 0) return VALUE_ERROR_DIV_ZERO;
+    if (bigint_compare(x.limbs, x.length, y.limbs, y.length) < 0) {
+        *result = value_from_small_int(0);
+        return VALUE_OK;
+    }
+    size_t length = x.length - y.length + 1;
+    HeapBigInt* out = value_bigint_new(length);
+    if (y.length == 1) {
+        bigint_div_1(out->limbs, x.limbs, x.length, y.limbs[0]);
+    } else {
+        bigint_div(out->limbs, x.limbs, x.length, y.limbs, y.length);
+    }
+    *result = value_bigint_finish(out, negative, length);
+    return VALUE_OK;
+}
+
+ValueStatus value_try_arith(ValueOp op, Value a, Value b, Value* result) {
+    if (value_is_int(a) && value_is_int(b)) {
+        if (!value_is_bigint(a) && !value_is_bigint(b)) {
+            int64_t x = value_as_int64(a);
+            int64_t y = value_as_int64(b);
+            int64_t r;
+            if (op == VALUE_OP_DIV && y == 0) return VALUE_ERROR_DIV_ZERO;
+            if (value_int64_arith(op, x, y, &r)) {
+                *result = value_from_int64(r);
+                return VALUE_OK;
+            }
+        }
+        return value_bigint_arith(op, a, b, result);
+    }
+    if (value_is_tensor(a) || value_is_tensor(b)) {
+        if (!(value_is_tensor(a) || value_is_number(a)) || !(value_is_tensor(b) || value_is_number(b))) {
+            return VALUE_ERROR_TYPE;
+        }
+        // Numbers broadcast like 1 x 1 tensors
+        double scalars[2];
+        HeapTensor operands[2];
+        const HeapTensor* tensors[2];
+        Value values[2] = {a, b};
+        for (int i = 0; i < 2; i++) {
+            if (value_is_tensor(values[i])) {
+                tensors[i] = value_as_tensor(values[i]);
+                continue;
+            }
+            scalars[i] = value_number_as_double(values[i]);
+            operands[i] = (HeapTensor){{NULL, HEAP_TENSOR}, 1, 1, 1, &scalars[i], NULL, NULL, 0};
+            tensors[i] = &operands[i];
+        }
+        HeapTensor* out;
+        ValueStatus status = core_runtime_tensor_binary(op, tensors[0], tensors[1], &out);
+        if (status == VALUE_OK) *result = value_from_heap(&out->header);
+        return status;
+    }
+    if (!value_is_number(a) || !value_is_number(b)) return VALUE_ERROR_TYPE;
+    double x = value_number_as_double(a);
+    double y = value_number_as_double(b);
+    switch (op) {
+        case VALUE_OP_ADD: *result = value_from_double(x + y); break;
+        case VALUE_OP_SUB: *result = value_from_double(x - y); break;
+        case VALUE_OP_MUL: *result = value_from_double(x * y); break;
+        case VALUE_OP_DIV:
+            if (y == 0.0) return VALUE_ERROR_DIV_ZERO;
+            *result = value_from_double(x / y);
+            break;
+    }
+    return VALUE_OK;
+}
+
+Value value_arith(ValueOp op, Value a, Value b) {
+    Value result = 0;
+    char message[128];
+    switch (value_try_arith(op, a, b, &result)) {
+        case VALUE_OK:
+            return result;
+        case VALUE_ERROR_TYPE:
+            snprintf(message, sizeof(message), "Type Error: Unsupported operand types for '%s': '%s' and '%s'.",
+                     value_op_symbol(op), value_type_name(value_type(a)), value_type_name(value_type(b)));
+            core_runtime_panic(message);
+            break;
+        case VALUE_ERROR_DIV_ZERO:
+            core_runtime_panic("Runtime Error: Division by zero.");
+            break;
+        case VALUE_ERROR_RANGE:
+            core_runtime_panic("Runtime Error: Integer is too large.");
+            break;
+        case VALUE_ERROR_SHAPE: {
+            // Only two tensors can mismatch
+            HeapTensor* left = value_as_tensor(a);
+            HeapTensor* right = value_as_tensor(b);
+            snprintf(message, sizeof(message), "Runtime Error: Tensor shapes (%zu, %zu) and (%zu, %zu) cannot be broadcast for '%s'.",
+                     left->rows, left->cols, right->rows, right->cols, value_op_symbol(op));
+            core_runtime_panic(message);
+            break;
+        }
+    }
+    return result;
+}
+
+void value_format(Value v, char* buffer, size_t size) {
+    switch (value_type(v)) {
+        case VALUE_TYPE_INT: {
+            char text[OUTPUT_NUMBER_SIZE];
+            size_t length;
+            if (value_is_bigint(v)) {
+                char* digits = value_bigint_format(value_as_bigint(v), &length);
+                snprintf(buffer, size, "%s", digits);
+                core_runtime_free(digits);
+                break;
+            }
+            length = output_format_int64(value_as_int64(v), text);
+            snprintf(buffer, size, "%.*s", (int)length, text);
+            break;
+        }
+        case VALUE_TYPE_DOUBLE: core_runtime_format_double(value_as_double(v), buffer, size); break;
+        case VALUE_TYPE_BOOL: snprintf(buffer, size, "%s", value_as_bool(v) ? "satya" : "asatya"); break;
+        case VALUE_TYPE_STRING: snprintf(buffer, size, "%s", value_string_chars(v)); break;
+        case VALUE_TYPE_TENSOR:
+            snprintf(buffer, size, "<tensor %zux%zu>", value_as_tensor(v)->rows, value_as_tensor(v)->cols);
+            break;
+        case VALUE_TYPE_FUTURE: snprintf(buffer, size, "<prashna>"); break;
+    }
+}
+
+void value_print(Value v) {
+    switch (value_type(v)) {
+        case VALUE_TYPE_INT:
+            if (value_is_bigint(v)) {
+                size_t length;
+                char* digits = value_bigint_format(value_as_bigint(v), &length);
+                core_runtime_print_string(digits);
+                core_runtime_free(digits);
+            } else {
+                core_runtime_print_int64(value_as_int64(v));
+            }
+            break;
+        case VALUE_TYPE_DOUBLE: core_runtime_print_double(value_as_double(v)); break;
+        case VALUE_TYPE_BOOL: core_runtime_print_bool(value_as_bool(v)); break;
+        case VALUE_TYPE_STRING: core_runtime_print_string(value_string_chars(v)); break;
+        case VALUE_TYPE_TENSOR: core_runtime_print_tensor(value_as_tensor(v)); break;
+        case VALUE_TYPE_FUTURE: value_print(core_runtime_prashna_await(v)); break;
+    }
+}
+
+// --- Parallel scheduler ---
+// A pool of worker threads with one deque of index ranges each. A loop starts
+// as a single range on the caller's deque. Whoever runs a range splits it in
+// half until it is no larger than the grain, pushing each upper half onto its
+// own deque and carrying on with the lower half. An idle thread pops its own
+// newest range or steals the oldest (and so largest) range from another
+// thread, so work spreads out in a few big pieces and each thread stays on
+// neighbouring memory.
+//
+// The calling thread takes part as worker 0. Loops run one at a time: a loop
+// started from inside a loop body, or by another thread while the pool is
+// busy, runs serially on the thread that started it rather than waiting.
+// Pool threads allocate Values on the context of the thread that started the
+// loop.
+#define PARALLEL_MAX_THREADS 256
+#define PARALLEL_DEQUE_CAPACITY 128  // Halving keeps each deque under 64 ranges
+#define PARALLEL_CHUNKS_PER_THREAD 4 // Reduction chunks outside deterministic mode
+
+typedef struct {
+    size_t begin;
+    size_t end;
+} ParallelRange;
+
+typedef struct {
+    _Alignas(64) pthread_mutex_t lock; // One cache line per deque
+    ParallelRange ranges[PARALLEL_DEQUE_CAPACITY];
+    size_t top;    // Oldest range; thieves take from here
+    size_t bottom; // One past the newest; the owner pushes and pops here
+} ParallelDeque;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;      // Workers sleep here between loops
+    atomic_int threads;       // Requested thread count, 0 until configured
+    atomic_int deterministic; // -1 until configured
+    atomic_int busy;          // A thread owns the pool and is running a loop on it
+    int started;              // Threads in the running pool, including the caller
+    pthread_t handles[PARALLEL_MAX_THREADS];
+    ParallelDeque* deques;
+    unsigned long generation; // Bumped when a loop starts
+    int shutdown;
+    // The running loop
+    ParallelBody body;
+    void* context;
+    size_t grain;
+    RuntimeContext* runtime;  // The starting thread's context
+    atomic_size_t remaining;  // Iterations not finished yet
+} parallel_pool = {.lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .deterministic = -1};
+
+static _Thread_local int parallel_in_loop = 0;
+
+static int parallel_push(ParallelDeque* deque, ParallelRange range) {
+    pthread_mutex_lock(&deque->lock);
+    int pushed = deque->bottom - deque->top < PARALLEL_DEQUE_CAPACITY;
+    if (pushed) deque->ranges[deque->bottom++ % PARALLEL_DEQUE_CAPACITY] = range;
+    pthread_mutex_unlock(&deque->lock);
+    return pushed;
+}
+
+// Takes the newest range (owner) or the oldest (thief)
+static int parallel_take(ParallelDeque* deque, int newest, ParallelRange* range) {
+    pthread_mutex_lock(&deque->lock);
+    int taken = deque->bottom != deque->top;
+    if (taken) {
+        *range = newest ? deque->ranges[--deque->bottom % PARALLEL_DEQUE_CAPACITY]
+                        : deque->ranges[deque->top++ % PARALLEL_DEQUE_CAPACITY];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return taken;
+}
+
+// Runs ranges of the current loop on behalf of worker `self` until none are left
+static void parallel_work(int self) {
+    int count = parallel_pool.started;
+    while (atomic_load(&parallel_pool.remaining) > 0) {
+        ParallelRange range;
+        int found = parallel_take(&parallel_pool.deques[self], 1, &range);
+        for (int i = 1; !found && i < count; i++) {
+            found = parallel_take(&parallel_pool.deques[(self + i) % count], 0, &range);
+        }
+        if (!found) {
+            sched_yield(); // Everything left is already running elsewhere
+            continue;
+        }
+        // Holding a range makes the loop fields visible: it came through the deque locks
+        while (range.end - range.begin > parallel_pool.grain) {
+            size_t middle = range.begin + (range.end - range.begin) / 2;
+            if (!parallel_push(&parallel_pool.deques[self], (ParallelRange){middle, range.end})) break;
+            range.end = middle;
+        }
+        runtime_context = parallel_pool.runtime;
+        parallel_pool.body(parallel_pool.context, range.begin, range.end);
+        atomic_fetch_sub(&parallel_pool.remaining, range.end - range.begin);
+    }
+}
+
+static void* parallel_worker_main(void* argument) {
+    int self = (int)(intptr_t)argument;
+    parallel_in_loop = 1; // Loops started by a body run serially
+    pthread_mutex_lock(&parallel_pool.lock);
+    unsigned long seen = parallel_pool.generation;
+    while (!parallel_pool.shutdown) {
+        if (parallel_pool.generation == seen) {
+            pthread_cond_wait(&parallel_pool.wake, &parallel_pool.lock);
+            continue;
+        }
+        seen = parallel_pool.generation;
+        pthread_mutex_unlock(&parallel_pool.lock);
+        parallel_work(self);
+        pthread_mutex_lock(&parallel_pool.lock);
+    }
+    pthread_mutex_unlock(&parallel_pool.lock);
+    return NULL;
+}
+
+static void parallel_stop(void) {
+    if (parallel_pool.started == 0) return;
+    pthread_mutex_lock(&parallel_pool.lock);
+    parallel_pool.shutdown = 1;
+    pthread_cond_broadcast(&parallel_pool.wake);
+    pthread_mutex_unlock(&parallel_pool.lock);
+    for (int i = 1; i < parallel_pool.started; i++) pthread_join(parallel_pool.handles[i], NULL);
+    for (int i = 0; i < parallel_pool.started; i++) pthread_mutex_destroy(&parallel_pool.deques[i].lock);
+    core_runtime_free(parallel_pool.deques);
+    parallel_pool.deques = NULL;
+    parallel_pool.started = 0;
+    parallel_pool.shutdown = 0;
+}
+
+// Starts the pool at the configured size, replacing a pool of another size
+static void parallel_start(void) {
+    int threads = core_runtime_threads();
+    if (parallel_pool.started == threads) return;
+    parallel_stop();
+    parallel_pool.deques = (ParallelDeque*)core_runtime_aligned_alloc(MEMORY_RUNTIME, _Alignof(ParallelDeque),
+                                                                      sizeof(ParallelDeque) * threads);
+    if (!parallel_pool.deques) core_runtime_panic("Memory allocation failed for thread pool.");
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&parallel_pool.deques[i].lock, NULL);
+        parallel_pool.deques[i].top = parallel_pool.deques[i].bottom = 0;
+    }
+    parallel_pool.started = 1;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&parallel_pool.handles[i], NULL, parallel_worker_main, (void*)(intptr_t)i) != 0) {
+            fprintf(stderr, "Warning: could only start %d of %d threads.\n", i, threads);
+            break;
+        }
+        parallel_pool.started++;
+    }
+}
+
+static int parallel_env_int(const char* name, int fallback) {
+    const char* text = getenv(name);
+    if (!text || !*text) return fallback;
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (*end != '\0' || value < 0 || value > PARALLEL_MAX_THREADS) {
+        fprintf(stderr, "Warning: ignoring %s=%s.\n", name, text);
+        return fallback;
+    }
+    return (int)value;
+}
+
+void core_runtime_set_threads(int threads) {
+    if (threads <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = parallel_env_int("PANLANG_THREADS", 0);
+        if (threads == 0) threads = online > 0 ? (int)online : 1;
+    }
+    parallel_pool.threads = threads < PARALLEL_MAX_THREADS ? threads : PARALLEL_MAX_THREADS;
+}
+
+int core_runtime_threads(void) {
+    if (parallel_pool.threads == 0) core_runtime_set_threads(0);
+    return parallel_pool.threads;
+}
+
+void core_runtime_set_deterministic(int deterministic) {
+    parallel_pool.deterministic = deterministic != 0;
+}
+
+int core_runtime_deterministic(void) {
+    if (parallel_pool.deterministic < 0) {
+        parallel_pool.deterministic = parallel_env_int("PANLANG_DETERMINISTIC", 0) != 0;
+    }
+    return parallel_pool.deterministic;
+}
+
+void core_runtime_parallel_for(size_t n, size_t grain, ParallelBody body, void* context) {
+    if (grain == 0) grain = 1;
+    if (n <= grain || parallel_in_loop || core_runtime_threads() == 1) {
+        if (n > 0) body(context, 0, n);
+        return;
+    }
+    if (atomic_exchange(&parallel_pool.busy, 1)) { // Another context's loop is running
+        body(context, 0, n);
+        return;
+    }
+    parallel_start();
+    if (parallel_pool.started == 1) {
+        atomic_store(&parallel_pool.busy, 0);
+        body(context, 0, n);
+        return;
+    }
+    pthread_mutex_lock(&parallel_pool.lock);
+    parallel_pool.body = body;
+    parallel_pool.context = context;
+    parallel_pool.grain = grain;
+    parallel_pool.runtime = runtime_context;
+    atomic_store(&parallel_pool.remaining, n);
+    parallel_push(&parallel_pool.deques[0], (ParallelRange){0, n});
+    parallel_pool.generation++;
+    pthread_cond_broadcast(&parallel_pool.wake);
+    pthread_mutex_unlock(&parallel_pool.lock);
+
+    parallel_in_loop = 1;
+    parallel_work(0);
+    parallel_in_loop = 0;
+    atomic_store(&parallel_pool.busy, 0);
+}
+
+typedef struct {
+    ParallelReduceBody body;
+    void* context;
+    size_t n;
+    size_t chunk;
+    double* partials;
+} ParallelReduction;
+
+static void parallel_reduce_chunks(void* context, size_t begin, size_t end) {
+    ParallelReduction* reduction = (ParallelReduction*)context;
+    for (size_t i = begin; i < end; i++) {
+        size_t first = i * reduction->chunk;
+        size_t last = reduction->n - first < reduction->chunk ? reduction->n : first + reduction->chunk;
+        reduction->partials[i] = reduction->body(reduction->context, first, last);
+    }
+}
+
+double core_runtime_parallel_reduce(size_t n, size_t grain, ParallelReduceBody body, ParallelCombine combine,
+                                    void* context) {
+    if (grain == 0) grain = 1;
+    ParallelReduction reduction = {body, context, n, grain, NULL};
+    if (!core_runtime_deterministic()) {
+        // A few chunks per thread, or the whole range when it will run serially anyway
+        size_t chunks = (size_t)core_runtime_threads() * PARALLEL_CHUNKS_PER_THREAD;
+        if (n <= grain || parallel_in_loop || chunks <= PARALLEL_CHUNKS_PER_THREAD) chunks = 1;
+        size_t chunk = (n + chunks - 1) / chunks;
+        if (chunk > reduction.chunk) reduction.chunk = chunk;
+    }
+    if (n <= reduction.chunk) return body(context, 0, n);
+
+    size_t chunks = (n + reduction.chunk - 1) / reduction.chunk;
+    reduction.partials = (double*)core_runtime_alloc(MEMORY_RUNTIME, sizeof(double) * chunks);
+    if (!reduction.partials) core_runtime_panic("Memory allocation failed for reduction.");
+    core_runtime_parallel_for(chunks, 1, parallel_reduce_chunks, &reduction);
+    double result = reduction.partials[0];
+    for (size_t i = 1; i < chunks; i++) result = combine(result, reduction.partials[i]);
+    core_runtime_free(reduction.partials);
+    return result;
+}
+
+// --- Tensors ---
+// One set of vector primitives per instruction set; the kernels below are
+// written against them and finish every loop with a scalar tail.
+// Define PANLANG_TENSOR_SCALAR to force the scalar kernels.
+#if defined(__AVX2__) && !defined(PANLANG_TENSOR_SCALAR)
+#include <immintrin.h>
+#define TENSOR_KERNELS "avx2"
+#define TENSOR_LANES 4
+typedef __m256d TensorVec;
+#define tensor_vec_load(p) _mm256_loadu_pd(p)
+#define tensor_vec_store(p, v) _mm256_storeu_pd(p, v)
+#define tensor_vec_splat(x) _mm256_set1_pd(x)
+#define tensor_vec_add(a, b) _mm256_add_pd(a, b)
+#define tensor_vec_sub(a, b) _mm256_sub_pd(a, b)
+#define tensor_vec_mul(a, b) _mm256_mul_pd(a, b)
+#define tensor_vec_div(a, b) _mm256_div_pd(a, b)
+#define tensor_vec_sqrt(a) _mm256_sqrt_pd(a)
+#define tensor_vec_max(a, b) _mm256_max_pd(a, b) // a > b ? a : b, so a NaN `a` keeps `b`
+#define tensor_vec_min(a, b) _mm256_min_pd(a, b)
+#elif defined(__SSE2__) && !defined(PANLANG_TENSOR_SCALAR)
+#include <emmintrin.h>
+#define TENSOR_KERNELS "sse2"
+#define TENSOR_LANES 2
+typedef __m128d TensorVec;
+#define tensor_vec_load(p) _mm_loadu_pd(p)
+#define tensor_vec_store(p, v) _mm_storeu_pd(p, v)
+#define tensor_vec_splat(x) _mm_set1_pd(x)
+#define tensor_vec_add(a, b) _mm_add_pd(a, b)
+#define tensor_vec_sub(a, b) _mm_sub_pd(a, b)
+#define tensor_vec_mul(a, b) _mm_mul_pd(a, b)
+#define tensor_vec_div(a, b) _mm_div_pd(a, b)
+#define tensor_vec_sqrt(a) _mm_sqrt_pd(a)
+#define tensor_vec_max(a, b) _mm_max_pd(a, b)
+#define tensor_vec_min(a, b) _mm_min_pd(a, b)
+#else
+#define TENSOR_KERNELS "scalar"
+#endif
+
+// a * b + c, fused exactly when FMA is compiled in, so the vector code and its
+// scalar tail round the same way. Without FMA the compiler cannot contract
+// a * b + c on its own (GCC does so by default when it can).
+#if defined(__FMA__)
+#if defined(TENSOR_LANES) && TENSOR_LANES == 4
+#define tensor_vec_madd(a, b, c) _mm256_fmadd_pd(a, b, c)
+#elif defined(TENSOR_LANES)
+#include <immintrin.h>
+#define tensor_vec_madd(a, b, c) _mm_fmadd_pd(a, b, c)
+#endif
+#define tensor_scalar_madd(a, b, c) fma(a, b, c)
+#else
+#if defined(TENSOR_LANES)
+#define tensor_vec_madd(a, b, c) tensor_vec_add(tensor_vec_mul(a, b), c)
+#endif
+#define tensor_scalar_madd(a, b, c) ((a) * (b) + (c))
+#endif
+
+// Kernels whose inputs are being differentiated record their result on the
+// autodiff tape (see the Autodiff section) once it is computed
+static void autodiff_record_binary(ValueOp op, const HeapTensor* a, const HeapTensor* b, HeapTensor* out);
+static void autodiff_record_matmul(const HeapTensor* a, const HeapTensor* b, HeapTensor* out);
+static void autodiff_record_transpose(const HeapTensor* a, HeapTensor* out);
+static void autodiff_record_activation(Activation activation, const HeapTensor* a, HeapTensor* out);
+static void autodiff_record_softmax(const HeapTensor* a, HeapTensor* out);
+
+// Reductions keep this many partial results regardless of the kernel set, so
+// sums add up in the same order (and give the same bits) everywhere
+#define TENSOR_REDUCE_WIDTH 8
+
+// matmul tiles: a TENSOR_BLOCK_K x TENSOR_BLOCK_N panel of b (256 KB) stays in cache
+#define TENSOR_BLOCK_K 128
+#define TENSOR_BLOCK_N 256
+
+// Smallest parallel ranges: elements for elementwise kernels and reductions,
+// multiply-adds for matmul. Below these a kernel runs on the calling thread.
+#define TENSOR_PARALLEL_GRAIN 32768
+#define TENSOR_PARALLEL_MATMUL_WORK 131072
+
+const char* core_runtime_tensor_kernels(void) {
+    return TENSOR_KERNELS;
+}
+
+HeapTensor* core_runtime_tensor_new(size_t rows, size_t cols) {
+    if (cols != 0 && rows > SIZE_MAX / sizeof(double) / cols) {
+        core_runtime_panic("Runtime Error: Tensor is too large.");
+    }
+    size_t size = rows * cols;
+    // Padded to a multiple of the alignment
+    size_t bytes = (size * sizeof(double) + VALUE_TENSOR_ALIGNMENT - 1) / VALUE_TENSOR_ALIGNMENT * VALUE_TENSOR_ALIGNMENT;
+    HeapTensor* tensor = (HeapTensor*)core_runtime_alloc(MEMORY_VALUES, sizeof(HeapTensor));
+    double* data = (double*)core_runtime_aligned_alloc(MEMORY_VALUES, VALUE_TENSOR_ALIGNMENT, bytes ? bytes : VALUE_TENSOR_ALIGNMENT);
+    if (!tensor || !data) {
+        core_runtime_free(tensor);
+        core_runtime_free(data);
+        core_runtime_panic("Memory allocation failed for tensor.");
+    }
+    memset(data, 0, bytes);
+    tensor->header.kind = HEAP_TENSOR;
+    tensor->rows = rows;
+    tensor->cols = cols;
+    tensor->size = size;
+    tensor->data = data;
+    tensor->param = NULL;
+    tensor->node = NULL;
+    tensor->tape_step = 0;
+    value_heap_push(&tensor->header);
+    return tensor;
+}
+
+HeapTensor* core_runtime_tensor_fill(size_t rows, size_t cols, double value) {
+    HeapTensor* tensor = core_runtime_tensor_new(rows, cols);
+    for (size_t i = 0; i < tensor->size; i++) tensor->data[i] = value;
+    return tensor;
+}
+
+typedef struct {
+    double start;
+    double* data;
+} TensorRangeJob;
+
+static void tensor_range_fill(void* context, size_t begin, size_t end) {
+    const TensorRangeJob* job = (const TensorRangeJob*)context;
+    for (size_t i = begin; i < end; i++) job->data[i] = job->start + (double)i;
+}
+
+HeapTensor* core_runtime_tensor_range(double start, size_t n) {
+    HeapTensor* tensor = core_runtime_tensor_new(1, n);
+    TensorRangeJob job = {start, tensor->data};
+    core_runtime_parallel_for(n, TENSOR_PARALLEL_GRAIN, tensor_range_fill, &job);
+    return tensor;
+}
+
+HeapTensor* core_runtime_tensor_random(size_t rows, size_t cols) {
+    HeapTensor* tensor = core_runtime_tensor_new(rows, cols);
+    uint64_t state = runtime_current()->random_state;
+    for (size_t i = 0; i < tensor->size; i++) {
+        // xorshift64*; the top 53 bits become a double in [0, 1)
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        uint64_t bits = (state * 0x2545F4914F6CDD1DULL) >> 11;
+        tensor->data[i] = (double)bits * (2.0 / 9007199254740992.0) - 1.0;
+    }
+    runtime_current()->random_state = state;
+    return tensor;
+}
+
+// y[0..n) += alpha * x[0..n)
+static void tensor_axpy(double alpha, const double* x, double* y, size_t n) {
+    size_t j = 0;
+#ifdef TENSOR_LANES
+    TensorVec va = tensor_vec_splat(alpha);
+    for (; j + 2 * TENSOR_LANES <= n; j += 2 * TENSOR_LANES) {
+        TensorVec y0 = tensor_vec_madd(va, tensor_vec_load(x + j), tensor_vec_load(y + j));
+        TensorVec y1 = tensor_vec_madd(va, tensor_vec_load(x + j + TENSOR_LANES), tensor_vec_load(y + j + TENSOR_LANES));
+        tensor_vec_store(y + j, y0);
+        tensor_vec_store(y + j + TENSOR_LANES, y1);
+    }
+    for (; j + TENSOR_LANES <= n; j += TENSOR_LANES) {
+        tensor_vec_store(y + j, tensor_vec_madd(va, tensor_vec_load(x + j), tensor_vec_load(y + j)));
+    }
+#endif
+    for (; j < n; j++) y[j] = tensor_scalar_madd(alpha, x[j], y[j]);
+}
+
+typedef struct {
+    const HeapTensor* a;
+    const HeapTensor* b;
+    HeapTensor* out;
+} TensorMatmulJob;
+
+// Row-major i-k-j product: each output row accumulates scaled rows of b, so
+// the inner loop streams contiguous memory in both operands. Every output
+// element still sums its k terms in increasing order, whatever the tiling or
+// the split of rows between threads.
+static void tensor_matmul_rows(void* context, size_t begin, size_t end) {
+    const TensorMatmulJob* job = (const TensorMatmulJob*)context;
+    size_t depth = job->a->cols;
+    size_t n = job->b->cols;
+    for (size_t j0 = 0; j0 < n; j0 += TENSOR_BLOCK_N) {
+        size_t width = n - j0 < TENSOR_BLOCK_N ? n - j0 : TENSOR_BLOCK_N;
+        for (size_t k0 = 0; k0 < depth; k0 += TENSOR_BLOCK_K) {
+            size_t k1 = depth - k0 < TENSOR_BLOCK_K ? depth : k0 + TENSOR_BLOCK_K;
+            for (size_t i = begin; i < end; i++) {
+                const double* a_row = job->a->data + i * depth;
+                double* out_row = job->out->data + i * n + j0;
+                for (size_t k = k0; k < k1; k++) {
+                    tensor_axpy(a_row[k], job->b->data + k * n + j0, out_row, width);
+                }
+            }
+        }
+    }
+}
+
+HeapTensor* core_runtime_tensor_matmul(const HeapTensor* a, const HeapTensor* b) {
+    TensorMatmulJob job = {a, b, core_runtime_tensor_new(a->rows, b->cols)};
+    size_t row_work = a->cols * b->cols;
+    size_t grain = row_work ? TENSOR_PARALLEL_MATMUL_WORK / row_work + 1 : a->rows;
+    core_runtime_parallel_for(a->rows, grain, tensor_matmul_rows, &job);
+    autodiff_record_matmul(a, b, job.out);
+    return job.out;
+}
+
+HeapTensor* core_runtime_tensor_transpose(const HeapTensor* a) {
+    HeapTensor* out = core_runtime_tensor_new(a->cols, a->rows);
+    for (size_t i = 0; i < a->rows; i++) {
+        for (size_t j = 0; j < a->cols; j++) {
+            out->data[j * a->rows + i] = a->data[i * a->cols + j];
+        }
+    }
+    autodiff_record_transpose(a, out);
+    return out;
+}
+
+// out[j] = x[j * x_step] op y[j * y_step] for j < n, where a step of 0
+// broadcasts a single element across the row
+#ifdef TENSOR_LANES
+#define TENSOR_ROW_VECTOR_LOOP(vec_op)                                   \
+    do {                                                                 \
+        TensorVec vx = tensor_vec_splat(x[0]);                           \
+        TensorVec vy = tensor_vec_splat(y[0]);                           \
+        for (; j + TENSOR_LANES <= n; j += TENSOR_LANES) {               \
+            if (x_step) vx = tensor_vec_load(x + j);                     \
+            if (y_step) vy = tensor_vec_load(y + j);                     \
+            tensor_vec_store(out + j, vec_op(vx, vy));                   \
+        }                                                                \
+    } while (0)
+#else
+#define TENSOR_ROW_VECTOR_LOOP(vec_op) ((void)0)
+#endif
+
+#define TENSOR_ROW_LOOP(vec_op, scalar_op)                               \
+    do {                                                                 \
+        TENSOR_ROW_VECTOR_LOOP(vec_op);                                  \
+        for (; j < n; j++) out[j] = x[j * x_step] scalar_op y[j * y_step]; \
+    } while (0)
+
+static void tensor_row_op(ValueOp op, const double* x, size_t x_step, const double* y, size_t y_step,
+                          double* out, size_t n) {
+    size_t j = 0;
+    switch (op) {
+        case VALUE_OP_ADD: TENSOR_ROW_LOOP(tensor_vec_add, +); break;
+        case VALUE_OP_SUB: TENSOR_ROW_LOOP(tensor_vec_sub, -); break;
+        case VALUE_OP_MUL: TENSOR_ROW_LOOP(tensor_vec_mul, *); break;
+        case VALUE_OP_DIV: TENSOR_ROW_LOOP(tensor_vec_div, /); break;
+    }
+}
+
+// The output is walked as rows of `row_length` elements; an operand's row
+// stride is 0 when it broadcasts a single row, its step 0 when it broadcasts
+// a single column
+typedef struct {
+    ValueOp op;
+    const double* a;
+    size_t a_stride;
+    size_t a_step;
+    const double* b;
+    size_t b_stride;
+    size_t b_step;
+    double* out;
+    size_t row_length;
+} TensorBinaryJob;
+
+static void tensor_binary_range(void* context, size_t begin, size_t end) {
+    const TensorBinaryJob* job = (const TensorBinaryJob*)context;
+    while (begin < end) {
+        size_t i = begin / job->row_length;
+        size_t j = begin % job->row_length;
+        size_t n = job->row_length - j < end - begin ? job->row_length - j : end - begin;
+        tensor_row_op(job->op, job->a + i * job->a_stride + j * job->a_step, job->a_step,
+                      job->b + i * job->b_stride + j * job->b_step, job->b_step, job->out + begin, n);
+        begin += n;
+    }
+}
+
+ValueStatus core_runtime_tensor_binary(ValueOp op, const HeapTensor* a, const HeapTensor* b, HeapTensor** out) {
+    if ((a->rows != b->rows && a->rows != 1 && b->rows != 1) ||
+        (a->cols != b->cols && a->cols != 1 && b->cols != 1)) {
+        return VALUE_ERROR_SHAPE;
+    }
+    size_t rows = a->rows == 1 ? b->rows : a->rows;
+    size_t cols = a->cols == 1 ? b->cols : a->cols;
+    HeapTensor* result = core_runtime_tensor_new(rows, cols);
+    TensorBinaryJob job = {op, a->data, a->rows == 1 ? 0 : a->cols, a->cols != 1,
+                           b->data, b->rows == 1 ? 0 : b->cols, b->cols != 1, result->data, cols};
+    if (a->rows == rows && b->rows == rows && a->cols == cols && b->cols == cols) {
+        // Same shape: one row over the contiguous buffers
+        job.a_stride = job.b_stride = 0;
+        job.a_step = job.b_step = 1;
+        job.row_length = result->size;
+    }
+    core_runtime_parallel_for(result->size, TENSOR_PARALLEL_GRAIN, tensor_binary_range, &job);
+    autodiff_record_binary(op, a, b, result);
+    *out = result;
+    return VALUE_OK;
+}
+
+static double tensor_array_sum(const double* x, size_t n) {
+    size_t i = 0;
+    double partial[TENSOR_REDUCE_WIDTH] = {0};
+#ifdef TENSOR_LANES
+    TensorVec acc[TENSOR_REDUCE_WIDTH / TENSOR_LANES];
+    for (int k = 0; k < TENSOR_REDUCE_WIDTH / TENSOR_LANES; k++) acc[k] = tensor_vec_splat(0.0);
+    for (; i + TENSOR_REDUCE_WIDTH <= n; i += TENSOR_REDUCE_WIDTH) {
+        for (int k = 0; k < TENSOR_REDUCE_WIDTH / TENSOR_LANES; k++) {
+            acc[k] = tensor_vec_add(acc[k], tensor_vec_load(x + i + k * TENSOR_LANES));
+        }
+    }
+    for (int k = 0; k < TENSOR_REDUCE_WIDTH / TENSOR_LANES; k++) tensor_vec_store(partial + k * TENSOR_LANES, acc[k]);
+#else
+    for (; i + TENSOR_REDUCE_WIDTH <= n; i += TENSOR_REDUCE_WIDTH) {
+        for (int k = 0; k < TENSOR_REDUCE_WIDTH; k++) partial[k] += x[i + k];
+    }
+#endif
+    double total = 0.0;
+    for (int k = 0; k < TENSOR_REDUCE_WIDTH; k++) total += partial[k];
+    for (; i < n; i++) total += x[i];
+    return total;
+}
+
+static double tensor_sum_range(void* context, size_t begin, size_t end) {
+    return tensor_array_sum((const double*)context + begin, end - begin);
+}
+
+static double tensor_add_partials(double a, double b) {
+    return a + b;
+}
+
+double core_runtime_tensor_sum(const HeapTensor* t) {
+    return core_runtime_parallel_reduce(t->size, TENSOR_PARALLEL_GRAIN, tensor_sum_range, tensor_add_partials, t->data);
+}
+
+// max_vec(x, best) is `x > best ? x : best`, like the scalar test, so a NaN
+// element never replaces the running result
+static double tensor_array_extremum(const double* x, size_t n, int want_max) {
+    size_t i = 0;
+    double best = want_max ? -INFINITY : INFINITY;
+#ifdef TENSOR_LANES
+    TensorVec acc = tensor_vec_splat(best);
+    if (want_max) {
+        for (; i + TENSOR_LANES <= n; i += TENSOR_LANES) acc = tensor_vec_max(tensor_vec_load(x + i), acc);
+    } else {
+        for (; i + TENSOR_LANES <= n; i += TENSOR_LANES) acc = tensor_vec_min(tensor_vec_load(x + i), acc);
+    }
+    double lanes[TENSOR_LANES];
+    tensor_vec_store(lanes, acc);
+    for (int k = 0; k < TENSOR_LANES; k++) {
+        if (want_max ? lanes[k] > best : lanes[k] < best) best = lanes[k];
+    }
+#endif
+    for (; i < n; i++) {
+        if (want_max ? x[i] > best : x[i] < best) best = x[i];
+    }
+    return best;
+}
+
+static double tensor_max_range(void* context, size_t begin, size_t end) {
+    return tensor_array_extremum((const double*)context + begin, end - begin, 1);
+}
+
+static double tensor_min_range(void* context, size_t begin, size_t end) {
+    return tensor_array_extremum((const double*)context + begin, end - begin, 0);
+}
+
+// Partials are never NaN, so these give the same result in any grouping
+static double tensor_max_partials(double a, double b) {
+    return a > b ? a : b;
+}
+
+static double tensor_min_partials(double a, double b) {
+    return a < b ? a : b;
+}
+
+double core_runtime_tensor_max(const HeapTensor* t) {
+    return core_runtime_parallel_reduce(t->size, TENSOR_PARALLEL_GRAIN, tensor_max_range, tensor_max_partials, t->data);
+}
+
+double core_runtime_tensor_min(const HeapTensor* t) {
+    return core_runtime_parallel_reduce(t->size, TENSOR_PARALLEL_GRAIN, tensor_min_range, tensor_min_partials, t->data);
+}
+
+void core_runtime_print_tensor(const HeapTensor* t) {
+    core_runtime_output_write("[", 1);
+    for (size_t i = 0; i < t->rows; i++) {
+        core_runtime_output_write(i ? ", [" : "[", i ? 3 : 1);
+        for (size_t j = 0; j < t->cols; j++) {
+            char* p = output_reserve(OUTPUT_NUMBER_SIZE + 2);
+            if (j) {
+                memcpy(p, ", ", 2);
+                p += 2;
+                output_buffer.length += 2;
+            }
+            output_buffer.length += output_format_double(t->data[i * t->cols + j], p);
+        }
+        core_runtime_output_write("]", 1);
+    }
+    core_runtime_output_write("]", 1);
+    output_end_line();
+}
+
+// --- Activations ---
+// Batched activation functions over contiguous doubles. The kernels come from
+// activation_kernels.h, instantiated for AVX2+FMA, SSE2 and plain C; on x86
+// the best set the host CPU supports is picked once, on first use, so a
+// portable -O2 build still runs AVX2 code where it can. $PANLANG_KERNELS
+// (scalar, sse2 or avx2) selects a lower set for testing and benchmarking.
+//
+// Accuracy against correctly rounded results (measured over 10^7 points):
+//   exp      relative error < 2^-50 (about 2 ulp) for x in [-708, 709];
+//            inputs outside that range are clamped to it, so exp never
+//            overflows to inf or underflows below 2^-1021
+//   sigmoid  relative error < 2^-50 for x >= -708, absolute error < 2^-1000 below
+//   tanh     relative error < 2^-49 (computed from expm1, so small |x| keeps
+//            full precision); saturates to exactly +-1
+//   relu     exact
+// NaN inputs give NaN outputs. Kernels without FMA round each step, so the
+// AVX2 set can differ from the others in the last bit or two.
+#define ACT_EXP_MIN -708.0
+#define ACT_EXP_MAX 709.0
+#define ACT_LOG2E 1.4426950408889634
+#define ACT_ROUND_MAGIC 6755399441055744.0 // 1.5 * 2^52: adding it rounds to an integer in the low bits
+#define ACT_LN2_HI 6.93147180369123816490e-01
+#define ACT_LN2_LO 1.90821492927058770002e-10
+#define ACT_EXP_C3 (1.0 / 6.0)
+#define ACT_EXP_C4 (1.0 / 24.0)
+#define ACT_EXP_C5 (1.0 / 120.0)
+#define ACT_EXP_C6 (1.0 / 720.0)
+#define ACT_EXP_C7 (1.0 / 5040.0)
+#define ACT_EXP_C8 (1.0 / 40320.0)
+#define ACT_EXP_C9 (1.0 / 362880.0)
+#define ACT_EXP_C10 (1.0 / 3628800.0)
+#define ACT_EXP_C11 (1.0 / 39916800.0)
+#define ACT_EXP_C12 (1.0 / 479001600.0)
+
+// Elements per parallel range; each costs a few nanoseconds, not one
+#define ACTIVATION_PARALLEL_GRAIN 4096
+
+typedef void (*ActivationKernel)(const double* x, double* out, size_t n);
+
+typedef struct {
+    const char* name;
+    ActivationKernel kernels[ACTIVATION_COUNT];
+} ActivationKernels;
+
+// Scalar kernels: one "lane", with the same operations as the vector sets
+static inline uint64_t act_bits(double d) { uint64_t u; memcpy(&u, &d, sizeof(u)); return u; }
+static inline double act_from_bits(uint64_t u) { double d; memcpy(&d, &u, sizeof(d)); return d; }
+
+#define ACT_SUFFIX scalar
+#define ACT_TARGET
+#define ACT_LANES 1
+#define ActVec double
+#define act_load(p) (*(p))
+#define act_store(p, v) (*(p) = (v))
+#define act_splat(x) (x)
+#define act_add(a, b) ((a) + (b))
+#define act_sub(a, b) ((a) - (b))
+#define act_mul(a, b) ((a) * (b))
+#define act_div(a, b) ((a) / (b))
+#define act_max(a, b) ((a) > (b) ? (a) : (b))
+#define act_min(a, b) ((a) < (b) ? (a) : (b))
+#define act_madd(a, b, c) ((a) * (b) + (c))
+#define act_pow2(shifted) act_from_bits((act_bits(shifted) - act_bits(ACT_ROUND_MAGIC) + 1023) << 52)
+#define act_abs(x) fabs(x)
+#define act_copysign(magnitude, sign) copysign(magnitude, sign)
+#define act_keep_nan(x, result) ((x) != (x) ? (x) : (result))
+#include "activation_kernels.h"
+#undef ACT_SUFFIX
+#undef ACT_TARGET
+#undef ACT_LANES
+#undef ActVec
+#undef act_load
+#undef act_store
+#undef act_splat
+#undef act_add
+#undef act_sub
+#undef act_mul
+#undef act_div
+#undef act_max
+#undef act_min
+#undef act_madd
+#undef act_pow2
+#undef act_abs
+#undef act_copysign
+#undef act_keep_nan
+
+static const ActivationKernels activation_kernels_scalar = {
+    "scalar",
+    {activation_exp_scalar, activation_relu_scalar, activation_sigmoid_scalar, activation_tanh_scalar},
+};
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(PANLANG_TENSOR_SCALAR)
+#define ACT_X86 1
+#include <immintrin.h>
+
+#define ACT_SUFFIX sse2
+#define ACT_TARGET __attribute__((target("sse2")))
+#define ACT_LANES 2
+#define ActVec __m128d
+#define act_load(p) _mm_loadu_pd(p)
+#define act_store(p, v) _mm_storeu_pd(p, v)
+#define act_splat(x) _mm_set1_pd(x)
+#define act_add(a, b) _mm_add_pd(a, b)
+#define act_sub(a, b) _mm_sub_pd(a, b)
+#define act_mul(a, b) _mm_mul_pd(a, b)
+#define act_div(a, b) _mm_div_pd(a, b)
+#define act_max(a, b) _mm_max_pd(a, b)
+#define act_min(a, b) _mm_min_pd(a, b)
+#define act_madd(a, b, c) _mm_add_pd(_mm_mul_pd(a, b), c)
+#define act_pow2(shifted) _mm_castsi128_pd(_mm_slli_epi64(_mm_add_epi64(_mm_sub_epi64(_mm_castpd_si128(shifted), \
+    _mm_castpd_si128(_mm_set1_pd(ACT_ROUND_MAGIC))), _mm_set1_epi64x(1023)), 52))
+#define act_abs(x) _mm_andnot_pd(_mm_set1_pd(-0.0), x)
+#define act_copysign(magnitude, sign) _mm_or_pd(act_abs(magnitude), _mm_and_pd(_mm_set1_pd(-0.0), sign))
+#define act_keep_nan(x, result) _mm_or_pd(_mm_and_pd(_mm_cmpunord_pd(x, x), x), \
+    _mm_andnot_pd(_mm_cmpunord_pd(x, x), result))
+#include "activation_kernels.h"
+#undef ACT_SUFFIX
+#undef ACT_TARGET
+#undef ACT_LANES
+#undef ActVec
+#undef act_load
+#undef act_store
+#undef act_splat
+#undef act_add
+#undef act_sub
+#undef act_mul
+#undef act_div
+#undef act_max
+#undef act_min
+#undef act_madd
+#undef act_pow2
+#undef act_abs
+#undef act_copysign
+#undef act_keep_nan
+
+#define ACT_SUFFIX avx2
+#define ACT_TARGET __attribute__((target("avx2,fma")))
+#define ACT_LANES 4
+#define ActVec __m256d
+#define act_load(p) _mm256_loadu_pd(p)
+#define act_store(p, v) _mm256_storeu_pd(p, v)
+#define act_splat(x) _mm256_set1_pd(x)
+#define act_add(a, b) _mm256_add_pd(a, b)
+#define act_sub(a, b) _mm256_sub_pd(a, b)
+#define act_mul(a, b) _mm256_mul_pd(a, b)
+#define act_div(a, b) _mm256_div_pd(a, b)
+#define act_max(a, b) _mm256_max_pd(a, b)
+#define act_min(a, b) _mm256_min_pd(a, b)
+#define act_madd(a, b, c) _mm256_fmadd_pd(a, b, c)
+#define act_pow2(shifted) _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(_mm256_sub_epi64( \
+    _mm256_castpd_si256(shifted), _mm256_castpd_si256(_mm256_set1_pd(ACT_ROUND_MAGIC))), \
+    _mm256_set1_epi64x(1023)), 52))
+#define act_abs(x) _mm256_andnot_pd(_mm256_set1_pd(-0.0), x)
+#define act_copysign(magnitude, sign) _mm256_or_pd(act_abs(magnitude), _mm256_and_pd(_mm256_set1_pd(-0.0), sign))
+#define act_keep_nan(x, result) _mm256_blendv_pd(result, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q))
+#include "activation_kernels.h"
+#undef ACT_SUFFIX
+#undef ACT_TARGET
+#undef ACT_LANES
+#undef ActVec
+#undef act_load
+#undef act_store
+#undef act_splat
+#undef act_add
+#undef act_sub
+#undef act_mul
+#undef act_div
+#undef act_max
+#undef act_min
+#undef act_madd
+#undef act_pow2
+#undef act_abs
+#undef act_copysign
+#undef act_keep_nan
+
+static const ActivationKernels activation_kernels_sse2 = {
+    "sse2",
+    {activation_exp_sse2, activation_relu_sse2, activation_sigmoid_sse2, activation_tanh_sse2},
+};
+
+static const ActivationKernels activation_kernels_avx2 = {
+    "avx2",
+    {activation_exp_avx2, activation_relu_avx2, activation_sigmoid_avx2, activation_tanh_avx2},
+};
+#endif
+
+static const ActivationKernels* activation_kernels = NULL;
+static pthread_once_t activation_once = PTHREAD_ONCE_INIT;
+
+static void activation_choose(void) {
+    // Candidates from slowest to fastest; the host's best is the last supported one
+    const ActivationKernels* candidates[3] = {&activation_kernels_scalar};
+    int count = 1;
+#ifdef ACT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        candidates[count++] = &activation_kernels_sse2;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            candidates[count++] = &activation_kernels_avx2;
+        }
+    }
+#endif
+    activation_kernels = candidates[count - 1];
+    const char* requested = getenv("PANLANG_KERNELS");
+    if (requested && *requested) {
+        int found = 0;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(candidates[i]->name, requested) == 0) {
+                activation_kernels = candidates[i];
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "Warning: PANLANG_KERNELS=%s is not available on this CPU; using %s.\n",
+                    requested, activation_kernels->name);
+        }
+    }
+}
+
+// Chosen once for the process, whichever thread gets here first
+static const ActivationKernels* activation_select(void) {
+    pthread_once(&activation_once, activation_choose);
+    return activation_kernels;
+}
+
+const char* core_runtime_activation_kernels(void) {
+    return activation_select()->name;
+}
+
+typedef struct {
+    ActivationKernel kernel;
+    const double* x;
+    double* out;
+} ActivationJob;
+
+static void activation_range(void* context, size_t begin, size_t end) {
+    const ActivationJob* job = (const ActivationJob*)context;
+    job->kernel(job->x + begin, job->out + begin, end - begin);
+}
+
+void core_runtime_activation(Activation activation, const double* x, double* out, size_t n) {
+    // Selected here, on the calling thread, before any worker can race to do it
+    ActivationJob job = {activation_select()->kernels[activation], x, out};
+    core_runtime_parallel_for(n, ACTIVATION_PARALLEL_GRAIN, activation_range, &job);
+}
+
+HeapTensor* core_runtime_tensor_activation(Activation activation, const HeapTensor* t) {
+    HeapTensor* out = core_runtime_tensor_new(t->rows, t->cols);
+    core_runtime_activation(activation, t->data, out->data, t->size);
+    autodiff_record_activation(activation, t, out);
+    return out;
+}
+
+typedef struct {
+    const HeapTensor* in;
+    HeapTensor* out;
+    ActivationKernel exp;
+} SoftmaxJob;
+
+// Each row becomes exp(x - max) / sum, so no exp argument is ever positive
+static void softmax_rows(void* context, size_t begin, size_t end) {
+    const SoftmaxJob* job = (const SoftmaxJob*)context;
+    size_t cols = job->in->cols;
+    for (size_t i = begin; i < end; i++) {
+        const double* row = job->in->data + i * cols;
+        double* out_row = job->out->data + i * cols;
+        double max = tensor_array_extremum(row, cols, 1);
+        tensor_row_op(VALUE_OP_SUB, row, 1, &max, 0, out_row, cols);
+        job->exp(out_row, out_row, cols);
+        double sum = tensor_array_sum(out_row, cols);
+        tensor_row_op(VALUE_OP_DIV, out_row, 1, &sum, 0, out_row, cols);
+    }
+}
+
+HeapTensor* core_runtime_tensor_softmax(const HeapTensor* t) {
+    SoftmaxJob job = {t, core_runtime_tensor_new(t->rows, t->cols), activation_select()->kernels[ACTIVATION_EXP]};
+    core_runtime_parallel_for(t->rows, ACTIVATION_PARALLEL_GRAIN / t->cols + 1, softmax_rows, &job);
+    autodiff_record_softmax(t, job.out);
+    return job.out;
+}
+
+// --- Autodiff ---
+// The tape is a chain of nodes in recording order, one per operation and one
+// leaf per tensor it read that was not recorded itself (parameters and
+// constants). Backward visits the chain from its newest node, so every node's
+// gradient is complete before it is passed on to its inputs. Nodes,
+// gradients and scratch space are bump-allocated from the tape's arena.
+// Tensors point at their node for as long as the step that recorded it,
+// identified by a stamp that is unique across all tapes.
+#define AUTODIFF_ALIGNMENT VALUE_TENSOR_ALIGNMENT
+#define AUTODIFF_MIN_BLOCK (64 * 1024)
+
+typedef enum {
+    AUTODIFF_LEAF,
+    AUTODIFF_BINARY,      // detail: the ValueOp
+    AUTODIFF_MATMUL,
+    AUTODIFF_AFFINE,      // inputs x, W, b
+    AUTODIFF_TRANSPOSE,
+    AUTODIFF_ACTIVATION,  // detail: the Activation
+    AUTODIFF_SOFTMAX,
+    AUTODIFF_MSE,         // inputs prediction, target
+    AUTODIFF_CROSS_ENTROPY, // inputs logits, labels; scratch: the softmax
+} AutodiffOp;
+
+struct AutodiffNode {
+    AutodiffNode* previous;   // Recorded just before this one
+    AutodiffOp op;
+    int detail;
+    int requires_grad;        // Leads back to a parameter
+    int fused;                // A consumer's kernel already passed its gradient on
+    int live;                 // Set by the collector: a root or a loss still reaches it
+    size_t consumers;         // Nodes that read it
+    size_t rows;
+    size_t cols;
+    double* value;            // Losses: &scalar
+    double* grad;             // NULL until a gradient arrives; a parameter's own buffer
+    double scalar;            // A loss, or a 1 x 1 constant, which may live on the C stack
+    AutodiffNode* inputs[3];
+    AutodiffParam* param;     // Parameter leaves
+    AutodiffNode* next_param; // Parameter leaves of this step
+    double* scratch;
+    AutodiffNode* moved;      // Its copy, while the collector compacts the tape
+};
+
+struct AutodiffParam {
+    double* grad; // size elements each, in the same block
+    double* m;
+    double* v;
+    size_t size;
+    uint64_t updates;
+};
+
+// Header of a block a step spilled into after filling the arena
+typedef struct AutodiffBlock {
+    struct AutodiffBlock* next;
+} AutodiffBlock;
+
+struct AutodiffTape {
+    char* arena;
+    size_t arena_size;
+    char* block;          // Being filled: the arena, or the newest spill block
+    size_t block_size;
+    size_t block_used;
+    AutodiffBlock* spilled;
+    size_t step_bytes;
+    uint64_t step;        // Stamp of the step being recorded
+    AutodiffNode* last;
+    AutodiffNode* params;
+    size_t nodes;
+    size_t losses;
+    int backward_done;
+    double loss;
+    AdamSettings adam;
+    AutodiffStats stats;
+};
+
+static atomic_uint_fast64_t autodiff_stamps = 0;
+
+static uint64_t autodiff_new_stamp(void) {
+    return atomic_fetch_add_explicit(&autodiff_stamps, 1, memory_order_relaxed) + 1;
+}
+
+static AutodiffTape* autodiff_tape(void) {
+    RuntimeContext* context = runtime_current();
+    if (context->tape) return context->tape;
+    AutodiffTape* tape = (AutodiffTape*)core_runtime_calloc(MEMORY_AUTODIFF, 1, sizeof(AutodiffTape));
+    if (!tape) core_runtime_panic("Memory allocation failed for autodiff tape.");
+    tape->step = autodiff_new_stamp();
+    tape->adam = (AdamSettings){0.001, 0.9, 0.999, 1e-8};
+    context->tape = tape;
+    return tape;
+}
+
+static void autodiff_free_blocks(AutodiffBlock* block) {
+    while (block) {
+        AutodiffBlock* next = block->next;
+        core_runtime_free(block);
+        block = next;
+    }
+}
+
+static void autodiff_tape_free(AutodiffTape* tape) {
+    if (!tape) return;
+    autodiff_free_blocks(tape->spilled);
+    core_runtime_free(tape->arena);
+    core_runtime_free(tape);
+}
+
+static void* autodiff_alloc(AutodiffTape* tape, size_t bytes) {
+    bytes = (bytes + AUTODIFF_ALIGNMENT - 1) / AUTODIFF_ALIGNMENT * AUTODIFF_ALIGNMENT;
+    tape->step_bytes += bytes;
+    if (tape->block_size - tape->block_used < bytes) {
+        size_t size = bytes > tape->arena_size ? bytes : tape->arena_size;
+        if (size < AUTODIFF_MIN_BLOCK) size = AUTODIFF_MIN_BLOCK;
+        AutodiffBlock* block = (AutodiffBlock*)core_runtime_aligned_alloc(MEMORY_AUTODIFF, AUTODIFF_ALIGNMENT,
+                                                                          AUTODIFF_ALIGNMENT + size);
+        if (!block) core_runtime_panic("Memory allocation failed for autodiff tape.");
+        block->next = tape->spilled;
+        tape->spilled = block;
+        tape->block = (char*)block + AUTODIFF_ALIGNMENT;
+        tape->block_size = size;
+        tape->block_used = 0;
+    }
+    void* p = tape->block + tape->block_used;
+    tape->block_used += bytes;
+    return p;
+}
+
+static double* autodiff_zeros(AutodiffTape* tape, size_t n) {
+    double* p = (double*)autodiff_alloc(tape, n * sizeof(double));
+    memset(p, 0, n * sizeof(double));
+    return p;
+}
+
+static int autodiff_current(const AutodiffTape* tape, const HeapTensor* t) {
+    return tape && t->node && t->tape_step == tape->step;
+}
+
+// Marks the records backward or Adam may still read: those of the tensors
+// the roots point to, the losses and the parameter leaves, and everything
+// they were computed from. Nothing is dropped once backward has run.
+static void autodiff_mark(AutodiffTape* tape, const uintptr_t* live, size_t num_live) {
+    if (!tape) return;
+    for (AutodiffNode* node = tape->last; node; node = node->previous) {
+        node->live = tape->backward_done || node->param || node->op == AUTODIFF_MSE ||
+                     node->op == AUTODIFF_CROSS_ENTROPY;
+    }
+    for (size_t i = 0; i < num_live; i++) {
+        HeapObject* object = (HeapObject*)live[i];
+        if (object->kind == HEAP_TENSOR && autodiff_current(tape, (HeapTensor*)object)) {
+            ((HeapTensor*)object)->node->live = 1;
+        }
+    }
+    // Inputs are recorded before the nodes that read them
+    for (AutodiffNode* node = tape->last; node; node = node->previous) {
+        if (!node->live) continue;
+        for (int k = 0; k < 3; k++) {
+            if (node->inputs[k]) node->inputs[k]->live = 1;
+        }
+    }
+}
+
+static int autodiff_keeps(const AutodiffTape* tape, const HeapTensor* t) {
+    return autodiff_current(tape, t) && t->node->live;
+}
+
+// Whether an operation reading `t` must be recorded
+static int autodiff_tracks(const HeapTensor* t) {
+    if (t->param) return 1;
+    if (!t->node) return 0;
+    const AutodiffTape* tape = runtime_current()->tape;
+    return autodiff_current(tape, t) && t->node->requires_grad;
+}
+
+static AutodiffNode* autodiff_node(AutodiffTape* tape, AutodiffOp op, size_t rows, size_t cols) {
+    AutodiffNode* node = (AutodiffNode*)autodiff_alloc(tape, sizeof(AutodiffNode));
+    memset(node, 0, sizeof(*node));
+    node->op = op;
+    node->rows = rows;
+    node->cols = cols;
+    node->previous = tape->last;
+    tape->last = node;
+    tape->nodes++;
+    return node;
+}
+
+// The node for an input: the one that computed it this step, or a new leaf
+static AutodiffNode* autodiff_input(AutodiffTape* tape, const HeapTensor* t) {
+    HeapTensor* tensor = (HeapTensor*)t;
+    AutodiffNode* node;
+    if (autodiff_current(tape, t)) {
+        node = t->node;
+    } else {
+        node = autodiff_node(tape, AUTODIFF_LEAF, t->rows, t->cols);
+        node->value = tensor->data;
+        if (t->param) {
+            node->requires_grad = 1;
+            node->param = t->param;
+            node->grad = t->param->grad;
+            node->next_param = tape->params;
+            tape->params = node;
+        } else if (t->size == 1) {
+            node->scalar = t->data[0];
+            node->value = &node->scalar;
+        }
+        tensor->node = node;
+        tensor->tape_step = tape->step;
+    }
+    node->consumers++;
+    return node;
+}
+
+static AutodiffNode* autodiff_output(AutodiffTape* tape, AutodiffOp op, HeapTensor* out) {
+    AutodiffNode* node = autodiff_node(tape, op, out->rows, out->cols);
+    node->requires_grad = 1;
+    node->value = out->data;
+    out->node = node;
+    out->tape_step = tape->step;
+    return node;
+}
+
+static void autodiff_record_binary(ValueOp op, const HeapTensor* a, const HeapTensor* b, HeapTensor* out) {
+    if (!autodiff_tracks(a) && !autodiff_tracks(b)) return;
+    AutodiffTape* tape = autodiff_tape();
+    AutodiffNode* left = autodiff_input(tape, a);
+    AutodiffNode* right = autodiff_input(tape, b);
+    AutodiffNode* node = autodiff_output(tape, AUTODIFF_BINARY, out);
+    node->detail = (int)op;
+    node->inputs[0] = left;
+    node->inputs[1] = right;
+}
+
+static void autodiff_record_matmul(const HeapTensor* a, const HeapTensor* b, HeapTensor* out) {
+    if (!autodiff_tracks(a) && !autodiff_tracks(b)) return;
+    AutodiffTape* tape = autodiff_tape();
+    AutodiffNode* left = autodiff_input(tape, a);
+    AutodiffNode* right = autodiff_input(tape, b);
+    AutodiffNode* node = autodiff_output(tape, AUTODIFF_MATMUL, out);
+    node->inputs[0] = left;
+    node->inputs[1] = right;
+}
+
+static void autodiff_record_transpose(const HeapTensor* a, HeapTensor* out) {
+    if (!autodiff_tracks(a)) return;
+    AutodiffTape* tape = autodiff_tape();
+    AutodiffNode* input = autodiff_input(tape, a);
+    autodiff_output(tape, AUTODIFF_TRANSPOSE, out)->inputs[0] = input;
+}
+
+static void autodiff_record_activation(Activation activation, const HeapTensor* a, HeapTensor* out) {
+    if (!autodiff_tracks(a)) return;
+    AutodiffTape* tape = autodiff_tape();
+    AutodiffNode* input = autodiff_input(tape, a);
+    AutodiffNode* node = autodiff_output(tape, AUTODIFF_ACTIVATION, out);
+    node->detail = (int)activation;
+    node->inputs[0] = input;
+}
+
+static void autodiff_record_softmax(const HeapTensor* a, HeapTensor* out) {
+    if (!autodiff_tracks(a)) return;
+    AutodiffTape* tape = autodiff_tape();
+    AutodiffNode* input = autodiff_input(tape, a);
+    autodiff_output(tape, AUTODIFF_SOFTMAX, out)->inputs[0] = input;
+}
+
+void core_runtime_autodiff_param(HeapTensor* t) {
+    if (t->param) return;
+    if (autodiff_tracks(t)) {
+        // Its gradient would flow into the parameters it came from this step
+        core_runtime_panic("Runtime Error: Buddhimatta.Param expects a tensor that is not computed from a trainable tensor.");
+    }
+    size_t bytes = (sizeof(AutodiffParam) + AUTODIFF_ALIGNMENT - 1) / AUTODIFF_ALIGNMENT * AUTODIFF_ALIGNMENT;
+    if (t->size > (SIZE_MAX - bytes) / 3 / sizeof(double)) core_runtime_panic("Runtime Error: Tensor is too large.");
+    AutodiffParam* param = (AutodiffParam*)core_runtime_aligned_alloc(MEMORY_AUTODIFF, AUTODIFF_ALIGNMENT,
+                                                                      bytes + 3 * t->size * sizeof(double));
+    if (!param) core_runtime_panic("Memory allocation failed for autodiff parameter.");
+    param->grad = (double*)((char*)param + bytes);
+    param->m = param->grad + t->size;
+    param->v = param->m + t->size;
+    param->size = t->size;
+    param->updates = 0;
+    memset(param->grad, 0, 3 * t->size * sizeof(double));
+    t->param = param;
+    // A constant leaf recorded earlier this step would hide the parameter
+    t->node = NULL;
+    t->tape_step = 0;
+}
+
+const double* core_runtime_autodiff_grad(const HeapTensor* t) {
+    return t->param ? t->param->grad : NULL;
+}
+
+HeapTensor* core_runtime_tensor_affine(const HeapTensor* x, const HeapTensor* w, const HeapTensor* b) {
+    TensorMatmulJob job = {x, w, core_runtime_tensor_new(x->rows, w->cols)};
+    // The matmul kernel accumulates into its output, so start every row at b
+    for (size_t i = 0; i < x->rows; i++) memcpy(job.out->data + i * w->cols, b->data, w->cols * sizeof(double));
+    size_t row_work = x->cols * w->cols;
+    size_t grain = row_work ? TENSOR_PARALLEL_MATMUL_WORK / row_work + 1 : x->rows;
+    core_runtime_parallel_for(x->rows, grain, tensor_matmul_rows, &job);
+    if (autodiff_tracks(x) || autodiff_tracks(w) || autodiff_tracks(b)) {
+        AutodiffTape* tape = autodiff_tape();
+        AutodiffNode* inputs[3] = {autodiff_input(tape, x), autodiff_input(tape, w), autodiff_input(tape, b)};
+        AutodiffNode* node = autodiff_output(tape, AUTODIFF_AFFINE, job.out);
+        memcpy(node->inputs, inputs, sizeof(inputs));
+    }
+    return job.out;
+}
+
+static AutodiffNode* autodiff_loss(AutodiffTape* tape, AutodiffOp op, const HeapTensor* a, const HeapTensor* b,
+                                   double loss) {
+    AutodiffNode* left = autodiff_input(tape, a);
+    AutodiffNode* right = autodiff_input(tape, b);
+    AutodiffNode* node = autodiff_node(tape, op, 1, 1);
+    node->requires_grad = 1;
+    node->scalar = loss;
+    node->value = &node->scalar;
+    node->inputs[0] = left;
+    node->inputs[1] = right;
+    tape->losses++;
+    tape->loss += loss;
+    return node;
+}
+
+double core_runtime_tensor_mse(const HeapTensor* prediction, const HeapTensor* target) {
+    double sum = 0.0;
+    for (size_t i = 0; i < prediction->size; i++) {
+        double d = prediction->data[i] - target->data[i];
+        sum += d * d;
+    }
+    double loss = sum / (double)prediction->size;
+    if (autodiff_tracks(prediction) || autodiff_tracks(target)) {
+        autodiff_loss(autodiff_tape(), AUTODIFF_MSE, prediction, target, loss);
+    }
+    return loss;
+}
+
+// Softmax rows into `probabilities` (a row at a time, when `step` is 0) and
+// the summed cross-entropy, -sum(y * log softmax) = sum(y * (logsumexp - z))
+static double autodiff_cross_entropy_rows(const HeapTensor* logits, const HeapTensor* labels, double* probabilities,
+                                          size_t step) {
+    ActivationKernel exp_kernel = activation_select()->kernels[ACTIVATION_EXP];
+    size_t cols = logits->cols;
+    double total = 0.0;
+    for (size_t i = 0; i < logits->rows; i++) {
+        const double* z = logits->data + i * cols;
+        const double* y = labels->data + i * cols;
+        double* p = probabilities + i * step;
+        double max = tensor_array_extremum(z, cols, 1);
+        tensor_row_op(VALUE_OP_SUB, z, 1, &max, 0, p, cols);
+        exp_kernel(p, p, cols);
+        double sum = tensor_array_sum(p, cols);
+        double log_sum = max + log(sum);
+        for (size_t j = 0; j < cols; j++) total += y[j] * (log_sum - z[j]);
+        tensor_row_op(VALUE_OP_DIV, p, 1, &sum, 0, p, cols);
+    }
+    return total;
+}
+
+double core_runtime_tensor_cross_entropy(const HeapTensor* logits, const HeapTensor* labels) {
+    if (autodiff_tracks(labels)) {
+        core_runtime_panic("Runtime Error: Buddhimatta.CrossEntropy cannot differentiate its labels; "
+                           "they must not be computed from a trainable tensor.");
+    }
+    if (!autodiff_tracks(logits)) {
+        double* row = (double*)core_runtime_alloc(MEMORY_AUTODIFF, logits->cols * sizeof(double));
+        if (!row) core_runtime_panic("Memory allocation failed for tensor.");
+        double total = autodiff_cross_entropy_rows(logits, labels, row, 0);
+        core_runtime_free(row);
+        return total / (double)logits->rows;
+    }
+    AutodiffTape* tape = autodiff_tape();
+    double* probabilities = (double*)autodiff_alloc(tape, logits->size * sizeof(double));
+    double loss = autodiff_cross_entropy_rows(logits, labels, probabilities, logits->cols) / (double)logits->rows;
+    autodiff_loss(tape, AUTODIFF_CROSS_ENTROPY, logits, labels, loss)->scratch = probabilities;
+    return loss;
+}
+
+static double* autodiff_grad(AutodiffTape* tape, AutodiffNode* node) {
+    if (!node->grad) node->grad = autodiff_zeros(tape, node->rows * node->cols);
+    return node->grad;
+}
+
+// Sum of x[i] * y[i], in the same order as tensor_array_sum
+static double tensor_array_dot(const double* x, const double* y, size_t n) {
+    size_t i = 0;
+    double partial[TENSOR_REDUCE_WIDTH] = {0};
+#ifdef TENSOR_LANES
+    TensorVec acc[TENSOR_REDUCE_WIDTH / TENSOR_LANES];
+    for (int k = 0; k < TENSOR_REDUCE_WIDTH / TENSOR_LANES; k++) acc[k] = tensor_vec_splat(0.0);
+    for (; i + TENSOR_REDUCE_WIDTH <= n; i += TENSOR_REDUCE_WIDTH) {
+        for (int k = 0; k < TENSOR_REDUCE_WIDTH / TENSOR_LANES; k++) {
+            acc[k] = tensor_vec_add(acc[k], tensor_vec_mul(tensor_vec_load(x + i + k * TENSOR_LANES),
+                                                           tensor_vec_load(y + i + k * TENSOR_LANES)));
+        }
+    }
+    for (int k = 0; k < TENSOR_REDUCE_WIDTH / TENSOR_LANES; k++) tensor_vec_store(partial + k * TENSOR_LANES, acc[k]);
+#else
+    for (; i + TENSOR_REDUCE_WIDTH <= n; i += TENSOR_REDUCE_WIDTH) {
+        for (int k = 0; k < TENSOR_REDUCE_WIDTH; k++) partial[k] += x[i + k] * y[i + k];
+    }
+#endif
+    double total = 0.0;
+    for (int k = 0; k < TENSOR_REDUCE_WIDTH; k++) total += partial[k];
+    for (; i < n; i++) total += x[i] * y[i];
+    return total;
+}
+
+// For Z = A B, with A m x k, B k x n and dZ m x n
+typedef struct {
+    const double* dz;
+    const double* a;
+    const double* b;
+    double* grad;
+    size_t m;
+    size_t k;
+    size_t n;
+} AutodiffMatmulJob;
+
+// dA[i, :] += dZ[i, :] B^T: each element is the dot product of two rows
+static void autodiff_matmul_grad_left(void* context, size_t begin, size_t end) {
+    const AutodiffMatmulJob* job = (const AutodiffMatmulJob*)context;
+    for (size_t i = begin; i < end; i++) {
+        const double* dz_row = job->dz + i * job->n;
+        double* grad_row = job->grad + i * job->k;
+        for (size_t kk = 0; kk < job->k; kk++) grad_row[kk] += tensor_array_dot(dz_row, job->b + kk * job->n, job->n);
+    }
+}
+
+// dB[kk, :] += sum over i of A[i, kk] dZ[i, :], adding the rows of dZ in order
+static void autodiff_matmul_grad_right(void* context, size_t begin, size_t end) {
+    const AutodiffMatmulJob* job = (const AutodiffMatmulJob*)context;
+    for (size_t i = 0; i < job->m; i++) {
+        const double* a_row = job->a + i * job->k;
+        const double* dz_row = job->dz + i * job->n;
+        for (size_t kk = begin; kk < end; kk++) tensor_axpy(a_row[kk], dz_row, job->grad + kk * job->n, job->n);
+    }
+}
+
+static void autodiff_matmul_backward(AutodiffTape* tape, const double* dz, AutodiffNode* a, AutodiffNode* b) {
+    AutodiffMatmulJob job = {dz, a->value, b->value, NULL, a->rows, a->cols, b->cols};
+    if (a->requires_grad) {
+        job.grad = autodiff_grad(tape, a);
+        size_t row_work = job.k * job.n;
+        core_runtime_parallel_for(job.m, row_work ? TENSOR_PARALLEL_MATMUL_WORK / row_work + 1 : job.m,
+                                  autodiff_matmul_grad_left, &job);
+    }
+    if (b->requires_grad) {
+        job.grad = autodiff_grad(tape, b);
+        size_t row_work = job.m * job.n;
+        core_runtime_parallel_for(job.k, row_work ? TENSOR_PARALLEL_MATMUL_WORK / row_work + 1 : job.k,
+                                  autodiff_matmul_grad_right, &job);
+    }
+}
+
+// dy * f'(x) from y = f(x), for one row
+static void autodiff_activation_grad(Activation activation, const double* y, const double* dy, double* dx, size_t n,
+                                     int accumulate) {
+    for (size_t j = 0; j < n; j++) {
+        double d;
+        switch (activation) {
+            case ACTIVATION_RELU: d = y[j] > 0.0 ? dy[j] : 0.0; break;
+            case ACTIVATION_SIGMOID: d = dy[j] * y[j] * (1.0 - y[j]); break;
+            case ACTIVATION_TANH: d = dy[j] * (1.0 - y[j] * y[j]); break;
+            default: d = dy[j] * y[j]; break; // exp
+        }
+        dx[j] = accumulate ? dx[j] + d : d;
+    }
+}
+
+// A dense layer y = act(x W + b), whichever nodes it was recorded as: x, W
+// and b (NULL without a bias) are its leaves, `dz` the gradient of x W + b,
+// or of y when `activation` is given, and `y` its output. The activation's
+// gradient and the bias gradient are computed in one pass over the rows,
+// then the weight and input gradients read the result.
+static void autodiff_dense_backward(AutodiffTape* tape, const double* dy, const double* y, int activation,
+                                    AutodiffNode* x, AutodiffNode* w, AutodiffNode* b) {
+    size_t rows = x->rows, cols = w->cols;
+    const double* dz = dy;
+    double* db = b && b->requires_grad ? autodiff_grad(tape, b) : NULL;
+    if (activation >= 0) {
+        double* scratch = (double*)autodiff_alloc(tape, rows * cols * sizeof(double));
+        for (size_t i = 0; i < rows; i++) {
+            autodiff_activation_grad((Activation)activation, y + i * cols, dy + i * cols, scratch + i * cols, cols, 0);
+            if (db) tensor_axpy(1.0, scratch + i * cols, db, cols);
+        }
+        dz = scratch;
+    } else if (db) {
+        for (size_t i = 0; i < rows; i++) tensor_axpy(1.0, dz + i * cols, db, cols);
+    }
+    autodiff_matmul_backward(tape, dz, x, w);
+}
+
+// Finds the dense layer that computed `z` if `z` is one, and nothing but its
+// consumer read the intermediate nodes: affine(x, W, b), matmul(x, W) + b
+// with a row vector b, or matmul(x, W) alone
+static int autodiff_dense_parts(AutodiffNode* z, AutodiffNode** x, AutodiffNode** w, AutodiffNode** b) {
+    if (z->op == AUTODIFF_AFFINE || z->op == AUTODIFF_MATMUL) {
+        *x = z->inputs[0];
+        *w = z->inputs[1];
+        *b = z->inputs[2];
+        return 1;
+    }
+    if (z->op != AUTODIFF_BINARY || z->detail != VALUE_OP_ADD) return 0;
+    for (int side = 0; side < 2; side++) {
+        AutodiffNode* product = z->inputs[side];
+        AutodiffNode* bias = z->inputs[1 - side];
+        if (product->op == AUTODIFF_MATMUL && !product->fused && product->consumers == 1 &&
+            product->rows == z->rows && product->cols == z->cols && bias->rows == 1 && bias->cols == z->cols) {
+            product->fused = 1;
+            *x = product->inputs[0];
+            *w = product->inputs[1];
+            *b = bias;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// a op b, with each operand broadcast over the output's rows and columns
+#define AUTODIFF_BROADCAST_LOOP(statement)                                   \
+    for (size_t i = 0; i < rows; i++) {                                      \
+        for (size_t j = 0; j < cols; j++) {                                  \
+            double g = dz[i * cols + j];                                     \
+            size_t ia = i * a_stride + j * a_step, ib = i * b_stride + j * b_step; \
+            (void)ia;                                                        \
+            (void)ib;                                                        \
+            statement;                                                       \
+        }                                                                    \
+    }
+
+static void autodiff_binary_backward(AutodiffTape* tape, AutodiffNode* node) {
+    AutodiffNode* a = node->inputs[0];
+    AutodiffNode* b = node->inputs[1];
+    size_t rows = node->rows, cols = node->cols;
+    size_t a_stride = a->rows == 1 ? 0 : a->cols, a_step = a->cols != 1;
+    size_t b_stride = b->rows == 1 ? 0 : b->cols, b_step = b->cols != 1;
+    const double* dz = node->grad;
+    const double* av = a->value;
+    const double* bv = b->value;
+    const double* out = node->value;
+    double* da = a->requires_grad ? autodiff_grad(tape, a) : NULL;
+    double* db = b->requires_grad ? autodiff_grad(tape, b) : NULL;
+    switch ((ValueOp)node->detail) {
+        case VALUE_OP_ADD:
+            if (da) AUTODIFF_BROADCAST_LOOP(da[ia] += g);
+            if (db) AUTODIFF_BROADCAST_LOOP(db[ib] += g);
+            break;
+        case VALUE_OP_SUB:
+            if (da) AUTODIFF_BROADCAST_LOOP(da[ia] += g);
+            if (db) AUTODIFF_BROADCAST_LOOP(db[ib] -= g);
+            break;
+        case VALUE_OP_MUL:
+            if (da) AUTODIFF_BROADCAST_LOOP(da[ia] += g * bv[ib]);
+            if (db) AUTODIFF_BROADCAST_LOOP(db[ib] += g * av[ia]);
+            break;
+        case VALUE_OP_DIV:
+            if (da) AUTODIFF_BROADCAST_LOOP(da[ia] += g / bv[ib]);
+            if (db) AUTODIFF_BROADCAST_LOOP(db[ib] -= g * out[i * cols + j] / bv[ib]);
+            break;
+    }
+}
+
+static void autodiff_node_backward(AutodiffTape* tape, AutodiffNode* node) {
+    AutodiffNode* x;
+    AutodiffNode* w;
+    AutodiffNode* b;
+    switch (node->op) {
+        case AUTODIFF_LEAF:
+            break;
+        case AUTODIFF_BINARY:
+            if (autodiff_dense_parts(node, &x, &w, &b)) {
+                autodiff_dense_backward(tape, node->grad, NULL, -1, x, w, b);
+            } else {
+                autodiff_binary_backward(tape, node);
+            }
+            break;
+        case AUTODIFF_MATMUL:
+            autodiff_matmul_backward(tape, node->grad, node->inputs[0], node->inputs[1]);
+            break;
+        case AUTODIFF_AFFINE:
+            autodiff_dense_backward(tape, node->grad, NULL, -1, node->inputs[0], node->inputs[1], node->inputs[2]);
+            break;
+        case AUTODIFF_TRANSPOSE: {
+            AutodiffNode* a = node->inputs[0];
+            if (!a->requires_grad) break;
+            double* da = autodiff_grad(tape, a);
+            for (size_t i = 0; i < a->rows; i++) {
+                for (size_t j = 0; j < a->cols; j++) da[i * a->cols + j] += node->grad[j * a->rows + i];
+            }
+            break;
+        }
+        case AUTODIFF_ACTIVATION: {
+            AutodiffNode* z = node->inputs[0];
+            if (!z->requires_grad) break;
+            if (z->consumers == 1 && !z->grad && autodiff_dense_parts(z, &x, &w, &b)) {
+                z->fused = 1;
+                autodiff_dense_backward(tape, node->grad, node->value, node->detail, x, w, b);
+                break;
+            }
+            double* dz = autodiff_grad(tape, z);
+            for (size_t i = 0; i < node->rows; i++) {
+                size_t offset = i * node->cols;
+                autodiff_activation_grad((Activation)node->detail, node->value + offset, node->grad + offset,
+                                         dz + offset, node->cols, 1);
+            }
+            break;
+        }
+        case AUTODIFF_SOFTMAX: {
+            // Jacobian-vector product of each row: dx = y * (dy - dot(dy, y))
+            AutodiffNode* z = node->inputs[0];
+            if (!z->requires_grad) break;
+            double* dz = autodiff_grad(tape, z);
+            for (size_t i = 0; i < node->rows; i++) {
+                size_t offset = i * node->cols;
+                const double* y = node->value + offset;
+                const double* dy = node->grad + offset;
+                double dot = tensor_array_dot(dy, y, node->cols);
+                for (size_t j = 0; j < node->cols; j++) dz[offset + j] += y[j] * (dy[j] - dot);
+            }
+            break;
+        }
+        case AUTODIFF_MSE: {
+            AutodiffNode* p = node->inputs[0];
+            AutodiffNode* t = node->inputs[1];
+            size_t n = p->rows * p->cols;
+            double scale = 2.0 / (double)n;
+            double* dp = p->requires_grad ? autodiff_grad(tape, p) : NULL;
+            double* dt = t->requires_grad ? autodiff_grad(tape, t) : NULL;
+            for (size_t i = 0; i < n; i++) {
+                double d = scale * (p->value[i] - t->value[i]);
+                if (dp) dp[i] += d;
+                if (dt) dt[i] -= d;
+            }
+            break;
+        }
+        case AUTODIFF_CROSS_ENTROPY: {
+            // d/dz of the mean loss: (softmax * sum(y) - y) / rows
+            AutodiffNode* z = node->inputs[0];
+            const double* y = node->inputs[1]->value;
+            double* dz = autodiff_grad(tape, z);
+            double scale = 1.0 / (double)z->rows;
+            for (size_t i = 0; i < z->rows; i++) {
+                size_t offset = i * z->cols;
+                double label_sum = tensor_array_sum(y + offset, z->cols);
+                for (size_t j = 0; j < z->cols; j++) {
+                    dz[offset + j] += scale * (node->scratch[offset + j] * label_sum - y[offset + j]);
+                }
+            }
+            break;
+        }
+    }
+}
+
+double core_runtime_autodiff_backward(void) {
+    AutodiffTape* tape = autodiff_tape();
+    if (!tape->losses) {
+        core_runtime_panic("Runtime Error: Nothing to differentiate: no loss of a trainable tensor was computed this step.");
+    }
+    if (tape->backward_done) return tape->loss;
+    tape->backward_done = 1;
+    for (AutodiffNode* node = tape->last; node; node = node->previous) {
+        if (node->fused || (!node->grad && node->op != AUTODIFF_MSE && node->op != AUTODIFF_CROSS_ENTROPY)) continue;
+        autodiff_node_backward(tape, node);
+    }
+    return tape->loss;
+}
+
+void core_runtime_adam_configure(const AdamSettings* settings) {
+    autodiff_tape()->adam = *settings;
+}
+
+void core_runtime_adam_settings(AdamSettings* settings) {
+    *settings = autodiff_tape()->adam;
+}
+
+typedef struct {
+    double* p;
+    double* g;
+    double* m;
+    double* v;
+    double beta1;
+    double beta2;
+    double step;    // Learning rate with both bias corrections folded in
+    double epsilon; // Scaled to match
+} AdamJob;
+
+// m = b1 m + (1 - b1) g, v = b2 v + (1 - b2) g^2, p -= step m / (sqrt(v) + eps)
+// and g = 0, in one pass over the four buffers. The moments are written as
+// multiply-adds on both paths, so an element gets the same result in the
+// vector loop as in the tail.
+static void adam_range(void* context, size_t begin, size_t end) {
+    const AdamJob* job = (const AdamJob*)context;
+    size_t i = begin;
+#ifdef TENSOR_LANES
+    TensorVec b1 = tensor_vec_splat(job->beta1), c1 = tensor_vec_splat(1.0 - job->beta1);
+    TensorVec b2 = tensor_vec_splat(job->beta2), c2 = tensor_vec_splat(1.0 - job->beta2);
+    TensorVec step = tensor_vec_splat(job->step), epsilon = tensor_vec_splat(job->epsilon);
+    TensorVec zero = tensor_vec_splat(0.0);
+    for (; i + TENSOR_LANES <= end; i += TENSOR_LANES) {
+        TensorVec g = tensor_vec_load(job->g + i);
+        TensorVec m = tensor_vec_madd(b1, tensor_vec_load(job->m + i), tensor_vec_mul(c1, g));
+        TensorVec v = tensor_vec_madd(b2, tensor_vec_load(job->v + i), tensor_vec_mul(c2, tensor_vec_mul(g, g)));
+        TensorVec update = tensor_vec_div(tensor_vec_mul(step, m), tensor_vec_add(tensor_vec_sqrt(v), epsilon));
+        tensor_vec_store(job->m + i, m);
+        tensor_vec_store(job->v + i, v);
+        tensor_vec_store(job->p + i, tensor_vec_sub(tensor_vec_load(job->p + i), update));
+        tensor_vec_store(job->g + i, zero);
+    }
+#endif
+    for (; i < end; i++) {
+        double g = job->g[i];
+        double m = tensor_scalar_madd(job->beta1, job->m[i], (1.0 - job->beta1) * g);
+        double v = tensor_scalar_madd(job->beta2, job->v[i], (1.0 - job->beta2) * (g * g));
+        job->m[i] = m;
+        job->v[i] = v;
+        job->p[i] -= job->step * m / (sqrt(v) + job->epsilon);
+        job->g[i] = 0.0;
+    }
+}
+
+void core_runtime_adam_update(void) {
+    AutodiffTape* tape = autodiff_tape();
+    const AdamSettings* adam = &tape->adam;
+    for (AutodiffNode* leaf = tape->params; leaf; leaf = leaf->next_param) {
+        AutodiffParam* param = leaf->param;
+        param->updates++;
+        double correction1 = 1.0 - pow(adam->beta1, (double)param->updates);
+        double correction2 = sqrt(1.0 - pow(adam->beta2, (double)param->updates));
+        AdamJob job = {leaf->value, param->grad, param->m, param->v, adam->beta1, adam->beta2,
+                       adam->learning_rate * correction2 / correction1, adam->epsilon * correction2};
+        core_runtime_parallel_for(param->size, TENSOR_PARALLEL_GRAIN, adam_range, &job);
+    }
+}
+
+void core_runtime_autodiff_reset(void) {
+    AutodiffTape* tape = runtime_current()->tape;
+    if (!tape) return;
+    tape->stats.steps++;
+    tape->stats.nodes = tape->nodes;
+    if (tape->step_bytes > tape->stats.arena_peak) tape->stats.arena_peak = tape->step_bytes;
+    if (tape->spilled) {
+        // Next time the whole step fits in the arena
+        autodiff_free_blocks(tape->spilled);
+        tape->spilled = NULL;
+        core_runtime_free(tape->arena);
+        size_t size = (tape->step_bytes + AUTODIFF_MIN_BLOCK - 1) / AUTODIFF_MIN_BLOCK * AUTODIFF_MIN_BLOCK;
+        tape->arena = (char*)core_runtime_aligned_alloc(MEMORY_AUTODIFF, AUTODIFF_ALIGNMENT, size);
+        if (!tape->arena) core_runtime_panic("Memory allocation failed for autodiff tape.");
+        tape->arena_size = size;
+        tape->stats.arena_growths++;
+    }
+    tape->block = tape->arena;
+    tape->block_size = tape->arena_size;
+    tape->block_used = 0;
+    tape->step_bytes = 0;
+    tape->step = autodiff_new_stamp();
+    tape->last = NULL;
+    tape->params = NULL;
+    tape->nodes = 0;
+    tape->losses = 0;
+    tape->backward_done = 0;
+    tape->loss = 0.0;
+}
+
+// Copies the records autodiff_mark kept into a fresh arena, oldest first, and
+// points the surviving tensors in `kept` at the copies, so forward passes that
+// never reach a loss (inference) do not grow the tape without bound
+static void autodiff_compact(AutodiffTape* tape, HeapObject* kept) {
+    if (!tape || tape->backward_done) return;
+    size_t count = 0;
+    for (AutodiffNode* node = tape->last; node; node = node->previous) count += (size_t)node->live;
+    if (count == tape->nodes) return;
+    size_t size = tape->arena_size ? tape->arena_size : AUTODIFF_MIN_BLOCK;
+    AutodiffNode** order = (AutodiffNode**)core_runtime_alloc(MEMORY_AUTODIFF, sizeof(AutodiffNode*) * (count + 1));
+    char* arena = (char*)core_runtime_aligned_alloc(MEMORY_AUTODIFF, AUTODIFF_ALIGNMENT, size);
+    if (!order || !arena) {
+        core_runtime_free(order);
+        core_runtime_free(arena);
+        core_runtime_panic("Memory allocation failed for autodiff tape.");
+    }
+    size_t n = count;
+    for (AutodiffNode* node = tape->last; node; node = node->previous) {
+        if (node->live) order[--n] = node;
+    }
+
+    char* old_arena = tape->arena;
+    AutodiffBlock* old_spilled = tape->spilled;
+    tape->arena = arena;
+    tape->arena_size = size;
+    tape->spilled = NULL;
+    tape->block = arena;
+    tape->block_size = size;
+    tape->block_used = 0;
+    tape->step_bytes = 0;
+    tape->last = NULL;
+    tape->params = NULL;
+    tape->nodes = 0;
+    for (size_t i = 0; i < count; i++) {
+        AutodiffNode* old = order[i];
+        AutodiffNode* node = autodiff_node(tape, old->op, old->rows, old->cols);
+        AutodiffNode* previous = node->previous;
+        *node = *old;
+        node->previous = previous;
+        node->consumers = 0;
+        node->moved = NULL;
+        if (old->value == &old->scalar) node->value = &node->scalar;
+        for (int k = 0; k < 3; k++) {
+            if (!old->inputs[k]) continue;
+            node->inputs[k] = old->inputs[k]->moved;
+            node->inputs[k]->consumers++;
+        }
+        if (old->scratch) { // The softmax of cross-entropy, one value per logit
+            size_t scratch = node->inputs[0]->rows * node->inputs[0]->cols;
+            node->scratch = (double*)autodiff_alloc(tape, scratch * sizeof(double));
+            memcpy(node->scratch, old->scratch, scratch * sizeof(double));
+        }
+        if (node->param) {
+            node->next_param = tape->params;
+            tape->params = node;
+        }
+        old->moved = node;
+    }
+    for (HeapObject* object = kept; object; object = object->next) {
+        HeapTensor* t = (HeapTensor*)object;
+        if (object->kind == HEAP_TENSOR && autodiff_current(tape, t)) t->node = t->node->moved;
+    }
+
+    core_runtime_free(order);
+    core_runtime_free(old_arena);
+    autodiff_free_blocks(old_spilled);
+}
+
+double core_runtime_autodiff_step(void) {
+    double loss = core_runtime_autodiff_backward();
+    core_runtime_adam_update();
+    core_runtime_autodiff_reset();
+    return loss;
+}
+
+void core_runtime_autodiff_stats(AutodiffStats* stats) {
+    const AutodiffTape* tape = runtime_current()->tape;
+    if (!tape) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = tape->stats;
+    stats->arena_bytes = tape->arena_size;
+}
+
+// --- Prashna ---
+// A request is shared by its future and, until it is answered, the
+// dispatcher; whichever lets go last frees it. Queue, settings and requests
+// are guarded by prashna.lock, except that a done request is only read.
+#define PRASHNA_DEFAULT_BATCH 32
+#define PRASHNA_DEFAULT_WINDOW_MS 2
+#define PRASHNA_MAX_BATCH 4096
+#define PRASHNA_MAX_WINDOW_MS 60000
+
+typedef enum {
+    PRASHNA_QUEUED,
+    PRASHNA_SENT,
+    PRASHNA_DONE,
+} PrashnaState;
+
+struct PrashnaRequest {
+    PrashnaRequest* next; // Queue order
+    char* prompt;
+    char* context;
+    char* answer; // Once done, unless its batch failed
+    char* error;  // Once done, if its batch failed
+    PrashnaState state;
+    int references;
+    struct timespec queued_at;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake; // The dispatcher sleeps here
+    pthread_cond_t done; // Signalled after every batch
+    int configured;
+    int started;
+    size_t batch_size;
+    int window_ms;
+    const PrashnaBackend* backend;
+    int sending;         // A batch is with the backend
+    int waiters;         // Threads blocked in core_runtime_prashna_await
+    PrashnaRequest* head;
+    PrashnaRequest* tail;
+    size_t queued;
+    // The dispatcher's batch, PRASHNA_MAX_BATCH entries each
+    PrashnaRequest** batch;
+    PrashnaQuery* queries;
+    char** answers;
+    PrashnaStats stats;
+} prashna = {.lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER};
+
+static void prashna_sleep_ms(long ms) {
+    struct timespec delay = {ms / 1000, (ms % 1000) * 1000000L};
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+}
+
+static long prashna_env_long(const char* name, long fallback, long min, long max) {
+    const char* text = getenv(name);
+    if (!text || !*text) return fallback;
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (*end != '\0' || value < min || value > max) {
+        fprintf(stderr, "Warning: ignoring %s=%s.\n", name, text);
+        return fallback;
+    }
+    return value;
+}
+
+// The mock answers at once (or after the configured latency), in-process
+static int prashna_mock_batch(void* state, const PrashnaQuery* queries, size_t count, char** answers,
+                              char* error, size_t error_size) {
+    (void)state;
+    long latency = prashna_env_long("PANLANG_PRASHNA_MOCK_LATENCY_MS", 0, 0, PRASHNA_MAX_WINDOW_MS);
+    if (latency > 0) prashna_sleep_ms(latency);
+    for (size_t i = 0; i < count; i++) {
+        size_t length = strlen(queries[i].prompt) + strlen(queries[i].context) + 16;
+        answers[i] = (char*)core_runtime_alloc(MEMORY_RUNTIME, length);
+        if (!answers[i]) {
+            snprintf(error, error_size, "out of memory");
+            return 0;
+        }
+        if (queries[i].context[0]) {
+            snprintf(answers[i], length, "[mock] %s | %s", queries[i].prompt, queries[i].context);
+        } else {
+            snprintf(answers[i], length, "[mock] %s", queries[i].prompt);
+        }
+    }
+    return 1;
+}
+
+static const PrashnaBackend prashna_mock_backend = {"mock", prashna_mock_batch, NULL};
+
+// The command backend: one child process, started on the first batch and
+// again after it fails
+typedef struct {
+    pid_t pid; // 0 when not running
+    int input; // The child's stdin
+    FILE* output;
+} PrashnaCommand;
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} PrashnaText;
+
+static int prashna_text_append(PrashnaText* text, const char* data, size_t length) {
+    if (text->length + length + 1 > text->capacity) {
+        size_t capacity = text->capacity ? text->capacity : 256;
+        while (capacity < text->length + length + 1) capacity *= 2;
+        char* grown = (char*)core_runtime_realloc(MEMORY_RUNTIME, text->data, capacity);
+        if (!grown) return 0;
+        text->data = grown;
+        text->capacity = capacity;
+    }
+    memcpy(text->data + text->length, data, length);
+    text->length += length;
+    text->data[text->length] = '\0';
+    return 1;
+}
+
+// Appends `s` as a JSON string literal. Bytes from 0x80 up are passed through:
+// the lexer only lets well-formed UTF-8 into string literals.
+static int prashna_json_append_string(PrashnaText* text, const char* s) {
+    int ok = prashna_text_append(text, "\"", 1);
+    for (; ok && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        char escape[8];
+        if (c == '"' || c == '\\') {
+            escape[0] = '\\';
+            escape[1] = (char)c;
+            ok = prashna_text_append(text, escape, 2);
+        } else if (c == '\n') {
+            ok = prashna_text_append(text, "\\n", 2);
+        } else if (c == '\t') {
+            ok = prashna_text_append(text, "\\t", 2);
+        } else if (c < 0x20) {
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            ok = prashna_text_append(text, escape, 6);
+        } else {
+            ok = prashna_text_append(text, s, 1);
+        }
+    }
+    return ok && prashna_text_append(text, "\"", 1);
+}
+
+static const char* prashna_json_skip_space(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    return p;
+}
+
+static int prashna_json_hex4(const char* p, unsigned int* value) {
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        unsigned int digit;
+        if (c >= '0' && c <= '9') digit = (unsigned int)(c - '0');
+        else if (c >= 'a' && c <= 'f') digit = (unsigned int)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') digit = (unsigned int)(c - 'A' + 10);
+        else return 0;
+        *value = *value * 16 + digit;
+    }
+    return 1;
+}
+
+// Parses the JSON string literal at *p, advancing *p past it. Returns the
+// decoded string (UTF-8), or NULL if it is malformed or memory ran out.
+static char* prashna_json_parse_string(const char** p) {
+    const char* s = *p;
+    if (*s++ != '"') return NULL;
+    PrashnaText text = {NULL, 0, 0};
+    if (!prashna_text_append(&text, "", 0)) return NULL;
+    while (*s != '"') {
+        char bytes[4];
+        size_t length = 1;
+        if ((unsigned char)*s < 0x20) goto malformed; // Includes the terminating NUL
+        if (*s != '\\') {
+            bytes[0] = *s++;
+        } else {
+            s++;
+            switch (*s++) {
+                case '"': bytes[0] = '"'; break;
+                case '\\': bytes[0] = '\\'; break;
+                case '/': bytes[0] = '/'; break;
+                case 'b': bytes[0] = '\b'; break;
+                case 'f': bytes[0] = '\f'; break;
+                case 'n': bytes[0] = '\n'; break;
+                case 'r': bytes[0] = '\r'; break;
+                case 't': bytes[0] = '\t'; break;
+                case 'u': {
+                    unsigned int code, low;
+                    if (!prashna_json_hex4(s, &code)) goto malformed;
+                    s += 4;
+                    if (code >= 0xD800 && code <= 0xDBFF) { // A surrogate pair
+                        if (s[0] != '\\' || s[1] != 'u' || !prashna_json_hex4(s + 2, &low) ||
+                            low < 0xDC00 || low > 0xDFFF) {
+                            goto malformed;
+                        }
+                        s += 6;
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                        goto malformed;
+                    }
+                    if (code == 0) goto malformed; // Strings are NUL-terminated
+                    if (code < 0x80) {
+                        bytes[0] = (char)code;
+                    } else if (code < 0x800) {
+                        bytes[0] = (char)(0xC0 | code >> 6);
+                        bytes[1] = (char)(0x80 | (code & 0x3F));
+                        length = 2;
+                    } else if (code < 0x10000) {
+                        bytes[0] = (char)(0xE0 | code >> 12);
+                        bytes[1] = (char)(0x80 | (code >> 6 & 0x3F));
+                        bytes[2] = (char)(0x80 | (code & 0x3F));
+                        length = 3;
+                    } else {
+                        bytes[0] = (char)(0xF0 | code >> 18);
+                        bytes[1] = (char)(0x80 | (code >> 12 & 0x3F));
+                        bytes[2] = (char)(0x80 | (code >> 6 & 0x3F));
+                        bytes[3] = (char)(0x80 | (code & 0x3F));
+                        length = 4;
+                    }
+                    break;
+                }
+                default:
+                    goto malformed;
+            }
+        }
+        if (!prashna_text_append(&text, bytes, length)) goto malformed;
+    }
+    *p = s + 1;
+    return text.data;
+malformed:
+    core_runtime_free(text.data);
+    return NULL;
+}
+
+static void prashna_command_stop(PrashnaCommand* command) {
+    if (command->pid == 0) return;
+    close(command->input);
+    fclose(command->output);
+    waitpid(command->pid, NULL, 0);
+    command->pid = 0;
+}
+
+static int prashna_command_start(PrashnaCommand* command, char* error, size_t error_size) {
+    const char* line = getenv("PANLANG_PRASHNA_COMMAND");
+    int to_child[2], from_child[2];
+    if (pipe(to_child) != 0) {
+        snprintf(error, error_size, "cannot create a pipe: %s", strerror(errno));
+        return 0;
+    }
+    if (pipe(from_child) != 0) {
+        snprintf(error, error_size, "cannot create a pipe: %s", strerror(errno));
+        close(to_child[0]);
+        close(to_child[1]);
+        return 0;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(to_child[0], STDIN_FILENO);
+        dup2(from_child[1], STDOUT_FILENO);
+        close(to_child[0]);
+        close(to_child[1]);
+        close(from_child[0]);
+        close(from_child[1]);
+        execl("/bin/sh", "sh", "-c", line, (char*)NULL);
+        _exit(127);
+    }
+    close(to_child[0]);
+    close(from_child[1]);
+    if (pid < 0) {
+        snprintf(error, error_size, "cannot start '%s': %s", line, strerror(errno));
+        close(to_child[1]);
+        close(from_child[0]);
+        return 0;
+    }
+    // Children started later (the next backend, `panlang build`'s compiler) must not hold the pipes open
+    fcntl(to_child[1], F_SETFD, FD_CLOEXEC);
+    fcntl(from_child[0], F_SETFD, FD_CLOEXEC);
+    command->pid = pid;
+    command->input = to_child[1];
+    command->output = fdopen(from_child[0], "r");
+    if (!command->output) {
+        close(from_child[0]);
+        command->output = NULL;
+        close(command->input);
+        waitpid(pid, NULL, 0);
+        command->pid = 0;
+        snprintf(error, error_size, "cannot read from '%s'", line);
+        return 0;
+    }
+    return 1;
+}
+
+// Reads a reply line: a JSON array of `count` strings
+static int prashna_command_parse(const char* line, size_t count, char** answers, char* error, size_t error_size) {
+    const char* p = prashna_json_skip_space(line);
+    if (*p != '[') {
+        snprintf(error, error_size, "the backend replied '%.200s'", line);
+        return 0;
+    }
+    p = prashna_json_skip_space(p + 1);
+    size_t n = 0;
+    if (*p == ']') {
+        p++;
+    } else {
+        while (1) {
+            if (n == count) {
+                snprintf(error, error_size, "the backend sent more answers than the %zu queries in the batch", count);
+                return 0;
+            }
+            answers[n] = prashna_json_parse_string(&p);
+            if (!answers[n]) {
+                snprintf(error, error_size, "the backend sent a malformed answer");
+                return 0;
+            }
+            n++;
+            p = prashna_json_skip_space(p);
+            if (*p == ']') {
+                p++;
+                break;
+            }
+            if (*p++ != ',') {
+                snprintf(error, error_size, "the backend sent a malformed reply");
+                return 0;
+            }
+            p = prashna_json_skip_space(p);
+        }
+    }
+    if (*prashna_json_skip_space(p) != '\0') {
+        snprintf(error, error_size, "the backend sent a malformed reply");
+        return 0;
+    }
+    if (n != count) {
+        snprintf(error, error_size, "the backend answered %zu of the %zu queries in the batch", n, count);
+        return 0;
+    }
+    return 1;
+}
+
+static int prashna_command_batch(void* state, const PrashnaQuery* queries, size_t count, char** answers,
+                                 char* error, size_t error_size) {
+    PrashnaCommand* command = (PrashnaCommand*)state;
+    if (command->pid == 0 && !prashna_command_start(command, error, error_size)) return 0;
+
+    PrashnaText request = {NULL, 0, 0};
+    int ok = prashna_text_append(&request, "[", 1);
+    for (size_t i = 0; ok && i < count; i++) {
+        ok = prashna_text_append(&request, i ? ",{\"prompt\":" : "{\"prompt\":", i ? 11 : 10) &&
+             prashna_json_append_string(&request, queries[i].prompt) &&
+             prashna_text_append(&request, ",\"context\":", 11) &&
+             prashna_json_append_string(&request, queries[i].context) &&
+             prashna_text_append(&request, "}", 1);
+    }
+    ok = ok && prashna_text_append(&request, "]\n", 2);
+    if (!ok) {
+        core_runtime_free(request.data);
+        snprintf(error, error_size, "out of memory");
+        return 0;
+    }
+    // The dispatcher blocks SIGPIPE, so a backend that died shows up as EPIPE here
+    for (size_t written = 0; written < request.length;) {
+        ssize_t n = write(command->input, request.data + written, request.length - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            snprintf(error, error_size, "cannot write to the backend: %s", strerror(errno));
+            core_runtime_free(request.data);
+            prashna_command_stop(command);
+            return 0;
+        }
+        written += (size_t)n;
+    }
+    core_runtime_free(request.data);
+
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length = getline(&line, &capacity, command->output);
+    if (length < 0) {
+        free(line);
+        snprintf(error, error_size, "the backend exited without answering");
+        prashna_command_stop(command);
+        return 0;
+    }
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) line[--length] = '\0';
+    ok = prashna_command_parse(line, count, answers, error, error_size);
+    free(line);
+    if (!ok) prashna_command_stop(command); // It may be out of step with the queries now
+    return ok;
+}
+
+static PrashnaCommand prashna_command_state = {0, -1, NULL};
+static const PrashnaBackend prashna_command_backend = {"command", prashna_command_batch, &prashna_command_state};
+
+static const PrashnaBackend* prashna_default_backend(void) {
+    const char* command = getenv("PANLANG_PRASHNA_COMMAND");
+    return command && *command ? &prashna_command_backend : &prashna_mock_backend;
+}
+
+// With the lock held
+static void prashna_configure(void) {
+    if (prashna.configured) return;
+    prashna.batch_size = (size_t)prashna_env_long("PANLANG_PRASHNA_BATCH", PRASHNA_DEFAULT_BATCH, 1, PRASHNA_MAX_BATCH);
+    prashna.window_ms = (int)prashna_env_long("PANLANG_PRASHNA_WINDOW_MS", PRASHNA_DEFAULT_WINDOW_MS, 0,
+                                              PRASHNA_MAX_WINDOW_MS);
+    if (!prashna.backend) prashna.backend = prashna_default_backend();
+    prashna.configured = 1;
+}
+
+static void prashna_request_free(PrashnaRequest* request) {
+    core_runtime_free(request->prompt);
+    core_runtime_free(request->context);
+    core_runtime_free(request->answer);
+    core_runtime_free(request->error);
+    core_runtime_free(request);
+}
+
+// Called when a future is freed
+static void prashna_request_release(PrashnaRequest* request) {
+    pthread_mutex_lock(&prashna.lock);
+    int last = --request->references == 0;
+    pthread_mutex_unlock(&prashna.lock);
+    if (last) prashna_request_free(request);
+}
+
+static void* prashna_dispatch_main(void* unused) {
+    (void)unused;
+    pthread_mutex_lock(&prashna.lock);
+    while (1) {
+        while (!prashna.head) pthread_cond_wait(&prashna.wake, &prashna.lock);
+        // Give the batch its window to fill up, unless someone is waiting
+        struct timespec deadline = prashna.head->queued_at;
+        deadline.tv_sec += prashna.window_ms / 1000;
+        deadline.tv_nsec += (long)(prashna.window_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (prashna.queued < prashna.batch_size && prashna.waiters == 0 &&
+               pthread_cond_timedwait(&prashna.wake, &prashna.lock, &deadline) == 0) {
+        }
+
+        size_t count = prashna.queued < prashna.batch_size ? prashna.queued : prashna.batch_size;
+        for (size_t i = 0; i < count; i++) {
+            PrashnaRequest* request = prashna.head;
+            prashna.head = request->next;
+            request->state = PRASHNA_SENT;
+            prashna.batch[i] = request;
+            prashna.queries[i] = (PrashnaQuery){request->prompt, request->context};
+            prashna.answers[i] = NULL;
+        }
+        if (!prashna.head) prashna.tail = NULL;
+        prashna.queued -= count;
+        const PrashnaBackend* backend = prashna.backend;
+        prashna.sending = 1;
+        pthread_mutex_unlock(&prashna.lock);
+
+        char error[RUNTIME_ERROR_SIZE] = "the backend failed";
+        int ok = backend->batch(backend->state, prashna.queries, count, prashna.answers, error, sizeof(error));
+
+        pthread_mutex_lock(&prashna.lock);
+        for (size_t i = 0; i < count; i++) {
+            PrashnaRequest* request = prashna.batch[i];
+            if (ok) {
+                request->answer = prashna.answers[i];
+            } else {
+                core_runtime_free(prashna.answers[i]);
+                request->error = core_runtime_strndup(MEMORY_RUNTIME, error, strlen(error));
+            }
+            request->state = PRASHNA_DONE;
+            if (--request->references == 0) prashna_request_free(request);
+        }
+        prashna.stats.queries += count;
+        prashna.stats.batches++;
+        if (count > prashna.stats.largest_batch) prashna.stats.largest_batch = count;
+        if (!ok) prashna.stats.failed_batches++;
+        prashna.sending = 0;
+        pthread_cond_broadcast(&prashna.done);
+    }
+    return NULL;
+}
+
+// With the lock held. Signals are blocked on the dispatcher, which keeps
+// SIGPIPE from a dead command backend off the program.
+static int prashna_start(void) {
+    if (prashna.started) return 1;
+    prashna.batch = (PrashnaRequest**)core_runtime_alloc(MEMORY_RUNTIME, sizeof(PrashnaRequest*) * PRASHNA_MAX_BATCH);
+    prashna.queries = (PrashnaQuery*)core_runtime_alloc(MEMORY_RUNTIME, sizeof(PrashnaQuery) * PRASHNA_MAX_BATCH);
+    prashna.answers = (char**)core_runtime_alloc(MEMORY_RUNTIME, sizeof(char*) * PRASHNA_MAX_BATCH);
+    pthread_t thread;
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    int failed = !prashna.batch || !prashna.queries || !prashna.answers ||
+                 pthread_create(&thread, NULL, prashna_dispatch_main, NULL) != 0;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (failed) {
+        core_runtime_free(prashna.batch);
+        core_runtime_free(prashna.queries);
+        core_runtime_free(prashna.answers);
+        return 0;
+    }
+    pthread_detach(thread);
+    prashna.started = 1;
+    return 1;
+}
+
+void core_runtime_prashna_set_backend(const PrashnaBackend* backend) {
+    pthread_mutex_lock(&prashna.lock);
+    while (prashna.sending) pthread_cond_wait(&prashna.done, &prashna.lock);
+    prashna.backend = backend ? backend : prashna_default_backend();
+    pthread_mutex_unlock(&prashna.lock);
+}
+
+void core_runtime_prashna_set_batching(size_t batch_size, int window_ms) {
+    pthread_mutex_lock(&prashna.lock);
+    prashna_configure();
+    prashna.batch_size = batch_size < 1 ? 1 : batch_size > PRASHNA_MAX_BATCH ? PRASHNA_MAX_BATCH : batch_size;
+    prashna.window_ms = window_ms < 0 ? 0 : window_ms > PRASHNA_MAX_WINDOW_MS ? PRASHNA_MAX_WINDOW_MS : window_ms;
+    pthread_cond_signal(&prashna.wake); // A batch may be full now
+    pthread_mutex_unlock(&prashna.lock);
+}
+
+size_t core_runtime_prashna_batch_size(void) {
+    pthread_mutex_lock(&prashna.lock);
+    prashna_configure();
+    size_t batch_size = prashna.batch_size;
+    pthread_mutex_unlock(&prashna.lock);
+    return batch_size;
+}
+
+Value core_runtime_prashna_ask(const char* prompt, size_t prompt_length, const char* context, size_t context_length) {
+    PrashnaRequest* request = (PrashnaRequest*)core_runtime_calloc(MEMORY_RUNTIME, 1, sizeof(PrashnaRequest));
+    HeapFuture* future = (HeapFuture*)core_runtime_alloc(MEMORY_VALUES, sizeof(HeapFuture));
+    if (request) {
+        request->prompt = core_runtime_strndup(MEMORY_RUNTIME, prompt, prompt_length);
+        request->context = core_runtime_strndup(MEMORY_RUNTIME, context, context_length);
+    }
+    if (!request || !future || !request->prompt || !request->context) {
+        if (request) prashna_request_free(request);
+        core_runtime_free(future);
+        core_runtime_panic("Memory allocation failed for prashna query.");
+    }
+    request->state = PRASHNA_QUEUED;
+    request->references = 2;
+    clock_gettime(CLOCK_REALTIME, &request->queued_at);
+
+    pthread_mutex_lock(&prashna.lock);
+    prashna_configure();
+    if (!prashna_start()) {
+        pthread_mutex_unlock(&prashna.lock);
+        prashna_request_free(request);
+        core_runtime_free(future);
+        core_runtime_panic("Runtime Error: Could not start the prashna dispatcher.");
+    }
+    if (prashna.tail) {
+        prashna.tail->next = request;
+    } else {
+        prashna.head = request;
+    }
+    prashna.tail = request;
+    prashna.queued++;
+    // Wake the dispatcher for a new batch, or when the current one is full
+    if (prashna.queued == 1 || prashna.queued >= prashna.batch_size) pthread_cond_signal(&prashna.wake);
+    pthread_mutex_unlock(&prashna.lock);
+
+    future->header.kind = HEAP_FUTURE;
+    future->request = request;
+    value_heap_push(&future->header);
+    return value_from_heap(&future->header);
+}
+
+Value core_runtime_prashna_await(Value future) {
+    PrashnaRequest* request = value_as_future(future)->request;
+    pthread_mutex_lock(&prashna.lock);
+    if (request->state != PRASHNA_DONE) {
+        prashna.waiters++;
+        pthread_cond_signal(&prashna.wake); // Send what is queued without waiting out the window
+        while (request->state != PRASHNA_DONE) pthread_cond_wait(&prashna.done, &prashna.lock);
+        prashna.waiters--;
+    }
+    pthread_mutex_unlock(&prashna.lock);
+    if (request->error) {
+        char message[RUNTIME_ERROR_SIZE];
+        snprintf(message, sizeof(message), "Runtime Error: prashna failed: %s.", request->error);
+        core_runtime_panic(message);
+    }
+    return value_box_string(request->answer, strlen(request->answer));
+}
+
+void core_runtime_prashna_stats(PrashnaStats* stats) {
+    pthread_mutex_lock(&prashna.lock);
+    *stats = prashna.stats;
+    pthread_mutex_unlock(&prashna.lock);
+}
+
+// --- Native functions ---
+// Bindings are made at startup, before any code runs or any pool thread reads
+// the registry, so it needs no lock.
+static NativeBinding* native_bindings = NULL;
+static int native_count = 0;
+static int native_capacity = 0;
+
+static void native_bind_error(const char* name, const char* problem) {
+    char message[200];
+    snprintf(message, sizeof(message), "Bind Error: native function '%s' %s.", name ? name : "", problem);
+    core_runtime_panic(message);
+}
+
+int core_runtime_native_bind(const NativeBinding* binding) {
+    if (!binding->name || !binding->name[0]) native_bind_error(binding->name, "has no name");
+    if (!binding->function) native_bind_error(binding->name, "has no implementation");
+    if (binding->arity < 0 || binding->arity > NATIVE_MAX_ARITY) {
+        native_bind_error(binding->name, "takes more arguments than NATIVE_MAX_ARITY");
+    }
+    for (int i = 0; i < binding->arity; i++) {
+        if ((binding->params[i] & NATIVE_ANY) == 0 || (binding->params[i] & ~NATIVE_ANY) != 0) {
+            native_bind_error(binding->name, "has a parameter of no valid type");
+        }
+    }
+    if (core_runtime_native_lookup(binding->name, strlen(binding->name)) >= 0) {
+        native_bind_error(binding->name, "is already bound");
+    }
+    if (native_count == native_capacity) {
+        native_capacity = native_capacity ? native_capacity * 2 : 32;
+        native_bindings = (NativeBinding*)core_runtime_realloc(MEMORY_RUNTIME, native_bindings, sizeof(NativeBinding) * native_capacity);
+        if (!native_bindings) core_runtime_panic("Memory allocation failed for native functions.");
+    }
+    native_bindings[native_count] = *binding;
+    return native_count++;
+}
+
+void core_runtime_native_bind_table(const NativeBinding* bindings) {
+    for (; bindings->name != NULL; bindings++) {
+        core_runtime_native_bind(bindings);
+    }
+}
+
+int core_runtime_native_lookup(const char* name, size_t length) {
+    for (int i = 0; i < native_count; i++) {
+        if (strncmp(native_bindings[i].name, name, length) == 0 && native_bindings[i].name[length] == '\0') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int core_runtime_native_count(void) {
+    return native_count;
+}
+
+const NativeBinding* core_runtime_natives(void) {
+    return native_bindings;
+}
+
+const char* core_runtime_native_type_name(NativeType type) {
+    switch (type) {
+        case NATIVE_INT: return "an int";
+        case NATIVE_DOUBLE: return "a double";
+        case NATIVE_BOOL: return "a bool";
+        case NATIVE_STRING: return "a string";
+        case NATIVE_TENSOR: return "a tensor";
+        case NATIVE_FUTURE: return "a future";
+        case NATIVE_NUMBER: return "a number";
+        case NATIVE_NUMERIC: return "a number or a tensor";
+        default: return "a value";
+    }
+}
+
+void core_runtime_native_type_error(const NativeBinding* native, int index, Value arg) {
+    char message[200];
+    snprintf(message, sizeof(message), "Type Error: %s expects %s for argument %d, got '%s'.", native->name,
+             core_runtime_native_type_name(native->params[index]), index + 1, value_type_name(value_type(arg)));
+    core_runtime_panic(message);
+}
+
+Value core_runtime_power(Value base, Value exponent) {
+    if (value_is_int(base) && value_is_int(exponent) && !value_int_is_negative(exponent)) {
+        // Exact, through the same int multiplication as `*`. The base is not
+        // squared past the exponent's top bit, so only a result that is itself
+        // too large fails.
+        ValueIntView e, b;
+        value_int_view(exponent, &e);
+        value_int_view(base, &b);
+        if (b.length > 1 || (b.length == 1 && b.limbs[0] > 1)) {
+            // |base| >= 2^bits, so results this long fail at once instead of after the squarings
+            uint64_t bits = (b.length - 1) * 64;
+            for (uint64_t top = b.limbs[b.length - 1]; top > 1; top >>= 1) bits++;
+            uint64_t limit = (uint64_t)64 * VALUE_BIGINT_MAX_LIMBS;
+            if (e.length > 1 || (bits > 0 && e.limbs[0] >= (limit + bits - 1) / bits)) {
+                core_runtime_panic("Runtime Error: Integer is too large.");
+            }
+        }
+        Value result = value_from_small_int(1);
+        Value factor = base;
+        for (size_t i = 0; i < e.length; i++) {
+            uint64_t bits = e.limbs[i];
+            int count = 64;
+            if (i + 1 == e.length) {
+                for (count = 0; count < 64 && bits >> count; count++) {
+                }
+            }
+            for (int k = 0; k < count; k++, bits >>= 1) {
+                if (bits & 1) result = value_mul(result, factor);
+                if (i + 1 < e.length || k + 1 < count) factor = value_mul(factor, factor);
+            }
+        }
+        return result;
+    }
+    return value_from_double(pow(value_number_as_double(base), value_number_as_double(exponent)));
+}
+
+// Sankhya.* from panlang-stdlib/sankhya.pan, with the same results
+static Value native_sankhya_yoga(const Value* args) {
+    return value_add(args[0], args[1]);
+}
+
+static Value native_sankhya_viyaga(const Value* args) {
+    return value_sub(args[0], args[1]);
+}
+
+static Value native_sankhya_guna(const Value* args) {
+    return value_mul(args[0], args[1]);
+}
+
+// Division by zero prints the library's message and returns 0 instead of failing
+static Value native_sankhya_bhaga(const Value* args) {
+    if (value_number_as_double(args[1]) == 0.0) {
+        core_runtime_print_string("त्रुटि: शून्य से विभाजन संभव नहीं है। (Error: Division by zero is not allowed.)");
+        return value_from_small_int(0);
+    }
+    return value_div(args[0], args[1]);
+}
+
+static Value native_sankhya_shakti(const Value* args) {
+    return core_runtime_power(args[0], args[1]);
+}
+
+static const NativeBinding native_stdlib[] = {
+    {"Sankhya.yoga", 2, {NATIVE_NUMBER, NATIVE_NUMBER}, native_sankhya_yoga},
+    {"Sankhya.viyaga", 2, {NATIVE_NUMBER, NATIVE_NUMBER}, native_sankhya_viyaga},
+    {"Sankhya.guna", 2, {NATIVE_NUMBER, NATIVE_NUMBER}, native_sankhya_guna},
+    {"Sankhya.bhaga", 2, {NATIVE_NUMBER, NATIVE_NUMBER}, native_sankhya_bhaga},
+    {"Sankhya.shakti", 2, {NATIVE_NUMBER, NATIVE_NUMBER}, native_sankhya_shakti},
+    {NULL, 0, {0}, NULL}
+};
+
+void core_runtime_native_bind_stdlib(void) {
+    core_runtime_native_bind_table(native_stdlib);
 }
 
 // --- Other conceptual runtime functions ---
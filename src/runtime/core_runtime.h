@@ -0,0 +1,443 @@
+// panlang/src/runtime/core_runtime.h
+// Declarations for the PanLang core runtime (linked into compiled and JIT-ed programs)
+
+#ifndef PANLANG_CORE_RUNTIME_H
+#define PANLANG_CORE_RUNTIME_H
+
+#include <setjmp.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "value.h"
+
+void core_runtime_print_string(const char* str);
+void core_runtime_print_int(int val);
+void core_runtime_print_int64(int64_t val);
+void core_runtime_print_double(double val);
+void core_runtime_print_bool(int val);
+int core_runtime_add_int(int a, int b);
+
+// Writes the shortest decimal form of `val` that reads back exactly. Integral
+// values keep a trailing ".0" so they never print like ints. Exponent form is
+// used only below 1e-4 and from 1e16 up.
+void core_runtime_format_double(double val, char* buffer, size_t size);
+
+// --- Memory ---
+// Every heap block the engine and the runtime allocate goes through these
+// wrappers, tagged with the subsystem that owns it. Blocks carry a 16-byte
+// header with their size and tag, so core_runtime_free and realloc need no
+// tag. While tracking is on (core_runtime_memory_track) each tag counts its
+// allocations, bytes, live bytes and peak; while it is off the wrappers only
+// add the header. Blocks allocated while tracking was off are never counted.
+typedef enum {
+    MEMORY_SOURCE,    // Script text read for the lexer
+    MEMORY_PARSER,    // Parser scratch space
+    MEMORY_AST,       // Arenas holding parsed code
+    MEMORY_SYMBOLS,   // Symbol tables and interned names
+    MEMORY_OPTIMIZER,
+    MEMORY_BYTECODE,  // Compiled bytecode and VM stacks
+    MEMORY_MODULES,   // Module registry and paths
+    MEMORY_PROFILER,
+    MEMORY_CODEGEN,   // C and LLVM backends
+    MEMORY_VALUES,    // Heap values: boxed ints, strings, tensors
+    MEMORY_AUTODIFF,  // Autodiff tapes and parameter gradients
+    MEMORY_RUNTIME,   // Output buffers, thread pool, native registry
+    MEMORY_TAG_COUNT
+} MemoryTag;
+
+typedef struct {
+    size_t allocations; // Blocks allocated; a realloc frees one and allocates one
+    size_t frees;
+    size_t bytes;       // Bytes requested, over all allocations
+    size_t live;        // Bytes allocated and not freed yet
+    size_t peak;        // Highest `live` since the last core_runtime_memory_reset_peaks
+} MemoryStats;
+
+void core_runtime_memory_track(int enabled);
+int core_runtime_memory_tracking(void);
+const char* core_runtime_memory_tag_name(MemoryTag tag);
+// Fills stats[MEMORY_TAG_COUNT] with each tag's counters and `total` with all
+// tags' together; either may be NULL
+void core_runtime_memory_stats(MemoryStats* stats, MemoryStats* total);
+// Restarts every peak at the current live bytes
+void core_runtime_memory_reset_peaks(void);
+
+void* core_runtime_alloc(MemoryTag tag, size_t size);
+void* core_runtime_calloc(MemoryTag tag, size_t count, size_t size);
+// `tag` only applies when `ptr` is NULL; blocks keep the tag they were allocated with
+void* core_runtime_realloc(MemoryTag tag, void* ptr, size_t size);
+// `alignment` is a power of two; the block must not be passed to core_runtime_realloc
+void* core_runtime_aligned_alloc(MemoryTag tag, size_t alignment, size_t size);
+char* core_runtime_strndup(MemoryTag tag, const char* text, size_t length);
+void core_runtime_free(void* ptr);
+
+// --- Output ---
+// The print functions above write to a buffer per thread rather than to
+// stdio. It goes to the current sink when it fills, on
+// core_runtime_output_flush, and at exit. Sinks: stdout (the default), a
+// file, memory (for embedding), or any OutputWrite callback. A context (see
+// below) may have a sink of its own instead of the process-wide one set here.
+
+// Receives buffered output; calls are serialized
+typedef void (*OutputWrite)(void* context, const char* data, size_t length);
+
+void core_runtime_output_write(const char* data, size_t length);
+// Passes on everything the calling thread has printed so far
+void core_runtime_output_flush(void);
+// 0 passes each line on as soon as it is printed (interactive use). The
+// default is buffered, except for stdout when it is a terminal.
+void core_runtime_set_output_buffered(int buffered);
+// Each switch flushes the calling thread's pending output to the old sink
+void core_runtime_output_stdout(void);
+// Truncates or creates `path`; returns -1 (with errno set) if it cannot be opened
+int core_runtime_output_file(const char* path);
+// Collects output in memory, starting empty
+void core_runtime_output_memory(void);
+// Everything collected by the memory sink, NUL-terminated
+const char* core_runtime_output_memory_contents(size_t* length);
+void core_runtime_output_sink(OutputWrite write, void* context);
+
+// --- Errors ---
+// core_runtime_panic reports a fatal error. By default it prints the message
+// on stderr and terminates the program. A thread that sets a trap gets the
+// message back instead: the panic stores it in the innermost trap, removes
+// that trap and longjmps to it.
+//
+//   RuntimeTrap trap;
+//   core_runtime_trap_push(&trap);
+//   if (setjmp(trap.jump) == 0) {
+//       ... code that may panic ...
+//       core_runtime_trap_pop(&trap);
+//   } else {
+//       ... failed with trap.message; the trap is already removed ...
+//   }
+//
+// Traps belong to a thread: a panic on a pool thread (see below) only lands in
+// a trap that thread set itself.
+#define RUNTIME_ERROR_SIZE 512
+
+typedef struct RuntimeTrap {
+    jmp_buf jump;
+    char message[RUNTIME_ERROR_SIZE];
+    struct RuntimeTrap* previous;
+} RuntimeTrap;
+
+void core_runtime_trap_push(RuntimeTrap* trap);
+// Removes `trap`, which must be the calling thread's innermost trap
+void core_runtime_trap_pop(RuntimeTrap* trap);
+// Flushes output, then reports `message` to the innermost trap or exits
+_Noreturn void core_runtime_panic(const char* message);
+
+// --- Contexts ---
+// What running a script changes in the runtime: the heap its values are
+// allocated on, where its output goes and the Matrix.random generator. Each
+// thread works on one context at a time, the process-wide default until it
+// enters another, so scripts on separate contexts can run on separate
+// threads at once without sharing anything they write. Still process-wide:
+// the native registry (bind everything before starting threads), the output
+// buffering mode and the thread pool's settings. The pool runs one loop at a
+// time; a loop that finds it busy with another context's loop runs on the
+// calling thread instead of waiting.
+typedef struct AutodiffTape AutodiffTape;
+
+typedef struct {
+    _Atomic(HeapObject*) heap; // Runtime-owned objects, see value_heap_release
+    atomic_size_t heap_objects;
+    OutputWrite output;        // NULL: the process-wide sink
+    void* output_context;
+    uint64_t random_state;     // Matrix.random
+    AutodiffTape* tape;        // Created on first use, see Autodiff below
+} RuntimeContext;
+
+void core_runtime_context_init(RuntimeContext* context);
+// Frees every object on the context's heap and its autodiff tape. It must not
+// be entered by any thread.
+void core_runtime_context_free(RuntimeContext* context);
+// Makes `context` (NULL: the default) the calling thread's and returns the
+// previous one. Output printed so far goes to the previous context's sink.
+RuntimeContext* core_runtime_context_enter(RuntimeContext* context);
+
+// --- Parallel scheduler ---
+// A work-stealing thread pool for data-parallel loops. Tensor kernels use it
+// once their input is large enough to pay for the hand-off.
+//
+// Thread count: core_runtime_set_threads, else $PANLANG_THREADS, else the
+// number of online CPUs. 1 runs every loop on the calling thread.
+// Deterministic mode (core_runtime_set_deterministic or
+// $PANLANG_DETERMINISTIC=1): reductions use fixed-size chunks combined in
+// order, so floating-point results are identical for any thread count.
+// Otherwise the chunks scale with the thread count; results are still
+// repeatable from run to run with the same thread count.
+
+// Handles iterations [begin, end) of a loop
+typedef void (*ParallelBody)(void* context, size_t begin, size_t end);
+// Reduces iterations [begin, end) to one value
+typedef double (*ParallelReduceBody)(void* context, size_t begin, size_t end);
+typedef double (*ParallelCombine)(double a, double b);
+
+// Sets the thread count, including the calling thread; 0 restores the default
+void core_runtime_set_threads(int threads);
+int core_runtime_threads(void);
+void core_runtime_set_deterministic(int deterministic);
+int core_runtime_deterministic(void);
+// Calls body over [0, n) in ranges of at most `grain` iterations (except when
+// the loop runs serially: n <= grain, one thread, or a call from inside a
+// body) and returns once every range is done. Bodies run concurrently, so
+// they must only write disjoint data and must not panic; allocating Values
+// is safe, on the caller's context.
+void core_runtime_parallel_for(size_t n, size_t grain, ParallelBody body, void* context);
+// Splits [0, n) into chunks of at least `grain` iterations, reduces them in
+// parallel and folds the partial results left to right with `combine`.
+double core_runtime_parallel_reduce(size_t n, size_t grain, ParallelReduceBody body, ParallelCombine combine,
+                                    void* context);
+
+// --- Tensors ---
+// Kernels are vectorized with AVX2 or SSE2 when the runtime is compiled for
+// them (e.g. -mavx2 -mfma or -march=native) and fall back to scalar loops.
+// Elementwise and reduction results do not depend on the kernel set; matmul
+// and Adam updates may differ in the last bit when FMA is available. Large inputs are split
+// across the parallel scheduler, which only changes results for sums (see
+// deterministic mode above).
+
+// Name of the kernel set compiled in: "avx2", "sse2" or "scalar"
+const char* core_runtime_tensor_kernels(void);
+// Zero-filled rows x cols tensor on the value heap (freed by value_heap_release)
+HeapTensor* core_runtime_tensor_new(size_t rows, size_t cols);
+HeapTensor* core_runtime_tensor_fill(size_t rows, size_t cols, double value);
+// The 1 x n vector start, start + 1, ..., start + n - 1
+HeapTensor* core_runtime_tensor_range(double start, size_t n);
+// Uniform samples in [-1, 1) from the context's fixed-seed generator, so runs are reproducible
+HeapTensor* core_runtime_tensor_random(size_t rows, size_t cols);
+// Matrix product; requires a->cols == b->rows
+HeapTensor* core_runtime_tensor_matmul(const HeapTensor* a, const HeapTensor* b);
+HeapTensor* core_runtime_tensor_transpose(const HeapTensor* a);
+// Elementwise `a op b` with broadcasting: each dimension must match or be 1.
+// Division follows IEEE 754 (x / 0 is inf or nan) rather than raising.
+// Returns VALUE_ERROR_SHAPE, leaving *out untouched, if the shapes do not broadcast.
+ValueStatus core_runtime_tensor_binary(ValueOp op, const HeapTensor* a, const HeapTensor* b, HeapTensor** out);
+// Reductions over every element. max and min ignore NaN elements.
+double core_runtime_tensor_sum(const HeapTensor* t);
+double core_runtime_tensor_max(const HeapTensor* t);
+double core_runtime_tensor_min(const HeapTensor* t);
+// Prints the tensor as nested rows, e.g. [[1.0, 2.0], [3.0, 4.0]]
+void core_runtime_print_tensor(const HeapTensor* t);
+
+// --- Activations ---
+// Vectorized elementwise functions. The kernel set is chosen for the host CPU
+// on first use; see core_runtime.c for the error bounds of each function.
+typedef enum {
+    ACTIVATION_EXP,
+    ACTIVATION_RELU,
+    ACTIVATION_SIGMOID,
+    ACTIVATION_TANH,
+    ACTIVATION_COUNT
+} Activation;
+
+// Name of the kernel set in use: "avx2", "sse2" or "scalar"
+const char* core_runtime_activation_kernels(void);
+// out[i] = f(x[i]) for i < n; `out` may be `x`
+void core_runtime_activation(Activation activation, const double* x, double* out, size_t n);
+HeapTensor* core_runtime_tensor_activation(Activation activation, const HeapTensor* t);
+// Softmax of each row
+HeapTensor* core_runtime_tensor_softmax(const HeapTensor* t);
+
+// --- Autodiff ---
+// Reverse-mode differentiation for training. core_runtime_autodiff_param
+// makes a tensor trainable. From then on, every tensor operation with a
+// trainable input, or an input computed from one, is recorded on the
+// context's tape as it runs: + - * / (with broadcasting), matmul, transpose,
+// the activations, softmax and core_runtime_tensor_affine. Reductions return
+// plain numbers, which carry no gradient. Losses end a forward pass, and
+// backward walks the tape once from them into every parameter's gradient.
+//
+// The tape records operations, gradients and kernel scratch space in one
+// contiguous arena that is rewound, not freed, after each step. A step that
+// outgrows it finishes in extra blocks, and the arena is then reallocated
+// once to hold the whole step, so a training loop whose steps keep the same
+// shapes stops allocating after its first step. Results stay ordinary tensors
+// on the value heap; value_heap_collect keeps those the current step still
+// needs and copies the records a root or a loss still reaches into a fresh
+// arena, so forward passes that never reach a loss do not grow the tape.
+// A tensor computed in an earlier step is a constant in later ones.
+//
+// Backward fuses a dense layer, act(x W + b), into one kernel: the gradient
+// through the activation and the bias gradient are computed in one pass over
+// the rows, then feed the weight and input gradients directly. This applies
+// to core_runtime_tensor_affine and to matmul followed by a row-vector `+`,
+// with or without an activation, when nothing else used the intermediates.
+
+// Makes `t` trainable; its gradient and Adam moments are zero to begin with.
+// `t` must not have been computed from a trainable tensor this step.
+void core_runtime_autodiff_param(HeapTensor* t);
+// x W + b, with `b` one row broadcast over x's rows, in one pass. Requires
+// x->cols == w->rows, b->rows == 1 and b->cols == w->cols.
+HeapTensor* core_runtime_tensor_affine(const HeapTensor* x, const HeapTensor* w, const HeapTensor* b);
+// Losses. Both require tensors of the same shape; the losses of one step add up.
+// Mean squared error over every element
+double core_runtime_tensor_mse(const HeapTensor* prediction, const HeapTensor* target);
+// Mean over rows of the cross-entropy between softmax(logits) and the label
+// distribution in each row of `labels` (usually one-hot), which must be a
+// constant: labels computed from a trainable tensor are a runtime error
+double core_runtime_tensor_cross_entropy(const HeapTensor* logits, const HeapTensor* labels);
+
+typedef struct {
+    double learning_rate; // 0.001
+    double beta1;         // 0.9
+    double beta2;         // 0.999
+    double epsilon;       // 1e-8
+} AdamSettings;
+
+void core_runtime_adam_configure(const AdamSettings* settings);
+void core_runtime_adam_settings(AdamSettings* settings);
+// Backpropagates from the losses recorded this step and adds the result to
+// the gradient of every parameter they depend on. Returns the total loss; a
+// step without a loss is a runtime error.
+double core_runtime_autodiff_backward(void);
+// Applies one Adam update to each parameter used this step, in one pass over
+// its data, gradient and moments, and clears its gradient
+void core_runtime_adam_update(void);
+// Ends the step: forgets what was recorded and rewinds the arena. Gradients
+// not yet applied carry over into the next step.
+void core_runtime_autodiff_reset(void);
+// Backward, Adam update and reset; returns the loss
+double core_runtime_autodiff_step(void);
+// The gradient of a trainable tensor (size elements), or NULL
+const double* core_runtime_autodiff_grad(const HeapTensor* t);
+
+typedef struct {
+    size_t steps;        // Steps ended so far
+    size_t nodes;        // Operations recorded in the last step
+    size_t arena_bytes;  // Capacity of the arena
+    size_t arena_peak;   // Most bytes one step used
+    size_t arena_growths; // Times a step outgrew the arena
+} AutodiffStats;
+
+void core_runtime_autodiff_stats(AutodiffStats* stats);
+
+// --- Prashna ---
+// `prashna` queries to a language model run asynchronously. Asking queues the
+// query and returns a future at once, so a program can ask many questions
+// before it waits for the first answer. A dispatcher thread gathers queued
+// queries into batches of up to `batch_size`, waiting at most `window_ms`
+// after the first one for a batch to fill, and sends each batch to the
+// backend in one call. Awaiting a query that is still queued sends its batch
+// without waiting out the window. The dispatcher, its settings and the
+// backend are process-wide, like the thread pool; futures belong to the value
+// heap of the context that asked.
+//
+// Defaults come from the environment: $PANLANG_PRASHNA_BATCH (32),
+// $PANLANG_PRASHNA_WINDOW_MS (2) and the backend. With
+// $PANLANG_PRASHNA_COMMAND set, that command is started once and gets each
+// batch on its stdin as one line, a JSON array of {"prompt", "context"}
+// objects; it replies on stdout with one line, a JSON array of answer
+// strings in the same order. Otherwise an in-process mock answers
+// "[mock] <prompt>" (and " | <context>" when there is one), after sleeping
+// $PANLANG_PRASHNA_MOCK_LATENCY_MS per batch.
+typedef struct {
+    const char* prompt;
+    const char* context; // "" when the query has none
+} PrashnaQuery;
+
+// Answers queries[0, count) on the dispatcher thread. Stores each answer in
+// answers[i] as a NUL-terminated string from core_runtime_alloc (the runtime
+// frees it), or fails the whole batch by returning 0 with a message in
+// `error`; answers stored before a failure are freed by the runtime.
+typedef int (*PrashnaBatchFunction)(void* state, const PrashnaQuery* queries, size_t count, char** answers,
+                                    char* error, size_t error_size);
+
+typedef struct {
+    const char* name;
+    PrashnaBatchFunction batch;
+    void* state;
+} PrashnaBackend;
+
+typedef struct {
+    size_t queries; // Sent to the backend so far
+    size_t batches;
+    size_t largest_batch;
+    size_t failed_batches;
+} PrashnaStats;
+
+// Replaces the backend (NULL: the one the environment selects). A batch
+// already being sent finishes on the old backend first. `backend` must
+// outlive its use.
+void core_runtime_prashna_set_backend(const PrashnaBackend* backend);
+// Sets the largest batch (at least 1) and the time window in milliseconds
+void core_runtime_prashna_set_batching(size_t batch_size, int window_ms);
+size_t core_runtime_prashna_batch_size(void);
+// Queues a query and returns its future, on the value heap. The texts are
+// copied, so they need not be NUL-terminated.
+Value core_runtime_prashna_ask(const char* prompt, size_t prompt_length, const char* context, size_t context_length);
+// Waits for the answer and returns it as a string on the value heap. A
+// failed batch is reported through core_runtime_panic.
+Value core_runtime_prashna_await(Value future);
+void core_runtime_prashna_stats(PrashnaStats* stats);
+
+// --- Native functions ---
+// A registry of C functions that PanLang code calls by name, e.g.
+// `Sankhya.shakti(2, 10)`. A binding declares its arity and the types each
+// parameter accepts, and both are validated when it is bound. The front end
+// resolves a call site to its binding index once, when the call is parsed,
+// and may prove there that the arguments have the declared types; other calls
+// go through core_runtime_native_call, which checks them first. Either way the
+// implementation reads its arguments without checking their types again, and
+// no interpreter frame is created: it runs directly on the caller's values.
+#define NATIVE_MAX_ARITY 3
+
+// Sets of value types (masks of 1 << ValueType)
+typedef enum {
+    NATIVE_INT = 1 << VALUE_TYPE_INT,
+    NATIVE_DOUBLE = 1 << VALUE_TYPE_DOUBLE,
+    NATIVE_BOOL = 1 << VALUE_TYPE_BOOL,
+    NATIVE_STRING = 1 << VALUE_TYPE_STRING,
+    NATIVE_TENSOR = 1 << VALUE_TYPE_TENSOR,
+    NATIVE_FUTURE = 1 << VALUE_TYPE_FUTURE,
+    NATIVE_NUMBER = NATIVE_INT | NATIVE_DOUBLE,
+    NATIVE_NUMERIC = NATIVE_NUMBER | NATIVE_TENSOR,
+    NATIVE_ANY = NATIVE_NUMERIC | NATIVE_BOOL | NATIVE_STRING | NATIVE_FUTURE,
+} NativeType;
+
+// Receives exactly `arity` arguments, each of its parameter's type
+typedef Value (*NativeFunction)(const Value* args);
+
+typedef struct {
+    const char* name; // Must outlive the registry
+    int arity;
+    NativeType params[NATIVE_MAX_ARITY];
+    NativeFunction function;
+} NativeBinding;
+
+// Adds `binding` to the registry and returns its index. A duplicate name, an
+// arity above NATIVE_MAX_ARITY or an empty parameter type is a fatal error.
+int core_runtime_native_bind(const NativeBinding* binding);
+// Binds each entry of a table ending in a NULL name
+void core_runtime_native_bind_table(const NativeBinding* bindings);
+// Binds the standard library's natives: Sankhya.yoga, viyaga, guna, bhaga and shakti
+void core_runtime_native_bind_stdlib(void);
+// Registry index of the native called `name`, or -1
+int core_runtime_native_lookup(const char* name, size_t length);
+int core_runtime_native_count(void);
+// The bindings, in index order; valid until the next bind
+const NativeBinding* core_runtime_natives(void);
+// "a number", "an int", ... for error messages
+const char* core_runtime_native_type_name(NativeType type);
+// Reports that argument `index` (from 0) of `native` has the wrong type and exits
+void core_runtime_native_type_error(const NativeBinding* native, int index, Value arg);
+
+static inline int core_runtime_native_accepts(NativeType type, Value v) {
+    return (type >> value_type(v)) & 1;
+}
+
+// Checks the argument types, then calls the native
+static inline Value core_runtime_native_call(const NativeBinding* native, const Value* args) {
+    for (int i = 0; i < native->arity; i++) {
+        if (!core_runtime_native_accepts(native->params[i], args[i])) core_runtime_native_type_error(native, i, args[i]);
+    }
+    return native->function(args);
+}
+
+// base raised to exponent. An int to a non-negative int power is exact,
+// computed by repeated squaring with `*`; anything else goes through pow().
+Value core_runtime_power(Value base, Value exponent);
+
+#endif // PANLANG_CORE_RUNTIME_H
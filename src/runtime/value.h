@@ -0,0 +1,317 @@
+// panlang/src/runtime/value.h
+// Tagged 8-byte value representation shared by the interpreter, the VM and the runtime
+
+#ifndef PANLANG_VALUE_H
+#define PANLANG_VALUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// A Value is a NaN-boxed 64-bit word. Every bit pattern below VALUE_TAG_INT is
+// a double (NaNs are canonicalised to a single positive quiet NaN, so the
+// negative quiet-NaN space is free); the tags above it carry a 48-bit payload:
+//
+//   0xFFF9 | int48    small integers, sign-extended on access
+//   0xFFFA | 0 or 1   booleans
+//   0xFFFB | pointer  heap objects (integers outside int48, strings, tensors)
+//
+// Integers have arbitrary precision in the language. Values that fit in 48
+// bits never touch the heap, so numeric fast paths work on the word directly
+// and allocate nothing; the rest of int64 is boxed as a HeapInt, and only
+// results that overflow int64 become a HeapBigInt.
+typedef uint64_t Value;
+
+#define VALUE_TAG_INT  0xFFF9000000000000ULL
+#define VALUE_TAG_BOOL 0xFFFA000000000000ULL
+#define VALUE_TAG_HEAP 0xFFFB000000000000ULL
+#define VALUE_TAG_MASK 0xFFFF000000000000ULL
+#define VALUE_PAYLOAD_MASK 0x0000FFFFFFFFFFFFULL
+#define VALUE_CANONICAL_NAN 0x7FF8000000000000ULL
+
+#define VALUE_SMALL_INT_MIN (-((int64_t)1 << 47))
+#define VALUE_SMALL_INT_MAX (((int64_t)1 << 47) - 1)
+
+#define VALUE_FALSE (VALUE_TAG_BOOL | 0)
+#define VALUE_TRUE (VALUE_TAG_BOOL | 1)
+
+typedef enum {
+    VALUE_TYPE_INT,
+    VALUE_TYPE_DOUBLE,
+    VALUE_TYPE_BOOL,
+    VALUE_TYPE_STRING,
+    VALUE_TYPE_TENSOR,
+    VALUE_TYPE_FUTURE,
+} ValueType;
+
+typedef enum {
+    VALUE_OP_ADD,
+    VALUE_OP_SUB,
+    VALUE_OP_MUL,
+    VALUE_OP_DIV,
+} ValueOp;
+
+// Outcome of value_try_arith
+typedef enum {
+    VALUE_OK,
+    VALUE_ERROR_TYPE,        // Operands are not both numbers
+    VALUE_ERROR_DIV_ZERO,
+    VALUE_ERROR_SHAPE,       // Tensor shapes do not broadcast
+    VALUE_ERROR_RANGE,       // Int result longer than VALUE_BIGINT_MAX_LIMBS
+} ValueStatus;
+
+// --- Heap objects ---
+typedef enum {
+    HEAP_INT,
+    HEAP_BIGINT,
+    HEAP_STRING,
+    HEAP_TENSOR,
+    HEAP_FUTURE,
+} HeapKind;
+
+typedef struct HeapObject {
+    struct HeapObject* next; // Runtime-owned objects are chained for value_heap_release
+    HeapKind kind;
+} HeapObject;
+
+typedef struct {
+    HeapObject header;
+    int64_t value;
+} HeapInt;
+
+// An int outside int64, as a sign and a magnitude in 64-bit limbs, least
+// significant first. `limbs[length - 1]` is never zero, and an int that fits
+// in int64 is never a bigint, so equal ints always have the same kind.
+#define VALUE_BIGINT_MAX_LIMBS (1 << 20) // 2^26 bits, about 20 million digits
+
+typedef struct {
+    HeapObject header;
+    int negative;
+    size_t length;
+    uint64_t limbs[];
+} HeapBigInt;
+
+typedef struct {
+    HeapObject header;
+    size_t length;
+    char chars[]; // NUL-terminated
+} HeapString;
+
+// Dense row-major matrix of doubles. Vectors are 1 x n. `data` is contiguous
+// and aligned to VALUE_TENSOR_ALIGNMENT bytes so SIMD kernels can stream it.
+#define VALUE_TENSOR_ALIGNMENT 64
+
+// `param` and `node` are autodiff state (see core_runtime.h): the gradient
+// and optimizer moments of a trainable tensor, and the tape record of the
+// operation that produced it, which is only current while `tape_step` is the
+// tape's step.
+typedef struct AutodiffParam AutodiffParam;
+typedef struct AutodiffNode AutodiffNode;
+
+typedef struct {
+    HeapObject header;
+    size_t rows;
+    size_t cols;
+    size_t size; // rows * cols
+    double* data;
+    AutodiffParam* param;
+    AutodiffNode* node;
+    uint64_t tape_step;
+} HeapTensor;
+
+// The answer to a `prashna` query, which may still be on its way. The
+// request is shared with the runtime's dispatcher (see core_runtime.h).
+typedef struct PrashnaRequest PrashnaRequest;
+
+typedef struct {
+    HeapObject header;
+    PrashnaRequest* request;
+} HeapFuture;
+
+// --- Encoding ---
+static inline int value_is_double(Value v) { return v < VALUE_TAG_INT; }
+static inline int value_is_small_int(Value v) { return (v & VALUE_TAG_MASK) == VALUE_TAG_INT; }
+static inline int value_is_bool(Value v) { return (v & VALUE_TAG_MASK) == VALUE_TAG_BOOL; }
+static inline int value_is_heap(Value v) { return (v & VALUE_TAG_MASK) == VALUE_TAG_HEAP; }
+
+static inline HeapObject* value_as_heap(Value v) { return (HeapObject*)(uintptr_t)(v & VALUE_PAYLOAD_MASK); }
+static inline Value value_from_heap(HeapObject* object) { return VALUE_TAG_HEAP | (Value)(uintptr_t)object; }
+
+static inline int value_is_bigint(Value v) {
+    return value_is_heap(v) && value_as_heap(v)->kind == HEAP_BIGINT;
+}
+static inline int value_is_int(Value v) {
+    return value_is_small_int(v) ||
+           (value_is_heap(v) && (value_as_heap(v)->kind == HEAP_INT || value_as_heap(v)->kind == HEAP_BIGINT));
+}
+static inline int value_is_string(Value v) {
+    return value_is_heap(v) && value_as_heap(v)->kind == HEAP_STRING;
+}
+static inline int value_is_tensor(Value v) {
+    return value_is_heap(v) && value_as_heap(v)->kind == HEAP_TENSOR;
+}
+static inline int value_is_future(Value v) {
+    return value_is_heap(v) && value_as_heap(v)->kind == HEAP_FUTURE;
+}
+static inline int value_is_number(Value v) { return value_is_double(v) || value_is_int(v); }
+
+static inline double value_as_double(Value v) {
+    double d;
+    memcpy(&d, &v, sizeof(d));
+    return d;
+}
+
+static inline Value value_from_double(double d) {
+    Value v;
+    if (d != d) return VALUE_CANONICAL_NAN;
+    memcpy(&v, &d, sizeof(v));
+    return v;
+}
+
+static inline int value_fits_small_int(int64_t i) { return i >= VALUE_SMALL_INT_MIN && i <= VALUE_SMALL_INT_MAX; }
+static inline int64_t value_small_int(Value v) { return (int64_t)(v << 16) >> 16; }
+static inline Value value_from_small_int(int64_t i) { return VALUE_TAG_INT | ((Value)i & VALUE_PAYLOAD_MASK); }
+
+// Only for ints that are not bigints
+static inline int64_t value_as_int64(Value v) {
+    return value_is_small_int(v) ? value_small_int(v) : ((HeapInt*)value_as_heap(v))->value;
+}
+static inline HeapBigInt* value_as_bigint(Value v) { return (HeapBigInt*)value_as_heap(v); }
+
+static inline int value_int_is_negative(Value v) {
+    return value_is_bigint(v) ? value_as_bigint(v)->negative : value_as_int64(v) < 0;
+}
+
+// Any int, with bigints clamped to INT64_MIN or INT64_MAX (for sizes and indices)
+static inline int64_t value_as_int64_saturated(Value v) {
+    if (!value_is_bigint(v)) return value_as_int64(v);
+    return value_as_bigint(v)->negative ? INT64_MIN : INT64_MAX;
+}
+
+static inline Value value_from_bool(int b) { return b ? VALUE_TRUE : VALUE_FALSE; }
+static inline int value_as_bool(Value v) { return (int)(v & 1); }
+
+static inline const char* value_string_chars(Value v) { return ((HeapString*)value_as_heap(v))->chars; }
+static inline HeapTensor* value_as_tensor(Value v) { return (HeapTensor*)value_as_heap(v); }
+static inline HeapFuture* value_as_future(Value v) { return (HeapFuture*)value_as_heap(v); }
+
+static inline ValueType value_type(Value v) {
+    if (value_is_double(v)) return VALUE_TYPE_DOUBLE;
+    if (value_is_small_int(v)) return VALUE_TYPE_INT;
+    if (value_is_bool(v)) return VALUE_TYPE_BOOL;
+    switch (value_as_heap(v)->kind) {
+        case HEAP_INT:
+        case HEAP_BIGINT: return VALUE_TYPE_INT;
+        case HEAP_STRING: return VALUE_TYPE_STRING;
+        case HEAP_FUTURE: return VALUE_TYPE_FUTURE;
+        default: return VALUE_TYPE_TENSOR;
+    }
+}
+
+// Result type of `left op right`, or -1 if the operands are not both numbers.
+// Compilers use this to type programs statically; it matches value_try_arith.
+// (Tensors and futures only come from built-in calls, which compiled programs reject.)
+static inline int value_arith_type(ValueType left, ValueType right) {
+    if (left == VALUE_TYPE_INT && right == VALUE_TYPE_INT) return VALUE_TYPE_INT;
+    if ((left == VALUE_TYPE_INT || left == VALUE_TYPE_DOUBLE) &&
+        (right == VALUE_TYPE_INT || right == VALUE_TYPE_DOUBLE)) {
+        return VALUE_TYPE_DOUBLE;
+    }
+    return -1;
+}
+
+// --- Runtime entry points (core_runtime.c) ---
+// Integers outside int48 are boxed on the runtime heap
+Value value_box_int64(int64_t i);
+// A copy of chars[0, length) as a string on the runtime heap
+Value value_box_string(const char* chars, size_t length);
+// An int from its sign and magnitude (`length` limbs, least significant
+// first), boxed as whatever kind its value needs
+Value value_from_limbs(int negative, const uint64_t* limbs, size_t length);
+// Parses `length` decimal digits; VALUE_ERROR_RANGE if the int is too long
+ValueStatus value_parse_int(const char* digits, size_t length, Value* result);
+// The double nearest to an int (ties to even), infinite past DBL_MAX
+double value_int_to_double(Value v);
+// Computes `a op b`: int op int is exact (int64 arithmetic that moves to a
+// bigint only when it overflows, truncating division); any double operand
+// makes the result a double. If either operand is a tensor the operation is
+// elementwise with broadcasting (see core_runtime_tensor_binary).
+ValueStatus value_try_arith(ValueOp op, Value a, Value b, Value* result);
+// value_try_arith that reports failures through core_runtime_panic
+Value value_arith(ValueOp op, Value a, Value b);
+const char* value_type_name(ValueType type);
+const char* value_op_symbol(ValueOp op);
+// Writes the printed form of `v` (without a newline) into `buffer`. A
+// future is written as `<prashna>`: formatting never waits.
+void value_format(Value v, char* buffer, size_t size);
+// Prints `v`; a future is awaited and its answer printed
+void value_print(Value v);
+// The runtime heap is the calling thread's context's (see core_runtime.h).
+// Frees every object boxed on it so far
+void value_heap_release(void);
+// Number of objects on the runtime heap
+size_t value_heap_count(void);
+// Frees every object on the runtime heap that none of `roots` refers to. Values
+// held anywhere else (a VM stack, an argument array) are not seen, so callers
+// collect only between statements, and never while another thread allocates.
+void value_heap_collect(const Value* roots, size_t num_roots);
+
+static inline Value value_from_int64(int64_t i) {
+    return value_fits_small_int(i) ? value_from_small_int(i) : value_box_int64(i);
+}
+
+// Any number as a double
+static inline double value_number_as_double(Value v) {
+    if (value_is_double(v)) return value_as_double(v);
+    return value_is_small_int(v) ? (double)value_small_int(v) : value_int_to_double(v);
+}
+
+// --- Arithmetic fast paths ---
+// Small ints and doubles are handled inline; everything else (boxed ints,
+// results outside int48, mixed operands, errors) goes through value_arith.
+static inline Value value_add(Value a, Value b) {
+    if (value_is_small_int(a) && value_is_small_int(b)) {
+        int64_t r = value_small_int(a) + value_small_int(b); // Cannot overflow int64
+        if (value_fits_small_int(r)) return value_from_small_int(r);
+    } else if (value_is_double(a) && value_is_double(b)) {
+        return value_from_double(value_as_double(a) + value_as_double(b));
+    }
+    return value_arith(VALUE_OP_ADD, a, b);
+}
+
+static inline Value value_sub(Value a, Value b) {
+    if (value_is_small_int(a) && value_is_small_int(b)) {
+        int64_t r = value_small_int(a) - value_small_int(b);
+        if (value_fits_small_int(r)) return value_from_small_int(r);
+    } else if (value_is_double(a) && value_is_double(b)) {
+        return value_from_double(value_as_double(a) - value_as_double(b));
+    }
+    return value_arith(VALUE_OP_SUB, a, b);
+}
+
+static inline Value value_mul(Value a, Value b) {
+#if defined(__GNUC__)
+    if (value_is_small_int(a) && value_is_small_int(b)) {
+        int64_t r;
+        if (!__builtin_mul_overflow(value_small_int(a), value_small_int(b), &r) && value_fits_small_int(r)) {
+            return value_from_small_int(r);
+        }
+    } else
+#endif
+    if (value_is_double(a) && value_is_double(b)) {
+        return value_from_double(value_as_double(a) * value_as_double(b));
+    }
+    return value_arith(VALUE_OP_MUL, a, b);
+}
+
+static inline Value value_div(Value a, Value b) {
+    if (value_is_small_int(a) && value_is_small_int(b) && value_small_int(b) != 0) {
+        int64_t r = value_small_int(a) / value_small_int(b);
+        if (value_fits_small_int(r)) return value_from_small_int(r);
+    } else if (value_is_double(a) && value_is_double(b) && value_as_double(b) != 0.0) {
+        return value_from_double(value_as_double(a) / value_as_double(b));
+    }
+    return value_arith(VALUE_OP_DIV, a, b);
+}
+
+#endif // PANLANG_VALUE_H
@@ -0,0 +1,9 @@
+# panlang/tests/checks/command_line.sh
+# An optimization level above -O2 is rejected with the usage
+if "$PANLANGC" -O3 "$TMP/probe.pan" > /dev/null 2> "$TMP/stderr"; then
+    fail "-O3 was accepted"
+elif grep -q "^Usage:" "$TMP/stderr"; then
+    pass
+else
+    fail "-O3 did not print the usage"
+fi
@@ -0,0 +1,20 @@
+# panlang/tests/checks/module_cache.sh
+# The first run compiles and caches each module, later runs map the cached
+# bytecode, and a damaged cache file is recompiled rather than run.
+export PANLANG_CACHE_DIR="$TMP/module-cache"
+MODULES="$ROOT/examples/modules.pan"
+run vm -O1 "$MODULES" > "$TMP/cold"
+cached="$(ls "$PANLANG_CACHE_DIR" | wc -l)"
+run vm -O1 "$MODULES" > "$TMP/warm"
+if [ "$cached" -gt 0 ] && diff -q "$TESTS/examples/modules.out" "$TMP/cold" > /dev/null &&
+   diff -q "$TMP/cold" "$TMP/warm" > /dev/null; then
+    pass
+else
+    fail "module cache runs differ or nothing was cached"
+fi
+for file in "$PANLANG_CACHE_DIR"/*; do
+    head -c 40 "$file" > "$TMP/truncated" && cat "$TMP/truncated" > "$file"
+done
+run vm -O1 "$MODULES" > "$TMP/damaged"
+if diff -q "$TMP/cold" "$TMP/damaged" > /dev/null; then pass; else fail "a damaged cache file was not recompiled"; fi
+export PANLANG_CACHE_DIR="$TMP/cache"
@@ -0,0 +1,34 @@
+# panlang/tests/checks/parallel_parse.sh
+# Sources over 1 MB are parsed in chunks on the thread pool; the program and
+# its first error must be the same as with one thread. Comments and strings
+# with quotes and '#' make sure chunks are only cut between statements.
+awk 'BEGIN {
+    print "total = 0"
+    for (i = 0; i < 40000; i++) {
+        printf "v%d = %d * 3 + total # \"not a string\n", i % 500, i
+        printf "total = v%d - total\n", i % 500
+        if (i % 1000 == 0) printf "s = \"# not a comment\"\n"
+    }
+    print "darshaya(total)"
+    print "darshaya(s)"
+}' > "$TMP/parse.pan"
+cp "$TMP/parse.pan" "$TMP/parse_error.pan"
+echo 'darshaya(total +)' >> "$TMP/parse_error.pan"
+for file in parse parse_error; do
+    PANLANG_THREADS=1 run vm -O1 "$TMP/$file.pan" > "$TMP/serial"
+    for engine in tree vm; do
+        run "$engine" -O1 "$TMP/$file.pan" > "$TMP/parallel"
+        if diff -u "$TMP/serial" "$TMP/parallel" > "$TMP/diff"; then
+            pass
+        else
+            fail "parallel parse of $file.pan ($engine)"
+            cat "$TMP/diff"
+        fi
+    done
+done
+if grep -q "at line $(wc -l < "$TMP/parse_error.pan")," "$TMP/serial"; then
+    pass
+else
+    fail "the parse error is not reported at the last line"
+    cat "$TMP/serial"
+fi
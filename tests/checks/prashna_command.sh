@@ -0,0 +1,19 @@
+# panlang/tests/checks/prashna_command.sh
+# A command backend that quotes each prompt: an answer that starts and ends
+# with a quote must reach the next query unchanged, as prompt and context.
+cat > "$TMP/quote.pan" <<'PAN'
+uttar = Prashna.pratiksha(Prashna.puccha("Kaun?", ""))
+darshaya(uttar)
+darshaya(Prashna.pratiksha(Prashna.puccha(uttar, uttar)))
+PAN
+printf '"Kaun?"\n""Kaun?""\n' > "$TMP/expected"
+for engine in tree vm; do
+    PANLANG_PRASHNA_COMMAND='sed -u '\''s/^\[{"prompt":"\(.*\)","context":".*"}\]$/["\\"\1\\""]/'\' \
+        run "$engine" -O1 "$TMP/quote.pan" > "$TMP/actual"
+    if diff -u "$TMP/expected" "$TMP/actual" > "$TMP/diff"; then
+        pass
+    else
+        fail "quoted prashna answers are changed when asked again ($engine)"
+        cat "$TMP/diff"
+    fi
+done
@@ -0,0 +1,22 @@
+# panlang/tests/checks/profile_cache.sh
+# --profile builds carry line markers, so they get their own module cache
+# files and leave those of normal runs alone.
+export PANLANG_CACHE_DIR="$TMP/profile-cache"
+MODULES="$ROOT/examples/modules.pan"
+run vm -O1 "$MODULES" > "$TMP/cold"
+cached="$(ls "$PANLANG_CACHE_DIR" | wc -l)"
+cksum "$PANLANG_CACHE_DIR"/* > "$TMP/sums"
+run vm -O1 "$MODULES" --profile --profile-out "$TMP/folded" > /dev/null
+run vm -O1 "$MODULES" > "$TMP/after_profile"
+if [ -s "$TMP/folded" ] && diff -q "$TMP/cold" "$TMP/after_profile" > /dev/null; then
+    pass
+else
+    fail "a --profile run changed the output of the next run"
+fi
+if [ "$cached" -gt 0 ] && [ "$(ls "$PANLANG_CACHE_DIR" | wc -l)" -eq $((cached * 2)) ] &&
+   cksum $(awk '{ print $3 }' "$TMP/sums") | diff -q - "$TMP/sums" > /dev/null; then
+    pass
+else
+    fail "--profile runs share or rewrite the cache files of normal runs"
+fi
+export PANLANG_CACHE_DIR="$TMP/cache"
@@ -0,0 +1,35 @@
+# panlang/tests/checks/stream_memory.sh
+# Training steps whose forward pass spans collections, then forward passes
+# without a loss, and a string kept across batches. --stream must print what
+# the tree-walker prints, and the tape must not keep every layer output alive.
+awk 'BEGIN {
+    print "name = \"नमस्ते\""
+    print "x = Matrix.random(16, 8)"
+    print "target = Matrix.zeros(16, 4)"
+    print "w = Buddhimatta.Param(Matrix.random(8, 4) / 4)"
+    print "b = Buddhimatta.Param(Matrix.zeros(1, 4))"
+    for (i = 1; i <= 8000; i++) {
+        print "y = Buddhimatta.Tanh(Buddhimatta.GhanaSthara(x, w, b))"
+        if (i % 2000 == 0) print "Buddhimatta.MSE(y, target)\ndarshaya(Buddhimatta.Step())"
+    }
+    for (i = 1; i <= 20000; i++) print "y = Buddhimatta.Tanh(Buddhimatta.GhanaSthara(x, w, b))"
+    print "darshaya(Matrix.sum(y))"
+    print "darshaya(name)"
+}' > "$TMP/stream.pan"
+run tree -O1 "$TMP/stream.pan" > "$TMP/tree"
+run stream -O1 "$TMP/stream.pan" > "$TMP/stream"
+if diff -u "$TMP/tree" "$TMP/stream" > "$TMP/diff"; then
+    pass
+else
+    fail "--stream output differs from the tree-walker"
+    cat "$TMP/diff"
+fi
+run stream -O1 "$TMP/stream.pan" --mem-stats > /dev/null
+# Pinned, the 20000 outputs and their records would take about 30 MB
+peak="$(awk '$1 == "values" || $1 == "autodiff" { peak += $4 } END { print peak + 0 }' "$TMP/stderr")"
+if [ "$peak" -gt 0 ] && [ "$peak" -lt 8388608 ]; then
+    pass
+else
+    fail "tensors and the autodiff tape peaked at $peak bytes under --stream"
+fi
+if grep -q "^No leaks" "$TMP/stderr"; then pass; else fail "--stream leaked memory"; fi
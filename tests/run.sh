@@ -0,0 +1,139 @@
+#!/bin/bash
+# panlang/tests/run.sh
+# Runs examples/*.pan and the focused cases in tests/cases under every engine
+# (tree-walker, VM, LLVM and --stream) at -O0, -O1 and -O2, and compares the
+# output with the expected files. Then sources tests/checks/*.sh, the checks
+# that need generated input or several runs.
+#
+#   tests/run.sh [--update] [path/to/panlangc]
+#
+# Without a path the engine is built into a temporary directory, with LLVM
+# when llvm-config is available; the llvm engine is skipped for builds
+# without it. A case names its engines on a "# engines:" line (default: all
+# four). Its expected output is cases/<name>.out, or cases/<name>.<engine>.out
+# for an engine whose output differs. The output compared is what follows
+# "--- Execution Results ---" on stdout, then stderr, then "[exit N]" if the
+# run failed. --update rewrites cases/<name>.out and examples/<name>.out from
+# the tree-walker at -O1. A check script may use run, pass and fail, and
+# keeps its files in $TMP.
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+TESTS="$ROOT/tests"
+UPDATE=0
+if [ "$1" = "--update" ]; then
+    UPDATE=1
+    shift
+fi
+
+TMP="$(mktemp -d)"
+trap 'rm -rf "$TMP"' EXIT
+
+PANLANGC="$1"
+if [ -z "$PANLANGC" ]; then
+    PANLANGC="$TMP/panlangc"
+    SOURCES=("$ROOT/src/main.c" "$ROOT/src/backend/c_backend.c" "$ROOT/src/runtime/core_runtime.c")
+    if command -v llvm-config > /dev/null &&
+       gcc -O2 -pthread -DPANLANG_WITH_LLVM $(llvm-config --cflags) -o "$PANLANGC" "${SOURCES[@]}" \
+           "$ROOT/src/backend/llvm_backend.c" $(llvm-config --ldflags --libs) -lm 2> "$TMP/build.log"; then
+        :
+    elif ! gcc -O2 -pthread -o "$PANLANGC" "${SOURCES[@]}" -lm 2> "$TMP/build.log"; then
+        cat "$TMP/build.log"
+        exit 1
+    fi
+fi
+
+# Results must not depend on the CPU, the thread count or the batch timing
+export PANLANG_KERNELS=scalar
+export PANLANG_DETERMINISTIC=1
+export PANLANG_THREADS=4
+export PANLANG_PRASHNA_WINDOW_MS=60000
+export PANLANG_CACHE_DIR="$TMP/cache"
+unset PANLANG_PRASHNA_COMMAND PANLANG_PRASHNA_BATCH PANLANG_PRASHNA_MOCK_LATENCY_MS
+
+ENGINES="tree vm llvm stream"
+echo 'darshaya(1)' > "$TMP/probe.pan"
+if "$PANLANGC" --llvm "$TMP/probe.pan" 2>&1 | grep -q "without LLVM support"; then
+    echo "note: $PANLANGC was built without LLVM; skipping the llvm engine"
+    ENGINES="tree vm stream"
+fi
+
+PASSED=0
+FAILED=0
+
+pass() {
+    PASSED=$((PASSED + 1))
+}
+
+fail() {
+    FAILED=$((FAILED + 1))
+    echo "FAIL: $1"
+}
+
+# run <engine> <opt> <file> [flags...]: the output to compare, on stdout
+run() {
+    local engine="$1" opt="$2" file="$3"
+    shift 3
+    local flags=()
+    case "$engine" in
+        vm) flags=(--vm) ;;
+        llvm) flags=(--llvm) ;;
+        stream) flags=(--stream) ;;
+    esac
+    "$PANLANGC" "$opt" "${flags[@]}" "$@" "$file" > "$TMP/stdout" 2> "$TMP/stderr"
+    local status=$?
+    awk 'found { lines[n++] = $0 }
+         /^--- Execution Results ---$/ { found = 1 }
+         END {
+             while (n > 0 && (lines[n - 1] == "" || lines[n - 1] ~ /^Streamed [0-9]+ statements\.$/)) n--
+             for (i = 0; i < n; i++) print lines[i]
+         }' "$TMP/stdout"
+    cat "$TMP/stderr"
+    if [ "$status" -ne 0 ]; then
+        echo "[exit $status]"
+    fi
+}
+
+# check <file> <expected dir> <engines>
+check() {
+    local file="$1" dir="$2" engines="$3"
+    local name
+    name="$(basename "$file" .pan)"
+    if [ "$UPDATE" -eq 1 ]; then
+        run tree -O1 "$file" > "$dir/$name.out"
+    fi
+    for engine in $engines; do
+        case " $ENGINES " in
+            *" $engine "*) ;;
+            *) continue ;;
+        esac
+        local expected="$dir/$name.$engine.out"
+        [ -f "$expected" ] || expected="$dir/$name.out"
+        for opt in -O0 -O1 -O2; do
+            run "$engine" "$opt" "$file" > "$TMP/actual"
+            if diff -u "$expected" "$TMP/actual" > "$TMP/diff"; then
+                pass
+            else
+                fail "$name ($engine $opt)"
+                cat "$TMP/diff"
+            fi
+        done
+    done
+}
+
+# --- Expected output ---
+for file in "$ROOT"/examples/*.pan; do
+    check "$file" "$TESTS/examples" "tree vm llvm stream"
+done
+for file in "$TESTS"/cases/*.pan; do
+    engines="$(sed -n 's/^# engines: *//p' "$file" | head -n 1)"
+    check "$file" "$TESTS/cases" "${engines:-tree vm llvm stream}"
+done
+
+# --- Generated checks ---
+for script in "$TESTS"/checks/*.sh; do
+    [ -f "$script" ] || continue
+    . "$script"
+done
+
+echo "passed: $PASSED, failed: $FAILED"
+[ "$FAILED" -eq 0 ]